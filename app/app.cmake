@@ -21,4 +21,20 @@ set( INC_DIR__APP "")
 GET_SUBDIR( INC_DIR__APP ${PRJ_TOP}/app)
 
 list(APPEND INC_LIST ${PRJ_TOP}/app)
-list(APPEND INC_LIST ${INC_DIR__APP})
\ No newline at end of file
+list(APPEND INC_LIST ${INC_DIR__APP})
+
+# The keyword hash of the command box follows `APP_CMDBOX_LIST`. The generated header is committed
+# and only verified here, so a build without Python still works and `make clean` leaves it alone.
+find_package( Python3 COMPONENTS Interpreter QUIET)
+if( Python3_Interpreter_FOUND)
+    add_custom_command( OUTPUT              "${CMAKE_BINARY_DIR}/app_cmdbox_hash.stamp"
+                        COMMAND             ${Python3_EXECUTABLE} "${PRJ_TOP}/tool/cmdbox.py" --check
+                                            --input  "${PRJ_TOP}/app/include/app_cmdbox.h"
+                                            --output "${PRJ_TOP}/app/include/app_cmdbox_hash.h"
+                        COMMAND             ${CMAKE_COMMAND} -E touch "${CMAKE_BINARY_DIR}/app_cmdbox_hash.stamp"
+                        DEPENDS             "${PRJ_TOP}/app/include/app_cmdbox.h"
+                                            "${PRJ_TOP}/app/include/app_cmdbox_hash.h"
+                                            "${PRJ_TOP}/tool/cmdbox.py"
+                        COMMENT             "Checking the command box keyword hash")
+    add_custom_target( app_cmdbox_hash ALL DEPENDS "${CMAKE_BINARY_DIR}/app_cmdbox_hash.stamp")
+endif()
@@ -20,6 +20,8 @@
 /* ************************************************************************** */
 /*                                  Includes                                  */
 /* ************************************************************************** */
+#define TRACE_MODULE  APP_CLOCK
+#include <string.h>
 #include "global.h"
 #include "assert.h"
 #include "trace.h"
@@ -29,6 +31,7 @@
 #include "app_lvgl.h"
 #include "app_clock.h"
 #include "cmn_utility.h"
+#include "cmn_math.h"
 #include "cmn_color.h"
 #include "app_gui_asset"
 #include "bsp_rtc.h"
@@ -168,8 +171,8 @@ static void analogclk_inc_time(tAppGuiClockParam *pClient, tAnalogClockInternalP
   uint16_t hour_inc, minute_inc;
   cmn_utility_angleinc( &params->_rem_hour, &params->_rem_minute, NULL, &hour_inc, &minute_inc, NULL, ms);
   
-  params->_degree_hour += hour_inc;
-  params->_degree_minute += minute_inc;
+  params->_degree_hour   = cmn_math_wrap3600( params->_degree_hour   + hour_inc);
+  params->_degree_minute = cmn_math_wrap3600( params->_degree_minute + minute_inc);
 
   /**
    * @note
@@ -228,12 +231,8 @@ static void analogclk_inc_time(tAppGuiClockParam *pClient, tAnalogClockInternalP
  * @addtogroup NotThreadSafe
  */
 static void analogclk_idle(tAppGuiClockParam *pClient, tAnalogClockInternalParam *params){
-  if(params->_degree_hour > 3600){
-    params->_degree_hour %= 3600;
-  }
-  if(params->_degree_minute > 3600){
-    params->_degree_minute %= 3600;
-  }
+  params->_degree_hour   = cmn_math_mod3600( params->_degree_hour);
+  params->_degree_minute = cmn_math_mod3600( params->_degree_minute);
 }
 
 
@@ -1864,6 +1863,156 @@ void app_clock_idle(void *param) RTOSIDLE APP_CLOCK_GLOBAL{
 }
 
 
+#if ((defined BENCH_RENDER) && (BENCH_RENDER==1)) || ((defined UNIT_TEST) && (UNIT_TEST==1))
+/**
+ * @brief Bring up one clock style outside of the clock task, as the starting point of a benchmark
+ * @note  The style is rendered once at 2022/01/01 00:00:00.
+ * @param [in] p_app_clock - Clock application handle
+ * @param [in] x           - Clock style
+ * @addtogroup NotThreadSafe
+ */
+void app_clock_bench_open(tAppClock *p_app_clock, AppGuiClockEnum_t x) APP_CLOCK_GLOBAL{
+  cmnDateTime_t time = {.word = 0};
+  time.month = 1;
+  time.day   = 1;
+
+  p_app_clock->style = x;
+  app_clock_gui_ctrl_switch(p_app_clock, x);
+  app_clock_gui_ctrl_init(&p_app_clock->param, p_app_clock->func.init);
+  app_clock_gui_ctrl_flush(&p_app_clock->param, NULL);
+  p_app_clock->func.set_time(&p_app_clock->param, time.word);
+  lv_refr_now(NULL);
+}
+
+/**
+ * @brief Force the battery level shown by the opened clock style
+ * @param [in] p_app_clock            - Clock application handle
+ * @param [in] battery_percentage_256 - Battery Percentage in the scale of 256
+ * @return Return `false` if the style does NOT display the battery
+ * @addtogroup NotThreadSafe
+ */
+cmnBoolean_t app_clock_bench_set_battery(tAppClock *p_app_clock, uint8_t battery_percentage_256) APP_CLOCK_GLOBAL{
+  if( p_app_clock->style!=kAppGuiClock_ClockModern ){
+    return false;
+  }
+  BaseType_t ret = xSemaphoreTake(p_app_clock->param.customized._semphr, portMAX_DELAY);
+  ASSERT(ret==pdTRUE, "Data was NOT obtained");
+  ui_clockmodern_set_battery((tClockModernInternalParam *)p_app_clock->param.customized.p_anything, battery_percentage_256);
+  xSemaphoreGive(p_app_clock->param.customized._semphr);
+  return true;
+}
+
+/**
+ * @brief Release the clock style opened by `app_clock_bench_open()`
+ * @addtogroup NotThreadSafe
+ */
+void app_clock_bench_close(tAppClock *p_app_clock) APP_CLOCK_GLOBAL{
+  app_clock_gui_ctrl_deinit(&p_app_clock->param, p_app_clock->func.deinit);
+}
+#endif
+
+
+#if (defined BENCH_RENDER) && (BENCH_RENDER==1)
+
+#define BENCH_RENDER_DURATION_MS  (24U*3600U*1000U)
+#define BENCH_RENDER_RESYNC_MS    (3600U*1000U)
+
+/**
+ * @brief Free running cycle counter for the render benchmark
+ * @note  DWT is NOT modelled by QEMU. The emulator derives cycles from the RTOS tick and SysTick instead.
+ * @addtogroup MachineDependent
+ */
+static inline uint32_t app_clock_bench_cycle(void){
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6)
+  return DWT->CYCCNT;
+#else
+  TickType_t tick;
+  uint32_t   val;
+  do{
+    tick = xTaskGetTickCount();
+    val  = SysTick->VAL;
+  }while(tick!=xTaskGetTickCount());
+  return tick*(SysTick->LOAD+1) + (SysTick->LOAD-val);
+#endif
+}
+
+/**
+ * @brief Accelerated 24h render benchmark of one clock style
+ * @note  The clock starts from 2022/01/01 00:00:00 and is advanced by `step_ms` until one simulated day
+ *        has escaped. A `set_time()` is issued every hour to mimic `CMN_EVENT_UPDATE_RTC` and the idle
+ *        program is called every `DEFAULT_IDLE_TASK_PERIOD`. Each step is rendered by `lv_refr_now()`.
+ * @note  Heap figures are ONLY valid when the scheduler is running, ie. `MALLOC()` goes to the RTOS heap.
+ * @param [in]  p_app_clock - Clock application handle
+ * @param [in]  x           - Clock style to be measured
+ * @param [in]  step_ms     - Simulated time per frame
+ * @param [out] result      - Benchmark result
+ * @addtogroup NotThreadSafe
+ */
+void app_clock_bench_render(tAppClock *p_app_clock, AppGuiClockEnum_t x, uint32_t step_ms, tAppClockBench *result) APP_CLOCK_GLOBAL{
+  tAppLvglStat  *p_stat = &metope.app.lvgl.stat;
+  cmnDateTime_t  time   = {.word = 0};
+  uint32_t       ms_rem = 0;
+  uint32_t       idle_ms = 0;
+
+  ASSERT( step_ms>0, "Benchmark step can NOT be zero");
+
+  time.month = 1;
+  time.day   = 1;
+
+  memset(result, 0, sizeof(*result));
+  result->step_ms        = step_ms;
+  result->render_cyc_min = UINT32_MAX;
+  result->heap_min_free  = xPortGetFreeHeapSize();
+
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6)
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT       = 0;
+  DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+  app_clock_bench_open(p_app_clock, x);
+
+  memset(p_stat, 0, sizeof(*p_stat));
+
+  for(uint32_t escaped_ms=step_ms; escaped_ms<=BENCH_RENDER_DURATION_MS; escaped_ms+=step_ms){
+    uint32_t cyc = app_clock_bench_cycle();
+
+    cmn_utility_timeinc(&ms_rem, &time, step_ms);
+    if( escaped_ms % BENCH_RENDER_RESYNC_MS < step_ms ){
+      p_app_clock->func.set_time(&p_app_clock->param, time.word);
+    }else{
+      p_app_clock->func.inc_time(&p_app_clock->param, step_ms);
+    }
+
+    idle_ms += step_ms;
+    if( idle_ms >= DEFAULT_IDLE_TASK_PERIOD && p_app_clock->func.idle ){
+      idle_ms = 0;
+      p_app_clock->func.idle(&p_app_clock->param);
+    }
+
+    lv_tick_inc(step_ms);
+    lv_refr_now(NULL);
+
+    cyc = app_clock_bench_cycle() - cyc;
+
+    result->num_frame      += 1;
+    result->render_cyc_sum += cyc;
+    result->render_cyc_min  = CMN_MIN(result->render_cyc_min, cyc);
+    result->render_cyc_max  = CMN_MAX(result->render_cyc_max, cyc);
+    result->heap_min_free   = CMN_MIN(result->heap_min_free, xPortGetFreeHeapSize());
+  }
+
+  result->num_flush          = p_stat->num_flush;
+  result->num_pixel          = p_stat->num_pixel;
+  result->num_spi_byte       = p_stat->num_spi_byte;
+  result->heap_min_ever_free = xPortGetMinimumEverFreeHeapSize();
+
+  app_clock_bench_close(p_app_clock);
+}
+
+#endif
+
+
 #ifdef __cplusplus
 }
 #endif
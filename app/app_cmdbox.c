@@ -20,11 +20,11 @@
 /* ************************************************************************** */
 /*                                  Includes                                  */
 /* ************************************************************************** */
+#define TRACE_MODULE  APP_CMDBOX
 #include <string.h>
-#include <stdlib.h>
 #include <stdarg.h>
 #include <stdbool.h>
-#include <ctype.h>
+#include <stddef.h>
 #include "assert.h"
 #include "trace.h"
 #if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
@@ -34,102 +34,88 @@
   #include <unistd.h>
 #endif
 #include "bsp_type.h"
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  #include "bsp_uart.h"
+#else
+  #include <stdio.h>
+#endif
+#include "cmn_frame.h"
+#include "cmn_utility.h"
 #include "app_cmdbox.h"
+#include "app_cmdbox_hash.h"
 #include "app_cmdbox_callback.h" /*!< This must be included at the end of the header file list */
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* ************************************************************************** */
+/*                               Private Macros                               */
+/* ************************************************************************** */
+/**
+ * @note FNV-1a over the upper case keyword. Must match `hash_keyword()` in `tool/cmdbox.py`.
+ */
+#define APP_CMDBOX_HASH_STEP( h, c)   (((h) ^ (uint8_t)(c)) * 0x01000193U)
+#define APP_CMDBOX_HASH_SLOT( h)      ((h) >> (32U-APP_CMDBOX_HASH_BITS))
+#define APP_CMDBOX_TO_UPPER( c)       (((c) >= 'a' && (c) <= 'z') ? (char)((c) - 'a' + 'A') : (c))
 
+#define APP_CMDBOX_REPLY_LEN          (48)
 
-
-
-
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  /* Kept across a reset. See the `.noinit` section of the linker script */
+  #define APP_CMDBOX_MACRO_SECTION    __attribute__((section(".noinit")))
+  #define APP_CMDBOX_NOW_MS()         ((uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS))
+#else
+  #define APP_CMDBOX_MACRO_SECTION
+#endif
 
 
 /* ************************************************************************** */
 /*                             Private Variables                              */
 /* ************************************************************************** */
-static const tAppCmdboxDatabaseList CMD_DUMMY = {
-  .database = NULL,
-  .len      = 0
-};
-
-static const tAppCmdboxDatabaseListUnit CMD_C_LIST[] = {
-  {
-    .keyword  = "CCW",
-    .callback = app_cmdbox_callback_1args_CCW,
-    .nargs    = 1
-  },
-  {
-    .keyword  = "CW",
-    .callback = app_cmdbox_callback_1args_CW,
-    .nargs    = 1
-  }
-};
-static const tAppCmdboxDatabaseList CMD_C = {
-  .database = &CMD_C_LIST[0],
-  .len      = sizeof(CMD_C_LIST)/sizeof(tAppCmdboxDatabaseListUnit)
-};
-static const tAppCmdboxDatabaseListUnit CMD_D_LIST[] = {
-  {
-    .keyword  = "DISPBR",
-    .callback = app_cmdbox_callback_1args_DISPBR,
-    .nargs    = 1
-  },
-  {
-    .keyword  = "DISPOFF",
-    .callback = app_cmdbox_callback_0args_DISPOFF,
-    .nargs    = 0
+#define APP_CMDBOX_LIST_UNIT( KEYWORD, NARGS)             \
+  {                                                         \
+    .keyword  = #KEYWORD,                                   \
+    .callback = app_cmdbox_callback_##NARGS##args_##KEYWORD,\
+    .nargs    = NARGS                                       \
   },
-  {
-    .keyword  = "DISPON",
-    .callback = app_cmdbox_callback_0args_DISPON,
-    .nargs    = 0
-  }
-};
-static const tAppCmdboxDatabaseList CMD_D = {
-  .database = &CMD_D_LIST[0],
-  .len      = sizeof(CMD_D_LIST)/sizeof(tAppCmdboxDatabaseListUnit)
-};
-static const tAppCmdboxDatabaseListUnit CMD_G_LIST[] = {
-  {
-    .keyword  = "GT",
-    .callback = app_cmdbox_callback_0args_GT,
-    .nargs    = 0
-  }
-};
-static const tAppCmdboxDatabaseList CMD_G = {
-  .database = &CMD_G_LIST[0],
-  .len      = sizeof(CMD_G_LIST)/sizeof(tAppCmdboxDatabaseListUnit)
-};
-static const tAppCmdboxDatabaseListUnit CMD_S_LIST[] = {
-  {
-    .keyword  = "ST",
-    .callback = app_cmdbox_callback_6args_ST,
-    .nargs    = 6
-  }
-};
-static const tAppCmdboxDatabaseList CMD_S = {
-  .database = &CMD_S_LIST[0],
-  .len      = sizeof(CMD_S_LIST)/sizeof(tAppCmdboxDatabaseListUnit)
+static const tAppCmdboxDatabaseListUnit CMD_LIST[] = {
+  APP_CMDBOX_LIST( APP_CMDBOX_LIST_UNIT)
 };
+#undef APP_CMDBOX_LIST_UNIT
+
+_Static_assert( sizeof(CMD_LIST)/sizeof(CMD_LIST[0]) == APP_CMDBOX_HASH_NUM, "`app_cmdbox_hash.h` is out of date. Run `tool/cmdbox.py`.");
 
-static const tAppCmdboxDatabaseList *CMD_TABLE[] = {
-  [('A'-'A') ... ('B'-'A')] = &CMD_DUMMY,
-  [('C'-'A')]               = &CMD_C,
-  [('D'-'A')]               = &CMD_D,
-  [('E'-'A') ... ('F'-'A')] = &CMD_DUMMY,
-  [('G'-'A')]               = &CMD_G,
-  [('H'-'A') ... ('R'-'A')] = &CMD_DUMMY,
-  [('S'-'A')]               = &CMD_S,
-  [('T'-'A') ... ('Z'-'A')] = &CMD_DUMMY
+#define APP_CMDBOX_LIST_INDEX( KEYWORD, NARGS)   kAppCmdbox_##KEYWORD,
+enum {
+  APP_CMDBOX_LIST( APP_CMDBOX_LIST_INDEX)
+  kNumAppCmdbox
 };
+#undef APP_CMDBOX_LIST_INDEX
+
+#define APP_CMDBOX_LIST_NARGS( KEYWORD, NARGS)   _Static_assert( NARGS <= APP_CMDBOX_MACRO_NARGS, "`" #KEYWORD "` has more arguments than a macro step holds");
+APP_CMDBOX_LIST( APP_CMDBOX_LIST_NARGS)
+#undef APP_CMDBOX_LIST_NARGS
+#define APP_CMDBOX_LIST_WRAPPER( KEYWORD, NARGS)  _Static_assert( NARGS==0 || NARGS==1 || NARGS==2 || NARGS==6, "`" #KEYWORD "` has no `app_cmdbox_callback_wrapper`");
+APP_CMDBOX_LIST( APP_CMDBOX_LIST_WRAPPER)
+#undef APP_CMDBOX_LIST_WRAPPER
+_Static_assert( kNumAppCmdbox < APP_CMDBOX_MACRO_WAIT, "A macro step holds the command index in a byte");
+_Static_assert( APP_CMDBOX_MACRO_STEP_NUM < MAX_NUM_PENDING, "A pass of a macro MUST fit in the ring");
 
-// static char rx_buf_copy[BSP_CFG_UART_RX_BUF_SIZE];
+/**
+ * @note The bank of the command box task. See `app_cmdbox_macro_init()`.
+ */
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+static tAppCmdboxMacroBank macro_bank APP_CMDBOX_MACRO_SECTION;
+#endif
+#define APP_CMDBOX_FRAME_HANDLER( NAME, TYPE)   [TYPE] = app_cmdbox_frame_##NAME,
+static tAppCmdboxFrameHandler frame_handler[APP_CMDBOX_FRAME_TYPE_NUM] = {
+  APP_CMDBOX_FRAME_LIST( APP_CMDBOX_FRAME_HANDLER)
+};
+#undef APP_CMDBOX_FRAME_HANDLER
 
-// static tAppCmdBoxPendingExe pending_exe[MAX_NUM_PENDING] = {0};
+_Static_assert( (MAX_NUM_PENDING & (MAX_NUM_PENDING-1)) == 0, "MAX_NUM_PENDING must be a power of 2");
+_Static_assert( MAX_NUM_PENDING*2 >= MAX_CMD_STRING_LEN, "Every command of the longest line MUST fit in the ring");
 
 
 int app_cmdbox_callback_wrapper_0args(const char *cmd, int(*callback)(const char *, ...), int *args) {
@@ -178,51 +164,166 @@ static cmnBoolean_t app_cmdbox_string_is_enter(char c) {
   return app_cmdbox_string_is_LF(c) || app_cmdbox_string_is_CR(c) || app_cmdbox_string_is_NULL(c);
 }
 
-static cmnBoolean_t app_cmdbox_string_is_SP(char c) {
-  return (c == '\x20');
+static cmnBoolean_t app_cmdbox_string_is_separator(char c) {
+  return app_cmdbox_string_is_enter(c) || (c == ';');
 }
 
-static cmnBoolean_t app_cmdbox_string_is_digit(char c) {
-  return (0x00 != isdigit(c));
+static cmnBoolean_t app_cmdbox_string_is_blank(char c) {
+  return app_cmdbox_string_is_separator(c) || (c == '\x20');
 }
 
 
-static size_t app_cmdbox_string_skip_until(const char *cmd, tAppCmnBoxStrCmpFunc comparator, cmnBoolean_t reversed, const char *p_end) {
+/**
+ * @brief Send bytes through the reply channel
+ * @note  The console is the UART transmit ring on target and stdout on native.
+ */
+static void app_cmdbox_tx(tAppCmdBox *p_cmdbox, const void *data, size_t len) {
+  if (p_cmdbox->tx != NULL) {
+    p_cmdbox->tx(data, len);
+    return;
+  }
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  bsp_uart_write(data, len);
+#else
+  fwrite(data, 1, len, stdout);
+#endif
+}
+
+/**
+ * @brief Send one reply line. Same format as `cmn_utility_vsnprintf()`.
+ */
+static void app_cmdbox_reply(tAppCmdBox *p_cmdbox, const char *format, ...) {
+  if (p_cmdbox->quiet) {
+    return;
+  }
+  char    buf[APP_CMDBOX_REPLY_LEN];
+  va_list va;
+  va_start(va, format);
+  int len = cmn_utility_vsnprintf(buf, sizeof(buf), format, va);
+  va_end(va);
+  if (len > 0) {
+    buf[len-1] = '\n';
+    app_cmdbox_tx(p_cmdbox, buf, (size_t)len);
+  }
+}
+
+/**
+ * @brief Commands driving the macros. They run while recording.
+ */
+static bool app_cmdbox_macro_is_control(const tAppCmdboxDatabaseListUnit *p_cmd) {
+  switch (p_cmd - CMD_LIST) {
+    case kAppCmdbox_MCLR:
+    case kAppCmdbox_MEND:
+    case kAppCmdbox_MLS:
+    case kAppCmdbox_MPLAY:
+    case kAppCmdbox_MREC:
+    case kAppCmdbox_MSTOP:
+    case kAppCmdbox_MWAIT:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static uint32_t app_cmdbox_macro_crc(const tAppCmdboxMacroBank *bank) {
+  const size_t offset = offsetof(tAppCmdboxMacroBank, len);
+  return cmn_frame_crc16((const uint8_t *)bank + offset, sizeof(*bank) - offset, CMN_FRAME_CRC16_INIT);
+}
+
+static void app_cmdbox_macro_seal(tAppCmdboxMacroBank *bank) {
+  bank->magic = APP_CMDBOX_MACRO_MAGIC;
+  bank->crc   = app_cmdbox_macro_crc(bank);
+}
+
+/**
+ * @brief Store one step into the macro being recorded
+ * @return Index of the step. `-1` when the macro is full.
+ */
+static int app_cmdbox_macro_append(tAppCmdBox *p_cmdbox, const tAppCmdboxDatabaseListUnit *p_cmd, const arg_t *args) {
+  tAppCmdboxMacro *p_macro = &p_cmdbox->macro;
+  if (p_macro->rec_len >= APP_CMDBOX_MACRO_STEP_NUM) {
+    return -1;
+  }
+  tAppCmdboxMacroStep *p_step = &p_macro->bank->step[p_macro->rec-1][p_macro->rec_len];
+  memset(p_step, 0, sizeof(*p_step));
+  p_step->index = (p_cmd == NULL) ? APP_CMDBOX_MACRO_WAIT : (uint8_t)(p_cmd - CMD_LIST);
+  memcpy(p_step->args, args, ((p_cmd == NULL) ? 1 : p_cmd->nargs) * sizeof(arg_t));
+  app_cmdbox_macro_seal(p_macro->bank);
+  return p_macro->rec_len++;
+}
+
+static size_t app_cmdbox_string_skip_until(const char *cmd, tAppCmnBoxStrCmpFunc comparator, cmnBoolean_t reversed) {
   size_t cursor = 0;
-  while ( ((true == comparator(cmd[cursor])) ^ reversed) && (&cmd[cursor] != p_end)) {
+  while ( ((true == comparator(cmd[cursor])) ^ reversed) && (cmd[cursor] != '\0')) {
     ++cursor;
   }
   return cursor;
 }
 
-static size_t app_cmdbox_parse_search(const char *cmd, const tAppCmdboxDatabaseListUnit **pp_matched_cmd) {
+/**
+ * @brief Tokenize one command in a single pass
+ * @note  The keyword is hashed while it is scanned and ends at a space, a `;` or the end of the line.
+ *        The perfect hash gives the only candidate, which is confirmed by one comparison, so a
+ *        prefix or an extension of a keyword is unknown. Arguments are decimal and accumulated
+ *        as the digits are scanned. A missing argument is `0`.
+ * @param [in]  cmd            - Command string. Terminated by `;`, `\r`, `\n` or `\0`.
+ * @param [out] pp_matched_cmd - Matched command. `NULL` when it is unknown.
+ * @param [out] args           - At least `MAX_NUN_ARGS_SUPPORTED` arguments. Untouched when it is unknown.
+ * @return Number of characters scanned, up to the end of the last argument taken.
+ */
+size_t app_cmdbox_tokenize(const char *cmd, const tAppCmdboxDatabaseListUnit **pp_matched_cmd, arg_t *args) {
+  size_t   cursor = 0;
+  uint32_t hash   = APP_CMDBOX_HASH_SEED;
+  char     c;
+
+  /* Characters are tested in place. This runs once per received character. */
+  while ((c = cmd[cursor]) != '\x20' && c != ';' && c != '\r' && c != '\n' && c != '\0') {
+    hash = APP_CMDBOX_HASH_STEP( hash, APP_CMDBOX_TO_UPPER(c));
+    ++cursor;
+  }
+
   const tAppCmdboxDatabaseListUnit *p_matched_cmd = NULL;
-  size_t                           cursor         = 0;
-
-  if (isalpha((int)cmd[0]) && cmd[0] >= 'A') {
-    const tAppCmdboxDatabaseList *cmd_database_list = CMD_TABLE[cmd[cursor]-'A'];
-    /* Search if command was supported */
-    const char *ptr   = NULL;
-    for( int i = 0; i < cmd_database_list->len; ++i){
-      ptr = strstr( &cmd[cursor], cmd_database_list->database[i].keyword);
-      if (ptr == &cmd[cursor]) {
-        p_matched_cmd = &cmd_database_list->database[i];
-        TRACE_INFO("Received user command: [%s]", &cmd[cursor]);
-        cursor = strlen(cmd_database_list->database[i].keyword);
-        break;
-      }
+  const uint8_t                     index         = APP_CMDBOX_HASH_TABLE[APP_CMDBOX_HASH_SLOT(hash)];
+  if (index != 0) {
+    const char *keyword = CMD_LIST[index-1].keyword;
+    size_t      i       = 0;
+    while (i < cursor && keyword[i] == APP_CMDBOX_TO_UPPER(cmd[i])) {
+      ++i;
+    }
+    if (i == cursor && keyword[i] == '\0') {
+      p_matched_cmd = &CMD_LIST[index-1];
     }
   }
-  ASSERT( (!p_matched_cmd) || (p_matched_cmd->callback), "Found a command with a null callback" );
+
   *pp_matched_cmd = p_matched_cmd;
+  if (NULL == p_matched_cmd) {
+    return cursor;
+  }
+
+  ASSERT( (p_matched_cmd->callback), "Found a command with a null callback" );
+  ASSERT( p_matched_cmd->nargs <= MAX_NUN_ARGS_SUPPORTED, "Too many arguments.");
+  for (size_t i = 0; i < p_matched_cmd->nargs; ++i) {
+    while (cmd[cursor] == '\x20') {
+      ++cursor;
+    }
+    uint32_t value = 0;
+    uint32_t digit;
+    while ((digit = (uint32_t)(uint8_t)cmd[cursor] - '0') < 10U) {
+      value = value*10U + digit;
+      ++cursor;
+    }
+    args[i] = (arg_t)value;
+  }
   return cursor;
 }
 
 /**
- * @brief Parse the user commands
+ * @brief Parse the user commands and queue them for `app_cmdbox_exe()`
  * @attention
  *  - `cmd` MUST be a null terminated string
- *  - `cmd` MUST follow this pattern: {<str> [int1] ... <\r|\n>  <\0>}
+ *  - `cmd` MUST follow this pattern: {<str> [int1] ... [; <str> [int1] ...] <\r|\n>  <\0>}
+ *  - `cmd` is NOT modified. Keywords are case insensitive.
+ * @note  A command that is unknown or finds the ring full is answered at once. See `tAppCmdBox`.
  * @param [in] cmd - User Command
  */
 void app_cmdbox_parse(tAppCmdBox *p_cmdbox, const char *cmd) {
@@ -230,94 +331,358 @@ void app_cmdbox_parse(tAppCmdBox *p_cmdbox, const char *cmd) {
     return;
   }
 
-  char        *cmd_copy = p_cmdbox->cmd_buf;
-  char * const cmd_end  = stpncpy(cmd_copy, cmd, BSP_CFG_UART_RX_BUF_SIZE);
-
-  ASSERT( (*cmd_end == '\0'), "Command string must be null terminated!!");
-
-  for ( int i = 0; cmd_copy[i] != '\0'; ++i) {
-    if (cmd_copy[i] == '\r' || cmd_copy[i] == '\n') {
-      cmd_copy[i] = '\0';
-    }else {
-      cmd_copy[i] = toupper(cmd_copy[i]);
-    }
-  }
-
   size_t cursor = 0;
 
   while (1) {
-    /* Skip escaping charactors */
-    cursor += app_cmdbox_string_skip_until(&cmd_copy[cursor], app_cmdbox_string_is_enter, false, cmd_end);
-    
-    if (&cmd_copy[cursor] == cmd_end) {
+    /* Skip escaping charactors and empty commands */
+    cursor += app_cmdbox_string_skip_until(&cmd[cursor], app_cmdbox_string_is_blank, false);
+
+    if (cmd[cursor] == '\0') {
       break;
     }
 
     const tAppCmdboxDatabaseListUnit *p_matched_cmd = NULL;
+    arg_t                             args[MAX_NUN_ARGS_SUPPORTED] = {0};
+    const uint32_t                    seq = p_cmdbox->seq++;
 
-    cursor += app_cmdbox_parse_search(&cmd_copy[cursor], &p_matched_cmd);
+    const size_t start = cursor;
+    cursor += app_cmdbox_tokenize(&cmd[cursor], &p_matched_cmd, args);
 
-    if (NULL == p_matched_cmd) {
-      TRACE_WARNING("=> Unknown command: [%s]", &cmd_copy[cursor]);
+    /* Whatever follows the arguments is ignored */
+    cursor += app_cmdbox_string_skip_until(&cmd[cursor], app_cmdbox_string_is_separator, true);
 
-      /* Skip until the user enter reached */
-      cursor += app_cmdbox_string_skip_until(&cmd_copy[cursor], app_cmdbox_string_is_enter, true, cmd_end);
+    if (NULL == p_matched_cmd) {
+      char   unknown[MAX_CMD_STRING_LEN];
+      size_t len = cursor - start < sizeof(unknown) ? cursor - start : sizeof(unknown)-1;
+      memcpy(unknown, &cmd[start], len);
+      unknown[len] = '\0';
+      TRACE_WARNING("=> Unknown command: [%s]", unknown);
+      ++p_cmdbox->unknown;
+      app_cmdbox_reply(p_cmdbox, "=> NAK %u UNKNOWN", seq);
       continue;
     }
-    /* Extract arguments */
-    ASSERT(p_matched_cmd->nargs <= MAX_NUN_ARGS_SUPPORTED, "Too many arguments.");
-    arg_t args[MAX_NUN_ARGS_SUPPORTED];
-    for (int i = 0; i < p_matched_cmd->nargs; ++i) {
-      
-      /* Skip the space */
-      cursor += app_cmdbox_string_skip_until(&cmd_copy[cursor], app_cmdbox_string_is_SP, false, cmd_end);
-
-      uint8_t cursor_arg_start = cursor;
-      /* Skip digits */
-      cursor += app_cmdbox_string_skip_until(&cmd_copy[cursor], app_cmdbox_string_is_digit, false, cmd_end);
-
-      {
-        char tmp = cmd_copy[cursor];
-        cmd_copy[cursor] = '\0';
-        args[i] = atoi( &cmd_copy[cursor_arg_start]);
-        cmd_copy[cursor] = tmp;
-
-        /* Execute */
+    TRACE_INFO("Received user command: [%s]", p_matched_cmd->keyword);
 #if (defined SYS_TARGET_NATIVE)
-        TRACE_DEBUG("\targ[%d]=%d", i, args[i]);
-#endif
-      }
+    for (size_t i = 0; i < p_matched_cmd->nargs; ++i) {
+      TRACE_DEBUG("\targ[%d]=%d", (int)i, args[i]);
     }
+#endif
+
     /* Add it to Pending Execution */
-    int i = 0;
-    for ( ; i < MAX_NUM_PENDING; ++i) {
-      tAppCmdBoxPendingExe *p_pending_exe = &p_cmdbox->pending_exe[i];
-      if (p_pending_exe->p_matched_cmd == NULL) {
-        p_pending_exe->p_matched_cmd = p_matched_cmd;
-        memcpy(p_pending_exe->args, args, MAX_NUN_ARGS_SUPPORTED);
-        break;
-      }
+    if (p_cmdbox->head - p_cmdbox->tail >= MAX_NUM_PENDING) {
+      ++p_cmdbox->busy;
+      app_cmdbox_reply(p_cmdbox, "=> NAK %u BUSY", seq);
+      continue;
     }
-    ASSERT( i != MAX_NUM_PENDING, "Pending execution list is full.");
+    tAppCmdBoxPendingExe *p_pending_exe = &p_cmdbox->pending_exe[p_cmdbox->head & (MAX_NUM_PENDING-1)];
+    p_pending_exe->p_matched_cmd = p_matched_cmd;
+    p_pending_exe->seq           = seq;
+    p_pending_exe->replay        = 0;
+    memcpy(p_pending_exe->args, args, sizeof(args));
+    ++p_cmdbox->head;
   }
 
 }
 
-void app_cmdbox_exe(tAppCmdBox *p_cmdbox, uint32_t escape_ms) {
-  for ( int i = 0; i < MAX_NUM_PENDING; ++i) {
-    tAppCmdBoxPendingExe *p_pending_exe = &p_cmdbox->pending_exe[i];
-    if (p_pending_exe->p_matched_cmd != NULL) {
-      app_cmdbox_callback_wrapper[p_pending_exe->p_matched_cmd->nargs]( p_pending_exe->p_matched_cmd->keyword, p_pending_exe->p_matched_cmd->callback, p_pending_exe->args);
-      p_pending_exe->p_matched_cmd = NULL;
-      if (escape_ms != 0) {
+/**
+ * @brief Run the queued commands in order and reply to each of them
+ * @param [in] escape_ms - Delay after every command
+ * @return Number of commands executed
+ */
+uint32_t app_cmdbox_exe(tAppCmdBox *p_cmdbox, uint32_t escape_ms) {
+  uint32_t cnt = 0;
+  p_cmdbox_running = p_cmdbox;
+  for ( ; p_cmdbox->tail != p_cmdbox->head; ++cnt) {
+    tAppCmdBoxPendingExe             *p_pending_exe = &p_cmdbox->pending_exe[p_cmdbox->tail & (MAX_NUM_PENDING-1)];
+    const tAppCmdboxDatabaseListUnit *p_cmd         = p_pending_exe->p_matched_cmd;
+    if (p_cmdbox->macro.rec != 0 && p_pending_exe->replay == 0 && !app_cmdbox_macro_is_control(p_cmd)) {
+      const int step = app_cmdbox_macro_append(p_cmdbox, p_cmd, p_pending_exe->args);
+      ++p_cmdbox->tail;
+      if (step < 0) {
+        app_cmdbox_reply(p_cmdbox, "=> NAK %u FULL", p_pending_exe->seq);
+      } else {
+        app_cmdbox_reply(p_cmdbox, "=> REC %u %s %d", p_pending_exe->seq, p_cmd->keyword, step);
+      }
+      continue;
+    }
+    int ret = app_cmdbox_callback_wrapper[p_cmd->nargs]( p_cmd->keyword, p_cmd->callback, p_pending_exe->args);
+    ++p_cmdbox->tail;
+    if (p_pending_exe->replay != 0) {
+      app_cmdbox_reply(p_cmdbox, "=> RUN %u %s %d", p_pending_exe->replay-1, p_cmd->keyword, ret);
+    } else {
+      app_cmdbox_reply(p_cmdbox, "=> ACK %u %s %d", p_pending_exe->seq, p_cmd->keyword, ret);
+    }
+    if (escape_ms != 0) {
 #if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
-        vTaskDelay(escape_ms);
+      vTaskDelay(escape_ms);
 #elif (defined SYS_TARGET_NATIVE)
-        usleep(escape_ms*1000);
+      usleep(escape_ms*1000);
 #endif
+    }
+  }
+  return cnt;
+}
+
+/**
+ * @brief Send one binary frame through the reply channel
+ * @note  Sent even when `quiet`. Frames are only sent on request.
+ * @param [in] type    - Message type
+ * @param [in] payload - At most `APP_CMDBOX_FRAME_MAX` bytes
+ * @param [in] len     - Length of `payload`
+ */
+void app_cmdbox_frame_send(tAppCmdBox *p_cmdbox, uint8_t type, const void *payload, size_t len) {
+  uint8_t wire[CMN_FRAME_WIRE_SIZE(APP_CMDBOX_FRAME_MAX)];
+  ASSERT( len <= APP_CMDBOX_FRAME_MAX, "Frame payload is too long.");
+  app_cmdbox_tx(p_cmdbox, wire, cmn_frame_encode(type, payload, len, wire));
+}
+
+/**
+ * @brief Check and dispatch one received frame, then answer it
+ * @param [inout] body - COBS body from `cmn_line_frame()`. Decoded in place.
+ * @param [in]    len  - Length of `body`
+ */
+void app_cmdbox_frame(tAppCmdBox *p_cmdbox, uint8_t *body, size_t len) {
+  uint8_t        type;
+  const uint8_t *payload;
+  size_t         payload_len;
+
+  ++p_cmdbox->frames;
+  int err = cmn_frame_decode(body, len, &type, &payload, &payload_len);
+  if (err == kCmnFrame_OK && (type >= APP_CMDBOX_FRAME_TYPE_NUM || frame_handler[type] == NULL)) {
+    err = APP_CMDBOX_FRAME_ERR_TYPE;
+  }
+  if (err != kCmnFrame_OK) {
+    const uint8_t nak[2] = { (uint8_t)(int8_t)err, (err == APP_CMDBOX_FRAME_ERR_TYPE) ? type : 0xFF };
+    ++p_cmdbox->frame_err;
+    TRACE_WARNING("=> Bad frame: error=%d", err);
+    app_cmdbox_frame_send(p_cmdbox, APP_CMDBOX_FRAME_NAK, nak, sizeof(nak));
+    return;
+  }
+
+  /* Status first, then the payload of the handler */
+  uint8_t reply[APP_CMDBOX_FRAME_MAX];
+  size_t  reply_len = 0;
+  reply[0] = (uint8_t)(int8_t)frame_handler[type](payload, payload_len, &reply[1], &reply_len);
+  ASSERT( reply_len < APP_CMDBOX_FRAME_MAX, "Frame reply is too long.");
+  app_cmdbox_frame_send(p_cmdbox, type | APP_CMDBOX_FRAME_REPLY, reply, 1+reply_len);
+}
+
+/**
+ * @brief Add or replace the handler of a binary message
+ * @note  Call it before the scheduler starts or from the command box task.
+ * @return `0` on success. `1` if the type is out of range.
+ */
+int app_cmdbox_frame_register(uint8_t type, tAppCmdboxFrameHandler handler) {
+  if (type >= APP_CMDBOX_FRAME_TYPE_NUM) {
+    return 1;
+  }
+  frame_handler[type] = handler;
+  return 0;
+}
+
+/**
+ * @brief Attach the macro bank and keep its macros if it survived the reset
+ * @note  A bank failing its magic or its CRC is cleared. Recording and replay are stopped.
+ * @param [in] bank - Bank of the box. `NULL` disables the macros.
+ */
+void app_cmdbox_macro_init(tAppCmdBox *p_cmdbox, tAppCmdboxMacroBank *bank) {
+  memset(&p_cmdbox->macro, 0, sizeof(p_cmdbox->macro));
+  p_cmdbox->macro.bank = bank;
+  if (bank == NULL) {
+    return;
+  }
+  if (bank->magic != APP_CMDBOX_MACRO_MAGIC || bank->crc != app_cmdbox_macro_crc(bank)) {
+    memset(bank, 0, sizeof(*bank));
+    app_cmdbox_macro_seal(bank);
+    return;
+  }
+  for (uint32_t i = 0; i < APP_CMDBOX_MACRO_NUM; ++i) {
+    if (bank->len[i] > APP_CMDBOX_MACRO_STEP_NUM) {
+      bank->len[i] = 0;
+    }
+    for (uint32_t k = 0; k < bank->len[i]; ++k) {
+      if (bank->step[i][k].index >= kNumAppCmdbox && bank->step[i][k].index != APP_CMDBOX_MACRO_WAIT) {
+        bank->len[i] = 0;
+      }
+    }
+  }
+  app_cmdbox_macro_seal(bank);
+  TRACE_INFO("Kept macros of %u %u %u %u steps", bank->len[0], bank->len[1], bank->len[2], bank->len[3]);
+}
+
+/**
+ * @brief Record the following commands into macro `id` until `app_cmdbox_macro_end()`
+ * @return `0` on success. `1` if the id is out of range, or a macro is being recorded or replayed.
+ */
+int app_cmdbox_macro_record(tAppCmdBox *p_cmdbox, uint32_t id) {
+  tAppCmdboxMacro *p_macro = &p_cmdbox->macro;
+  if (p_macro->bank == NULL || id >= APP_CMDBOX_MACRO_NUM || p_macro->rec != 0 || p_macro->play != 0) {
+    return 1;
+  }
+  p_macro->bank->len[id] = 0;
+  app_cmdbox_macro_seal(p_macro->bank);
+  p_macro->rec     = (uint8_t)(id+1);
+  p_macro->rec_len = 0;
+  return 0;
+}
+
+/**
+ * @brief Record a delay of `ms` before the next step
+ * @return `0` on success. `1` when not recording, the delay is too long or the macro is full.
+ */
+int app_cmdbox_macro_wait(tAppCmdBox *p_cmdbox, uint32_t ms) {
+  const arg_t args[1] = { (arg_t)ms };
+  if (p_cmdbox->macro.rec == 0 || ms > APP_CMDBOX_MACRO_WAIT_MAX) {
+    return 1;
+  }
+  return app_cmdbox_macro_append(p_cmdbox, NULL, args) < 0;
+}
+
+/**
+ * @brief Stop recording
+ * @return Number of steps recorded. `-1` when not recording.
+ */
+int app_cmdbox_macro_end(tAppCmdBox *p_cmdbox) {
+  tAppCmdboxMacro *p_macro = &p_cmdbox->macro;
+  if (p_macro->rec == 0) {
+    return -1;
+  }
+  p_macro->bank->len[p_macro->rec-1] = p_macro->rec_len;
+  app_cmdbox_macro_seal(p_macro->bank);
+  p_macro->rec = 0;
+  return p_macro->rec_len;
+}
+
+/**
+ * @brief Replay macro `id` from `app_cmdbox_macro_poll()`
+ * @note  A replay in progress is replaced.
+ * @param [in] times - Passes. `0` replays it until `app_cmdbox_macro_stop()`.
+ * @return `0` on success. `1` if the macro is empty or being recorded.
+ */
+int app_cmdbox_macro_play(tAppCmdBox *p_cmdbox, uint32_t id, uint32_t times) {
+  tAppCmdboxMacro *p_macro = &p_cmdbox->macro;
+  if (p_macro->bank == NULL || id >= APP_CMDBOX_MACRO_NUM || p_macro->bank->len[id] == 0 || p_macro->rec != 0) {
+    return 1;
+  }
+  p_macro->play   = (uint8_t)(id+1);
+  p_macro->step   = 0;
+  p_macro->armed  = 1;
+  p_macro->times  = times;
+  p_macro->passes = 0;
+  return 0;
+}
+
+/**
+ * @brief Stop replaying. The steps already queued still run.
+ * @return `0` on success. `1` when nothing was replaying.
+ */
+int app_cmdbox_macro_stop(tAppCmdBox *p_cmdbox) {
+  if (p_cmdbox->macro.play == 0) {
+    return 1;
+  }
+  p_cmdbox->macro.play = 0;
+  return 0;
+}
+
+/**
+ * @brief Reply with every step of every macro
+ * @note  => MACRO <id> <steps>
+ *        => <step> <keyword> <arguments>
+ */
+int app_cmdbox_macro_list(tAppCmdBox *p_cmdbox) {
+  const tAppCmdboxMacroBank *bank = p_cmdbox->macro.bank;
+  if (bank == NULL) {
+    return 1;
+  }
+  for (uint32_t i = 0; i < APP_CMDBOX_MACRO_NUM; ++i) {
+    app_cmdbox_reply(p_cmdbox, "=> MACRO %u %u", i, bank->len[i]);
+    for (uint32_t k = 0; k < bank->len[i]; ++k) {
+      const tAppCmdboxMacroStep *p_step = &bank->step[i][k];
+      const bool                 wait   = (p_step->index == APP_CMDBOX_MACRO_WAIT);
+      const size_t               nargs  = wait ? 1 : CMD_LIST[p_step->index].nargs;
+      char                       line[APP_CMDBOX_REPLY_LEN];
+      int                        len    = cmn_utility_snprintf(line, sizeof(line), "=> %u %s", k, wait ? "MWAIT" : CMD_LIST[p_step->index].keyword);
+      for (size_t a = 0; a < nargs && len > 0; ++a) {
+        len += cmn_utility_snprintf(&line[len-1], sizeof(line)-(len-1), " %d", p_step->args[a]) - 1;
+      }
+      app_cmdbox_reply(p_cmdbox, "%s", line);
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Forget macro `id`
+ * @return `0` on success. `1` if the id is out of range, or the macro is being recorded or replayed.
+ */
+int app_cmdbox_macro_clear(tAppCmdBox *p_cmdbox, uint32_t id) {
+  tAppCmdboxMacro *p_macro = &p_cmdbox->macro;
+  if (p_macro->bank == NULL || id >= APP_CMDBOX_MACRO_NUM || p_macro->rec == id+1 || p_macro->play == id+1) {
+    return 1;
+  }
+  p_macro->bank->len[id] = 0;
+  app_cmdbox_macro_seal(p_macro->bank);
+  return 0;
+}
+
+/**
+ * @brief Queue the steps of the replay that are due, then run them with `app_cmdbox_exe()`
+ * @note  The clock starts on the first poll after `app_cmdbox_macro_play()`. A delay is counted
+ *        from the poll that reached it. At most one pass is queued per poll, and the poll that
+ *        completes a pass asks for at least 1ms. A replay without delays therefore sleeps between
+ *        passes and lower priority tasks still run. The end is reported after the last step has run.
+ * @param [in] now_ms - Free running clock in ms
+ * @return ms until the next step is due. `0` to poll again at once, only while the pending ring
+ *         is full in the middle of a pass. `APP_CMDBOX_MACRO_IDLE` when nothing is replaying.
+ */
+uint32_t app_cmdbox_macro_poll(tAppCmdBox *p_cmdbox, uint32_t now_ms) {
+  tAppCmdboxMacro *p_macro = &p_cmdbox->macro;
+  if (p_macro->play == 0) {
+    return APP_CMDBOX_MACRO_IDLE;
+  }
+  if (p_macro->armed) {
+    p_macro->armed = 0;
+    p_macro->start = now_ms;
+    p_macro->due   = now_ms;
+  }
+
+  const uint32_t             id   = p_macro->play-1;
+  const tAppCmdboxMacroBank *bank = p_macro->bank;
+  while ((int32_t)(now_ms - p_macro->due) >= 0) {
+    if (p_macro->step >= bank->len[id]) {
+      ++p_macro->passes;
+      p_macro->step = 0;
+      if (p_macro->times != 0 && --p_macro->times == 0) {
+        p_macro->play = 0;
+        app_cmdbox_reply(p_cmdbox, "=> END %u %u %u", id, p_macro->passes, now_ms - p_macro->start);
+        return APP_CMDBOX_MACRO_IDLE;
       }
     }
+    if (p_cmdbox->head - p_cmdbox->tail >= MAX_NUM_PENDING) {
+      return 0;
+    }
+
+    const tAppCmdboxMacroStep *p_step = &bank->step[id][p_macro->step++];
+    if (p_step->index == APP_CMDBOX_MACRO_WAIT) {
+      p_macro->due = now_ms + (uint32_t)p_step->args[0];
+    } else {
+      tAppCmdBoxPendingExe *p_pending_exe = &p_cmdbox->pending_exe[p_cmdbox->head & (MAX_NUM_PENDING-1)];
+      memset(p_pending_exe->args, 0, sizeof(p_pending_exe->args));
+      memcpy(p_pending_exe->args, p_step->args, sizeof(p_step->args));
+      p_pending_exe->p_matched_cmd = &CMD_LIST[p_step->index];
+      p_pending_exe->seq           = 0;
+      p_pending_exe->replay        = p_macro->step;
+      ++p_cmdbox->head;
+    }
+    if (p_macro->step >= bank->len[id]) {
+      break;
+    }
+  }
+  const int32_t left = (int32_t)(p_macro->due - now_ms);
+  if (p_macro->step >= bank->len[id]) {
+    return (left > 1) ? (uint32_t)left : 1U;
   }
+  return (left > 0) ? (uint32_t)left : 0U;
 }
 
 /* ************************************************************************** */
@@ -332,32 +697,38 @@ void app_cmdbox_exe(tAppCmdBox *p_cmdbox, uint32_t escape_ms) {
 void app_cmdbox_main(void *param) RTOSTHREAD {
 #define CAST(x) ((tAppCmdBox *)(x))
   tRtosEvent *p_event = &metope.rtos.event;
-  tBspUart   *p_uart  = &metope.bsp.uart;
+  tCmnLine   *p_line  = &metope.bsp.uart.rx_line;
+  uint32_t    lost    = 0;
+
+  app_cmdbox_macro_init(CAST(param), &macro_bank);
 
-  xEventGroupClearBits(p_event->_handle, CMN_EVENT_UART_INPUT);
   while(1){
-    EventBits_t uxBits = xEventGroupWaitBits( p_event->_handle, CMN_EVENT_UART_INPUT, pdFALSE, pdFALSE, portMAX_DELAY);
+    /* The replay runs on the timeout of the wait */
+    const uint32_t next_ms = app_cmdbox_macro_poll(CAST(param), APP_CMDBOX_NOW_MS());
+    app_cmdbox_exe(CAST(param), 0);
+
+    /* Cleared before the ring is drained. A line completed afterwards sets it again. */
+    TickType_t ticks = (next_ms == APP_CMDBOX_MACRO_IDLE) ? portMAX_DELAY : pdMS_TO_TICKS(next_ms);
+    if (next_ms != 0 && ticks == 0) {
+      ticks = 1;    /* Below one tick. Still sleep. */
+    }
+    xEventGroupWaitBits( p_event->_handle, CMN_EVENT_UART_INPUT, pdTRUE, pdFALSE, ticks);
 
-    if(uxBits & CMN_EVENT_UART_INPUT){
-      taskENTER_CRITICAL();
-      if (p_uart->rx_status.error_code) {
-        TRACE_WARNING("Can NOT parse the command due to a RX error. Data will be flushed: error_code=0x%02X rawstr=%s rd_idx=%d", p_uart->rx_status.error_code, p_uart->rx_buf, p_uart->rx_idx);
-        p_uart->rx_status.error_code = 0;
-      }
-      else if (p_uart->rx_status.has_new_msg || p_uart->rx_status.is_overflowed) {
-        /**
-         * @bug `is_locked` was NOT safe enough.
-         */
-        p_uart->rx_status.is_locked     = 1;
-        app_cmdbox_parse(CAST(param), p_uart->rx_buf);
-        p_uart->rx_idx                  = 0;
-        p_uart->rx_status.has_new_msg   = 0;
-        p_uart->rx_status.is_overflowed = 0;
-        p_uart->rx_status.is_locked     = 0;
+    const uint32_t now_lost = p_line->overflow + p_line->dropped + p_line->error;
+    if (now_lost != lost) {
+      TRACE_WARNING("Dropped RX lines: overflow=%u busy=%u error=%u", p_line->overflow, p_line->dropped, p_line->error);
+      lost = now_lost;
+    }
+
+    for (const char *cmd = cmn_line_front(p_line); cmd != NULL; cmd = cmn_line_front(p_line)) {
+      uint8_t *body;
+      size_t   len = cmn_line_frame(p_line, &body);
+      if (len != 0) {
+        app_cmdbox_frame(CAST(param), body, len);
+      } else {
+        app_cmdbox_parse(CAST(param), cmd);
       }
-      taskEXIT_CRITICAL();
-      xEventGroupClearBits(p_event->_handle, CMN_EVENT_UART_INPUT);
-      
+      cmn_line_pop(p_line);
       app_cmdbox_exe(CAST(param), 0);
     }
   }
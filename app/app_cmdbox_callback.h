@@ -2,11 +2,35 @@
 #include <stdarg.h>
 #include "bsp_screen.h"
 #include "bsp_rtc.h"
+#include "profile.h"
+#include "app_rtos_top.h"
+#include "timeline.h"
+#include "memory.h"
+#if (defined SYS_TARGET_STM32F411CEU6) || defined (SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || defined (EMULATOR_STM32F405RGT6)
+  #include "app_lvgl.h"
+#endif
 
 #if !defined(UNUSED)
   #define UNUSED(X) (void)X      /* To avoid gcc/g++ warnings */
 #endif /* UNUSED */
 
+/**
+ * @note The box running the callbacks. Set by `app_cmdbox_exe()`.
+ */
+static tAppCmdBox *p_cmdbox_running = NULL;
+
+/**
+ * @note Callbacks printing many lines sleep a tick whenever the UART ring is nearly full, so no
+ *       line is dropped. Task context. The DMA drains the ring by its interrupt meanwhile.
+ */
+#if (defined SYS_TARGET_STM32F411CEU6) || defined (SYS_TARGET_STM32F405RGT6)
+  #define APP_CMDBOX_LINE_MAX     (96)
+  #define APP_CMDBOX_PRINTF( fmt, ...) \
+    do{ while( bsp_uart_tx_room() < APP_CMDBOX_LINE_MAX){ vTaskDelay(1); } TRACE_PRINTF( fmt, ##__VA_ARGS__); }while(0)
+#else
+  #define APP_CMDBOX_PRINTF( fmt, ...) TRACE_PRINTF( fmt, ##__VA_ARGS__)
+#endif
+
 static int app_cmdbox_callback_1args_CCW(const char *cmd, ...) {
   va_list args;
   va_start(args, cmd);
@@ -31,6 +55,37 @@ static int app_cmdbox_callback_1args_CW(const char *cmd, ...) {
   va_end(args);
   return 0;
 }
+/**
+ * @brief `CRASH`. Dump the crash record of the last boot, then start recording again.
+ * @note  The records are binary. Decode them with `tool/uart.py --table build/model1.trace`.
+ */
+static int app_cmdbox_callback_0args_CRASH(const char *cmd, ...) {
+  if (trace_crash.magic != TRACE_CRASH_FROZEN) {
+    TRACE_PRINTF("=> CRASH none");
+    return 0;
+  }
+  TRACE_PRINTF("=> CRASH reason=%u task=%s pc=0x%08X lr=0x%08X psr=0x%08X", trace_crash.reason, trace_crash.task, trace_crash.pc, trace_crash.lr, trace_crash.psr);
+  TRACE_PRINTF("=> CFSR=0x%08X HFSR=0x%08X MMFAR=0x%08X BFAR=0x%08X", trace_crash.cfsr, trace_crash.hfsr, trace_crash.mmfar, trace_crash.bfar);
+
+  uint8_t  buf[TRACE_DEFER_RECORD_MAX];
+  uint32_t cursor = 0;
+  size_t   len;
+  while (0 != (len = trace_crash_read(buf, sizeof(buf), &cursor))) {
+#if (defined SYS_TARGET_NATIVE)
+    for (size_t i = 0; i < len; i += TRACE_DEFER_HEADER_LEN + buf[i+1]) {
+      TRACE_PRINTF("=> %s", trace_defer_fmt(buf[i+2] | (buf[i+3] << 8) | (buf[i+4] << 16)));
+    }
+#elif (defined SYS_TARGET_STM32F411CEU6) || defined (SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || defined (EMULATOR_STM32F405RGT6)
+    /* Task context. The DMA drains the ring by its interrupt while this task sleeps. */
+    while (bsp_uart_tx_room() < len) {
+      vTaskDelay(1);
+    }
+    bsp_uart_write(buf, len);
+#endif
+  }
+  trace_crash_clear();
+  return 0;
+}
 static int app_cmdbox_callback_1args_DISPBR(const char *cmd, ...) {
   va_list args;
   va_start(args, cmd);
@@ -70,6 +125,176 @@ static int app_cmdbox_callback_0args_GT(const char *cmd, ...) {
 #endif
   return 0;
 }
+/**
+ * @brief `LOG <module> <level>`. Module `kNumTraceModule` means all modules. See `LOGLS`.
+ */
+static int app_cmdbox_callback_2args_LOG(const char *cmd, ...) {
+  va_list args;
+  va_start(args, cmd);
+  int module = va_arg(args, int);
+  int level  = va_arg(args, int);
+  va_end(args);
+  if (0 != trace_level_set( (uint32_t)module, (uint32_t)level)) {
+    TRACE_WARNING("=> LOG <module 0-%d> <level 0-%d>. Module %d means all.", kNumTraceModule, TRACE_LEVEL_DEBUG, kNumTraceModule);
+    return 1;
+  }
+  return 0;
+}
+static int app_cmdbox_callback_0args_LOGLS(const char *cmd, ...) {
+  for (uint32_t i = 0; i < kNumTraceModule; ++i) {
+    TRACE_PRINTF("=> %u %s %u", i, trace_module_name(i), trace_module_level[i]);
+  }
+  return 0;
+}
+/**
+ * @brief `MCLR <id>`. Forget a macro. See `APP_CMDBOX_MACRO_NUM`.
+ */
+static int app_cmdbox_callback_1args_MCLR(const char *cmd, ...) {
+  va_list args;
+  va_start(args, cmd);
+  int id = va_arg(args, int);
+  va_end(args);
+  return app_cmdbox_macro_clear(p_cmdbox_running, (uint32_t)id);
+}
+/**
+ * @brief `MEM`. RTOS heap, bytes charged to each owner and call site, LVGL objects and stack high-water of every task.
+ * @note  Owners are only counted with `-DMEMORY_OWNER=1` and call sites with `-DMEMORY_TRACK=1` on target.
+ *        See `top/memory.h`.
+ */
+static int app_cmdbox_callback_0args_MEM(const char *cmd, ...) {
+  tMemoryHeap heap;
+  memory_heap(&heap);
+  APP_CMDBOX_PRINTF("=> MEM heap free=%u min=%u largest=%u blocks=%u", heap.free, heap.min_ever_free, heap.largest_free, heap.count);
+#if (MEMORY_OWNER==1)
+  for (uint32_t i = 0; i < kNumMemoryOwner; ++i) {
+    tMemoryOwner owner = memory_owner[i];
+    APP_CMDBOX_PRINTF("=> %s bytes=%u n=%u peak=%u", memory_owner_name(i), owner.bytes, owner.count, owner.peak);
+  }
+#endif
+#if (MEMORY_TRACK==1)
+  static tMemoryTrackSite site[MEMORY_TRACK_SITE_NUM];
+  uint32_t num_site = memory_track_sites(site, MEMORY_TRACK_SITE_NUM);
+  APP_CMDBOX_PRINTF("=> track bytes=%u n=%u peak=%u lost=%u", memory_track.bytes, memory_track.count, memory_track.peak, memory_track.lost);
+  for (uint32_t i = 0; i < num_site; ++i) {
+    APP_CMDBOX_PRINTF("=> site %x %s bytes=%u n=%u peak=%u total=%u", (uint32_t)site[i].site, memory_owner_name(site[i].owner),
+      site[i].bytes, site[i].count, site[i].peak, site[i].total);
+  }
+#endif
+#if (defined SYS_TARGET_STM32F411CEU6) || defined (SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || defined (EMULATOR_STM32F405RGT6)
+  APP_CMDBOX_PRINTF("=> lvgl obj=%u", app_lvgl_obj_count());
+
+  static tAppRtosTopTask sample[APP_RTOS_TOP_MAX_TASK];
+  uint32_t total;
+  uint32_t num = app_rtos_top_snapshot(sample, APP_RTOS_TOP_MAX_TASK, &total);
+  for (uint32_t i = 0; i < num; ++i) {
+    APP_CMDBOX_PRINTF("=> %s stack_free=%u", sample[i].name, sample[i].stack_free);
+  }
+#endif
+  return 0;
+}
+/**
+ * @brief `MEND`. Stop recording.
+ * @return Number of steps recorded
+ */
+static int app_cmdbox_callback_0args_MEND(const char *cmd, ...) {
+  return app_cmdbox_macro_end(p_cmdbox_running);
+}
+static int app_cmdbox_callback_0args_MLS(const char *cmd, ...) {
+  return app_cmdbox_macro_list(p_cmdbox_running);
+}
+/**
+ * @brief `MPLAY <id> <times>`. Replay a macro from the task. `0` times replays it until `MSTOP`.
+ */
+static int app_cmdbox_callback_2args_MPLAY(const char *cmd, ...) {
+  va_list args;
+  va_start(args, cmd);
+  int id    = va_arg(args, int);
+  int times = va_arg(args, int);
+  va_end(args);
+  return app_cmdbox_macro_play(p_cmdbox_running, (uint32_t)id, (uint32_t)times);
+}
+/**
+ * @brief `MREC <id>`. Record the following commands into a macro until `MEND`.
+ */
+static int app_cmdbox_callback_1args_MREC(const char *cmd, ...) {
+  va_list args;
+  va_start(args, cmd);
+  int id = va_arg(args, int);
+  va_end(args);
+  return app_cmdbox_macro_record(p_cmdbox_running, (uint32_t)id);
+}
+static int app_cmdbox_callback_0args_MSTOP(const char *cmd, ...) {
+  return app_cmdbox_macro_stop(p_cmdbox_running);
+}
+/**
+ * @brief `MWAIT <ms>`. Record a delay. Only while recording.
+ */
+static int app_cmdbox_callback_1args_MWAIT(const char *cmd, ...) {
+  va_list args;
+  va_start(args, cmd);
+  int ms = va_arg(args, int);
+  va_end(args);
+  return app_cmdbox_macro_wait(p_cmdbox_running, (uint32_t)ms);
+}
+/**
+ * @brief `PROF`. Count, total, min, average and max ticks of every profiling zone.
+ * @note  Ticks are CPU cycles on target and nanoseconds on native. Each sample includes the overhead.
+ */
+static int app_cmdbox_callback_0args_PROF(const char *cmd, ...) {
+  TRACE_PRINTF("=> PROF overhead=%u", profile_overhead());
+  for (uint32_t i = 0; i < kNumProfileZone; ++i) {
+    tProfileZone zone = profile_zone[i];
+    if (zone.count == 0) {
+      continue;
+    }
+    TRACE_PRINTF("=> %s n=%u total_k=%u min=%u avg=%u max=%u", profile_zone_name(i), zone.count,
+      (uint32_t)(zone.total / 1000U), zone.min, (uint32_t)(zone.total / zone.count), zone.max);
+  }
+  return 0;
+}
+static int app_cmdbox_callback_0args_PROFRST(const char *cmd, ...) {
+  profile_reset();
+  return 0;
+}
+/**
+ * @brief `TIMELINE`. Dump the task timeline, then record again from an empty ring.
+ * @note  Convert the dump with `tool/timeline.py`. Only recorded with `-DTIMELINE=1`.
+ */
+static int app_cmdbox_callback_0args_TIMELINE(const char *cmd, ...) {
+#if (TIMELINE==1)
+  timeline_dump();
+#else
+  TRACE_WARNING("=> TIMELINE needs -DTIMELINE=1");
+#endif
+  return 0;
+}
+/**
+ * @brief `TOP`. CPU share, state and stack high-water mark of every task since the last `TOP`.
+ * @note  The task list is copied with the scheduler suspended, then printed into the transmit ring.
+ *        The first `TOP` covers the time since boot.
+ */
+static int app_cmdbox_callback_0args_TOP(const char *cmd, ...) {
+#if (defined SYS_TARGET_NATIVE)
+  TRACE_DEBUG("\tExecute user command: %s", cmd);
+#elif (defined SYS_TARGET_STM32F411CEU6) || defined (SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || defined (EMULATOR_STM32F405RGT6)
+  static tAppRtosTop     top;
+  static tAppRtosTopTask sample[APP_RTOS_TOP_MAX_TASK];
+  uint32_t total;
+  uint32_t num = app_rtos_top_snapshot(sample, APP_RTOS_TOP_MAX_TASK, &total);
+  if (num == 0) {
+    TRACE_WARNING("=> TOP supports at most %u tasks", APP_RTOS_TOP_MAX_TASK);
+    return 1;
+  }
+  app_rtos_top_update(&top, sample, num, total);
+
+  TRACE_PRINTF("=> TOP period=%ums", (uint32_t)(((uint64_t)top.period << APP_RTOS_TOP_RUNTIME_SHIFT) / (PROFILE_HZ / 1000U)));
+  for (uint32_t i = 0; i < top.num; ++i) {
+    const tAppRtosTopTask *p = &top.task[i];
+    TRACE_PRINTF("=> %s %c cpu=%u.%u stack_free=%u", p->name, p->state, p->permille / 10U, p->permille % 10U, p->stack_free);
+  }
+#endif
+  return 0;
+}
 static int app_cmdbox_callback_6args_ST(const char *cmd, ...) {
   va_list args;
   va_start(args, cmd);
@@ -88,3 +313,35 @@ static int app_cmdbox_callback_6args_ST(const char *cmd, ...) {
   va_end(args);
   return 0;
 }
+
+/**
+ * @brief Frame `PING`. Reply with the same payload.
+ */
+static int app_cmdbox_frame_PING(const uint8_t *payload, size_t len, uint8_t *reply, size_t *reply_len) {
+  len = (len < APP_CMDBOX_FRAME_MAX-1) ? len : APP_CMDBOX_FRAME_MAX-1;
+  memcpy(reply, payload, len);
+  *reply_len = len;
+  return 0;
+}
+/**
+ * @brief Frame `TIME`. Set the RTC from `year(LE16) month day hour minute second`.
+ * @note  Same as the `ST` command without the text.
+ */
+static int app_cmdbox_frame_TIME(const uint8_t *payload, size_t len, uint8_t *reply, size_t *reply_len) {
+  if (len != 7) {
+    return 1;
+  }
+#if (defined SYS_TARGET_NATIVE)
+  TRACE_DEBUG("\tExecute user frame: TIME %u", payload[0] | (payload[1] << 8));
+#elif (defined SYS_TARGET_STM32F411CEU6) || defined (SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || defined (EMULATOR_STM32F405RGT6)
+  cmnDateTime_t time = {0};
+  time.year   = (payload[0] | (payload[1] << 8)) - CMN_DATE_YEAR_OFFSET;
+  time.month  = payload[2];
+  time.day    = payload[3];
+  time.hour   = payload[4];
+  time.minute = payload[5];
+  time.second = payload[6];
+  bsp_rtc_set_time(time);
+#endif
+  return 0;
+}
@@ -24,12 +24,19 @@
 #include "device.h"
 #include "app_lvgl.h"
 #include "bsp_screen.h"
+#include "cmn_color.h"
+#include "profile.h"
 
 /* ************************************************************************** */
 /*                               Private Macros                               */
 /* ************************************************************************** */
 #define THIS (&metope.app)
 
+/**
+ * @note Column/Row address set commands issued by `bsp_screen_area()` before each refresh
+ */
+#define SCREEN_AREA_SPI_BYTE  (1+4+1+4+1)
+
 
 /* ************************************************************************** */
 /*                             Private Functions                              */
@@ -49,9 +56,25 @@ STATIC void app_lvgl_flush_cb(struct _lv_disp_drv_t *disp, const lv_area_t *area
 #elif LVGL_VERSION==922
 STATIC void app_lvgl_flush_cb(lv_display_t * disp, const lv_area_t * area, uint8_t * px_map)
 #endif
+  PROFILE_BEGIN( LVGL_FLUSH);
   THIS->lvgl.isFlushDone = lv_disp_flush_is_last(disp);
 
+#if (defined BENCH_RENDER) && (BENCH_RENDER==1)
+  {
+    uint32_t num_pixel = (uint32_t)(area->x2 - area->x1 + 1) * (uint32_t)(area->y2 - area->y1 + 1);
+    THIS->lvgl.stat.num_flush    += 1;
+    THIS->lvgl.stat.num_pixel    += num_pixel;
+    THIS->lvgl.stat.num_spi_byte += num_pixel*sizeof(bspScreenPixel_t) + SCREEN_AREA_SPI_BYTE;
+  }
+#endif
+
+#if (((defined BENCH_RENDER) && (BENCH_RENDER==1)) || ((defined INCLUDE_TB_PERF) && (INCLUDE_TB_PERF==1)) || ((defined INCLUDE_TB_RENDER) && (INCLUDE_TB_RENDER==1))) && ((defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6))
+  /* Dummy flush. The screen is NOT attached to the emulator. */
+#else
   bsp_screen_refresh( (bspScreenPixel_t *)buf, area->x1, area->y1, area->x2, area->y2);
+#endif
+
+  PROFILE_END( LVGL_FLUSH);
 
 #if LVGL_VERSION==836
   lv_disp_flush_ready(disp);
@@ -60,6 +83,59 @@ STATIC void app_lvgl_flush_cb(lv_display_t * disp, const lv_area_t * area, uint8
 #endif
 }
 
+#if LVGL_VERSION==836
+/**
+ * @brief Software blender with the RGB565 kernels of `cmn_color`
+ * @note  Only normal blending without mask is accelerated, which covers the solid fills and
+ *        the opaque/faded images of the clock screens. Anything else is handed back to LVGL.
+ */
+STATIC void app_lvgl_blend( lv_draw_ctx_t *draw_ctx, const lv_draw_sw_blend_dsc_t *dsc){
+  lv_area_t blend_area;
+  if( !_lv_area_intersect( &blend_area, dsc->blend_area, draw_ctx->clip_area)){
+    return;
+  }
+
+  lv_disp_t *disp = _lv_refr_get_disp_refreshing();
+  if( (dsc->mask_buf && dsc->mask_res!=LV_DRAW_MASK_RES_FULL_COVER) || \
+      dsc->blend_mode!=LV_BLEND_MODE_NORMAL                         || \
+      disp->driver->screen_transp                                   || \
+      disp->driver->set_px_cb ){
+    lv_draw_sw_blend_basic( draw_ctx, dsc);
+    return;
+  }
+
+  const lv_coord_t dst_stride = lv_area_get_width( draw_ctx->buf_area);
+  const lv_coord_t w          = lv_area_get_width( &blend_area);
+  const lv_coord_t h          = lv_area_get_height( &blend_area);
+  uint16_t *dst = (uint16_t *)draw_ctx->buf + dst_stride*(blend_area.y1 - draw_ctx->buf_area->y1) + (blend_area.x1 - draw_ctx->buf_area->x1);
+
+  if( dsc->src_buf){
+    const lv_coord_t src_stride = lv_area_get_width( dsc->blend_area);
+    const uint16_t  *src = (const uint16_t *)dsc->src_buf + src_stride*(blend_area.y1 - dsc->blend_area->y1) + (blend_area.x1 - dsc->blend_area->x1);
+    for( lv_coord_t y=0; y<h; ++y, dst+=dst_stride, src+=src_stride){
+      if( dsc->opa >= LV_OPA_MAX){
+        lv_memcpy( dst, src, w*sizeof(uint16_t));
+      }else{
+        cmn_color_565_blend( dst, src, w, dsc->opa, LV_COLOR_16_SWAP);
+      }
+    }
+  }else{
+    for( lv_coord_t y=0; y<h; ++y, dst+=dst_stride){
+      if( dsc->opa >= LV_OPA_MAX){
+        cmn_color_565_fill( dst, dsc->color.full, w);
+      }else{
+        cmn_color_565_fill_opa( dst, dsc->color.full, w, dsc->opa, LV_COLOR_16_SWAP);
+      }
+    }
+  }
+}
+
+STATIC void app_lvgl_draw_ctx_init( lv_disp_drv_t *disp_drv, lv_draw_ctx_t *draw_ctx){
+  lv_draw_sw_init_ctx( disp_drv, draw_ctx);
+  ((lv_draw_sw_ctx_t *)draw_ctx)->blend = app_lvgl_blend;
+}
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -116,6 +192,7 @@ void app_lvgl_init(void){
   THIS->lvgl.disp_drv.hor_res     = BSP_SCREEN_HEIGHT;
   THIS->lvgl.disp_drv.ver_res     = BSP_SCREEN_WIDTH;
   THIS->lvgl.disp_drv.direct_mode = false;
+  THIS->lvgl.disp_drv.draw_ctx_init = app_lvgl_draw_ctx_init;
   lv_disp_draw_buf_init( &THIS->lvgl.disp_draw_buf, THIS->lvgl.gram[0], THIS->lvgl.gram[1], sizeof(THIS->lvgl.gram[0])/sizeof(THIS->lvgl.gram[0][0]));
 
   THIS->lvgl.disp = lv_disp_drv_register( &THIS->lvgl.disp_drv);
@@ -168,6 +245,42 @@ void app_lvgl_load_default_screen(void){
 }
 
 
+static lv_obj_tree_walk_res_t app_lvgl_obj_count_cb( lv_obj_t *obj, void *user_data){
+  (void)obj;
+  *(uint32_t *)user_data += 1;
+  return LV_OBJ_TREE_WALK_NEXT;
+}
+
+/**
+ * @brief Number of LVGL objects, screens and layers included
+ * @note  Walks the object tree with the scheduler suspended, so no task modifies it meanwhile.
+ *        LVGL 9 only exposes the active screen and the layers.
+ */
+uint32_t app_lvgl_obj_count( void){
+  uint32_t num = 0;
+  vTaskSuspendAll();
+#if LVGL_VERSION==836
+  lv_disp_t *disp = lv_disp_get_default();
+  for(uint32_t i=0; disp && i<disp->screen_cnt; ++i){
+    lv_obj_tree_walk( disp->screens[i], app_lvgl_obj_count_cb, &num);
+  }
+  if( disp ){
+    lv_obj_tree_walk( disp->top_layer, app_lvgl_obj_count_cb, &num);
+    lv_obj_tree_walk( disp->sys_layer, app_lvgl_obj_count_cb, &num);
+  }
+#elif LVGL_VERSION==922
+  lv_display_t *disp = lv_display_get_default();
+  if( disp ){
+    lv_obj_tree_walk( lv_display_get_screen_active( disp), app_lvgl_obj_count_cb, &num);
+    lv_obj_tree_walk( lv_display_get_layer_top( disp),     app_lvgl_obj_count_cb, &num);
+    lv_obj_tree_walk( lv_display_get_layer_sys( disp),     app_lvgl_obj_count_cb, &num);
+  }
+#endif
+  xTaskResumeAll();
+  return num;
+}
+
+
 /* ************************************************************************** */
 /*                                 Generated                                  */
 /* ************************************************************************** */
@@ -21,14 +21,19 @@
 /* ************************************************************************** */
 /*                                  Includes                                  */
 /* ************************************************************************** */
+#define TRACE_MODULE  APP_RTOS
+#include <string.h>
 #include "FreeRTOS.h"
 #include "task.h"
 #include "global.h"
 #include "trace.h"
 #include "assert.h"
 #include "app_rtos.h"
+#include "app_rtos_top.h"
+#include "profile.h"
 #include "app_clock.h"
 #include "cmn_type.h"
+#include "cmn_utility.h"
 
 
 #ifdef __cplusplus
@@ -50,11 +55,17 @@ void app_rtos_stop(void){
  * @note All function marked `RTOSIDLE` within the app domain will be called here
  */
 void app_rtos_idle_callback(void) {
+  /* Sample the run-time counter, so a long idle period can NOT hide a wrap of the profiling tick */
+  app_rtos_runtime_counter();
+
   if( 0!=metope.rtos.task.bitmap_idle.clock ){
     app_clock_idle(&metope.app.clock);
     metope.rtos.task.bitmap_idle.clock = 0;
   }
 
+#if (defined TRACE_DEFER) && (TRACE_DEFER==1)
+  trace_defer_flush();
+#endif
 }
 
 
@@ -79,6 +90,52 @@ void app_rtos_checkpoint(void *param) RTOSTHREAD {
 }
 
 
+/**
+ * @brief Run-time counter of FreeRTOS. See `portGET_RUN_TIME_COUNTER_VALUE()`.
+ * @note  The profiling tick wraps in 44s at 96MHz. It is extended to 64 bits here, then scaled down
+ *        by `APP_RTOS_TOP_RUNTIME_SHIFT`. Called at every context switch and from the idle task,
+ *        i.e. much more often than the tick wraps.
+ * @addtogroup FreeRTOS
+ */
+uint32_t app_rtos_runtime_counter(void){
+  static uint32_t last = 0;
+  static uint64_t ext  = 0;
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint32_t now = profile_now();
+  ext  += now - last;
+  last  = now;
+  uint32_t ret = (uint32_t)(ext >> APP_RTOS_TOP_RUNTIME_SHIFT);
+  __set_PRIMASK(primask);
+  return ret;
+}
+
+/**
+ * @brief Run-time counter, stack high-water mark and state of every task
+ * @note  The scheduler is suspended while the task list is copied. Nothing is printed here.
+ * @param [out] sample - One per task
+ * @param [in]  max    - Capacity of `sample`. At most `APP_RTOS_TOP_MAX_TASK`.
+ * @param [out] total  - Run-time counter of the system
+ * @return Number of tasks. 0 if there are more than `max`.
+ */
+uint32_t app_rtos_top_snapshot( tAppRtosTopTask *sample, uint32_t max, uint32_t *total){
+  static const char STATE[] = { [eRunning]='X', [eReady]='R', [eBlocked]='B', [eSuspended]='S', [eDeleted]='D'};
+  static TaskStatus_t status[APP_RTOS_TOP_MAX_TASK];
+
+  uint32_t num = uxTaskGetSystemState( status, CMN_MIN( max, APP_RTOS_TOP_MAX_TASK), total);
+  for(uint32_t i=0; i<num; ++i){
+    sample[i].id         = status[i].xTaskNumber;
+    sample[i].runtime    = status[i].ulRunTimeCounter;
+    sample[i].stack_free = status[i].usStackHighWaterMark * sizeof(StackType_t);
+    sample[i].state      = status[i].eCurrentState<=eDeleted ? STATE[status[i].eCurrentState] : '?';
+    strncpy( sample[i].name, status[i].pcTaskName, APP_RTOS_TOP_NAME_LEN);
+    sample[i].name[APP_RTOS_TOP_NAME_LEN] = '\0';
+  }
+  return num;
+}
+
+
 /**
  * @ref
  *  https://www.freertos.org/Documentation/02-Kernel/02-Kernel-features/12-Hook-functions
@@ -0,0 +1,79 @@
+/**
+ ******************************************************************************
+ * @file    app_rtos_top.c
+ * @author  RandleH
+ * @brief   Application - FreeRTOS Run-time Statistics
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 RandleH.
+ * All rights reserved.
+ *
+ * This software component is licensed by RandleH under BSD 3-Clause license,
+ * the "License"; You may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at:
+ *                        opensource.org/licenses/BSD-3-Clause
+ *
+ ******************************************************************************
+*/
+
+
+/* ************************************************************************** */
+/*                                  Includes                                  */
+/* ************************************************************************** */
+#include <string.h>
+#include "app_rtos_top.h"
+
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @brief CPU share of every task since the last update
+ * @note  Pure bookkeeping of counters, so it also runs on native. The samples come from
+ *        `app_rtos_top_snapshot()` on target. A task created since the last update is charged
+ *        with its whole run-time. The counters are free running and wrap.
+ * @param [inout] top    - Result of the last update. Zero it before the first one.
+ * @param [inout] sample - Run-time counter of every task. `permille` is filled, then the samples
+ *                         are sorted busiest first and copied into `top`.
+ * @param [in]    num    - Number of samples. At most `APP_RTOS_TOP_MAX_TASK`.
+ * @param [in]    total  - Run-time counter of the system
+ */
+void app_rtos_top_update( tAppRtosTop *top, tAppRtosTopTask *sample, uint32_t num, uint32_t total){
+  const uint32_t period = total - top->total;
+
+  for(uint32_t i=0; i<num; ++i){
+    uint32_t delta = sample[i].runtime;
+    for(uint32_t j=0; j<top->num; ++j){
+      if( top->task[j].id==sample[i].id ){
+        delta -= top->task[j].runtime;
+        break;
+      }
+    }
+    uint64_t permille   = period ? ((uint64_t)delta*1000U)/period : 0;
+    sample[i].permille  = (uint16_t)(permille>1000U ? 1000U : permille);
+  }
+
+  /* Busiest first */
+  for(uint32_t i=1; i<num; ++i){
+    tAppRtosTopTask tmp = sample[i];
+    uint32_t        j   = i;
+    for(; j>0 && sample[j-1].permille<tmp.permille; --j){
+      sample[j] = sample[j-1];
+    }
+    sample[j] = tmp;
+  }
+
+  memcpy( top->task, sample, num*sizeof(tAppRtosTopTask));
+  top->num    = num;
+  top->total  = total;
+  top->period = period;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+/* ********************************** EOF *********************************** */
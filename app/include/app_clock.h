@@ -82,6 +82,32 @@ typedef struct stAppClock{
 void app_clock_main(void *param) RTOSTHREAD;
 void app_clock_idle(void *param) RTOSIDLE;
 
+#if ((defined BENCH_RENDER) && (BENCH_RENDER==1)) || ((defined UNIT_TEST) && (UNIT_TEST==1))
+void         app_clock_bench_open       (tAppClock *p_app_clock, AppGuiClockEnum_t x);
+cmnBoolean_t app_clock_bench_set_battery(tAppClock *p_app_clock, uint8_t battery_percentage_256);
+void         app_clock_bench_close      (tAppClock *p_app_clock);
+#endif
+
+#if (defined BENCH_RENDER) && (BENCH_RENDER==1)
+/**
+ * @brief Result of a 24h accelerated render benchmark of one clock style
+ */
+typedef struct stAppClockBench{
+  uint32_t step_ms;             /*!< Simulated time per frame */
+  uint32_t num_frame;           /*!< Number of rendered frames */
+  uint32_t num_flush;           /*!< Number of flush callbacks */
+  uint64_t num_pixel;           /*!< Total invalidated area in pixels */
+  uint64_t num_spi_byte;        /*!< Total bytes sent to the screen */
+  uint64_t render_cyc_sum;      /*!< Total cycles spent in `set_time`/`inc_time`/`idle` + render */
+  uint32_t render_cyc_min;      /*!< Fastest frame in cycles */
+  uint32_t render_cyc_max;      /*!< Slowest frame in cycles */
+  size_t   heap_min_free;       /*!< Lowest free heap observed after a frame */
+  size_t   heap_min_ever_free;  /*!< FreeRTOS heap high-water mark since boot */
+} tAppClockBench;
+
+void app_clock_bench_render(tAppClock *p_app_clock, AppGuiClockEnum_t x, uint32_t step_ms, tAppClockBench *result);
+#endif
+
 #if (defined UNIT_TEST) && (UNIT_TEST==1)
 extern void         app_clock_gui_switch         (AppGuiClockEnum_t x);
 extern void         app_clock_idle_timer_callback(xTimerHandle xTimer);
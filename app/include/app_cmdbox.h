@@ -33,9 +33,82 @@
 /*                              Public Macros                                 */
 /* ************************************************************************** */
 #define MAX_NUN_ARGS_SUPPORTED      8
-#define MAX_NUM_PENDING             2
+#define MAX_NUM_PENDING             32      /*!< Power of 2. Holds every command of the longest line. */
 #define MAX_CMD_STRING_LEN          BSP_CFG_UART_RX_BUF_SIZE
 
+/**
+ * @note
+ *  Every command of the box: `X( <keyword>, <number of int arguments>)`.
+ *  The callback is `app_cmdbox_callback_<nargs>args_<keyword>()` in `app_cmdbox_callback.h`.
+ *  The keywords are dispatched by the perfect hash of `app_cmdbox_hash.h`, which is generated
+ *  from this list by `tool/cmdbox.py`. CMake runs it whenever this file changes.
+ */
+#define APP_CMDBOX_LIST( X)   \
+  X( CCW,       1 )           \
+  X( CW,        1 )           \
+  X( CRASH,     0 )           \
+  X( DISPBR,    1 )           \
+  X( DISPOFF,   0 )           \
+  X( DISPON,    0 )           \
+  X( GT,        0 )           \
+  X( LOG,       2 )           \
+  X( LOGLS,     0 )           \
+  X( MCLR,      1 )           \
+  X( MEM,       0 )           \
+  X( MEND,      0 )           \
+  X( MLS,       0 )           \
+  X( MPLAY,     2 )           \
+  X( MREC,      1 )           \
+  X( MSTOP,     0 )           \
+  X( MWAIT,     1 )           \
+  X( PROF,      0 )           \
+  X( PROFRST,   0 )           \
+  X( ST,        6 )           \
+  X( TIMELINE,  0 )           \
+  X( TOP,       0 )
+
+/**
+ * @note
+ *  Binary messages of the framed channel: `X( <name>, <type>)`. The built-in handler is
+ *  `app_cmdbox_frame_<name>()` in `app_cmdbox_callback.h`. Others are added by `app_cmdbox_frame_register()`.
+ *  A request of type `T` is answered by one frame of type `T|APP_CMDBOX_FRAME_REPLY` holding the
+ *  status returned by the handler, then its reply payload. A frame that fails the CRC or has no
+ *  handler is answered by `APP_CMDBOX_FRAME_NAK` holding the error and the type (`0xFF` if unknown).
+ */
+#define APP_CMDBOX_FRAME_LIST( X)                                                                 \
+  X( PING,      0x01 )    /*!< Reply with the same payload                                   */   \
+  X( TIME,      0x02 )    /*!< Set the RTC. year(LE16) month day hour minute second           */
+
+#define APP_CMDBOX_FRAME_TYPE_NUM   (32)                    /*!< Request types `0x00-0x1F` */
+#define APP_CMDBOX_FRAME_REPLY      (0x80)
+#define APP_CMDBOX_FRAME_NAK        (0xFF)
+#define APP_CMDBOX_FRAME_ERR_TYPE   (-4)                    /*!< No handler. Others are `kCmnFrame_Err*`. */
+#define APP_CMDBOX_FRAME_MAX        (MAX_CMD_STRING_LEN)    /*!< Longest payload sent by the device */
+
+/**
+ * @note
+ *  Macros replay recorded commands from the command box task, without the host in the loop.
+ *    MREC <id>            Record macro `id`. The following commands are stored instead of run and
+ *                         answered by `=> REC <seq> <keyword> <step>`.
+ *    MWAIT <ms>           Record a delay
+ *    MEND                 Stop recording. Returns the number of steps.
+ *    MPLAY <id> <times>   Replay `times` times, `0` until `MSTOP`. Every step is answered by
+ *                         `=> RUN <step> <keyword> <return value>` and the replay by `=> END <id> <passes> <ms>`.
+ *    MSTOP                Stop replaying
+ *    MLS                  List the steps of every macro
+ *    MCLR <id>            Forget macro `id`
+ *  Steps hold the matched command and its arguments, so a replay is never parsed again. The delays
+ *  are the timeout of the task between two steps. See `app_cmdbox_macro_poll()`.
+ *  The bank is kept across a reset in `.noinit` RAM and checked by its CRC. It is lost on power off.
+ */
+#define APP_CMDBOX_MACRO_NUM        (4)
+#define APP_CMDBOX_MACRO_STEP_NUM   (16)
+#define APP_CMDBOX_MACRO_NARGS      (6)                     /*!< Most arguments of a command in `APP_CMDBOX_LIST` */
+#define APP_CMDBOX_MACRO_WAIT       (0xFF)                  /*!< Step holding a delay of `args[0]` ms */
+#define APP_CMDBOX_MACRO_WAIT_MAX   (60000)                 /*!< Longest delay of a step in ms */
+#define APP_CMDBOX_MACRO_IDLE       (UINT32_MAX)            /*!< Nothing is replaying */
+#define APP_CMDBOX_MACRO_MAGIC      (0x4D41434FU)
+
 #ifdef __cplusplus
 extern "C"{
 #endif
@@ -51,26 +124,97 @@ typedef struct stAppCmdboxDatabaseListUnit {
   size_t     nargs;
 } tAppCmdboxDatabaseListUnit;
 
-typedef struct stAppCmdboxDatabaseList{
-  const tAppCmdboxDatabaseListUnit *database;
-  const size_t                     len;
-} tAppCmdboxDatabaseList;
+/**
+ * @brief Handler of a binary message. Runs in the command box task.
+ * @param [in]  payload   - Request payload
+ * @param [in]  len       - Length of the request payload
+ * @param [out] reply     - `APP_CMDBOX_FRAME_MAX-1` bytes for the reply payload. The status goes first.
+ * @param [out] reply_len - Length of the reply payload. `0` when untouched.
+ * @return Status sent back to the host
+ */
+typedef int (*tAppCmdboxFrameHandler)(const uint8_t *payload, size_t len, uint8_t *reply, size_t *reply_len);
 
 typedef struct stAppCmdBoxPendingExe {
   arg_t                      args[MAX_NUN_ARGS_SUPPORTED];
   const tAppCmdboxDatabaseListUnit *p_matched_cmd;
+  uint32_t                   seq;         /*!< Sequence number echoed in the reply */
+  uint32_t                   replay;      /*!< Step of the macro plus 1. `0` for a command of the host. */
 } tAppCmdBoxPendingExe;
 
+typedef struct stAppCmdboxMacroStep {
+  uint8_t                    index;       /*!< Command in `APP_CMDBOX_LIST` or `APP_CMDBOX_MACRO_WAIT` */
+  arg_t                      args[APP_CMDBOX_MACRO_NARGS];
+} tAppCmdboxMacroStep;
+
+/**
+ * @note `crc` is the CRC-16 of everything after it. Resealed whenever a macro changes.
+ */
+typedef struct stAppCmdboxMacroBank {
+  uint32_t                   magic;
+  uint32_t                   crc;
+  uint8_t                    len[APP_CMDBOX_MACRO_NUM];
+  tAppCmdboxMacroStep        step[APP_CMDBOX_MACRO_NUM][APP_CMDBOX_MACRO_STEP_NUM];
+} tAppCmdboxMacroBank;
+
+typedef struct stAppCmdboxMacro {
+  tAppCmdboxMacroBank       *bank;        /*!< `NULL` disables the macros */
+  uint8_t                    rec;         /*!< Macro being recorded plus 1. `0` when not recording. */
+  uint8_t                    rec_len;     /*!< Steps recorded so far */
+  uint8_t                    play;        /*!< Macro being replayed plus 1. `0` when not replaying. */
+  uint8_t                    step;        /*!< Next step to replay */
+  uint8_t                    armed;       /*!< The clock starts on the next poll */
+  uint32_t                   times;       /*!< Passes left. `0` until `MSTOP`. */
+  uint32_t                   passes;      /*!< Passes done */
+  uint32_t                   start;       /*!< ms. First poll of the replay. */
+  uint32_t                   due;         /*!< ms. The next step is queued at. */
+} tAppCmdboxMacro;
+
+/**
+ * @note
+ *  Ring of parsed commands. `app_cmdbox_parse()` queues every command of a line, `;` separating
+ *  a batch, and `app_cmdbox_exe()` runs them in order. Every command takes the next sequence number,
+ *  unknown ones included, and gets exactly one reply line, so the host can pipeline commands and
+ *  match the replies by counting:
+ *    => ACK <seq> <keyword> <return value>   Executed
+ *    => NAK <seq> UNKNOWN                    Not a command
+ *    => NAK <seq> BUSY                       The ring was full
+ *  A line lost by the receiver gets no reply. See `tCmnLine` for its counters.
+ *  Replies go straight to `tx`, whatever the trace configuration, so the host can always parse them.
+ */
 typedef struct stAppCmdBox {
-  char                 cmd_buf[BSP_CFG_UART_RX_BUF_SIZE];
   tAppCmdBoxPendingExe pending_exe[MAX_NUM_PENDING];
+  uint32_t             head;              /*!< Commands ever queued. Free running. */
+  uint32_t             tail;              /*!< Commands ever executed. Free running. */
+  uint32_t             seq;               /*!< Sequence number of the next command */
+  uint32_t             unknown;           /*!< Commands rejected as unknown */
+  uint32_t             busy;              /*!< Commands rejected on a full ring */
+  uint32_t             quiet;             /*!< Replies are not printed when non-zero */
+  uint32_t             frames;            /*!< Binary frames received */
+  uint32_t             frame_err;         /*!< Binary frames answered by `APP_CMDBOX_FRAME_NAK` */
+  void               (*tx)(const void *data, size_t len);   /*!< Reply channel. `NULL` is the console. */
+  tAppCmdboxMacro      macro;
 } tAppCmdBox;
 
 #if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
 void app_cmdbox_main(void *param) RTOSTHREAD;
 void app_cmdbox_idle(void *param) RTOSIDLE;
 #endif
-void app_cmdbox_parse(tAppCmdBox *p_cmdbox, const char *cmd);
+void     app_cmdbox_parse(tAppCmdBox *p_cmdbox, const char *cmd);
+uint32_t app_cmdbox_exe(tAppCmdBox *p_cmdbox, uint32_t escape_ms);
+void     app_cmdbox_frame(tAppCmdBox *p_cmdbox, uint8_t *body, size_t len);
+void     app_cmdbox_frame_send(tAppCmdBox *p_cmdbox, uint8_t type, const void *payload, size_t len);
+int      app_cmdbox_frame_register(uint8_t type, tAppCmdboxFrameHandler handler);
+size_t   app_cmdbox_tokenize(const char *cmd, const tAppCmdboxDatabaseListUnit **pp_matched_cmd, arg_t *args);
+
+void     app_cmdbox_macro_init(tAppCmdBox *p_cmdbox, tAppCmdboxMacroBank *bank);
+int      app_cmdbox_macro_record(tAppCmdBox *p_cmdbox, uint32_t id);
+int      app_cmdbox_macro_wait(tAppCmdBox *p_cmdbox, uint32_t ms);
+int      app_cmdbox_macro_end(tAppCmdBox *p_cmdbox);
+int      app_cmdbox_macro_play(tAppCmdBox *p_cmdbox, uint32_t id, uint32_t times);
+int      app_cmdbox_macro_stop(tAppCmdBox *p_cmdbox);
+int      app_cmdbox_macro_list(tAppCmdBox *p_cmdbox);
+int      app_cmdbox_macro_clear(tAppCmdBox *p_cmdbox, uint32_t id);
+uint32_t app_cmdbox_macro_poll(tAppCmdBox *p_cmdbox, uint32_t now_ms);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,35 @@
+/**
+ ******************************************************************************
+ * @file    app_cmdbox_hash.h
+ * @author  RandleH
+ * @brief   Application Program - Command Box Keyword Hash
+ ******************************************************************************
+ * @attention
+ *
+ * Generated by `tool/cmdbox.py` from `APP_CMDBOX_LIST` in `app_cmdbox.h`.
+ * DO NOT EDIT.
+ *
+ ******************************************************************************
+*/
+
+#ifndef APP_CMDBOX_HASH_H
+#define APP_CMDBOX_HASH_H
+
+#include <stdint.h>
+
+#define APP_CMDBOX_HASH_SEED    (0x00000013U)
+#define APP_CMDBOX_HASH_BITS    (6)
+#define APP_CMDBOX_HASH_NUM     (22)
+
+/**
+ * @note Slot => index of the keyword in `APP_CMDBOX_LIST` plus 1. `0` is empty.
+ */
+static const uint8_t APP_CMDBOX_HASH_TABLE[1U<<APP_CMDBOX_HASH_BITS] = {
+  18,  0, 14,  5, 10, 21,  0, 19,  0,  0,  0,  0,  6,  0,  0,  0,
+   0,  0,  0, 13,  0, 20,  0,  0,  0, 17,  0,  1,  0,  9,  0,  0,
+   0,  0, 11,  0,  0,  2,  0,  0,  0,  7,  0,  0,  0,  0, 12,  0,
+   0, 15,  0,  0,  0,  0,  0, 22,  0, 16,  0,  3,  8,  0,  0,  4,
+};
+
+#endif
+/* ********************************** EOF *********************************** */
@@ -32,6 +32,17 @@
 extern "C"{
 #endif
 
+#if (defined BENCH_RENDER) && (BENCH_RENDER==1)
+/**
+ * @brief Flush statistics. Only collected for the render benchmark.
+ */
+typedef struct stAppLvglStat{
+  uint32_t num_flush;     /*!< Number of flush callbacks */
+  uint64_t num_pixel;     /*!< Invalidated area in pixels */
+  uint64_t num_spi_byte;  /*!< Bytes clocked out to the screen, including the area selection */
+} tAppLvglStat;
+#endif
+
 typedef struct stAppLvgl{
 #if LVGL_VERSION==836
   lv_disp_drv_t      disp_drv;
@@ -44,6 +55,9 @@ typedef struct stAppLvgl{
   lv_theme_t   *pLvglTheme;
 #endif
   lv_obj_t *default_scr;
+#if (defined BENCH_RENDER) && (BENCH_RENDER==1)
+  tAppLvglStat stat;
+#endif
 } tAppLvgl;
 
 
@@ -52,6 +66,7 @@ uint32_t app_lvgl_get_tick(void);
 void app_lvgl_init(void);
 void app_lvgl_flush_all( void);
 void app_lvgl_load_default_screen(void);
+uint32_t app_lvgl_obj_count( void);
 
 int app_lvgl_snprintf(char * buffer, size_t count, const char * format, ...);
 int app_lvgl_vsnprintf(char * buffer, size_t count, const char * format, va_list va);
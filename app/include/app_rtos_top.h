@@ -0,0 +1,74 @@
+/**
+ ******************************************************************************
+ * @file    app_rtos_top.h
+ * @author  RandleH
+ * @brief   Application - FreeRTOS Run-time Statistics
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 RandleH.
+ * All rights reserved.
+ *
+ * This software component is licensed by RandleH under BSD 3-Clause license,
+ * the "License"; You may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at:
+ *                        opensource.org/licenses/BSD-3-Clause
+ *
+ ******************************************************************************
+*/
+
+#ifndef APP_RTOS_TOP_H
+#define APP_RTOS_TOP_H
+
+/* ************************************************************************** */
+/*                                  Includes                                  */
+/* ************************************************************************** */
+#include <stdint.h>
+
+
+/* ************************************************************************** */
+/*                              Public Macros                                 */
+/* ************************************************************************** */
+#define APP_RTOS_TOP_MAX_TASK       (12)
+#define APP_RTOS_TOP_NAME_LEN       (8)     /*!< `configMAX_TASK_NAME_LEN` */
+
+/**
+ * @note The run-time counter is the profiling tick divided by 2^N. It wraps every 95min at 96MHz.
+ */
+#define APP_RTOS_TOP_RUNTIME_SHIFT  (7)
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/* ************************************************************************** */
+/*                              Public Objects                                */
+/* ************************************************************************** */
+typedef struct stAppRtosTopTask{
+  uint32_t id;                              /*!< Task number. Unique per task. */
+  uint32_t runtime;                         /*!< Run-time counter of the task. Free running. */
+  uint32_t stack_free;                      /*!< Stack high-water mark in bytes */
+  uint16_t permille;                        /*!< CPU share since the last update. Filled by `app_rtos_top_update()`. */
+  char     state;                           /*!< X=Running R=Ready B=Blocked S=Suspended D=Deleted */
+  char     name[APP_RTOS_TOP_NAME_LEN+1];
+} tAppRtosTopTask;
+
+typedef struct stAppRtosTop{
+  tAppRtosTopTask task[APP_RTOS_TOP_MAX_TASK];  /*!< Samples of the last update. Busiest first. */
+  uint32_t        num;
+  uint32_t        total;                        /*!< Run-time counter at the last update */
+  uint32_t        period;                       /*!< Run-time counter escaped between the last two updates */
+} tAppRtosTop;
+
+void     app_rtos_top_update( tAppRtosTop *top, tAppRtosTopTask *sample, uint32_t num, uint32_t total);
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+uint32_t app_rtos_top_snapshot( tAppRtosTopTask *sample, uint32_t max, uint32_t *total);
+uint32_t app_rtos_runtime_counter( void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/* ********************************** EOF *********************************** */
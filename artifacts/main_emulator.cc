@@ -22,17 +22,88 @@
 /*                                  Includes                                  */
 /* ************************************************************************** */
 #include <stdio.h>
+#include <stdlib.h>
 #include "init.h"
 #include "trace.h"
+#if (defined BENCH_RENDER) && (BENCH_RENDER==1)
+  #include "global.h"
+  #include "app_lvgl.h"
+  #include "app_clock.h"
+  #include "app_rtos.h"
+  #include "timeline.h"
+#endif
 
 #ifdef __cplusplus
 extern "C"{
 #endif
 
+#if (defined BENCH_RENDER) && (BENCH_RENDER==1)
+
+#ifndef BENCH_RENDER_STEP_MS
+  #define BENCH_RENDER_STEP_MS  (1000U)
+#endif
+
+static StaticTask_t bench_render_tcb;
+static StackType_t  bench_render_stack[APP_CFG_TASK_SCREEN_FRESH_STACK_SIZE];
+
+/**
+ * @brief Render Benchmark Task
+ * @note  Output is CSV through semihosting. One header line followed by one line per clock style.
+ *        Run with `qemu-system-arm -M netduinoplus2 -nographic -semihosting-config enable=on,target=native -kernel model1.elf`
+ *        With `-DTIMELINE=1` the task timeline of the last frames follows. See `tool/timeline.py`.
+ */
+static void bench_render_main(void *param) RTOSTHREAD{
+  const char *STYLE_NAME[NUM_OF_AppGuiClock] = {
+    "ClockModern",  /* kAppGuiClock_ClockModern */
+    "NANA",         /* kAppGuiClock_NANA        */
+    "LVVVW"         /* kAppGuiClock_LVVVW       */
+  };
+  tAppClockBench result;
+
+  printf("style,step_ms,frames,flushes,pixels,spi_bytes,cyc_sum,cyc_min,cyc_max,cyc_avg,heap_min_free,heap_min_ever_free\n");
+  for(int i=0; i<NUM_OF_AppGuiClock; ++i){
+    app_clock_bench_render( &metope.app.clock, (AppGuiClockEnum_t)i, BENCH_RENDER_STEP_MS, &result);
+    printf("%s,%lu,%lu,%lu,%llu,%llu,%llu,%lu,%lu,%llu,%lu,%lu\n",
+      STYLE_NAME[i],
+      (unsigned long)result.step_ms,
+      (unsigned long)result.num_frame,
+      (unsigned long)result.num_flush,
+      (unsigned long long)result.num_pixel,
+      (unsigned long long)result.num_spi_byte,
+      (unsigned long long)result.render_cyc_sum,
+      (unsigned long)result.render_cyc_min,
+      (unsigned long)result.render_cyc_max,
+      (unsigned long long)(result.render_cyc_sum / CMN_MAX(result.num_frame, 1U)),
+      (unsigned long)result.heap_min_free,
+      (unsigned long)result.heap_min_ever_free
+    );
+  }
+#if (TIMELINE==1)
+  timeline_dump();
+#endif
+  exit(0);
+}
+#endif
 
 int main(int argc, char *argv[]){
   hw_init();
   TRACE_INFO("System boot completed.");
+
+#if (defined BENCH_RENDER) && (BENCH_RENDER==1)
+  data_init();
+  app_lvgl_init();
+
+  xTaskCreateStatic(\
+    bench_render_main,\
+    "bench_render_main",\
+    sizeof(bench_render_stack) / sizeof(bench_render_stack[0]),\
+    NULL,\
+    kRtosTaskPriority_IMPORTANT,\
+    &bench_render_stack[0],\
+    &bench_render_tcb\
+  );
+  app_rtos_start();
+#endif
   
   return 1;
 }
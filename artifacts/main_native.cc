@@ -24,11 +24,297 @@
 #include "cmn_utility.h"
 #include "app_cmdbox.h"
 #include "trace.h"
+#if (defined UNIT_TEST) && (UNIT_TEST==1)
+  #include "test.hh"
+  #include "cmn_test.hh"
+  #include "perf_test.hh"
+#elif (defined FUZZ) && (FUZZ==1)
+  #include <fcntl.h>
+  #include <signal.h>
+  #include <stdlib.h>
+  #include <string.h>
+  #include <unistd.h>
+  #include <chrono>
+  #include <filesystem>
+  #include <fstream>
+  #include <iostream>
+  #include <iterator>
+  #include <vector>
+  #include <sanitizer/common_interface_defs.h>
+  #include "cmn_line.h"
+#endif
+
+/* ************************************************************************** */
+/*                              Native Test Bench                             */
+/* ************************************************************************** */
+#if (defined UNIT_TEST) && (UNIT_TEST==1)
+  #if (defined INCLUDE_TB_CMN) && (INCLUDE_TB_CMN==1)
+    LocalProjectTest tb_infra_local;
+  #endif
+  #if (defined INCLUDE_TB_PERF) && (INCLUDE_TB_PERF==1)
+    LocalProjectTest tb_infra_perf;
+  #endif
+#endif
 
 #ifdef __cplusplus
 extern "C"{
 #endif
 
+#if (defined UNIT_TEST) && (UNIT_TEST==1)
+/**
+ * @note Native test bench. Return non-zero to the shell if any test failed.
+ */
+int main(int argc, char *argv[]){
+  bool result = true;
+
+#if (defined INCLUDE_TB_CMN) && (INCLUDE_TB_CMN==1)
+  add_cmn_test();
+  cout<<"Local Project Test:"<<endl;
+  result &= tb_infra_local.verdict();
+#endif
+
+#if (defined INCLUDE_TB_PERF) && (INCLUDE_TB_PERF==1)
+  add_perf_test();
+  cout<<"Performance Test:"<<endl;
+  result &= tb_infra_perf.verdict();
+#endif
+
+  return result ? 0 : 1;
+}
+#elif (defined FUZZ) && (FUZZ==1)
+/**
+ * @note Levels of the trace before the first input. `LOG` may change them.
+ */
+static uint8_t fuzz_trace_level[kNumTraceModule];
+
+static void fuzz_sink( const void *data, size_t len){
+  (void)data;
+  (void)len;
+}
+
+/**
+ * @brief One input of the fuzzer: the bytes received by USART2
+ * @note  First the whole input as one command string, then through the receiver, the frame decoder,
+ *        the command box and the macro replay the way `app_cmdbox_main()` runs them. The first byte
+ *        of every chunk picks its length, as the idle line would cut it.
+ *        Every buffer is allocated to its exact size, so the sanitizers catch a byte out of bounds.
+ *        Nothing is kept from one input to the next. The replies and the trace lines go to
+ *        `fuzz_sink()`, so only the verdict is printed.
+ */
+int LLVMFuzzerTestOneInput( const uint8_t *data, size_t size){
+  static bool init = false;
+  if( !init ){
+    for(uint32_t i=0; i<kNumTraceModule; ++i){
+      fuzz_trace_level[i] = trace_module_level[i];
+    }
+    init = true;
+  }
+  trace_level_set( kNumTraceModule, TRACE_LEVEL_OFF);
+  trace_native_sink( fuzz_sink);
+
+  tAppCmdboxMacroBank *bank = (tAppCmdboxMacroBank *)calloc( 1, sizeof(tAppCmdboxMacroBank));
+  tAppCmdBox          *box  = (tAppCmdBox *)calloc( 1, sizeof(tAppCmdBox));
+  box->tx = fuzz_sink;
+  app_cmdbox_macro_init( box, bank);
+
+  char *cmd = (char *)malloc( size+1);
+  memcpy( cmd, data, size);
+  cmd[size] = '\0';
+  app_cmdbox_parse( box, cmd);
+  app_cmdbox_exe( box, 0);
+  free( cmd);
+
+  uint8_t *rx_buf = (uint8_t *)malloc( BSP_CFG_UART_RX_DMA_SIZE);
+  char    *slot   = (char *)malloc( BSP_CFG_UART_RX_LINE_NUM*BSP_CFG_UART_RX_BUF_SIZE);
+  uint32_t rx_pos = 0;
+  uint32_t now_ms = 0;
+  tCmnLine line;
+  cmn_line_init( &line, rx_buf, BSP_CFG_UART_RX_DMA_SIZE, slot, BSP_CFG_UART_RX_LINE_NUM, BSP_CFG_UART_RX_BUF_SIZE);
+
+  for( size_t i=0; i<size; ){
+    size_t n = 1 + data[i] % (BSP_CFG_UART_RX_DMA_SIZE/2);
+    n = (n < size-i) ? n : size-i;
+    for( size_t k=0; k<n; ++k){
+      rx_buf[rx_pos] = data[i+k];
+      rx_pos = (rx_pos+1) % BSP_CFG_UART_RX_DMA_SIZE;
+    }
+    i += n;
+    cmn_line_feed( &line, rx_pos);
+    for( const char *p = cmn_line_front( &line); p != NULL; p = cmn_line_front( &line)){
+      uint8_t *body;
+      size_t   len = cmn_line_frame( &line, &body);
+      if( len != 0 ){
+        app_cmdbox_frame( box, body, len);
+      }else{
+        app_cmdbox_parse( box, p);
+      }
+      cmn_line_pop( &line);
+      app_cmdbox_exe( box, 0);
+    }
+    app_cmdbox_macro_poll( box, now_ms += 10);
+    app_cmdbox_exe( box, 0);
+  }
+
+  /* A few more steps of a replay still going */
+  for( uint32_t k=0, next; k<64 && APP_CMDBOX_MACRO_IDLE != (next = app_cmdbox_macro_poll( box, now_ms)); ++k){
+    app_cmdbox_exe( box, 0);
+    now_ms += (next != 0) ? next : 1;
+  }
+
+  free( slot);
+  free( rx_buf);
+  free( box);
+  free( bank);
+  for(uint32_t i=0; i<kNumTraceModule; ++i){
+    trace_level_set( i, fuzz_trace_level[i]);
+  }
+  trace_native_sink( NULL);
+  return 0;
+}
+
+#if !(defined FUZZ_LIBFUZZER)
+/**
+ * @note Input being run. Written to `crash-<hash>` when a sanitizer stops the program.
+ */
+static std::vector<uint8_t> fuzz_input;
+
+static void fuzz_run( const std::vector<uint8_t> &input){
+  fuzz_input = input;
+  LLVMFuzzerTestOneInput( fuzz_input.data(), fuzz_input.size());
+}
+
+static void fuzz_death( void){
+  uint32_t hash = 0x811C9DC5U;
+  for( uint8_t c : fuzz_input){
+    hash = (hash ^ c) * 0x01000193U;
+  }
+  char name[32];
+  snprintf( name, sizeof(name), "crash-%08x", hash);
+  const int fd = open( name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if( fd >= 0 ){
+    (void)!write( fd, fuzz_input.data(), fuzz_input.size());
+    close( fd);
+  }
+  fprintf( stderr, "==fuzz== Input of %u bytes written to %s\n", (unsigned)fuzz_input.size(), name);
+}
+
+/**
+ * @note ASan calls `fuzz_death()` itself. UBSan of GCC has its own runtime, so it aborts instead.
+ */
+static void fuzz_abort( int sig){
+  fuzz_death();
+  signal( sig, SIG_DFL);
+  raise( sig);
+}
+
+const char *__ubsan_default_options( void){
+  return "abort_on_error=1:print_stacktrace=1";
+}
+
+/**
+ * @brief Mutate a corpus input. Bytes are flipped, set, inserted or erased, keywords and numbers
+ *        are inserted, inputs are spliced.
+ */
+static std::vector<uint8_t> fuzz_mutate( const std::vector<std::vector<uint8_t>> &corpus, uint32_t &seed){
+  auto rand = [&seed]( uint32_t n){ seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5; return n ? seed % n : 0; };
+#define FUZZ_KEYWORD( KEYWORD, NARGS)   #KEYWORD " ",
+  static const char *kToken[] = { APP_CMDBOX_LIST( FUZZ_KEYWORD) ";", "\r\n", "\n", " ", "0", "4294967295", "2147483648", "99999999999" };
+#undef FUZZ_KEYWORD
+  std::vector<uint8_t> input = corpus[rand( corpus.size())];
+  for( uint32_t k=1+rand( 4); k>0; --k){
+    const size_t pos = rand( input.size()+1);
+    switch( rand( 6)){
+      case 0: if( pos<input.size() ){ input[pos] ^= (uint8_t)(1U << rand( 8)); } break;
+      case 1: if( pos<input.size() ){ input[pos] = (uint8_t)rand( 256); } break;
+      case 2: input.insert( input.begin()+pos, (uint8_t)rand( 256)); break;
+      case 3: input.erase( input.begin()+pos, input.begin()+pos+rand( input.size()-pos+1)); break;
+      case 4:{
+        const char *token = kToken[rand( sizeof(kToken)/sizeof(kToken[0]))];
+        input.insert( input.begin()+pos, token, token+strlen( token));
+        break;
+      }
+      default:{
+        const std::vector<uint8_t> &other = corpus[rand( corpus.size())];
+        const size_t                from  = rand( other.size()+1);
+        input.insert( input.begin()+pos, other.begin()+from, other.begin()+from+rand( other.size()-from+1));
+        break;
+      }
+    }
+  }
+  return input;
+}
+
+/**
+ * @brief Replay driver when libFuzzer is not linked. Same command line as libFuzzer for the corpus.
+ * @note  model1.elf [-bench=<passes>] [-mutate=<inputs>] [-seed=<n>] [file | directory ...]
+ *        Every input is run once. Standard input is the only input without a path, as AFL feeds it.
+ *        `-bench` replays the corpus and prints the throughput. `-mutate` runs random mutations of
+ *        the corpus. Other `-<option>=` of libFuzzer are ignored.
+ */
+int main(int argc, char *argv[]){
+  std::vector<std::vector<uint8_t>> corpus;
+  uint32_t bench  = 0;
+  uint32_t mutate = 0;
+  uint32_t seed   = 1;
+
+  for( int i=1; i<argc; ++i){
+    const std::string arg = argv[i];
+    if( arg.rfind( "-bench=", 0)==0 ){
+      bench = (uint32_t)strtoul( &argv[i][7], NULL, 0);
+    }else if( arg.rfind( "-mutate=", 0)==0 ){
+      mutate = (uint32_t)strtoul( &argv[i][8], NULL, 0);
+    }else if( arg.rfind( "-seed=", 0)==0 ){
+      seed = (uint32_t)strtoul( &argv[i][6], NULL, 0) | 1U;
+    }else if( arg[0]=='-' ){
+      continue;
+    }else if( std::filesystem::is_directory( arg) ){
+      for( const auto &entry : std::filesystem::recursive_directory_iterator( arg)){
+        if( entry.is_regular_file() ){
+          std::ifstream f( entry.path(), std::ios::binary);
+          corpus.emplace_back( std::istreambuf_iterator<char>( f), std::istreambuf_iterator<char>());
+        }
+      }
+    }else{
+      std::ifstream f( arg, std::ios::binary);
+      corpus.emplace_back( std::istreambuf_iterator<char>( f), std::istreambuf_iterator<char>());
+    }
+  }
+  __sanitizer_set_death_callback( fuzz_death);
+  signal( SIGABRT, fuzz_abort);
+
+  if( corpus.empty() ){
+    fuzz_run( std::vector<uint8_t>( std::istreambuf_iterator<char>( std::cin), std::istreambuf_iterator<char>()));
+    return 0;
+  }
+
+  size_t bytes = 0;
+  for( const auto &input : corpus){
+    fuzz_run( input);
+    bytes += input.size();
+  }
+  fprintf( stderr, "==fuzz== %u inputs of %u bytes passed\n", (unsigned)corpus.size(), (unsigned)bytes);
+
+  if( bench != 0 ){
+    auto start = std::chrono::steady_clock::now();
+    for( uint32_t n=0; n<bench; ++n){
+      for( const auto &input : corpus){
+        LLVMFuzzerTestOneInput( input.data(), input.size());
+      }
+    }
+    const double sec = std::chrono::duration<double>( std::chrono::steady_clock::now() - start).count();
+    fprintf( stderr, "fuzz,bench,inputs_per_s,%u,bytes_per_s,%u\n", (unsigned)(bench*corpus.size()/sec), (unsigned)(bench*bytes/sec));
+  }
+
+  for( uint32_t n=0; n<mutate; ++n){
+    fuzz_run( fuzz_mutate( corpus, seed));
+  }
+  if( mutate != 0 ){
+    fprintf( stderr, "==fuzz== %u mutations passed\n", (unsigned)mutate);
+  }
+  return 0;
+}
+#endif
+#else
 int main(int argc, char *argv[]){
   TRACE_INFO("Hello world");
   tAppCmdBox metope_app_cmdbox = {{0}};
@@ -40,6 +326,7 @@ int main(int argc, char *argv[]){
   
   return 0;
 }
+#endif
 
 /**
  * @note Misc `cmnDateTime_t` | `cmn_utility_timediff()`
@@ -56,6 +56,9 @@ int main(int argc, char *argv[]){
   os_init();
 
   TRACE_INFO("System boot completed.");
+  if( trace_crash.magic==TRACE_CRASH_FROZEN ){
+    TRACE_WARNING("Crash record of the last boot found. Send `CRASH` to dump it.");
+  }
 
 #if 1
   {
@@ -29,7 +29,10 @@
 #include "cmn_test.hh"
 #include "bsp_test.hh"
 #include "app_test.hh"
+#include "perf_test.hh"
+#include "render_test.hh"
 #include "bsp_cpu.h"
+#include "app_lvgl.h"
 
 /* ************************************************************************** */
 /*                             Compiling Assertion                            */
@@ -79,6 +82,29 @@ int main(int argc, char *argv[]){
   cout<<"RTOS Test:"<<endl;
   tb_infra_os.verdict();
 #endif
+
+#if (defined INCLUDE_TB_PERF) && (INCLUDE_TB_PERF==1)
+  data_init();
+  app_lvgl_init();
+  add_perf_test();
+  cout<<"Performance Test:"<<endl;
+  tb_infra_perf.verdict();
+#endif
+
+#if (defined INCLUDE_TB_RENDER) && (INCLUDE_TB_RENDER==1)
+  #if !((defined INCLUDE_TB_PERF) && (INCLUDE_TB_PERF==1))
+  data_init();
+  app_lvgl_init();
+  #endif
+  add_render_test();
+  cout<<"Render Test:"<<endl;
+  tb_infra_render.verdict();
+#endif
+
+#if (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  /* Leave QEMU through semihosting so scripts can collect the whole log */
+  exit(0);
+#endif
   
   while(1){}
 }
@@ -20,6 +20,7 @@
 /* ************************************************************************** */
 /*                                  Includes                                  */
 /* ************************************************************************** */
+#define TRACE_MODULE  BSP_BATTERY
 #include "device.h"
 #include "global.h"
 #include "trace.h"
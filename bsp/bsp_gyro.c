@@ -20,12 +20,15 @@
 /* ************************************************************************** */
 /*                                  Includes                                  */
 /* ************************************************************************** */
+#define TRACE_MODULE  BSP_GYRO
 #include "device.h"
 #include "trace.h"
+#include "profile.h"
 #include "global.h"
 #include "assert.h"
 #include "bsp_gyro.h"
 #include "cmn_delay.h"
+#include "cmn_burst.h"
 
 /* ************************************************************************** */
 /*                                  Macros                                    */
@@ -189,6 +192,13 @@
 
 #define QMI8658_TIMEOUT_DELAY                   (200)  // ms
 
+/**
+ * @note The FIFO drain is walked by the INT1, INT2 and I2C interrupts of different priorities
+ */
+#define QMI8658_FIFO_LOCK()                     uint32_t primask = __get_PRIMASK(); __disable_irq()
+#define QMI8658_FIFO_UNLOCK()                   __set_PRIMASK(primask)
+#define QMI8658_BUS_FREE_LOOP                   (SystemCoreClock/40000U)  // About 100us. A stop condition takes a few us.
+
 #ifdef __cplusplus
 extern "C"{
 #endif
@@ -498,7 +508,9 @@ STATIC cmnBoolean_t                     bsp_qmi8658_i2c_polling_recv         ( u
 #if 0 /* Currently no requirement for dma tx */
 STATIC cmnBoolean_t                     bsp_qmi8658_i2c_dma_send             ( u8 reg, const u8 *buf, u8 len);
 #endif
-STATIC cmnBoolean_t                     bsp_qmi8658_i2c_dma_recv             ( u8 reg, u8 *buf, u8 len);
+STATIC cmnBoolean_t                     bsp_qmi8658_i2c_dma_recv             ( u8 reg, u8 *buf, u16 len);
+STATIC cmnBoolean_t                     bsp_qmi8658_i2c_it_send              ( u8 reg, u8 *buf, u16 len);
+STATIC int                              bsp_qmi8658_fifo_bus                 ( void *param, uint8_t op, uint8_t reg, uint8_t *buf, size_t len);
 STATIC u8                               bsp_qmi8658_i2c_polling_recv_1byte   ( u8 reg);
 STATIC void                             bsp_qmi8658_i2c_polling_send_1byte   ( u8 reg, u8 val);
 STATIC INLINE cmnBoolean_t              bsp_qmi8658_is_ready                 (void);
@@ -511,6 +523,28 @@ STATIC cmnBoolean_t                     bsp_qmi8658_ctrl9_protocol           ( u
 
 
 
+/* ************************************************************************** */
+/*                             Private Variables                              */
+/* ************************************************************************** */
+/**
+ * @brief Register sequence reading one watermark of samples
+ * @ref   Ctrl9 protocol - Read | FIFO read
+ * @note  INT1 reports the Ctrl9 command done. Rewriting FIFO_CTRL leaves the FIFO read mode.
+ */
+static const tCmnBurstStep bsp_qmi8658_fifo_step[] = {
+  { kCmnBurst_Write, QMI8658_REG_CTRL9,     QMI8658_CTRL9_CMD_REQ_FIFO },
+  { kCmnBurst_Wait,  0,                     0                          },
+  { kCmnBurst_Write, QMI8658_REG_CTRL9,     QMI8658_CTRL9_CMD_ACK      },
+  { kCmnBurst_Read,  QMI8658_REG_FIFO_DATA, 0                          },
+  { kCmnBurst_Write, QMI8658_REG_FIFO_CTRL, 0x0E                       },  /* Stream | 128 Samples */
+  { kCmnBurst_End,   0,                     0                          }
+};
+
+static tCmnBurst          bsp_qmi8658_fifo;
+static tBspGyroFifoSample bsp_qmi8658_fifo_buf[2][BSP_QMI8658_FIFO_WTM];
+
+
+
 /* ************************************************************************** */
 /*                             Public Functions                               */
 /* ************************************************************************** */
@@ -692,7 +726,10 @@ cmnBoolean_t bsp_qmi8658_update( tBspGyroData *data){
   data->temperature = (((int16_t)tmp[QMI8658_REG_TEMPERATURE_H-QMI8658_REG_TEMPERATURE_L] << 8) | tmp[QMI8658_REG_TEMPERATURE_L-QMI8658_REG_TEMPERATURE_L]);
 #endif
 
-  return bsp_qmi8658_i2c_polling_recv( QMI8658_REG_TEMPERATURE_L, &data->raw[0], sizeof(data->raw));
+  PROFILE_BEGIN( QMI8658_UPDATE);
+  cmnBoolean_t ret = bsp_qmi8658_i2c_polling_recv( QMI8658_REG_TEMPERATURE_L, &data->raw[0], sizeof(data->raw));
+  PROFILE_END( QMI8658_UPDATE);
+  return ret;
 }
 
 
@@ -751,7 +788,7 @@ cmnBoolean_t bsp_qmi8658_fifo_enable(void){
   };
   bsp_qmi8658_i2c_polling_send( QMI8658_REG_FIFO_CTRL, &reg_fifo_ctrl.reg, 1);
 
-  ret |= bsp_qmi8658_fifo_set_watermark(64);
+  ret |= bsp_qmi8658_fifo_set_watermark(BSP_QMI8658_FIFO_WTM);
 
   /* Setup Interrupt */
   /**
@@ -779,40 +816,112 @@ cmnBoolean_t bsp_qmi8658_fifo_enable(void){
   reg_ctrl7.syncSmpl = 0;
   bsp_qmi8658_i2c_polling_send( QMI8658_REG_CTRL7, &reg_ctrl7.reg, 1);
 
-  tQmi8658RegFIFO_STATUS reg_fifo_status;
-  bsp_qmi8658_i2c_polling_recv( QMI8658_REG_FIFO_STATUS, &reg_fifo_status.reg, 1);
-  
-  volatile u8 reg_fifo_samp_cnt;
-  reg_fifo_samp_cnt = bsp_qmi8658_fifo_get_sample_cnt();
-  UNUSED(reg_fifo_samp_cnt);
-  
-  ret |= bsp_qmi8658_ctrl9_protocol(QMI8658_CTRL9_CMD_REQ_FIFO);
-
-  /* Adjust I2C DMA speed below FIFO ODR */
+  /* The FIFO is read by `bsp_qmi8658_fifo_start()` */
 
   return ret;
 }
 
 
 /**
- * @brief Keep updating the data
- * @attention Buffer `data` MUST be valid until `bsp_qmi8658_stop_updating()` is called
- * @param [in] data - Buffer pointer
- * @return 
+ * @brief Keep reading the FIFO in bursts, without polling
+ * @note  INT2 rises at the watermark and starts the register sequence. The burst is read by DMA
+ *        into one half of a double buffer while the consumer reads the other one.
+ *        At 2KHz a burst of 64 samples is due every 32ms and takes about 20ms on the I2C bus.
+ * @attention The I2C bus belongs to the FIFO from now on. Do NOT call the polling functions.
+ * @return `SUCCESS` | `ERROR`
  */
-cmnBoolean_t bsp_qmi8658_dma_update( tBspGyroData *data){
-  if(false==bsp_qmi8658_is_ready()){
+cmnBoolean_t bsp_qmi8658_fifo_start( void){
+  if( SUCCESS!=bsp_qmi8658_fifo_enable()){
     return ERROR;
   }
+  cmn_burst_init( &bsp_qmi8658_fifo, bsp_qmi8658_fifo_step, bsp_qmi8658_fifo_bus, NULL, bsp_qmi8658_fifo_buf[0][0].raw, sizeof(bsp_qmi8658_fifo_buf[0]));
 
-  data->acc_sensitivity = bsp_qmi8658_acc_scale_2_sensitivity(QMI8658_DEFAULT_ACC_SCALE);
-  data->deg_sensitivity = bsp_qmi8658_gyro_scale_2_sensitivity(QMI8658_DEFAULT_GYRO_SCALE);
+  /* The watermark may be crossed already and INT2 is edge triggered */
+  bsp_qmi8658_int2_isr();
+  return SUCCESS;
+}
 
-  if(metope.rtos.status->running[0]){
-    //...//
+/**
+ * @brief Oldest burst of `BSP_QMI8658_FIFO_WTM` samples
+ * @note  The burst stays valid until `bsp_qmi8658_fifo_pop()`. Call it periodically: a transfer of
+ *        the drain that failed to start is started again from here.
+ * @param [in] timeout - Milliseconds to wait for a burst when running under the RTOS
+ * @return Samples. `NULL` if nothing was read.
+ */
+const tBspGyroFifoSample *bsp_qmi8658_fifo_front( u32 timeout){
+  const u8 *burst = cmn_burst_front( &bsp_qmi8658_fifo);
+  if( burst==NULL ){
+    /* No interrupt comes after a transfer that failed to start. The consumer starts it again. */
+    QMI8658_FIFO_LOCK();
+    cmn_burst_retry( &bsp_qmi8658_fifo);
+    QMI8658_FIFO_UNLOCK();
+  }
+  if( burst==NULL && timeout!=0 && metope.rtos.status->running[0]){
+    xEventGroupWaitBits( metope.rtos.event._handle, CMN_EVENT_QMI8658_RX_CPLT, pdTRUE, pdFALSE, pdMS_TO_TICKS(timeout));
+    burst = cmn_burst_front( &bsp_qmi8658_fifo);
   }
+  return (const tBspGyroFifoSample *)burst;
+}
 
-  return bsp_qmi8658_i2c_dma_recv( QMI8658_REG_TEMPERATURE_L , &data->raw[0], sizeof(data->raw));
+/**
+ * @brief Release the oldest burst
+ * @note  A watermark held while both halves were taken is read now.
+ */
+void bsp_qmi8658_fifo_pop( void){
+  QMI8658_FIFO_LOCK();
+  cmn_burst_pop( &bsp_qmi8658_fifo);
+  QMI8658_FIFO_UNLOCK();
+}
+
+
+
+/* ************************************************************************** */
+/*                            Interrupt Functions                             */
+/* ************************************************************************** */
+/**
+ * @brief INT1 rising edge. Ctrl9 command done.
+ */
+void bsp_qmi8658_int1_isr( void){
+  QMI8658_FIFO_LOCK();
+  metope.bsp.status->B5[0] = 1;
+  if( bsp_qmi8658_fifo.step!=NULL ){
+    cmn_burst_irq( &bsp_qmi8658_fifo);
+  }
+  QMI8658_FIFO_UNLOCK();
+}
+
+/**
+ * @brief INT2 rising edge. FIFO watermark.
+ */
+void bsp_qmi8658_int2_isr( void){
+  QMI8658_FIFO_LOCK();
+  metope.bsp.status->B6[0] = 1;
+  if( bsp_qmi8658_fifo.step!=NULL ){
+    PROFILE_BEGIN( QMI8658_FIFO);
+    cmn_burst_trigger( &bsp_qmi8658_fifo);
+    PROFILE_END( QMI8658_FIFO);
+  }
+  QMI8658_FIFO_UNLOCK();
+}
+
+/**
+ * @brief I2C1 transfer of the FIFO drain ended
+ * @param [in] ret - `SUCCESS` | `ERROR`
+ * @return Number of bursts completed
+ */
+u32 bsp_qmi8658_i2c_isr( cmnBoolean_t ret){
+  QMI8658_FIFO_LOCK();
+  PROFILE_BEGIN( QMI8658_FIFO);
+  const u32 head = bsp_qmi8658_fifo.head;
+  cmn_burst_done( &bsp_qmi8658_fifo, ret);
+
+  /* INT2 is a level. It stays high when the FIFO was refilled past the watermark meanwhile. */
+  if( !bsp_qmi8658_fifo.busy && GPIO_PIN_SET==HAL_GPIO_ReadPin( GYRO_INT2_GPIO_Port, GYRO_INT2_Pin)){
+    cmn_burst_trigger( &bsp_qmi8658_fifo);
+  }
+  PROFILE_END( QMI8658_FIFO);
+  QMI8658_FIFO_UNLOCK();
+  return bsp_qmi8658_fifo.head - head;
 }
 
 
@@ -922,39 +1031,62 @@ STATIC cmnBoolean_t bsp_qmi8658_i2c_dma_send( u8 reg, const u8 *buf, u8 len){
 #endif
 
 /**
- * @brief
- * @todo
+ * @brief Start reading without waiting
  * @param [in]  reg - Register address
  * @param [out] buf - Received data
  * @param [in]  len - Num of items
  * @return `SUCCESS` | `ERROR`
+ * @note
+ *  Phase 1: The I2C event interrupt sends the register address, then the DMA takes over.
+ *  Phase 2: DMA Interrupt will be triggered. Entering the `DMA1_Stream0_IRQHandler()`
+ *  Phase 3: `HAL_DMA_IRQHandler()` will be called.
+ *  Phase 4: `I2C_DMAXferCplt()` function will be called. This callback was configed during DMA requesting to send.
+ *  Phase 5: `HAL_I2C_MemRxCpltCallback()` will be called if no error. Otherwise `HAL_I2C_ErrorCallback()`.
  * @addtogroup MachineDependent
  */
-STATIC cmnBoolean_t bsp_qmi8658_i2c_dma_recv( u8 reg, u8 *buf, u8 len){
-  HAL_StatusTypeDef ret = HAL_I2C_Mem_Read_DMA( &hi2c1, QMI8658_SLAVE_ADDRESS, reg, I2C_MEMADD_SIZE_8BIT, (u8*)buf, len);
+STATIC cmnBoolean_t bsp_qmi8658_i2c_dma_recv( u8 reg, u8 *buf, u16 len){
+  HAL_StatusTypeDef ret = HAL_I2C_Mem_Read_DMA( &hi2c1, QMI8658_SLAVE_ADDRESS, reg, I2C_MEMADD_SIZE_8BIT, buf, len);
   if(HAL_OK!=ret){
     return ERROR;
   }
+  metope.bsp.status->i2c1[0] = BUSY;
+  return SUCCESS;
+}
 
-  /**
-   * @note
-   *  Phase 1: DMA Request to send bytes
-   *  Phase 2: DMA Interrupt will be triggered. Entering the `DMA1_Stream4_IRQHandler()`
-   *  Phase 3: `HAL_DMA_IRQHandler()` will be called.
-   *  Phase 4: `I2C_DMAXferCplt()` function will be called. This callback was configed during DMA requesting to send.
-   *  Phase 5: `HAL_I2C_SlaveRxCpltCallback()` will be called if no error. This is a weak function.
-   *  Phase 6: The escape function shall be notified to come back.
-   */
-  
-  // if(metope.rtos.status->running[0]){
-  //   xEventGroupWaitBits( metope.rtos.event._handle, CMN_EVENT_QMI8658_TX_CPLT, pdTRUE, pdFALSE, portMAX_DELAY);
-  // }else{
-  //   while(IDLE!=metope.bsp.status->i2c1[0]);
-  // }
-
+/**
+ * @brief Start writing without waiting
+ * @note  `HAL_I2C_MemTxCpltCallback()` will be called by the I2C event interrupt if no error.
+ * @param [in] reg - Register address
+ * @param [in] buf - Data. MUST be valid until the transfer ends.
+ * @param [in] len - Num of items
+ * @return `SUCCESS` | `ERROR`
+ * @addtogroup MachineDependent
+ */
+STATIC cmnBoolean_t bsp_qmi8658_i2c_it_send( u8 reg, u8 *buf, u16 len){
+  HAL_StatusTypeDef ret = HAL_I2C_Mem_Write_IT( &hi2c1, QMI8658_SLAVE_ADDRESS, reg, I2C_MEMADD_SIZE_8BIT, buf, len);
+  if(HAL_OK!=ret){
+    return ERROR;
+  }
+  metope.bsp.status->i2c1[0] = BUSY;
   return SUCCESS;
 }
 
+/**
+ * @brief Bus of the FIFO drain. See `tCmnBurstBus`.
+ * @note  Called with the interrupts masked. The HAL would spin up to 25ms on a busy line before
+ *        it gives up, so only the stop condition of the previous transfer is waited for here.
+ */
+STATIC int bsp_qmi8658_fifo_bus( void *param, uint8_t op, uint8_t reg, uint8_t *buf, size_t len){
+  UNUSED(param);
+  for( u32 cnt=QMI8658_BUS_FREE_LOOP; __HAL_I2C_GET_FLAG( &hi2c1, I2C_FLAG_BUSY)!=RESET; --cnt){
+    if( cnt==0 ){
+      return -1;
+    }
+  }
+  cmnBoolean_t ret = (op==kCmnBurst_Read) ? bsp_qmi8658_i2c_dma_recv( reg, buf, (u16)len) : bsp_qmi8658_i2c_it_send( reg, buf, (u16)len);
+  return ret==SUCCESS ? 0 : -1;
+}
+
 /**
  * @brief Read 1 byte from register
  */
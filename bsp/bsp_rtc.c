@@ -25,6 +25,7 @@
 #include "bsp_rtc.h"
 #include "device.h"
 #include "global.h"
+#include "profile.h"
 
 
 
@@ -221,8 +222,11 @@ cmnDateTime_t bsp_rtc_get_time__debug( u8 *raw_7){
  * @return Return Time Info aligned with `cmnDataTime_t`
  */
 cmnDateTime_t bsp_rtc_get_time(void){
+  PROFILE_BEGIN( RTC_GET_TIME);
   u8 raw_7[7];
-  return bsp_rtc_get_time__debug(raw_7);
+  cmnDateTime_t time = bsp_rtc_get_time__debug(raw_7);
+  PROFILE_END( RTC_GET_TIME);
+  return time;
 }
 
 
@@ -25,6 +25,7 @@
 #include <stdbool.h>
 #include "device.h"
 #include "global.h"
+#include "profile.h"
 #include "bsp_screen.h"
 #include "bsp_timer.h"
 #include "cmn_delay.h"
@@ -526,7 +527,9 @@ void bsp_screen_main(void *param) RTOSTHREAD{
   while(1){
     vTaskDelayUntil( &xLastWakeTime, CAST(param)->refresh_rate_ms);
     lv_tick_inc(CAST(param)->refresh_rate_ms);
+    PROFILE_BEGIN( LV_TIMER);
     lv_timer_handler();
+    PROFILE_END( LV_TIMER);
   }
 #undef CAST
 }
@@ -27,33 +27,140 @@
 #include "cmn_type.h"
 #include "cmn_utility.h"
 #include "cmn_delay.h"
+#include "cmn_ring.h"
 
 
 /* ************************************************************************** */
 /*                               Private Macros                               */
 /* ************************************************************************** */
-#define BSP_UART_PRINTF_BUF_SIZE         256
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6)
+  /* USART2_TX: DMA1 Stream6 Channel4 */
+  #define BSP_UART_TX_DMA_FLAGS     (DMA_HISR_TCIF6 | DMA_HISR_HTIF6 | DMA_HISR_TEIF6 | DMA_HISR_DMEIF6 | DMA_HISR_FEIF6)
+  /* USART2_RX: DMA1 Stream5 Channel4 */
+  #define BSP_UART_RX_DMA_FLAGS     (DMA_HISR_TCIF5 | DMA_HISR_HTIF5 | DMA_HISR_TEIF5 | DMA_HISR_DMEIF5 | DMA_HISR_FEIF5)
+#endif
+
+#define BSP_UART_RX_ERROR_FLAGS     (USART_SR_ORE | USART_SR_NE | USART_SR_FE | USART_SR_PE)
 
 
 /* ************************************************************************** */
-/*                              Public Functions                              */
+/*                              Private Functions                             */
 /* ************************************************************************** */
 #ifdef __cplusplus
 extern "C"{
 #endif
 
+/**
+ * @brief Start sending a chunk of the TX ring
+ * @note  The caller owns the ring consumer. Nothing happens if `len==0`.
+ * @note  QEMU does NOT model the DMA, so the emulator sends by polling until the ring is empty.
+ * @return Length of the first chunk. 0 if nothing was started.
+ */
+static size_t bsp_uart_tx_start( tBspUart *p_uart, const uint8_t *ptr, size_t len){
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6)
+  if( len ){
+    p_uart->tx_dma_len  = len;
+    DMA1->HIFCR         = BSP_UART_TX_DMA_FLAGS;
+    DMA1_Stream6->M0AR  = (uint32_t)ptr;
+    DMA1_Stream6->NDTR  = len;
+    DMA1_Stream6->CR   |= DMA_SxCR_EN;
+  }
+  return len;
+#else
+  size_t first = len;
+  while( len ){
+    for( size_t i = 0; i < len; ++i) {
+      /* Wait until DR can accept new data */
+      while( 0 == (USART2->SR & USART_SR_TXE));
+      USART2->DR = ptr[i];
+    }
+    len = cmn_ring_next( &p_uart->tx_ring, len, &ptr);
+  }
+  return first;
+#endif
+}
+
+/**
+ * @brief Position the receiver writes next in `rx_dma_buf`
+ * @note  QEMU does NOT model the DMA. The emulator receives by interrupt and moves the position by itself.
+ */
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6)
+static uint32_t bsp_uart_rx_pos( void){
+  uint32_t pos = BSP_CFG_UART_RX_DMA_SIZE - DMA1_Stream5->NDTR;
+  return pos==BSP_CFG_UART_RX_DMA_SIZE ? 0 : pos;
+}
+#else
+static uint32_t bsp_uart_rx_emulated_pos = 0;
+
+static uint32_t bsp_uart_rx_pos( void){
+  return bsp_uart_rx_emulated_pos;
+}
+#endif
+
+/**
+ * @brief Start the consumer if it is idle
+ * @return Length of the chunk started. 0 if the consumer was busy or nothing was ready.
+ */
+static size_t bsp_uart_tx_kick( tBspUart *p_uart){
+  const uint8_t *ptr = NULL;
+  size_t         len = cmn_ring_claim( &p_uart->tx_ring, &ptr);
+  return bsp_uart_tx_start( p_uart, ptr, len);
+}
+
+/**
+ * @brief Queue a message and start the DMA if it is idle
+ * @return `SUCCESS` | `ERROR` - The ring was full and the message was dropped
+ */
+static int bsp_uart_tx_queue( tBspUart *p_uart, const void *data, size_t len){
+  int ret = cmn_ring_write( &p_uart->tx_ring, data, len)==len ? SUCCESS : ERROR;
+  bsp_uart_tx_kick( p_uart);
+  return ret;
+}
+
+
+/* ************************************************************************** */
+/*                              Public Functions                              */
+/* ************************************************************************** */
 void bsp_uart_init(void) {
   tBspUart *p_uart = &metope.bsp.uart;
 
+  cmn_line_init( &p_uart->rx_line, p_uart->rx_dma_buf, BSP_CFG_UART_RX_DMA_SIZE, p_uart->rx_line_buf, BSP_CFG_UART_RX_LINE_NUM, BSP_CFG_UART_RX_BUF_SIZE);
+
 #ifndef UNIT_TEST
-  /* Use RX interrupt for main program */
+  /* Receive lines for the main program */
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6)
+  /* Peripheral to memory. Byte wide. Circular. Interrupt on half and full transfer and error. */
+  DMA1_Stream5->CR  &= ~DMA_SxCR_EN;
+  while( 0 != READ_BIT( DMA1_Stream5->CR, DMA_SxCR_EN));
+  DMA1_Stream5->CR   = DMA_CHANNEL_4 | DMA_PERIPH_TO_MEMORY | DMA_MINC_ENABLE | DMA_CIRCULAR | DMA_IT_HT | DMA_IT_TC | DMA_IT_TE;
+  DMA1_Stream5->FCR  = 0;
+  DMA1_Stream5->PAR  = (uint32_t)(&(USART2->DR));
+  DMA1_Stream5->M0AR = (uint32_t)p_uart->rx_dma_buf;
+  DMA1_Stream5->NDTR = BSP_CFG_UART_RX_DMA_SIZE;
+  DMA1->HIFCR        = BSP_UART_RX_DMA_FLAGS;
+  DMA1_Stream5->CR  |= DMA_SxCR_EN;
+  USART2->CR3       |= USART_CR3_DMAR;
+  USART2->CR1       |= USART_CR1_IDLEIE;
+#else
   USART2->CR1 |= USART_CR1_RXNEIE;
+#endif
   USART2->CR3 |= USART_CR3_EIE;
 #endif
 
-  p_uart->rx_buf[BSP_CFG_UART_RX_BUF_SIZE] = '\0';
-  p_uart->rx_status.word                   = 0;
-  p_uart->rx_idx                           = 0;
+  cmn_ring_init( &p_uart->tx_ring, p_uart->tx_ring_buf, BSP_CFG_UART_TX_RING_SIZE);
+  p_uart->tx_dma_len = 0;
+
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6)
+  /* Memory to peripheral. Byte wide. Direct mode. Interrupt on transfer complete and error. */
+  DMA1_Stream6->CR  &= ~DMA_SxCR_EN;
+  while( 0 != READ_BIT( DMA1_Stream6->CR, DMA_SxCR_EN));
+  DMA1_Stream6->CR   = DMA_CHANNEL_4 | DMA_MEMORY_TO_PERIPH | DMA_MINC_ENABLE | DMA_IT_TC | DMA_IT_TE;
+  DMA1_Stream6->FCR  = 0;
+  DMA1_Stream6->PAR  = (uint32_t)(&(USART2->DR));
+  DMA1->HIFCR        = BSP_UART_TX_DMA_FLAGS;
+  USART2->CR3       |= USART_CR3_DMAT;
+#endif
+  USART2->CR1 |= USART_CR1_TE;
 }
 
 /**
@@ -62,104 +169,163 @@ void bsp_uart_init(void) {
  * @param [in] ...    - Must be `uint32_t` / `int32_t`
  * @note  Only support `%u` | `%x` | `%d` with width indicator
  * @note  Automatically end with a new line
- * @return `SUCCESS` | `ERROR` - Something wrong with prarmeters
+ * @note  Never blocks. Safe from any task or ISR. The line is formatted on the caller stack.
+ * @return `SUCCESS` | `ERROR` - Something wrong with prarmeters or the TX ring was full
  */
 int bsp_uart_printf( const char *format, ...){
   tBspUart *p_uart = &metope.bsp.uart;
-  va_list va;
+  char      buf[BSP_CFG_UART_TX_BUF_SIZE];
+  va_list   va;
   va_start(va, format);
-  int num_c_inserted = cmn_utility_vsnprintf( p_uart->tx_buf, BSP_CFG_UART_TX_BUF_SIZE, format, va);
+  int num_c_inserted = cmn_utility_vsnprintf( buf, sizeof(buf), format, va);
   va_end(va);
 
-  p_uart->tx_buf[BSP_CFG_UART_TX_BUF_SIZE] = '\0';
-
   if(num_c_inserted==0){
     const char *msg = "Unable to print the message => ";
-    HAL_UART_Transmit( metope.bsp.pHuart2, msg, strlen(msg), HAL_MAX_DELAY);
-    HAL_UART_Transmit( metope.bsp.pHuart2, format, strlen(format), HAL_MAX_DELAY);
+    bsp_uart_tx_queue( p_uart, msg, strlen(msg));
+    bsp_uart_tx_queue( p_uart, format, strlen(format));
+    bsp_uart_tx_queue( p_uart, "\n", 1);
     return ERROR;
   }
 
-#if 1
-  int ret = SUCCESS;
-  {
-    uint32_t tmpreg = 0x00U;
-    tmpreg = USART2->CR1;
-    tmpreg &= ~(USART_CR1_TCIE | USART_CR1_TXEIE);
-    tmpreg |= USART_CR1_TE;
-    USART2->CR1 = tmpreg;
-    while( 0 == READ_BIT(USART2->CR1, USART_CR1_TE));
-  }
+  /* Replace the terminator by the new line */
+  buf[num_c_inserted-1] = '\n';
+  return bsp_uart_tx_queue( p_uart, buf, num_c_inserted);
+}
 
-  for( int i = 0; i < num_c_inserted; ++i) {
-    p_uart->tx_status.escape_ticks = 0;
-
-    /* Wait until DR can accept new data */
-    while( (0 == (USART2->SR & USART_SR_TXE)) && (p_uart->tx_status.escape_ticks != 0xFF) ) {
-      // if(metope.rtos.status->running[0]) {
-      //   vTaskDelay(1);
-      // }else{
-      //   cmnBoolean_t async_mode = false;
-      //   cmn_tim9_sleep(30000, async_mode);
-      // }
-      // p_uart->tx_status.escape_ticks++;
-    }
+/**
+ * @brief Print through a preformatted callback instead of parsing a format string
+ * @param [in] formatter - Fill the buffer. Same return value as `cmn_utility_vsnprintf()`
+ * @param [in] ctx       - Anything passed to the formatter
+ * @note  Used by `trace::uart_printf()` where the format string has been checked at compile time
+ * @note  Automatically end with a new line
+ * @return `SUCCESS` | `ERROR` - Something wrong with prarmeters or the TX ring was full
+ */
+int bsp_uart_print_with( bspUartFormatter_t formatter, const void *ctx){
+  tBspUart *p_uart = &metope.bsp.uart;
+  char      buf[BSP_CFG_UART_TX_BUF_SIZE];
+  int num_c_inserted = formatter( buf, sizeof(buf), ctx);
 
-    USART2->DR = (uint8_t)(p_uart->tx_buf[i] & (uint8_t)0xFF);
-    
-    if (p_uart->tx_status.escape_ticks == 0xFF) {
-      ret = ERROR;
-    }
+  if(num_c_inserted==0){
+    return ERROR;
   }
+  buf[num_c_inserted-1] = '\n';
+  return bsp_uart_tx_queue( p_uart, buf, num_c_inserted);
+}
 
-  p_uart->tx_buf[0] = '\n';
-  p_uart->tx_buf[1] = '\0';
-
-  for( int i = 0; i < 2; ++i) {
-    p_uart->tx_status.escape_ticks = 0;
-
-    /**
-     * the TXE (Transmit Empty) flag indicates that the Data Register (DR) can accept a new byte of data, allowing you to load the next byte into the transmit holding register. The TC (Transmission Complete) flag indicates that the entire last transmission, including the stop bit, has been fully sent out of the shift register and onto the TX line. 
-     */
-    while( (0 == (USART2->SR & USART_SR_TXE)) && (p_uart->tx_status.escape_ticks != 0xFF) ) {
-      // if(metope.rtos.status->running[0]) {
-      //   vTaskDelay(1);
-      // }else{
-      //   cmnBoolean_t async_mode = false;
-      //   cmn_tim9_sleep(3000, async_mode);
-      // }
-      // p_uart->tx_status.escape_ticks++;
-    }
+/**
+ * @brief Transmit raw bytes as they are
+ * @param [in] data - Bytes to send
+ * @param [in] len  - Number of bytes
+ * @note  Used by `trace_defer_flush()` for the binary log. No new line is appended.
+ * @return `SUCCESS` | `ERROR` - The TX ring was full
+ */
+int bsp_uart_write( const void *data, size_t len){
+  return bsp_uart_tx_queue( &metope.bsp.uart, data, len);
+}
 
-    USART2->DR = (uint8_t)(p_uart->tx_buf[i] & (uint8_t)0xFF);
-    
-    if (p_uart->tx_status.escape_ticks == 0xFF) {
-      ret = ERROR;
+/**
+ * @brief Number of bytes that can be queued right now
+ */
+size_t bsp_uart_tx_room( void){
+  return BSP_CFG_UART_TX_RING_SIZE - cmn_ring_pending( &metope.bsp.uart.tx_ring);
+}
+
+/**
+ * @brief Wait until the TX ring is empty and the last byte left the wire
+ * @note  Interrupts are masked and the transfer complete flag is polled, so it also works in a
+ *        fault context. Used by `ASSERT()` before halting.
+ * @note  Stops early if a producer was interrupted in the middle of a copy. That message is lost.
+ */
+void bsp_uart_flush( void){
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6)
+  tBspUart *p_uart  = &metope.bsp.uart;
+  uint32_t  primask = __get_PRIMASK();
+  __disable_irq();
+
+  for(;;){
+    if( 0 != (DMA1->HISR & (DMA_HISR_TCIF6 | DMA_HISR_TEIF6)) ){
+      bsp_uart_tx_dma_isr();
+    }else if( 0 == READ_BIT( DMA1_Stream6->CR, DMA_SxCR_EN) && 0 == bsp_uart_tx_kick( p_uart) ){
+      break;
     }
   }
-
-  while((0 == (USART2->SR & USART_SR_TC))) {
+  while( 0 == (USART2->SR & USART_SR_TC)){
     /* Wait until the datafram was completed */
   }
 
-  {
-    USART2->SR  &= ~USART_SR_TC;
-    uint32_t tmpreg = 0x00U;
-    tmpreg = USART2->CR1;
-    tmpreg &= ~USART_CR1_TE;
-    USART2->CR1 = tmpreg;
-    while( (0 == READ_BIT(USART2->CR1, USART_CR1_TE)) && (0 != READ_BIT(USART2->SR, USART_SR_TC)));
+  __set_PRIMASK(primask);
+#endif
+}
+
+/**
+ * @brief DMA1 Stream6 interrupt. Chain the next chunk of the TX ring.
+ * @note  Called by `DMA1_Stream6_IRQHandler()`
+ */
+void bsp_uart_tx_dma_isr( void){
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6)
+  tBspUart      *p_uart = &metope.bsp.uart;
+  uint32_t       flag   = DMA1->HISR;
+  const uint8_t *ptr    = NULL;
+
+  DMA1->HIFCR = flag & BSP_UART_TX_DMA_FLAGS;
+
+  /* A chunk with a transfer error is dropped as well. The ring MUST keep moving. */
+  if( 0 != (flag & (DMA_HISR_TCIF6 | DMA_HISR_TEIF6)) ){
+    size_t len = cmn_ring_next( &p_uart->tx_ring, p_uart->tx_dma_len, &ptr);
+    bsp_uart_tx_start( p_uart, ptr, len);
   }
-  return ret;
-#else
-#ifdef __cplusplus
-  std::cout << buf << std::endl;
-#else
-  printf("%s\n", buf);
 #endif
-  return SUCCESS;
+}
+
+/**
+ * @brief USART2 interrupt. Cut the bytes received so far into lines.
+ * @note  Called by `USART2_IRQHandler()` on the idle line and on receiver errors.
+ *        The line hit by an error is dropped. Reading SR then DR clears the flags.
+ *        The emulator takes one interrupt per byte and stores it like the DMA would.
+ * @return Number of lines completed
+ */
+uint32_t bsp_uart_rx_isr( void){
+  tBspUart *p_uart = &metope.bsp.uart;
+  uint32_t  sr     = USART2->SR;
+  uint8_t   dr     = (uint8_t)USART2->DR;
+  uint32_t  done;
+
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6)
+  (void)dr;
+#else
+  if( 0 != (sr & USART_SR_RXNE) && 0 == (sr & BSP_UART_RX_ERROR_FLAGS) ){
+    p_uart->rx_dma_buf[bsp_uart_rx_emulated_pos] = dr;
+    bsp_uart_rx_emulated_pos = (bsp_uart_rx_emulated_pos + 1) % BSP_CFG_UART_RX_DMA_SIZE;
+  }
 #endif
+  done = cmn_line_feed( &p_uart->rx_line, bsp_uart_rx_pos());
+  if( 0 != (sr & BSP_UART_RX_ERROR_FLAGS) ){
+    cmn_line_error( &p_uart->rx_line);
+  }
+  return done;
+}
 
+/**
+ * @brief DMA1 Stream5 interrupt. Cut the first or the second half of the receive buffer into lines.
+ * @note  Called by `DMA1_Stream5_IRQHandler()`. Bursts longer than the buffer keep flowing.
+ * @return Number of lines completed
+ */
+uint32_t bsp_uart_rx_dma_isr( void){
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6)
+  tBspUart *p_uart = &metope.bsp.uart;
+  uint32_t  flag   = DMA1->HISR;
+
+  DMA1->HIFCR = flag & BSP_UART_RX_DMA_FLAGS;
+  if( 0 != (flag & DMA_HISR_TEIF5) ){
+    /* The stream was disabled by the error */
+    cmn_line_error( &p_uart->rx_line);
+    DMA1_Stream5->CR |= DMA_SxCR_EN;
+  }
+  return cmn_line_feed( &p_uart->rx_line, bsp_uart_rx_pos());
+#else
+  return 0;
+#endif
 }
 
 #ifdef __cplusplus
@@ -131,6 +131,33 @@ typedef union{
   
 } tBspGyroData;
 
+/**
+ * @brief One FIFO sample with both sensors enabled
+ * @note  Accelerometer first, then gyroscope. Same byte order as `tBspGyroData`.
+ */
+typedef union{
+  u8 raw[12];
+
+  struct{
+    struct{
+      i16 x;
+      i16 y;
+      i16 z;
+    }acc;
+
+    struct{
+      i16 x;
+      i16 y;
+      i16 z;
+    }gyro;
+  };
+} tBspGyroFifoSample;
+
+/**
+ * @brief Samples of a FIFO burst. Same as the watermark.
+ */
+#define BSP_QMI8658_FIFO_WTM        (64U)
+
 
 /* ************************************************************************** */
 /*                             Public Functions                               */
@@ -142,7 +169,12 @@ u8           bsp_qmi8658_get_who_am_i (void);
 void         bsp_qmi8658_switch       ( cmnBoolean_t on_off);
 cmnBoolean_t bsp_qmi8658_update       ( tBspGyroData *data);
 cmnBoolean_t bsp_qmi8658_fifo_enable  (void);
-cmnBoolean_t bsp_qmi8658_dma_update   ( tBspGyroData *data);
+cmnBoolean_t bsp_qmi8658_fifo_start   (void);
+void         bsp_qmi8658_fifo_pop     (void);
+void         bsp_qmi8658_int1_isr     (void);
+void         bsp_qmi8658_int2_isr     (void);
+u32          bsp_qmi8658_i2c_isr      ( cmnBoolean_t ret);
+const tBspGyroFifoSample *bsp_qmi8658_fifo_front( u32 timeout);
 
 /* ************************************************************************** */
 /*                            Debugging Functions                             */
@@ -40,8 +40,11 @@ typedef u16 bspScreenCood_t;
 
 #define BSP_SCREEN_USE_HARDWARE_NSS     1
 
-#define BSP_CFG_UART_TX_BUF_SIZE        256
-#define BSP_CFG_UART_RX_BUF_SIZE        32
+#define BSP_CFG_UART_TX_BUF_SIZE        256     /*!< Longest formatted line */
+#define BSP_CFG_UART_TX_RING_SIZE       1024    /*!< Power of 2. Drained by DMA */
+#define BSP_CFG_UART_RX_BUF_SIZE        64      /*!< Longest command line plus the terminator. Fits a batch of commands. */
+#define BSP_CFG_UART_RX_DMA_SIZE        64      /*!< Circular DMA buffer. Interrupt on every half. */
+#define BSP_CFG_UART_RX_LINE_NUM        4       /*!< Power of 2. Lines waiting for the command box */
 
 #ifdef __cplusplus
 extern "C"{
@@ -23,40 +23,37 @@
 /*                                  Includes                                  */
 /* ************************************************************************** */
 #include "bsp_type.h"
+#include "cmn_ring.h"
+#include "cmn_line.h"
 
 #ifdef __cplusplus
 extern "C"{
 #endif
 
-typedef union stBspUartTxStatus {
-  struct {
-    uint16_t escape_ticks : 8;
-    uint16_t msg_len      : 8;
-  };
-  uint16_t word;
-} tBspUartTxStatus;
-
-typedef union stBspUartRxStatus {
-  struct {
-    uint8_t is_locked     : 1;
-    uint8_t is_overflowed : 1;
-    uint8_t has_new_msg   : 1;
-    uint8_t error_code    : 5;
-  };
-  uint8_t word;
-} tBspUartRxStatus;
+/**
+ * @brief Formatter callback. Fill `buf` and return the number of characters including the terminator.
+ */
+typedef int (*bspUartFormatter_t)( char *buf, size_t size, const void *ctx);
 
 typedef struct stBspUart{
-  char             tx_buf[BSP_CFG_UART_TX_BUF_SIZE+1];
-  tBspUartTxStatus tx_status;
-  char             rx_buf[BSP_CFG_UART_RX_BUF_SIZE+1];
-  uint8_t          rx_idx;
-  tBspUartRxStatus rx_status;
+  uint8_t          tx_ring_buf[BSP_CFG_UART_TX_RING_SIZE];  /*!< MUST NOT be in CCM. DMA1 can NOT reach it */
+  tCmnRing         tx_ring;
+  volatile size_t  tx_dma_len;                              /*!< Length of the running DMA chunk */
+  uint8_t          rx_dma_buf[BSP_CFG_UART_RX_DMA_SIZE];    /*!< MUST NOT be in CCM. Written by DMA1 Stream5 in circular mode */
+  char             rx_line_buf[BSP_CFG_UART_RX_LINE_NUM*BSP_CFG_UART_RX_BUF_SIZE];
+  tCmnLine         rx_line;                                 /*!< Received lines for the command box */
   //...//
 } tBspUart;
 
 void bsp_uart_init(void);
 int bsp_uart_printf( const char *format, ...); // __attribute__ (( format(printf,1,2)));
+int bsp_uart_print_with( bspUartFormatter_t formatter, const void *ctx);
+int bsp_uart_write( const void *data, size_t len);
+size_t bsp_uart_tx_room( void);
+void bsp_uart_flush( void);
+void bsp_uart_tx_dma_isr( void);
+uint32_t bsp_uart_rx_isr( void);
+uint32_t bsp_uart_rx_dma_isr( void);
 
 
 #ifdef __cplusplus
@@ -4,7 +4,12 @@
 #########################################################################################################
 if( $ENV{METOPE_CHIP} STREQUAL "NATIVE")
     list( APPEND SRC_DIR__CMN   "${PRJ_TOP}/cmn/cmn_utility.c"
-                                "${PRJ_TOP}/cmn/cmn_math.c")
+                                "${PRJ_TOP}/cmn/cmn_math.c"
+                                "${PRJ_TOP}/cmn/cmn_color.c"
+                                "${PRJ_TOP}/cmn/cmn_ring.c"
+                                "${PRJ_TOP}/cmn/cmn_line.c"
+                                "${PRJ_TOP}/cmn/cmn_frame.c"
+                                "${PRJ_TOP}/cmn/cmn_burst.c")
 else()
     file(GLOB_RECURSE SRC_DIR__CMN CONFIGURE_DEPENDS    "${PRJ_TOP}/cmn/*.h" 
                                                         "${PRJ_TOP}/cmn/*.cc" 
@@ -0,0 +1,210 @@
+/**
+ ******************************************************************************
+ * @file    cmn_burst.c
+ * @author  RandleH
+ * @brief   Common Program - Interrupt Driven Burst Reads into a Double Buffer
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 RandleH.
+ * All rights reserved.
+ *
+ * This software component is licensed by RandleH under BSD 3-Clause license,
+ * the "License"; You may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at:
+ *                        opensource.org/licenses/BSD-3-Clause
+ *
+ ******************************************************************************
+*/
+
+/* ************************************************************************** */
+/*                                  Includes                                  */
+/* ************************************************************************** */
+#include "cmn_burst.h"
+
+
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @note The half is written before `head` is released and read after `head` is acquired.
+ */
+#define LOAD( p)          __atomic_load_n( (p), __ATOMIC_ACQUIRE)
+#define STORE( p, v)      __atomic_store_n( (p), (v), __ATOMIC_RELEASE)
+
+
+/**
+ * @brief Start the step at `pc`
+ */
+static void cmn_burst_run( tCmnBurst *burst){
+  const tCmnBurstStep *step = &burst->step[burst->pc];
+  int ret = 0;
+
+  switch( step->op ){
+    case kCmnBurst_Write:{
+      burst->val = step->val;
+      ret = burst->bus( burst->param, kCmnBurst_Write, step->reg, &burst->val, 1);
+      break;
+    }
+    case kCmnBurst_Read:{
+      uint8_t *half = &burst->buf[(burst->head & 1U) * burst->size];
+      ret = burst->bus( burst->param, kCmnBurst_Read, step->reg, half, burst->size);
+      break;
+    }
+    case kCmnBurst_Wait:{
+      break;
+    }
+    default:{
+      /* End of the sequence. A trigger held meanwhile starts the next burst. */
+      burst->busy = 0;
+      if( burst->pending ){
+        burst->pending = 0;
+        cmn_burst_trigger( burst);
+      }
+      break;
+    }
+  }
+
+  if( ret != 0 ){
+    /* No interrupt will come. The step is kept for `cmn_burst_retry()`. */
+    burst->error += 1;
+    burst->retry  = 1;
+  }
+}
+
+/**
+ * @brief Initialize the double buffer
+ * @param [in] burst - Handle
+ * @param [in] step  - Register sequence closed by `kCmnBurst_End`. At most one `kCmnBurst_Read`.
+ * @param [in] bus   - Transfer starter
+ * @param [in] param - Passed to `bus`
+ * @param [in] buf   - Storage of `2*size` bytes
+ * @param [in] size  - Bytes of a burst
+ */
+void cmn_burst_init( tCmnBurst *burst, const tCmnBurstStep *step, tCmnBurstBus bus, void *param, uint8_t *buf, uint32_t size){
+  burst->step    = step;
+  burst->bus     = bus;
+  burst->param   = param;
+  burst->buf     = buf;
+  burst->size    = size;
+  burst->pc      = 0;
+  burst->val     = 0;
+  burst->busy    = 0;
+  burst->pending = 0;
+  burst->retry   = 0;
+  burst->head    = 0;
+  burst->tail    = 0;
+  burst->stall   = 0;
+  burst->error   = 0;
+}
+
+/**
+ * @brief Start a burst, or hold it until the running burst ends or a half is released
+ * @note  Producer side. Called by the watermark interrupt.
+ */
+void cmn_burst_trigger( tCmnBurst *burst){
+  if( burst->busy ){
+    burst->pending = 1;
+    return;
+  }
+  if( burst->head - LOAD( &burst->tail) >= 2 ){
+    burst->stall  += 1;
+    burst->pending = 1;
+    return;
+  }
+  burst->pending = 0;
+  burst->busy    = 1;
+  burst->pc      = 0;
+  cmn_burst_run( burst);
+}
+
+/**
+ * @brief The device interrupt a `kCmnBurst_Wait` step waits for
+ * @note  Producer side. Ignored by any other step.
+ */
+void cmn_burst_irq( tCmnBurst *burst){
+  if( !burst->busy || burst->step[burst->pc].op != kCmnBurst_Wait ){
+    return;
+  }
+  burst->pc += 1;
+  cmn_burst_run( burst);
+}
+
+/**
+ * @brief The transfer of the running step ended
+ * @note  Producer side. Called by the bus interrupt. A failed transfer aborts the burst and the
+ *        half is not published.
+ * @param [in] ret - `SUCCESS` | `ERROR`
+ */
+void cmn_burst_done( tCmnBurst *burst, cmnBoolean_t ret){
+  if( !burst->busy || burst->retry ){
+    return;
+  }
+  if( ret != SUCCESS ){
+    burst->error += 1;
+    burst->busy   = 0;
+    return;
+  }
+  if( burst->step[burst->pc].op == kCmnBurst_Read ){
+    STORE( &burst->head, burst->head + 1);
+  }
+  burst->pc += 1;
+  cmn_burst_run( burst);
+}
+
+/**
+ * @brief Start again the step whose transfer failed to start
+ * @note  Called by the consumer or a timer, under the same lock as the producer calls. Nothing
+ *        happens otherwise.
+ */
+void cmn_burst_retry( tCmnBurst *burst){
+  if( !burst->busy || !burst->retry ){
+    return;
+  }
+  burst->retry = 0;
+  cmn_burst_run( burst);
+}
+
+/**
+ * @brief Oldest burst
+ * @note  Consumer side. The burst stays valid until `cmn_burst_pop()`.
+ * @return `size` bytes. `NULL` if nothing was read.
+ */
+const uint8_t *cmn_burst_front( tCmnBurst *burst){
+  const uint32_t tail = burst->tail;
+  if( LOAD( &burst->head) == tail ){
+    return NULL;
+  }
+  return &burst->buf[(tail & 1U) * burst->size];
+}
+
+/**
+ * @brief Release the oldest burst and run a trigger held for it
+ * @note  Consumer side. Nothing happens if nothing was read.
+ */
+void cmn_burst_pop( tCmnBurst *burst){
+  const uint32_t tail = burst->tail;
+  if( LOAD( &burst->head) == tail ){
+    return;
+  }
+  STORE( &burst->tail, tail + 1);
+  if( burst->pending && !burst->busy ){
+    cmn_burst_trigger( burst);
+  }
+}
+
+/**
+ * @brief Number of bursts waiting for the consumer
+ */
+uint32_t cmn_burst_pending( const tCmnBurst *burst){
+  return LOAD( &burst->head) - LOAD( &burst->tail);
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+/* ********************************** EOF *********************************** */
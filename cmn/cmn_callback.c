@@ -4,6 +4,7 @@
 /* ************************************************************************** */
 /*                                  Includes                                  */
 /* ************************************************************************** */
+#define TRACE_MODULE  CMN
 #include "device.h"
 #include "global.h"
 #include "trace.h"
@@ -21,6 +21,8 @@
 /* ************************************************************************** */
 /*                                  Includes                                  */
 /* ************************************************************************** */
+#include <string.h>
+#include "device.h"
 #include "cmn_color.h"
 
 
@@ -29,6 +31,27 @@ extern "C"{
 #endif
 
 
+/* ************************************************************************** */
+/*                               Private Macros                               */
+/* ************************************************************************** */
+/**
+ * @note
+ *  Two RGB565 pixels are held in one 32-bit word. Each color channel of both pixels
+ *  is extracted into two 16-bit lanes, so one multiplication weights both pixels at once.
+ *  Lanes never overflow: the largest weighted sum is `63*255`.
+ */
+#define LANE_R(w)               (((w) >> 11) & 0x001F001FU)
+#define LANE_G(w)               (((w) >>  5) & 0x003F003FU)
+#define LANE_B(w)               ( (w)        & 0x001F001FU)
+#define LANE_PACK(r, g, b)      (((r) << 11) | ((g) << 5) | (b))
+
+/**
+ * @note
+ *  Lane-wise `LV_UDIV255()`. `(x + 1 + (x>>8)) >> 8` equals `(x*0x8081) >> 23` for every `x < 65535`.
+ */
+#define LANE_DIV255(x)          ((((x) + 0x00010001U + (((x) >> 8) & 0x00FF00FFU)) >> 8) & 0x00FF00FFU)
+
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
 /**
  * @brief Calculate the color gradient in linear mapping
  * @param [in] color_from - Source Color
@@ -48,6 +71,169 @@ cmnColor_t cmn_color_gradient( cmnColor_t color_from, cmnColor_t color_to, uint8
               GET_B(color_from)+((GET_B(color_to)-GET_B(color_from))*x >> 8);
   return cmn_color_make(r,g,b);
 }
+#endif
+
+/**
+ * @brief Load two pixels
+ * @note  Alignment free. Compiled into a single `LDR` on Cortex-M4.
+ */
+static inline uint32_t cmn_color_565x2_load( const uint16_t *p){
+  uint32_t w;
+  memcpy( &w, p, sizeof(w));
+  return w;
+}
+
+static inline void cmn_color_565x2_store( uint16_t *p, uint32_t w){
+  memcpy( p, &w, sizeof(w));
+}
+
+/**
+ * @brief Mix two pixels of `fg` into two pixels of `bg`
+ * @note  Per channel: `LV_UDIV255( fg*opa + bg*(255-opa))`
+ */
+static inline uint32_t cmn_color_565x2_mix( uint32_t fg, uint32_t bg, uint32_t opa){
+  uint32_t inv = 255 - opa;
+  uint32_t r   = LANE_DIV255( LANE_R(fg)*opa + LANE_R(bg)*inv);
+  uint32_t g   = LANE_DIV255( LANE_G(fg)*opa + LANE_G(bg)*inv);
+  uint32_t b   = LANE_DIV255( LANE_B(fg)*opa + LANE_B(bg)*inv);
+  return LANE_PACK( r, g, b);
+}
+
+/**
+ * @brief Fill pixels with a solid color
+ * @param [out] dst   - Pixel buffer
+ * @param [in]  color - Color in the same byte order as the buffer
+ * @param [in]  n     - Number of pixels
+ */
+void cmn_color_565_fill( uint16_t *dst, uint16_t color, uint32_t n){
+  uint32_t w = ((uint32_t)color << 16) | color;
+  for(; n>=2; n-=2, dst+=2){
+    cmn_color_565x2_store( dst, w);
+  }
+  if(n){
+    *dst = color;
+  }
+}
+
+/**
+ * @brief Fill pixels with a color over the existing content
+ * @note  Pixel exact with `lv_color_mix( color, dst, opa)` of LVGL 8.3 when `LV_COLOR_16_SWAP==1`
+ * @param [inout] dst     - Pixel buffer
+ * @param [in]    color   - Color in the same byte order as the buffer
+ * @param [in]    n       - Number of pixels
+ * @param [in]    opa     - Opacity of `color`. Range: [0:255]
+ * @param [in]    swapped - Pixels in the buffer are byte swapped (ie. `LV_COLOR_16_SWAP`)
+ */
+void cmn_color_565_fill_opa( uint16_t *dst, uint16_t color, uint32_t n, uint8_t opa, cmnBoolean_t swapped){
+  uint32_t inv = 255 - opa;
+  uint32_t fg  = ((uint32_t)color << 16) | color;
+  if(swapped){
+    fg = CMN_REV16(fg);
+  }
+
+  /* The foreground never changes. Weight it once. */
+  uint32_t fr  = LANE_R(fg)*opa;
+  uint32_t fgg = LANE_G(fg)*opa;
+  uint32_t fb  = LANE_B(fg)*opa;
+
+  for(; n>=2; n-=2, dst+=2){
+    uint32_t bg = cmn_color_565x2_load( dst);
+    if(swapped){
+      bg = CMN_REV16(bg);
+    }
+    uint32_t w = LANE_PACK( LANE_DIV255( fr  + LANE_R(bg)*inv),
+                            LANE_DIV255( fgg + LANE_G(bg)*inv),
+                            LANE_DIV255( fb  + LANE_B(bg)*inv));
+    cmn_color_565x2_store( dst, swapped ? CMN_REV16(w) : w);
+  }
+  if(n){
+    uint32_t bg = swapped ? CMN_REV16((uint32_t)*dst) : *dst;
+    uint32_t w  = LANE_PACK( LANE_DIV255( fr  + LANE_R(bg)*inv),
+                             LANE_DIV255( fgg + LANE_G(bg)*inv),
+                             LANE_DIV255( fb  + LANE_B(bg)*inv));
+    *dst = (uint16_t)(swapped ? CMN_REV16(w) : w);
+  }
+}
+
+/**
+ * @brief Blend an image over the existing content with a global opacity
+ * @note  Pixel exact with `lv_color_mix( src, dst, opa)` of LVGL 8.3 when `LV_COLOR_16_SWAP==1`
+ * @param [inout] dst     - Pixel buffer
+ * @param [in]    src     - Source pixels in the same byte order as `dst`
+ * @param [in]    n       - Number of pixels
+ * @param [in]    opa     - Opacity of `src`. Range: [0:255]
+ * @param [in]    swapped - Pixels are byte swapped (ie. `LV_COLOR_16_SWAP`)
+ */
+void cmn_color_565_blend( uint16_t *dst, const uint16_t *src, uint32_t n, uint8_t opa, cmnBoolean_t swapped){
+  for(; n>=2; n-=2, dst+=2, src+=2){
+    uint32_t fg = cmn_color_565x2_load( src);
+    uint32_t bg = cmn_color_565x2_load( dst);
+    if(swapped){
+      cmn_color_565x2_store( dst, CMN_REV16( cmn_color_565x2_mix( CMN_REV16(fg), CMN_REV16(bg), opa)));
+    }else{
+      cmn_color_565x2_store( dst, cmn_color_565x2_mix( fg, bg, opa));
+    }
+  }
+  if(n){
+    uint32_t fg = *src;
+    uint32_t bg = *dst;
+    if(swapped){
+      *dst = (uint16_t)CMN_REV16( cmn_color_565x2_mix( CMN_REV16(fg), CMN_REV16(bg), opa));
+    }else{
+      *dst = (uint16_t)cmn_color_565x2_mix( fg, bg, opa);
+    }
+  }
+}
+
+/**
+ * @brief Linear gradient span
+ * @note  Pixel `i` is `(from*(256-x) + to*x) >> 8` per channel, where `x = (i*((256<<16)/n)) >> 16`.
+ *        Both weights of one channel are applied by a single `SMUAD`.
+ * @param [out] dst     - Pixel buffer
+ * @param [in]  from    - Color of the first pixel in the same byte order as the buffer
+ * @param [in]  to      - Color approached by the last pixel in the same byte order as the buffer
+ * @param [in]  n       - Number of pixels
+ * @param [in]  swapped - Pixels are byte swapped (ie. `LV_COLOR_16_SWAP`)
+ */
+void cmn_color_565_gradient( uint16_t *dst, uint16_t from, uint16_t to, uint32_t n, cmnBoolean_t swapped){
+  if(n==0) return;
+
+  uint32_t ends = ((uint32_t)to << 16) | from;
+  if(swapped){
+    ends = CMN_REV16(ends);
+  }
+
+  /* Channel pairs (to:from) of the two ends */
+  const uint32_t pr   = LANE_R(ends);
+  const uint32_t pg   = LANE_G(ends);
+  const uint32_t pb   = LANE_B(ends);
+  const uint32_t step = (256U << 16) / n;
+  uint32_t       pos  = 0;
+
+  for(uint32_t i=0; i<n; ++i, pos+=step){
+    uint32_t x = pos >> 16;
+    uint32_t w = (x << 16) | (256 - x);
+    uint32_t c = ((CMN_SMUAD( pr, w) >> 8) << 11) | ((CMN_SMUAD( pg, w) >> 8) << 5) | (CMN_SMUAD( pb, w) >> 8);
+    dst[i] = (uint16_t)(swapped ? CMN_REV16(c) : c);
+  }
+}
+
+/**
+ * @brief Byte swap RGB565 pixels, two per instruction
+ * @note  Converts between the CPU byte order and the SPI screen byte order.
+ *        `dst` and `src` may be the same buffer.
+ * @param [out] dst - Pixel buffer
+ * @param [in]  src - Pixel buffer
+ * @param [in]  n   - Number of pixels
+ */
+void cmn_color_565_swap( uint16_t *dst, const uint16_t *src, uint32_t n){
+  for(; n>=2; n-=2, dst+=2, src+=2){
+    cmn_color_565x2_store( dst, CMN_REV16( cmn_color_565x2_load( src)));
+  }
+  if(n){
+    *dst = (uint16_t)CMN_REV16( (uint32_t)*src);
+  }
+}
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,161 @@
+/**
+ ******************************************************************************
+ * @file    cmn_frame.c
+ * @author  RandleH
+ * @brief   Common Program - COBS Frame with CRC-16
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 RandleH.
+ * All rights reserved.
+ *
+ * This software component is licensed by RandleH under BSD 3-Clause license,
+ * the "License"; You may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at:
+ *                        opensource.org/licenses/BSD-3-Clause
+ *
+ ******************************************************************************
+*/
+
+/* ************************************************************************** */
+/*                                  Includes                                  */
+/* ************************************************************************** */
+#include "cmn_frame.h"
+
+
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @brief COBS encoder writing one byte at a time
+ * @note  `code` is the position of the length byte of the running block.
+ */
+typedef struct stCmnFrameCobs{
+  uint8_t *dst;
+  size_t   code;
+  size_t   len;
+} tCmnFrameCobs;
+
+static void cmn_frame_cobs_put( tCmnFrameCobs *cobs, uint8_t c){
+  if( c != 0 ){
+    cobs->dst[cobs->len++] = c;
+    if( cobs->len - cobs->code < 0xFF ){
+      return;
+    }
+  }
+  cobs->dst[cobs->code] = (uint8_t)(cobs->len - cobs->code);
+  cobs->code = cobs->len++;
+}
+
+static size_t cmn_frame_cobs_end( tCmnFrameCobs *cobs){
+  cobs->dst[cobs->code] = (uint8_t)(cobs->len - cobs->code);
+  return cobs->len;
+}
+
+/**
+ * @brief CRC-16/CCITT-FALSE without a table
+ * @param [in] buf - Data
+ * @param [in] len - Length of `buf`
+ * @param [in] crc - `CMN_FRAME_CRC16_INIT`, or the result over the previous data
+ */
+uint16_t cmn_frame_crc16( const uint8_t *buf, size_t len, uint16_t crc){
+  for( size_t i=0; i<len; ++i){
+    uint8_t x = (uint8_t)(crc >> 8) ^ buf[i];
+    x  ^= x >> 4;
+    crc = (uint16_t)((crc << 8) ^ ((uint16_t)x << 12) ^ ((uint16_t)x << 5) ^ x);
+  }
+  return crc;
+}
+
+/**
+ * @brief Decode a COBS body
+ * @note  `dst` may be `src`. The output is never longer than the input.
+ * @param [in]  src - Body without the delimiters
+ * @param [in]  len - Length of `src`
+ * @param [out] dst - Decoded bytes
+ * @return Length of the decoded bytes. `0` if the body is malformed or empty.
+ */
+size_t cmn_frame_cobs_decode( const uint8_t *src, size_t len, uint8_t *dst){
+  size_t i = 0;
+  size_t o = 0;
+  while( i < len ){
+    const uint8_t code = src[i++];
+    if( code == 0 || i + code - 1 > len ){
+      return 0;
+    }
+    for( uint8_t k=1; k<code; ++k){
+      if( src[i] == 0 ){
+        return 0;
+      }
+      dst[o++] = src[i++];
+    }
+    if( code != 0xFF && i < len ){
+      dst[o++] = 0;
+    }
+  }
+  return o;
+}
+
+/**
+ * @brief Build a frame ready for the wire
+ * @param [in]  type    - Message type
+ * @param [in]  payload - Payload. May be `NULL` when `len` is 0.
+ * @param [in]  len     - Length of `payload`
+ * @param [out] dst     - At least `CMN_FRAME_WIRE_SIZE( len)` bytes
+ * @return Bytes written, both delimiters included
+ */
+size_t cmn_frame_encode( uint8_t type, const void *payload, size_t len, uint8_t *dst){
+  const uint8_t *p    = (const uint8_t *)payload;
+  uint16_t       crc  = cmn_frame_crc16( &type, 1, CMN_FRAME_CRC16_INIT);
+  tCmnFrameCobs  cobs = { &dst[1], 0, 1};
+
+  crc = cmn_frame_crc16( p, len, crc);
+
+  dst[0] = CMN_FRAME_DELIMITER;
+  cmn_frame_cobs_put( &cobs, type);
+  for( size_t i=0; i<len; ++i){
+    cmn_frame_cobs_put( &cobs, p[i]);
+  }
+  cmn_frame_cobs_put( &cobs, (uint8_t)(crc & 0xFF));
+  cmn_frame_cobs_put( &cobs, (uint8_t)(crc >> 8));
+
+  const size_t n = 1 + cmn_frame_cobs_end( &cobs);
+  dst[n] = CMN_FRAME_DELIMITER;
+  return n + 1;
+}
+
+/**
+ * @brief Decode a received frame in place and check it
+ * @param [inout] buf         - COBS body without the delimiters. Overwritten by the decoded bytes.
+ * @param [in]    len         - Length of `buf`
+ * @param [out]   type        - Message type
+ * @param [out]   payload     - Payload inside `buf`
+ * @param [out]   payload_len - Length of the payload
+ * @return `kCmnFrame_OK` or a negative error
+ */
+int cmn_frame_decode( uint8_t *buf, size_t len, uint8_t *type, const uint8_t **payload, size_t *payload_len){
+  const size_t n = cmn_frame_cobs_decode( buf, len, buf);
+  if( n == 0 ){
+    return kCmnFrame_ErrCobs;
+  }
+  if( n < 3 ){
+    return kCmnFrame_ErrShort;
+  }
+  const uint16_t crc = (uint16_t)(buf[n-2] | (buf[n-1] << 8));
+  if( crc != cmn_frame_crc16( buf, n-2, CMN_FRAME_CRC16_INIT) ){
+    return kCmnFrame_ErrCrc;
+  }
+  *type        = buf[0];
+  *payload     = &buf[1];
+  *payload_len = n - 3;
+  return kCmnFrame_OK;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+/* ********************************** EOF *********************************** */
@@ -30,6 +30,10 @@
 #include "cmn_callback.h"
 #include "bsp_led.h"
 #include "bsp_screen.h"
+#include "bsp_uart.h"
+#include "bsp_gyro.h"
+#include "trace.h"
+#include "timeline.h"
 #ifdef __cplusplus
 extern "C"{
 #endif
@@ -219,9 +223,23 @@ void cmn_interrupt_init_priority( void){
   HAL_NVIC_SetPriority(DMA1_Stream0_IRQn, CMN_NVIC_PRIORITY_NORMAL);
   HAL_NVIC_EnableIRQ(DMA1_Stream0_IRQn);
 
+  /* I2C1 interrupts. QMI8658 FIFO drain. */
+  HAL_NVIC_SetPriority(I2C1_EV_IRQn, CMN_NVIC_PRIORITY_NORMAL);
+  HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
+  HAL_NVIC_SetPriority(I2C1_ER_IRQn, CMN_NVIC_PRIORITY_NORMAL);
+  HAL_NVIC_EnableIRQ(I2C1_ER_IRQn);
+
   /* USART2 interrupt Init */
   HAL_NVIC_SetPriority(USART2_IRQn, CMN_NVIC_PRIORITY_NORMAL);
   HAL_NVIC_EnableIRQ(USART2_IRQn);
+
+  /* DMA1_Stream5_IRQn interrupt configuration. USART2 RX lines. */
+  HAL_NVIC_SetPriority(DMA1_Stream5_IRQn, CMN_NVIC_PRIORITY_NORMAL);
+  HAL_NVIC_EnableIRQ(DMA1_Stream5_IRQn);
+
+  /* DMA1_Stream6_IRQn interrupt configuration. USART2 TX ring. */
+  HAL_NVIC_SetPriority(DMA1_Stream6_IRQn, CMN_NVIC_PRIORITY_CASUAL);
+  HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
 #endif
 }
 
@@ -245,29 +263,48 @@ void DEFAULT NMI_Handler( void){
   }
 }
 
-void DEFAULT HardFault_Handler( void){
+/**
+ * @note The stacked frame is on PSP inside a task and on MSP otherwise. See bit 2 of EXC_RETURN.
+ */
+#define FAULT_HANDLER_ENTRY         \
+  "tst   lr, #4               \n"   \
+  "ite   eq                   \n"   \
+  "mrseq r0, msp              \n"   \
+  "mrsne r0, psp              \n"   \
+  "b     cmn_interrupt_fault  \n"
+
+/**
+ * @brief Common tail of the fault handlers. Stamp the crash record, then halt or reset.
+ * @param [in] frame - Stacked R0-R3, R12, LR, PC, xPSR
+ */
+void cmn_interrupt_fault( const uint32_t *frame){
+  /* HardFault, MemManage, BusFault and UsageFault are exception 3 to 6, in the order of `TraceCrashEnum_t` */
+  trace_crash_mark( kTraceCrash_HardFault + (__get_IPSR() & 0x1FF) - 3, frame);
+
+#ifdef DEBUG
   volatile uint8_t flag = true;
   while(flag){
     __NOP();
   }
+#endif
+  /* The record is dumped by the `CRASH` command after the reboot */
+  NVIC_SystemReset();
 }
 
-void DEFAULT MemManage_Handler( void){
-  while(1){
-
-  }
+void DEFAULT __attribute__((naked)) HardFault_Handler( void){
+  __asm volatile( FAULT_HANDLER_ENTRY);
 }
 
-void BusFault_Handler( void){
-  while(1){
-
-  }
+void DEFAULT __attribute__((naked)) MemManage_Handler( void){
+  __asm volatile( FAULT_HANDLER_ENTRY);
 }
 
-void UsageFault_Handler( void){
-  while(1){
+void __attribute__((naked)) BusFault_Handler( void){
+  __asm volatile( FAULT_HANDLER_ENTRY);
+}
 
-  }
+void __attribute__((naked)) UsageFault_Handler( void){
+  __asm volatile( FAULT_HANDLER_ENTRY);
 }
 
 void DebugMon_Handler( void){
@@ -292,6 +329,7 @@ void SVC_Handler( void){
  */
 void SysTick_Handler( void){
   extern void FreeRTOS_SysTick_Handler( void);
+  TIMELINE_ISR_ENTER();
   /* Clear overflow flag */
   SysTick->CTRL;
 
@@ -300,6 +338,7 @@ void SysTick_Handler( void){
     FreeRTOS_SysTick_Handler();
   }
   HAL_IncTick();
+  TIMELINE_ISR_EXIT();
 }
 
 void ADC_IRQHandler( void){}
@@ -309,14 +348,14 @@ void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin){
    * @note: B5 QMI8658C INT1 Rising Edge Trigger
    */
   if(GPIO_Pin==GYRO_INT1_Pin){
-    metope.bsp.status->B5[0] = 1;
+    bsp_qmi8658_int1_isr();
   }
 
   /**
    * @note: B6 QMI8658C INT2 Rising Edge Trigger
    */
   if(GPIO_Pin==GYRO_INT2_Pin){
-    metope.bsp.status->B6[0] = 1;
+    bsp_qmi8658_int2_isr();
   }
   
   /**
@@ -328,14 +367,17 @@ void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin){
 }
 
 void EXTI9_5_IRQHandler(void){
+  TIMELINE_ISR_ENTER();
   HAL_GPIO_EXTI_IRQHandler(GYRO_INT1_Pin);
   HAL_GPIO_EXTI_IRQHandler(GYRO_INT2_Pin);
   HAL_GPIO_EXTI_IRQHandler(TP_INT_Pin);
+  TIMELINE_ISR_EXIT();
 }
 
 
 uint32_t TIM9_FLAG = 0;
 void TIM1_BRK_TIM9_IRQHandler(void){
+  TIMELINE_ISR_ENTER();
 #if 1
   TIM9->SR = 0x00000000;
   CLEAR_BIT( TIM9->CR1, TIM_CR1_CEN);  // Disable timer
@@ -352,12 +394,14 @@ void TIM1_BRK_TIM9_IRQHandler(void){
       portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
     }
   }
+  TIMELINE_ISR_EXIT();
 }
 
 void TIM1_UP_TIM10_IRQHandler(void){}     
 void TIM1_TRG_COM_TIM11_IRQHandler(void){}
 void TIM1_CC_IRQHandler(void){}           
 void TIM2_IRQHandler(void){
+  TIMELINE_ISR_ENTER();
 #if 1
   TIM2->SR = 0x00000000;
   CLEAR_BIT( TIM2->CR1, TIM_CR1_CEN);  // Disable timer
@@ -373,77 +417,80 @@ void TIM2_IRQHandler(void){
       portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
     }
   }
+  TIMELINE_ISR_EXIT();
 }              
 void TIM3_IRQHandler(void){}
 
 
 void TIM4_IRQHandler(void){}              
-void I2C1_EV_IRQHandler(void){}           
-void I2C1_ER_IRQHandler(void){}           
-void I2C2_EV_IRQHandler(void){}           
-void I2C2_ER_IRQHandler(void){}           
-void SPI1_IRQHandler(void){}              
 
-void SPI2_IRQHandler(void){
-  HAL_SPI_IRQHandler(&hspi2);
+/**
+ * @brief Wake up the consumer after FIFO bursts were read
+ */
+static void cmn_interrupt_gyro_input( uint32_t num_burst) {
+  if( num_burst && metope.rtos.status->running[0]){
+    BaseType_t xHigherPriorityTaskWoken, xResult;
+    xHigherPriorityTaskWoken = pdFALSE;
+    xResult = xEventGroupSetBitsFromISR( metope.rtos.event._handle, CMN_EVENT_QMI8658_RX_CPLT, &xHigherPriorityTaskWoken );
+    if( xResult != pdFAIL ){
+      portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+    }
+  }
 }
 
-void USART1_IRQHandler(void){}
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c){
+  if(hi2c==&hi2c1){
+    metope.bsp.status->i2c1[0] = IDLE;
+    cmn_interrupt_gyro_input( bsp_qmi8658_i2c_isr(SUCCESS));
+  }
+}
 
-/**
- * @brief
- * @note Only DMA or Idle Interrupt, HAL will call this function.
- */
-void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size) {
-  tBspUart *p_uart = &metope.bsp.uart;
-  
-  if(huart->Instance == USART2) {
-    p_uart->rx_idx      = 0;
-    p_uart->rx_status.has_new_msg = 1;
-    HAL_UART_Receive_IT( huart, (uint8_t*)&p_uart->rx_buf[0], BSP_CFG_UART_RX_BUF_SIZE);
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c){
+  if(hi2c==&hi2c1){
+    metope.bsp.status->i2c1[0] = IDLE;
+    cmn_interrupt_gyro_input( bsp_qmi8658_i2c_isr(SUCCESS));
+  }
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c){
+  if(hi2c==&hi2c1){
+    metope.bsp.status->i2c1[0] = IDLE;
+    cmn_interrupt_gyro_input( bsp_qmi8658_i2c_isr(ERROR));
   }
 }
 
 /**
- * @brief
- * @note Each time when the transfer count reaches the buffer size, this function will be called.
+ * @note  QMI8658 I2C address phase and interrupt driven writes
  */
-void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) {
-  tBspUart *p_uart = &metope.bsp.uart;
-  p_uart->rx_status.is_locked = 1;
+void I2C1_EV_IRQHandler(void){
+  TIMELINE_ISR_ENTER();
+  HAL_I2C_EV_IRQHandler(&hi2c1);
+  TIMELINE_ISR_EXIT();
 }
 
-void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
-  tBspUart *p_uart = &metope.bsp.uart;
-  p_uart->rx_status.error_code = huart->ErrorCode;
+void I2C1_ER_IRQHandler(void){
+  TIMELINE_ISR_ENTER();
+  HAL_I2C_ER_IRQHandler(&hi2c1);
+  TIMELINE_ISR_EXIT();
 }
 
-void USART2_IRQHandler(void) {
-  // HAL_UART_IRQHandler(&huart2);
-  tBspUart *p_uart = &metope.bsp.uart;
-  volatile uint32_t REG_USART2_SR = USART2->SR;
-  volatile uint32_t REG_USART2_DR = USART2->DR;
-  
-  if (REG_USART2_SR & (uint32_t)(USART_SR_PE | USART_SR_FE | USART_SR_NE)) {
-    p_uart->rx_status.error_code = (uint8_t)(REG_USART2_SR & 0x1F);
-    p_uart->rx_idx = BSP_CFG_UART_RX_BUF_SIZE;
-  }
-  else if (REG_USART2_SR & USART_SR_RXNE) {
-    if (likely(!p_uart->rx_status.is_overflowed)) {
-      p_uart->rx_buf[p_uart->rx_idx++] = (char)REG_USART2_DR;
-      if (p_uart->rx_idx == BSP_CFG_UART_RX_BUF_SIZE) {
-        p_uart->rx_status.is_overflowed = 1;
-      }
-      if (REG_USART2_DR == '\n' || REG_USART2_DR == '\r') {
-        p_uart->rx_status.has_new_msg = 1;
-      }
-    }
-  }
+void I2C2_EV_IRQHandler(void){}           
+void I2C2_ER_IRQHandler(void){}           
+void SPI1_IRQHandler(void){}              
 
-  /* Always set the '\0' after the string */
-  p_uart->rx_buf[p_uart->rx_idx] = '\0';
+void SPI2_IRQHandler(void){
+  TIMELINE_ISR_ENTER();
+  HAL_SPI_IRQHandler(&hspi2);
+  TIMELINE_ISR_EXIT();
+}
 
-  if(metope.rtos.status->running[0]){
+void USART1_IRQHandler(void){}
+
+/**
+ * @brief Wake up the command box after lines were received
+ */
+static void cmn_interrupt_uart_input( uint32_t num_line) {
+  if( num_line && metope.rtos.status->running[0]){
     BaseType_t xHigherPriorityTaskWoken, xResult;
     xHigherPriorityTaskWoken = pdFALSE;
     xResult = xEventGroupSetBitsFromISR( metope.rtos.event._handle, CMN_EVENT_UART_INPUT, &xHigherPriorityTaskWoken );
@@ -453,6 +500,15 @@ void USART2_IRQHandler(void) {
   }
 }
 
+/**
+ * @brief Idle line and receiver errors. The bytes come by DMA1 Stream5.
+ */
+void USART2_IRQHandler(void) {
+  TIMELINE_ISR_ENTER();
+  cmn_interrupt_uart_input( bsp_uart_rx_isr());
+  TIMELINE_ISR_EXIT();
+}
+
 void RTC_Alarm_IRQHandler( void){}
 void OTG_FS_WKUP_IRQHandler( void){}
 void SDIO_IRQHandler( void){}
@@ -471,15 +527,21 @@ void RCC_IRQHandler( void){}
 
 
 void DEFAULT EXTI0_IRQHandler( void){
+  TIMELINE_ISR_ENTER();
   cmn_callback_user_key_detected(KEY_M_Pin);
+  TIMELINE_ISR_EXIT();
 }
 
 void DEFAULT EXTI1_IRQHandler( void){
+  TIMELINE_ISR_ENTER();
   cmn_callback_user_key_detected(KEY_R_Pin);
+  TIMELINE_ISR_EXIT();
 }
 
 void DEFAULT EXTI15_10_IRQHandler( void){
+  TIMELINE_ISR_ENTER();
   cmn_callback_user_key_detected(KEY_L_Pin);
+  TIMELINE_ISR_EXIT();
 }
 
 
@@ -492,8 +554,9 @@ void EXTI4_IRQHandler( void){}
  */
 void DMA1_Stream0_IRQHandler( void){
   extern DMA_HandleTypeDef hdma_i2c1_rx;
+  TIMELINE_ISR_ENTER();
   HAL_DMA_IRQHandler(&hdma_i2c1_rx);
-  metope.bsp.status->i2c1[0] = IDLE;
+  TIMELINE_ISR_EXIT();
 }
 
 /**
@@ -517,6 +580,7 @@ void DMA1_Stream2_IRQHandler( void){}
 void DMA1_Stream3_IRQHandler( void){}
 
 void DEFAULT DMA1_Stream4_IRQHandler(void){
+  TIMELINE_ISR_ENTER();
 
 #if 1
   u32 tmp = DMA1->HISR;
@@ -550,9 +614,21 @@ void DEFAULT DMA1_Stream4_IRQHandler(void){
   HAL_DMA_IRQHandler(&hdma_spi2_tx);
   cmn_callback_screen_spi_completed(&hspi2);
 #endif
+  TIMELINE_ISR_EXIT();
+}
+
+void DMA1_Stream5_IRQHandler( void){
+  TIMELINE_ISR_ENTER();
+  cmn_interrupt_uart_input( bsp_uart_rx_dma_isr());
+  TIMELINE_ISR_EXIT();
+}
+
+void DMA1_Stream6_IRQHandler( void){
+  TIMELINE_ISR_ENTER();
+  bsp_uart_tx_dma_isr();
+  TIMELINE_ISR_EXIT();
 }
 
-void DMA1_Stream5_IRQHandler( void){}
 void OTG_FS_IRQHandler( void){}
 void DMA2_Stream5_IRQHandler( void){}
 void DMA2_Stream6_IRQHandler( void){}
@@ -0,0 +1,207 @@
+/**
+ ******************************************************************************
+ * @file    cmn_line.c
+ * @author  RandleH
+ * @brief   Common Program - Receive Line Ring
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 RandleH.
+ * All rights reserved.
+ *
+ * This software component is licensed by RandleH under BSD 3-Clause license,
+ * the "License"; You may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at:
+ *                        opensource.org/licenses/BSD-3-Clause
+ *
+ ******************************************************************************
+*/
+
+
+/* ************************************************************************** */
+/*                                  Includes                                  */
+/* ************************************************************************** */
+#include <string.h>
+#include "cmn_line.h"
+
+
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @note The slot is written before `head` is released and read after `head` is acquired.
+ */
+#define LOAD( p)          __atomic_load_n( (p), __ATOMIC_ACQUIRE)
+#define STORE( p, v)      __atomic_store_n( (p), (v), __ATOMIC_RELEASE)
+
+
+/**
+ * @brief Initialize the ring
+ * @param [in] line    - Ring handle
+ * @param [in] rx_buf  - Circular receive buffer. Read from its start.
+ * @param [in] rx_size - Size of `rx_buf`
+ * @param [in] slot    - Storage of `num*width` bytes
+ * @param [in] num     - Number of slots. MUST be a power of 2.
+ * @param [in] width   - Longest line plus the terminator
+ */
+void cmn_line_init( tCmnLine *line, const uint8_t *rx_buf, uint32_t rx_size, char *slot, uint32_t num, uint32_t width){
+  line->rx_buf   = rx_buf;
+  line->rx_size  = rx_size;
+  line->rx_pos   = 0;
+  line->slot     = slot;
+  line->num      = num;
+  line->width    = width;
+  line->len      = 0;
+  line->skip     = 0;
+  line->frame    = 0;
+  line->cobs     = 0;
+  line->head     = 0;
+  line->tail     = 0;
+  line->overflow = 0;
+  line->dropped  = 0;
+  line->error    = 0;
+}
+
+/**
+ * @brief Cut the bytes received up to `rx_pos` into lines
+ * @note  Producer side. Called by the idle line, half and full transfer interrupts.
+ *        `rx_pos` is the position the DMA writes next, i.e. `rx_size - NDTR`.
+ *        The DMA MUST NOT lap the reader between two calls. Half a buffer of margin is left
+ *        when the half transfer interrupt is enabled.
+ * @param [in] line   - Ring handle
+ * @param [in] rx_pos - Write position of the DMA
+ * @return Number of lines completed
+ */
+uint32_t cmn_line_feed( tCmnLine *line, uint32_t rx_pos){
+  uint32_t head = line->head;
+  uint32_t done = 0;
+  uint32_t pos  = line->rx_pos;
+
+  while( pos != rx_pos && rx_pos < line->rx_size ){
+    const char c = (char)line->rx_buf[pos];
+    pos = (pos+1 == line->rx_size) ? 0 : pos+1;
+
+    if( c=='\0' || (!line->frame && (c=='\r' || c=='\n')) ){
+      /* Every `0x00` ends the frame being cut. One that ends no frame opens one. */
+      uint32_t open = (c=='\0') && !line->frame;
+      if( c=='\0' && !line->frame && !line->skip && line->len!=0 && line->len==line->cobs ){
+        /* The text is a whole COBS body. Its opening delimiter was lost. */
+        char *slot = &line->slot[(head & (line->num-1)) * line->width];
+        memmove( &slot[1], slot, line->len);
+        slot[0]      = '\0';
+        line->len   += 1;
+        line->frame  = 1;
+        open         = 0;
+      }
+      /* A frame holds its marker, so an empty frame is `len==1` and a no-op */
+      /* The opening delimiter ends a partial text line as well */
+      if( !line->skip && line->len > line->frame ){
+        line->slot[(head & (line->num-1)) * line->width + line->len] = '\0';
+        STORE( &line->head, ++head);
+        done += 1;
+      }
+      line->frame = open;
+      line->skip  = 0;
+      line->len   = 0;
+      line->cobs  = 0;
+      if( line->frame ){
+        if( head - LOAD( &line->tail) >= line->num ){
+          line->dropped += 1;
+          line->skip     = 1;
+        }else{
+          line->slot[(head & (line->num-1)) * line->width] = '\0';
+          line->len = 1;
+        }
+      }
+    }else if( line->skip ){
+      continue;
+    }else if( line->len + 1 >= line->width ){
+      line->overflow += 1;
+      line->skip      = 1;
+    }else if( line->len == 0 && head - LOAD( &line->tail) >= line->num ){
+      line->dropped += 1;
+      line->skip     = 1;
+    }else{
+      if( !line->frame && line->len==line->cobs ){
+        line->cobs += (uint8_t)c;
+      }
+      line->slot[(head & (line->num-1)) * line->width + line->len] = c;
+      line->len += 1;
+    }
+  }
+
+  line->rx_pos = pos;
+  return done;
+}
+
+/**
+ * @brief Drop the line being cut
+ * @note  Producer side. Called when the receiver reports an overrun, a framing or a noise error.
+ *        Inside a frame, the bytes up to the next `0x00` are dropped and that `0x00` closes the frame,
+ *        even if it follows right away.
+ */
+void cmn_line_error( tCmnLine *line){
+  line->error += 1;
+  line->skip   = 1;
+  line->len    = 0;
+  line->cobs   = 0;
+}
+
+/**
+ * @brief Oldest line
+ * @note  Consumer side. The line stays valid until `cmn_line_pop()`.
+ * @return Null terminated line. `NULL` if nothing was received.
+ */
+const char *cmn_line_front( tCmnLine *line){
+  const uint32_t tail = line->tail;
+  if( LOAD( &line->head) == tail ){
+    return NULL;
+  }
+  return &line->slot[(tail & (line->num-1)) * line->width];
+}
+
+/**
+ * @brief Oldest line if it is a binary frame
+ * @note  Consumer side. The body stays valid until `cmn_line_pop()` and may be decoded in place.
+ * @param [out] body - COBS body without the delimiters
+ * @return Length of the body. `0` if the oldest line is text or nothing was received.
+ */
+size_t cmn_line_frame( tCmnLine *line, uint8_t **body){
+  const uint32_t tail = line->tail;
+  if( LOAD( &line->head) == tail ){
+    return 0;
+  }
+  char *slot = &line->slot[(tail & (line->num-1)) * line->width];
+  if( slot[0] != '\0' ){
+    return 0;
+  }
+  *body = (uint8_t *)&slot[1];
+  return strlen( &slot[1]);
+}
+
+/**
+ * @brief Release the oldest line
+ * @note  Consumer side. Nothing happens if nothing was received.
+ */
+void cmn_line_pop( tCmnLine *line){
+  const uint32_t tail = line->tail;
+  if( LOAD( &line->head) != tail ){
+    STORE( &line->tail, tail + 1);
+  }
+}
+
+/**
+ * @brief Number of lines waiting for the consumer
+ */
+uint32_t cmn_line_pending( const tCmnLine *line){
+  return LOAD( &line->head) - LOAD( &line->tail);
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+/* ********************************** EOF *********************************** */
@@ -21,8 +21,10 @@
 /* ************************************************************************** */
 /*                                  Includes                                  */
 /* ************************************************************************** */
+#include <string.h>
 #include "device.h"
 #include "cmn_math.h"
+#include "cmn_utility.h"
 
 
 
@@ -153,6 +155,207 @@ uint8_t cmn_math_count_dec_digits( uint32_t x){
 }
 
 
+
+/* ************************************************************************** */
+/*                        Fixed Point Angle & Trigonometry                    */
+/* ************************************************************************** */
+/**
+ * @note
+ *  Quarter wave of `sin()` in Q15 over [0:PI/2] with 256 segments.
+ *  Entry `i` is `round(32767*sin(i*PI/512))`. The last entry is a guard for the interpolation.
+ */
+static const int16_t TABLE_SIN_Q15[256+2] = {
+      0,   201,   402,   603,   804,  1005,  1206,  1407,
+   1608,  1809,  2009,  2210,  2410,  2611,  2811,  3012,
+   3212,  3412,  3612,  3811,  4011,  4210,  4410,  4609,
+   4808,  5007,  5205,  5404,  5602,  5800,  5998,  6195,
+   6393,  6590,  6786,  6983,  7179,  7375,  7571,  7767,
+   7962,  8157,  8351,  8545,  8739,  8933,  9126,  9319,
+   9512,  9704,  9896, 10087, 10278, 10469, 10659, 10849,
+  11039, 11228, 11417, 11605, 11793, 11980, 12167, 12353,
+  12539, 12725, 12910, 13094, 13279, 13462, 13645, 13828,
+  14010, 14191, 14372, 14553, 14732, 14912, 15090, 15269,
+  15446, 15623, 15800, 15976, 16151, 16325, 16499, 16673,
+  16846, 17018, 17189, 17360, 17530, 17700, 17869, 18037,
+  18204, 18371, 18537, 18703, 18868, 19032, 19195, 19357,
+  19519, 19680, 19841, 20000, 20159, 20317, 20475, 20631,
+  20787, 20942, 21096, 21250, 21403, 21554, 21705, 21856,
+  22005, 22154, 22301, 22448, 22594, 22739, 22884, 23027,
+  23170, 23311, 23452, 23592, 23731, 23870, 24007, 24143,
+  24279, 24413, 24547, 24680, 24811, 24942, 25072, 25201,
+  25329, 25456, 25582, 25708, 25832, 25955, 26077, 26198,
+  26319, 26438, 26556, 26674, 26790, 26905, 27019, 27133,
+  27245, 27356, 27466, 27575, 27683, 27790, 27896, 28001,
+  28105, 28208, 28310, 28411, 28510, 28609, 28706, 28803,
+  28898, 28992, 29085, 29177, 29268, 29358, 29447, 29534,
+  29621, 29706, 29791, 29874, 29956, 30037, 30117, 30195,
+  30273, 30349, 30424, 30498, 30571, 30643, 30714, 30783,
+  30852, 30919, 30985, 31050, 31113, 31176, 31237, 31297,
+  31356, 31414, 31470, 31526, 31580, 31633, 31685, 31736,
+  31785, 31833, 31880, 31926, 31971, 32014, 32057, 32098,
+  32137, 32176, 32213, 32250, 32285, 32318, 32351, 32382,
+  32412, 32441, 32469, 32495, 32521, 32545, 32567, 32589,
+  32609, 32628, 32646, 32663, 32678, 32692, 32705, 32717,
+  32728, 32737, 32745, 32752, 32757, 32761, 32765, 32766,
+  32767, 32767,
+};
+
+/**
+ * @note
+ *  `atan(t)` over t=[0:1] with 64 segments. Measured in binary angle.
+ *  Entry `i` is `round(atan(i/64)*65536/(2*PI))`. The last entry is a guard for the interpolation.
+ */
+static const uint16_t TABLE_ATAN_BRAD[64+2] = {
+      0,   163,   326,   489,   651,   813,   975,  1136,
+   1297,  1457,  1617,  1775,  1933,  2090,  2246,  2401,
+   2555,  2708,  2860,  3010,  3159,  3307,  3453,  3599,
+   3742,  3884,  4025,  4164,  4302,  4438,  4572,  4705,
+   4836,  4966,  5094,  5220,  5344,  5467,  5589,  5708,
+   5826,  5943,  6058,  6171,  6282,  6392,  6500,  6607,
+   6712,  6815,  6917,  7018,  7117,  7214,  7310,  7405,
+   7498,  7589,  7679,  7768,  7856,  7942,  8026,  8110,
+   8192,  8192,
+};
+
+/**
+ * @brief Wrap an angle back to [0:3599]
+ * @note  Branch free. Valid for [-3600:7199], which is what a needle could reach after
+ *        one increment or decrement. Use `cmn_math_mod3600()` for anything else.
+ * @param [in] x - Angle in the scale of 3600
+ * @return Return the wrapped angle
+ */
+uint16_t cmn_math_wrap3600( int32_t x){
+  x -= 3600 & -(int32_t)(x >= 3600);
+  x += 3600 & (x >> 31);
+  return (uint16_t)x;
+}
+
+/**
+ * @brief Remainder of 3600 through a reciprocal multiplication
+ * @note  Exact for the full `uint32_t` range. `0x91A2B3C5` is `ceil(2^43/3600)`.
+ * @param [in] x - Angle in the scale of 3600
+ * @return Return `x%3600`
+ */
+uint16_t cmn_math_mod3600( uint32_t x){
+  uint32_t quot = (uint32_t)(((uint64_t)x * 0x91A2B3C5U) >> 43);
+  return (uint16_t)(x - quot*3600);
+}
+
+/**
+ * @brief Convert an angle in the scale of 3600 to binary angle
+ * @param [in] x - Angle in the scale of 3600. Range: [0:3599]
+ * @return Return the binary angle, rounded to the nearest
+ */
+cmnBrad_t cmn_math_ddeg2brad( uint16_t x){
+  /* 1193046 is `2^32/3600`. The product is less than 2^32 for x<3600 */
+  return (cmnBrad_t)(((uint32_t)x * 1193046U + 0x8000U) >> 16);
+}
+
+/**
+ * @brief Convert a binary angle to the scale of 3600
+ * @param [in] x - Binary angle
+ * @return Return the angle in the scale of 3600, rounded to the nearest. Range: [0:3599]
+ */
+uint16_t cmn_math_brad2ddeg( cmnBrad_t x){
+  return cmn_math_wrap3600( ((uint32_t)x * 3600U + 0x8000U) >> 16);
+}
+
+/**
+ * @brief Saturated Q15 multiplication with rounding
+ * @note  `-1 * -1` saturates to `0x7FFF`
+ * @addtogroup MachineDependent
+ */
+cmnQ15_t cmn_math_mul_q15( cmnQ15_t a, cmnQ15_t b){
+  int32_t x = ((int32_t)a * b + 0x4000) >> 15;
+  return (cmnQ15_t)CMN_SSAT( x, 16);
+}
+
+/**
+ * @brief Fixed point sine
+ * @note  Quarter wave table with linear interpolation. The two neighbouring entries are
+ *        loaded in one word and interpolated by a single `SMLAD`.
+ * @note  Maximum absolute error against `32767*sin()` is 1 LSB.
+ * @param [in] x - Binary angle
+ * @return Return `sin(x)` in Q15. Range: [-32767:32767]
+ * @addtogroup MachineDependent
+ */
+cmnQ15_t cmn_math_sin_q15( cmnBrad_t x){
+  uint32_t quadrant = x >> 14;
+  int32_t  mirror   = -(int32_t)(quadrant & 1);
+  int32_t  sign     = -(int32_t)(quadrant >> 1);
+
+  /* Distance into the quarter. Mirrored for the 2nd and 4th quadrant: 0x4000-x */
+  uint32_t pos   = ((((x & 0x3FFF) ^ mirror) - mirror) + (mirror & 0x4000)) & 0x7FFF;
+  uint32_t idx   = pos >> 6;
+  uint32_t frac  = pos & 0x3F;
+
+  uint32_t pair;
+  memcpy( &pair, &TABLE_SIN_Q15[idx], sizeof(pair));
+  int32_t  y     = (int32_t)CMN_SMLAD( pair, (frac<<16) | (64-frac), 32) >> 6;
+
+  return (cmnQ15_t)((y ^ sign) - sign);
+}
+
+/**
+ * @brief Fixed point cosine
+ * @note  Same accuracy as `cmn_math_sin_q15()`
+ * @param [in] x - Binary angle
+ * @return Return `cos(x)` in Q15. Range: [-32767:32767]
+ */
+cmnQ15_t cmn_math_cos_q15( cmnBrad_t x){
+  return cmn_math_sin_q15( (cmnBrad_t)(x + 0x4000));
+}
+
+/**
+ * @brief Fixed point sine and cosine
+ * @param [in]  x     - Binary angle
+ * @param [out] p_sin - `sin(x)` in Q15
+ * @param [out] p_cos - `cos(x)` in Q15
+ */
+void cmn_math_sincos_q15( cmnBrad_t x, cmnQ15_t *p_sin, cmnQ15_t *p_cos){
+  *p_sin = cmn_math_sin_q15( x);
+  *p_cos = cmn_math_sin_q15( (cmnBrad_t)(x + 0x4000));
+}
+
+/**
+ * @brief Fixed point arctangent of `y/x` over all four quadrants
+ * @note  Octant reduction, one division for the ratio, then table lookup with linear
+ *        interpolation. Maximum absolute error is 2 binary angle units (0.011 degree).
+ * @param [in] y - Any scale, same as `x`
+ * @param [in] x - Any scale, same as `y`
+ * @return Return the binary angle of vector (x,y). `0` when both are zero.
+ * @addtogroup MachineDependent
+ */
+cmnBrad_t cmn_math_atan2_brad( int32_t y, int32_t x){
+  uint32_t ax = (x<0) ? 0U-(uint32_t)x : (uint32_t)x;
+  uint32_t ay = (y<0) ? 0U-(uint32_t)y : (uint32_t)y;
+  uint32_t mx = CMN_MAX( ax, ay);
+  uint32_t mn = CMN_MIN( ax, ay);
+
+  if(mx==0){
+    return 0;
+  }
+
+  /* Keep `mn<<15` within 31 bits */
+  uint32_t lz = CMN_CLZ_U32(mx);
+  if(lz < 16){
+    mx >>= 16-lz;
+    mn >>= 16-lz;
+  }
+
+  uint32_t t    = (mn << 15) / mx;                    /*!< Q15 ratio. Range: [0:32768] */
+  uint32_t idx  = t >> 9;
+  uint32_t frac = t & 0x1FF;
+  uint32_t a    = TABLE_ATAN_BRAD[idx] + ((((int32_t)TABLE_ATAN_BRAD[idx+1] - TABLE_ATAN_BRAD[idx]) * (int32_t)frac + 0x100) >> 9);
+
+  /* Back to the octant */
+  if(ay > ax) a = 0x4000 - a;
+  if(x  < 0 ) a = 0x8000 - a;
+  if(y  < 0 ) a = 0x10000 - a;
+  return (cmnBrad_t)a;
+}
+
+
 #ifdef __cplusplus
 }
 #endif
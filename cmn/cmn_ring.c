@@ -0,0 +1,176 @@
+/**
+ ******************************************************************************
+ * @file    cmn_ring.c
+ * @author  RandleH
+ * @brief   Common Program - Lock-free Byte Ring
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 RandleH.
+ * All rights reserved.
+ *
+ * This software component is licensed by RandleH under BSD 3-Clause license,
+ * the "License"; You may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at:
+ *                        opensource.org/licenses/BSD-3-Clause
+ *
+ ******************************************************************************
+*/
+
+
+/* ************************************************************************** */
+/*                                  Includes                                  */
+/* ************************************************************************** */
+#include <string.h>
+#include "cmn_ring.h"
+#include "cmn_utility.h"
+
+
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @note
+ *  Cortex-M4 builds these with LDREX/STREX. The sequentially consistent order only matters on
+ *  a multi-core host, where the `busy` release and the `commit` add MUST NOT miss each other.
+ */
+#define LOAD( p)          __atomic_load_n( (p), __ATOMIC_SEQ_CST)
+#define STORE( p, v)      __atomic_store_n( (p), (v), __ATOMIC_SEQ_CST)
+#define ADD( p, v)        __atomic_fetch_add( (p), (v), __ATOMIC_SEQ_CST)
+#define CAS( p, e, v)     __atomic_compare_exchange_n( (p), (e), (v), 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+
+
+/**
+ * @brief Bytes left to send once every reserved byte was committed
+ * @note  The length comes from the `commit` that was checked against `head`. A `commit` loaded
+ *        again may already count a reservation opened meanwhile whose bytes are not copied yet.
+ * @return 0 if nothing is ready
+ */
+static inline uint32_t cmn_ring_ready( tCmnRing *ring){
+  uint32_t commit = LOAD( &ring->commit);
+  if( commit!=LOAD( &ring->head) ){
+    return 0;
+  }
+  return commit - LOAD( &ring->tail);
+}
+
+/**
+ * @brief Next contiguous chunk of the consumer
+ * @note  The caller owns `busy`. It is released if nothing is ready, then checked once more,
+ *        because a producer may have committed after the check and failed to claim.
+ * @return Chunk length. 0 if `busy` was released.
+ */
+static size_t cmn_ring_pick( tCmnRing *ring, const uint8_t **ptr){
+  for(;;){
+    uint32_t ready = cmn_ring_ready( ring);
+    if( ready ){
+      uint32_t offset = ring->tail & (ring->size-1);
+      *ptr = &ring->buf[offset];
+      return CMN_MIN( ready, ring->size - offset);
+    }
+
+    STORE( &ring->busy, 0U);
+
+    uint32_t expect = 0;
+    if( !cmn_ring_ready( ring) || !CAS( &ring->busy, &expect, 1U) ){
+      return 0;
+    }
+  }
+}
+
+/**
+ * @brief Initialize the ring
+ * @param [in] ring - Ring handle
+ * @param [in] buf  - Storage
+ * @param [in] size - Storage size. MUST be a power of 2.
+ */
+void cmn_ring_init( tCmnRing *ring, uint8_t *buf, uint32_t size){
+  ring->buf     = buf;
+  ring->size    = size;
+  ring->head    = 0;
+  ring->commit  = 0;
+  ring->tail    = 0;
+  ring->busy    = 0;
+  ring->dropped = 0;
+}
+
+/**
+ * @brief Queue one message
+ * @note  Safe from any task or ISR. Never blocks.
+ * @param [in] ring - Ring handle
+ * @param [in] data - Message
+ * @param [in] len  - Message length
+ * @return `len` if queued. 0 if the ring has no room and the message was dropped.
+ */
+size_t cmn_ring_write( tCmnRing *ring, const void *data, size_t len){
+  if( len==0 ){
+    return 0;
+  }
+
+  uint32_t head = LOAD( &ring->head);
+  do{
+    if( len > ring->size - (head - LOAD( &ring->tail)) ){
+      ADD( &ring->dropped, 1U);
+      return 0;
+    }
+  }while( !CAS( &ring->head, &head, head + (uint32_t)len) );
+
+  uint32_t offset = head & (ring->size-1);
+  size_t   first  = CMN_MIN( len, (size_t)(ring->size - offset));
+  memcpy( &ring->buf[offset], data, first);
+  memcpy( &ring->buf[0], (const uint8_t*)data + first, len - first);
+
+  ADD( &ring->commit, (uint32_t)len);
+  return len;
+}
+
+/**
+ * @brief Take the consumer and get the first chunk
+ * @param [in]  ring - Ring handle
+ * @param [out] ptr  - Start of the chunk
+ * @return Chunk length. 0 if the consumer is owned by someone else or nothing is ready.
+ *         Otherwise the caller owns the consumer and MUST call `cmn_ring_next()` when done.
+ */
+size_t cmn_ring_claim( tCmnRing *ring, const uint8_t **ptr){
+  uint32_t expect = 0;
+  if( !cmn_ring_ready( ring) || !CAS( &ring->busy, &expect, 1U) ){
+    return 0;
+  }
+  return cmn_ring_pick( ring, ptr);
+}
+
+/**
+ * @brief Release a sent chunk and get the next one
+ * @note  Called by the owner of the consumer. eg: DMA transfer complete interrupt.
+ * @param [in]  ring - Ring handle
+ * @param [in]  done - Length of the chunk just sent
+ * @param [out] ptr  - Start of the next chunk
+ * @return Next chunk length. 0 if the consumer was released.
+ */
+size_t cmn_ring_next( tCmnRing *ring, size_t done, const uint8_t **ptr){
+  STORE( &ring->tail, ring->tail + (uint32_t)done);
+  return cmn_ring_pick( ring, ptr);
+}
+
+/**
+ * @brief Number of bytes reserved and NOT released yet
+ */
+size_t cmn_ring_pending( const tCmnRing *ring){
+  return (size_t)(LOAD( &ring->head) - LOAD( &ring->tail));
+}
+
+/**
+ * @brief Number of messages dropped since initialization
+ */
+uint32_t cmn_ring_dropped( const tCmnRing *ring){
+  return LOAD( &ring->dropped);
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+/* ********************************** EOF *********************************** */
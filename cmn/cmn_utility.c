@@ -36,11 +36,13 @@
 /* ************************************************************************** */
 /*                                  Includes                                  */
 /* ************************************************************************** */
+#define TRACE_MODULE  CMN
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include "trace.h"
+#include "profile.h"
 #include "cmn_utility.h"
 #include "cmn_math.h"
 
@@ -59,6 +61,26 @@
 #define UNUSED(X) (void)X      /* To avoid gcc/g++ warnings */
 #endif /* UNUSED */
 
+
+/* ************************************************************************** */
+/*                                Private Tables                              */
+/* ************************************************************************** */
+/**
+ * @note
+ *  Two decimal digits per entry. Entry `n` is located at `TABLE_DEC_PAIR[2*n]`.
+ */
+static const char TABLE_DEC_PAIR[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
 #ifdef __cplusplus
 extern "C"{
 #endif
@@ -121,6 +143,17 @@ char *cmn_utility_strnrev(char *str, size_t len){
 /* ************************************************************************** */
 /*                 Utility Functions: Convert number to string                */
 /* ************************************************************************** */
+/**
+ * @brief Divide by 100 with a reciprocal multiplication
+ * @note  Exact for the full `uint32_t` range. `0x51EB851F` is `ceil(2^37/100)`.
+ *        Cortex-M4 `UDIV` takes up to 12 cycles while `UMULL` takes 1.
+ * @param [in] x - Dividend
+ * @return Return `x/100`
+ */
+static inline uint32_t cmn_utility_div100( uint32_t x){
+  return (uint32_t)(((uint64_t)x * 0x51EB851FU) >> 37);
+}
+
 /**
  * @brief Insert `#` instead of digits indicating this number can NOT fit in the width
  * @param [out] str     - String buffer
@@ -156,17 +189,29 @@ uint8_t cmn_utility_uint2strdec_width( char *str, uint8_t maxlen, uint32_t value
   if(likely( wordlen <= width && width <= maxlen-1 )){
     /**
      * @note
-     *  Insert the character through the LSB order
+     *  Insert two characters per step through the LSB order
      */
-    uint8_t idx = width;
-    div_t   tmp = {.quot = value};
-    str[idx] = '\0';
+    char *ptr = &str[width];
+    *ptr = '\0';
+
+    while(value >= 100){
+      uint32_t quot = cmn_utility_div100(value);
+      ptr -= 2;
+      memcpy( ptr, &TABLE_DEC_PAIR[(value - quot*100)<<1], 2);
+      value = quot;
+    }
 
-    do{
-      tmp = div(tmp.quot, 10);
-      str[--idx] = '0'+tmp.rem;
+    if(value >= 10){
+      ptr -= 2;
+      memcpy( ptr, &TABLE_DEC_PAIR[value<<1], 2);
+    }else{
+      *--ptr = '0'+value;
+    }
 
-    }while(idx > 0);
+    /* Zero padding */
+    while(ptr > str){
+      *--ptr = '0';
+    }
     return width;
   }else{
     /**
@@ -177,6 +222,20 @@ uint8_t cmn_utility_uint2strdec_width( char *str, uint8_t maxlen, uint32_t value
   }
 }
 
+/**
+ * @brief Convert an unsigned integer to exactly two zero padded decimal digits
+ * @note  Fast path for time labels. Same as `%02u`.
+ * @warning `value` must be less than 100. Buffer must hold at least 3 characters.
+ * @param [out] str   - String buffer
+ * @param [in]  value - Input. Range: [0:99]
+ * @return Return num of characters that have been placed to the buffer
+ */
+uint8_t cmn_utility_uint2strdec_2digits( char *str, uint32_t value){
+  memcpy( str, &TABLE_DEC_PAIR[value<<1], 2);
+  str[2] = '\0';
+  return 2;
+}
+
 /**
  * @brief Convert a signed integer to string in Decimal with width option
  * 
@@ -189,7 +248,7 @@ uint8_t cmn_utility_uint2strdec_width( char *str, uint8_t maxlen, uint32_t value
 uint8_t cmn_utility_int2strdec_width( char *str, uint8_t maxlen, int32_t value, uint8_t width){
   if(value<0 && maxlen!=0){
     str[0] = '-';
-    return 1 + cmn_utility_uint2strdec_width( ++str, maxlen-1, -value, width);
+    return 1 + cmn_utility_uint2strdec_width( ++str, maxlen-1, 0U-(uint32_t)value, width);
   }else{
     return cmn_utility_uint2strdec_width( str, maxlen, value, width);
   }
@@ -333,6 +392,7 @@ int cmn_utility_snprintf(char * restrict str, size_t size, const char * restrict
  * @todo Add to CI testing
  */
 int cmn_utility_vsnprintf(char * restrict buf, size_t size, const char * restrict format, va_list va){
+  PROFILE_BEGIN( VSNPRINTF);
   uint8_t idx = 0;
 
   while(*format && idx<size) {
@@ -352,10 +412,13 @@ int cmn_utility_vsnprintf(char * restrict buf, size_t size, const char * restric
       switch(c) {
         case 'u':
         case 'U':{
+          uint32_t value = va_arg(va, uint32_t);
           if(width==0xFF){
-            idx += cmn_utility_uint2strdec( &buf[idx], size-idx, va_arg(va, uint32_t));
+            idx += cmn_utility_uint2strdec( &buf[idx], size-idx, value);
+          }else if(width==2 && value<100 && size-idx>2){
+            idx += cmn_utility_uint2strdec_2digits( &buf[idx], value);
           }else{
-            idx += cmn_utility_uint2strdec_width( &buf[idx], size-idx, va_arg(va, uint32_t), width);
+            idx += cmn_utility_uint2strdec_width( &buf[idx], size-idx, value, width);
           }
           flag = FMT_STR_DEC_UNSIGNED;
           break;
@@ -369,10 +432,13 @@ int cmn_utility_vsnprintf(char * restrict buf, size_t size, const char * restric
         }
         case 'd':
         case 'D':{
+          int32_t value = va_arg(va, int32_t);
           if(width==0xFF){
-            idx += cmn_utility_int2strdec( &buf[idx], size-idx, va_arg(va, int32_t));
+            idx += cmn_utility_int2strdec( &buf[idx], size-idx, value);
+          }else if(width==2 && (uint32_t)value<100 && size-idx>2){
+            idx += cmn_utility_uint2strdec_2digits( &buf[idx], value);
           }else{
-            idx += cmn_utility_int2strdec_width( &buf[idx], size-idx, va_arg(va, int32_t), width);
+            idx += cmn_utility_int2strdec_width( &buf[idx], size-idx, value, width);
           }
           flag = FMT_STR_DEC_SIGNED;
           break;
@@ -427,6 +493,7 @@ int cmn_utility_vsnprintf(char * restrict buf, size_t size, const char * restric
   idx = CMN_MIN( idx, size-1);
   buf[idx++] = '\0';
 
+  PROFILE_END( VSNPRINTF);
   return idx;
 }
 
@@ -437,7 +504,7 @@ int cmn_utility_vsnprintf(char * restrict buf, size_t size, const char * restric
 
 /**
  * @brief   Calculate how much angle need to change given a microsecond increase
- * @note    The angle degreee was in scale of [0:3599]
+ * @note    The angle degreee was in scale of [0:3599]. An increase of a full circle or more wraps.
  * @param [inout] hour_rem    - Remaining value for hour (which is measured in microseconds)
  * @param [inout] minute_rem  - Remaining value for minute
  * @param [inout] second_rem  - Remaining value for second
@@ -455,32 +522,19 @@ void cmn_utility_angleinc(
                           uint16_t NULLABLE *second_inc,\
                           uint32_t           ms\
                           ){
-  div_t remainder_hour   = {.rem = *hour_rem};
-  div_t remainder_minute = {.rem = *minute_rem};
-  div_t remainder_second = {.rem = second_rem==NULL ? 0: *second_rem};
-
-#if 0
-  remainder_hour = div( remainder_hour.rem + ms*3600, 43200000);
-  remainder_minute = div( remainder_minute.rem + ms*3600, 3600000);  // It takes `3600000` ms to complete a secondwise circle
-  *hour_inc = remainder_hour.quot;
-  *minute_inc = remainder_minute.quot;
-  if(NULL!=second_inc){
-    remainder_second = div( remainder_second.rem + ms*3600, 60000);  // It takes `60000` ms to complete a secondwise circle
-    *second_inc = remainder_second.quot;
-  }
-#else
-  remainder_hour = div( remainder_hour.rem + ms, 12000);
-  remainder_minute = div( remainder_minute.rem + ms, 1000);
-  *hour_inc   = remainder_hour.quot;
-  *minute_inc = remainder_minute.quot;
-  *hour_rem   = remainder_hour.rem;
-  *minute_rem = remainder_minute.rem;
+  /* Unsigned division by constants compiles to a reciprocal multiplication, unlike the libc `div()` */
+  uint32_t hour   = *hour_rem   + ms;
+  uint32_t minute = *minute_rem + ms;
+
+  *hour_inc   = cmn_math_mod3600( hour/12000);
+  *minute_inc = cmn_math_mod3600( minute/1000);
+  *hour_rem   = (uint16_t)(hour%12000);
+  *minute_rem = (uint16_t)(minute%1000);
   if(NULL!=second_inc && NULL!=second_rem){
-    remainder_second = div( remainder_second.rem + ms*3, 50);
-    *second_inc = remainder_second.quot;
-    *second_rem = remainder_second.rem;
+    uint32_t second = *second_rem + ms*3;
+    *second_inc = cmn_math_mod3600( second/50);
+    *second_rem = (uint16_t)(second%50);
   }
-#endif
   return;
 }
 
@@ -512,7 +566,7 @@ void cmn_utility_angleset(
                           ){
   uint8_t hour = pTime->hour>12 ? pTime->hour-12 : pTime->hour;
   
-  *hour_deg   =        hour  *300 + pTime->minute*5 + pTime->second/12;
+  *hour_deg   = cmn_math_wrap3600( hour*300 + pTime->minute*5 + pTime->second/12);
   *hour_rem   = 1000*(pTime->second%12);
 
   *minute_deg = pTime->minute*60  + pTime->second;
@@ -529,8 +583,81 @@ void cmn_utility_angleset(
 /*                    Utility Functions: Timing Calculation                   */
 /* ************************************************************************** */
 /**
- * @todo: Add CI for this function
+ * @note
+ *  Epoch arithmetic is done on days since 2000/03/01. Starting the year from March puts the leap day
+ *  at the end of the year so the month length pattern becomes regular. 2000/03/01 is the start of a
+ *  400-year era which is valid until 2400/02/29, hence no era calculation is needed.
+ * @ref http://howardhinnant.github.io/date_algorithms.html
+ */
+#define DAYS_FROM_20000301_TO_EPOCH   (7976U)   /*!< Days from 2000/03/01 to 2022/01/01 */
+#define SEC_PER_DAY                   (86400U)
+
+/**
+ * @brief Convert a civil date to days since 2022/01/01
+ * @param [in] year  - Full year. Range: [2022:2158]
+ * @param [in] month - Range: [1:12]
+ * @param [in] day   - Range: [1:31]
+ * @return Return days since 2022/01/01
+ */
+uint32_t cmn_utility_days_from_civil( uint32_t year, uint32_t month, uint32_t day){
+  year -= (month <= 2);
+  const uint32_t yoe = year - 2000;                                     /* [0, 399] */
+  const uint32_t mp  = (month > 2) ? month-3 : month+9;                 /* [0, 11] */
+  const uint32_t doy = (153*mp + 2)/5 + day-1;                          /* [0, 365] */
+  const uint32_t doe = yoe*365 + yoe/4 - yoe/100 + doy;                 /* [0, 146096] */
+  return doe - DAYS_FROM_20000301_TO_EPOCH;
+}
+
+/**
+ * @brief Convert days since 2022/01/01 to a civil date
+ * @param [in]  days  - Days since 2022/01/01
+ * @param [out] year  - Full year
+ * @param [out] month - Range: [1:12]
+ * @param [out] day   - Range: [1:31]
+ */
+void cmn_utility_civil_from_days( uint32_t days, uint32_t *year, uint32_t *month, uint32_t *day){
+  const uint32_t doe = days + DAYS_FROM_20000301_TO_EPOCH;                    /* [0, 146096] */
+  const uint32_t yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;       /* [0, 399] */
+  const uint32_t doy = doe - (365*yoe + yoe/4 - yoe/100);                     /* [0, 365] */
+  const uint32_t mp  = (5*doy + 2)/153;                                       /* [0, 11] */
+  *day   = doy - (153*mp+2)/5 + 1;
+  *month = (mp < 10) ? mp+3 : mp-9;
+  *year  = yoe + 2000 + (*month <= 2);
+}
+
+/**
+ * @brief Convert the packed datetime to epoch
+ * @param [in] time - Input Time
+ * @return Return seconds since 2022/01/01 00:00:00
+ */
+cmnEpoch_t cmn_utility_datetime2epoch( cmnDateTime_t time){
+  uint32_t days = cmn_utility_days_from_civil( time.year + CMN_DATE_YEAR_OFFSET, time.month, time.day);
+  return days*SEC_PER_DAY + time.hour*3600 + time.minute*60 + time.second;
+}
+
+/**
+ * @brief Convert epoch to the packed datetime
+ * @warning Year is truncated if the epoch goes beyond what `cmnDateTime_t` could hold.
+ * @param [in] epoch - Seconds since 2022/01/01 00:00:00
+ * @return Return datetime
  */
+cmnDateTime_t cmn_utility_epoch2datetime( cmnEpoch_t epoch){
+  uint32_t      days = epoch / SEC_PER_DAY;
+  uint32_t      sec  = epoch - days*SEC_PER_DAY;
+  uint32_t      year, month, day;
+  cmnDateTime_t time;
+
+  cmn_utility_civil_from_days( days, &year, &month, &day);
+  time.year   = year - CMN_DATE_YEAR_OFFSET;
+  time.month  = month;
+  time.day    = day;
+  time.hour   = sec / 3600;
+  sec        -= time.hour * 3600;
+  time.minute = sec / 60;
+  time.second = sec - time.minute * 60;
+  return time;
+}
+
 /**
  * @brief   Update the time given a increased microsecond
  * @warning Always pass the same time pointer to this function.Becasuse this function will
@@ -540,89 +667,39 @@ void cmn_utility_angleset(
  * @param [in]    ms    - The increased microseconds
  */
 void cmn_utility_timeinc( uint32_t *ms_rem, cmnDateTime_t *pTime, uint32_t ms){
-  /* Extract seconds and microseconds */
-  div_t tmp = div( *ms_rem + ms, 1000);
-
-  cmnBoolean_t trace_triggered = false;
-
-  if(unlikely(pTime->second+tmp.quot >= 60)){
-    tmp = div(pTime->second+tmp.quot, 60);
-    pTime->second = tmp.rem;
-
-    trace_triggered = true;
-
-    if(unlikely(pTime->minute+tmp.quot >= 60)){
-      tmp = div(pTime->minute+tmp.quot, 60);
-      pTime->minute = tmp.rem;
+  uint32_t ms_total = *ms_rem + ms;
+  uint32_t sec      = ms_total / 1000;
 
-      if(unlikely(pTime->hour+tmp.quot >= 24)){
-        tmp = div(pTime->hour+tmp.quot, 24);
-        pTime->hour = tmp.rem;
+  *ms_rem = ms_total - sec*1000;
 
-        uint8_t max_day_this_month = ((pTime->month <=7) ? (30 + (pTime->month&0x01)) : (31 - (pTime->month&0x01)));
-
-        /**
-         * @note: Special case for leap year
-         */
-        if(unlikely(pTime->year%4==0 && pTime->month==2)){
-          max_day_this_month = 28;
-        }
-        if(unlikely(pTime->day+tmp.quot >= max_day_this_month)){
-          tmp = div(pTime->day+tmp.quot, max_day_this_month);
-          pTime->day = tmp.rem;
-          
-          if(unlikely(pTime->month+tmp.quot>12)){
-            tmp = div(pTime->month+tmp.quot, 12);
-            pTime->month = tmp.rem;
-            pTime->year+=tmp.quot;
-          }
-          else{
-            pTime->month += tmp.quot;
-          }
-        }
-        else{
-          pTime->day += tmp.quot;
-        }
-      }
-      else{
-        pTime->hour += tmp.quot;
-      }
-    }
-    else{
-      pTime->minute += tmp.quot;
-    }
-  }else{
-    pTime->second += tmp.quot;
+  /* Fast path: Second needle does NOT wrap */
+  if(likely(pTime->second + sec < 60)){
+    pTime->second += sec;
+    return;
   }
 
-  *ms_rem = tmp.rem;
+  *pTime = cmn_utility_epoch2datetime( cmn_utility_datetime2epoch(*pTime) + sec);
 
-  if(trace_triggered){
-    cmnDateTime_t time = *pTime;
-    TRACE_DEBUG("CMN - Time increased to %u/%u/%u %u:%u:%u", time.year + CMN_DATE_YEAR_OFFSET, time.month, time.day, time.hour, time.minute, time.second);
-    UNUSED(time);
-  }
+  cmnDateTime_t time = *pTime;
+  TRACE_DEBUG("CMN - Time increased to %u/%u/%u %u:%u:%u", time.year + CMN_DATE_YEAR_OFFSET, time.month, time.day, time.hour, time.minute, time.second);
+  UNUSED(time);
 }
 
 /**
  * @brief Ans in seconds := TimeA - TimeB
  * @param [in] timeA - Input Time A
  * @param [in] timeB - Input Time B
- * @return Return `INT32_MAX` if year and month are not equal!! Otherwise return difference gap in seconds
+ * @return Return difference gap in seconds
  */
 int32_t cmn_utility_timediff( cmnDateTime_t timeA, cmnDateTime_t timeB){
-  int32_t sec = 0;
-
-  if(timeA.year != timeB.year || timeA.month != timeB.month){
-    return INT32_MAX;
+  /* Fast path: Same month. Days count from the 1st and no calendar is needed */
+  if(likely(timeA.year == timeB.year && timeA.month == timeB.month)){
+    return ((int32_t)timeA.day    - (int32_t)timeB.day   )*(int32_t)SEC_PER_DAY
+         + ((int32_t)timeA.hour   - (int32_t)timeB.hour  )*3600
+         + ((int32_t)timeA.minute - (int32_t)timeB.minute)*60
+         + ((int32_t)timeA.second - (int32_t)timeB.second);
   }
-  
-  sec += ((signed)(timeA.day - timeB.day))*3600*12;
-  sec += ((signed)(timeA.hour - timeB.hour))*3600;
-  sec += ((signed)(timeA.minute - timeB.minute))*60;
-  sec += ((signed)(timeA.second - timeB.second));
-
-  return sec;
+  return (int32_t)(cmn_utility_datetime2epoch(timeA) - cmn_utility_datetime2epoch(timeB));
 }
 
 /**
@@ -631,13 +708,19 @@ int32_t cmn_utility_timediff( cmnDateTime_t timeA, cmnDateTime_t timeB){
  * @return Return weekday
  */
 cmnWeekday_t cmn_utility_get_weekday( cmnDateTime_t time){
-  int Y, C, M, N, D;
-  M = 1 + (9 + time.month) % 12;
-  Y = CMN_DATE_YEAR_OFFSET + time.year - (M > 10);
-  C = Y / 100;
-  D = Y % 100;
-  N = ((13 * M - 1) / 5 + D + D / 4 + 6 * C + time.day + 5) % 7;
-  return (cmnWeekday_t)((7 + N) % 7);
+  /**
+   * @note
+   *  Only the day count modulo 7 matters. A year of 365 days shifts the weekday by one, so the
+   *  year term reduces to the leap day count and the month term to a table of offsets from March.
+   */
+  static const uint8_t mp_offset[12] = {
+    /* Mar Apr May Jun Jul Aug Sep Oct Nov Dec Jan Feb */
+        0,  3,  5,  1,  3,  6,  2,  4,  0,  2,  5,  1
+  };
+  const uint32_t yoe = time.year + CMN_DATE_YEAR_OFFSET - 2000 - (time.month <= 2);
+  const uint32_t mp  = (time.month > 2) ? time.month-3 : time.month+9;
+  /* 2000/03/01 is a Wednesday */
+  return (cmnWeekday_t)((yoe + yoe/4 - yoe/100 + mp_offset[mp] + time.day - 1 + kWeekDay_Wednesday) % 7);
 }
 
 /**
@@ -0,0 +1,106 @@
+/**
+ ******************************************************************************
+ * @file    cmn_burst.h
+ * @author  RandleH
+ * @brief   Common Program - Interrupt Driven Burst Reads into a Double Buffer
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 RandleH.
+ * All rights reserved.
+ *
+ * This software component is licensed by RandleH under BSD 3-Clause license,
+ * the "License"; You may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at:
+ *                        opensource.org/licenses/BSD-3-Clause
+ *
+ ******************************************************************************
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include "cmn_type.h"
+
+
+#ifndef CMN_BURST_H
+#define CMN_BURST_H
+
+
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @brief Step of the register sequence run for every burst
+ * @note  `kCmnBurst_Write` writes `val` to `reg`, `kCmnBurst_Wait` waits for `cmn_burst_irq()` and
+ *        `kCmnBurst_Read` reads one half of the buffer from `reg`. `kCmnBurst_End` closes the list.
+ */
+enum{
+  kCmnBurst_End   = 0,
+  kCmnBurst_Write,
+  kCmnBurst_Wait,
+  kCmnBurst_Read
+};
+
+typedef struct stCmnBurstStep{
+  uint8_t op;
+  uint8_t reg;
+  uint8_t val;
+} tCmnBurstStep;
+
+/**
+ * @brief Start a transfer of `len` bytes and return at once
+ * @note  Called from the interrupts. The bus interrupt reports the end by `cmn_burst_done()`.
+ * @return `0` when the transfer started
+ */
+typedef int (*tCmnBurstBus)( void *param, uint8_t op, uint8_t reg, uint8_t *buf, size_t len);
+
+/**
+ * @brief Bursts read by a register sequence into two halves of a buffer, handed over to one consumer
+ * @note  `cmn_burst_trigger()` starts the sequence, e.g. from the watermark interrupt of a sensor.
+ *        The bus and the sensor interrupts walk it through `cmn_burst_done()` and `cmn_burst_irq()`.
+ *        The CPU only runs between the steps.
+ * @note  A half is published when its read completes. The consumer reads the oldest one in place
+ *        and releases it. Only the producer writes `head` and only the consumer writes `tail`.
+ * @note  A trigger is kept in `pending` while a burst runs or while both halves are taken, and
+ *        runs when the burst ends or a half is released. `stall` counts the triggers held because
+ *        the consumer was late, `error` the failed transfers.
+ * @note  A transfer that ends with an error aborts the burst. A transfer that fails to start has
+ *        no interrupt to come, so the burst stays busy with `retry` set until `cmn_burst_retry()`
+ *        starts the step again.
+ * @attention The producer calls MUST NOT preempt each other, nor `cmn_burst_pop()` and
+ *            `cmn_burst_retry()`.
+ */
+typedef struct stCmnBurst{
+  const tCmnBurstStep *step;
+  tCmnBurstBus         bus;
+  void                *param;
+  uint8_t             *buf;        /*!< Two halves of `size` bytes */
+  uint32_t             size;
+  uint32_t             pc;         /*!< Step running */
+  uint8_t              val;        /*!< Byte being written */
+  volatile uint32_t    busy;
+  volatile uint32_t    pending;
+  volatile uint32_t    retry;      /*!< The step at `pc` failed to start */
+  volatile uint32_t    head;       /*!< Halves filled by the producer */
+  volatile uint32_t    tail;       /*!< Halves released by the consumer */
+  volatile uint32_t    stall;
+  volatile uint32_t    error;
+} tCmnBurst;
+
+void           cmn_burst_init( tCmnBurst *burst, const tCmnBurstStep *step, tCmnBurstBus bus, void *param, uint8_t *buf, uint32_t size);
+void           cmn_burst_trigger( tCmnBurst *burst);
+void           cmn_burst_irq( tCmnBurst *burst);
+void           cmn_burst_done( tCmnBurst *burst, cmnBoolean_t ret);
+void           cmn_burst_retry( tCmnBurst *burst);
+const uint8_t *cmn_burst_front( tCmnBurst *burst);
+void           cmn_burst_pop( tCmnBurst *burst);
+uint32_t       cmn_burst_pending( const tCmnBurst *burst);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/* ********************************** EOF *********************************** */
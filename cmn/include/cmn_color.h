@@ -20,7 +20,11 @@
 /* ************************************************************************** */
 /*                             Interface Includes                             */
 /* ************************************************************************** */
+#include <stdint.h>
+#include "cmn_type.h"
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
 #include "lvgl.h"
+#endif
 
 
 #ifndef CMN_COLOR_H
@@ -44,6 +48,7 @@
 extern "C"{
 #endif
 
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
 typedef lv_color_t cmnColor_t;
 
 /* ************************************************************************** */
@@ -61,6 +66,7 @@ static inline cmnColor_t cmn_color_make(uint8_t r, uint8_t g, uint8_t b){
   };
   return rgb;
 }
+#endif
 
 #ifdef __cplusplus
 }
@@ -219,7 +225,15 @@ static inline cmnColor_t cmn_color_make(uint8_t r, uint8_t g, uint8_t b){
 extern "C"{
 #endif
 
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
 cmnColor_t cmn_color_gradient( cmnColor_t color_from, cmnColor_t color_to, uint8_t x);
+#endif
+
+void cmn_color_565_fill    ( uint16_t *dst, uint16_t color, uint32_t n);
+void cmn_color_565_fill_opa( uint16_t *dst, uint16_t color, uint32_t n, uint8_t opa, cmnBoolean_t swapped);
+void cmn_color_565_blend   ( uint16_t *dst, const uint16_t *src, uint32_t n, uint8_t opa, cmnBoolean_t swapped);
+void cmn_color_565_gradient( uint16_t *dst, uint16_t from, uint16_t to, uint32_t n, cmnBoolean_t swapped);
+void cmn_color_565_swap    ( uint16_t *dst, const uint16_t *src, uint32_t n);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,67 @@
+/**
+ ******************************************************************************
+ * @file    cmn_frame.h
+ * @author  RandleH
+ * @brief   Common Program - COBS Frame with CRC-16
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 RandleH.
+ * All rights reserved.
+ *
+ * This software component is licensed by RandleH under BSD 3-Clause license,
+ * the "License"; You may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at:
+ *                        opensource.org/licenses/BSD-3-Clause
+ *
+ ******************************************************************************
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include "cmn_type.h"
+
+
+#ifndef CMN_FRAME_H
+#define CMN_FRAME_H
+
+
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @brief Binary frames multiplexed with the text lines of the console
+ * @note  On the wire: `0x00 | COBS( type | payload | CRC-16 little endian ) | 0x00`
+ *        COBS removes every zero from the body, so `0x00` only ever delimits a frame, and text
+ *        never holds one. Every frame opens and closes with its own delimiter. See `cmn_line_feed()`.
+ * @note  CRC-16/CCITT-FALSE over the type and the payload. Polynomial 0x1021, initial value 0xFFFF.
+ *        Same as `crc16()` in `tool/uart.py`.
+ */
+#define CMN_FRAME_DELIMITER           (0x00)
+#define CMN_FRAME_CRC16_INIT          (0xFFFFU)
+
+/**
+ * @brief Bytes on the wire for a payload of `n` bytes, both delimiters included
+ */
+#define CMN_FRAME_WIRE_SIZE( n)       ((n) + 3U + ((n) + 3U)/254U + 1U + 2U)
+
+enum{
+  kCmnFrame_OK        =  0,
+  kCmnFrame_ErrCobs   = -1,         /*!< A zero or a block running past the end */
+  kCmnFrame_ErrShort  = -2,         /*!< Shorter than the type and the CRC */
+  kCmnFrame_ErrCrc    = -3
+};
+
+uint16_t cmn_frame_crc16( const uint8_t *buf, size_t len, uint16_t crc);
+size_t   cmn_frame_cobs_decode( const uint8_t *src, size_t len, uint8_t *dst);
+size_t   cmn_frame_encode( uint8_t type, const void *payload, size_t len, uint8_t *dst);
+int      cmn_frame_decode( uint8_t *buf, size_t len, uint8_t *type, const uint8_t **payload, size_t *payload_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/* ********************************** EOF *********************************** */
@@ -0,0 +1,86 @@
+/**
+ ******************************************************************************
+ * @file    cmn_line.h
+ * @author  RandleH
+ * @brief   Common Program - Receive Line Ring
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 RandleH.
+ * All rights reserved.
+ *
+ * This software component is licensed by RandleH under BSD 3-Clause license,
+ * the "License"; You may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at:
+ *                        opensource.org/licenses/BSD-3-Clause
+ *
+ ******************************************************************************
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include "cmn_type.h"
+
+
+#ifndef CMN_LINE_H
+#define CMN_LINE_H
+
+
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @brief Lines cut out of a circular receive buffer, handed over through a single-producer single-consumer ring
+ * @note  The producer is the receive interrupt. It tells where the DMA has written up to and
+ *        `cmn_line_feed()` splits the new bytes at `\r` or `\n`, straight into the next free slot.
+ *        Empty lines are skipped.
+ * @note  Every `0x00` ends the binary frame being cut, and an empty frame is a no-op. A `0x00` that
+ *        ends no frame opens one. `\r` and `\n` are data inside a frame.
+ *        The frame takes a slot like a line: a `0x00` marker, the COBS body and the terminator, so
+ *        `cmn_line_front()` sees an empty line. Read it with `cmn_line_frame()`. See `cmn_frame.h`.
+ * @note  A lost `0x00` does NOT shift the frames for good. Text ended by a `0x00` is taken as a frame
+ *        whose opening `0x00` was lost if it is a whole COBS body, i.e. its code bytes end exactly
+ *        there. So after a lost opening `0x00` the frame still goes through, and after a lost closing
+ *        one the next frame does, as long as its body holds no `\r` or `\n`.
+ * @note  The consumer is one task. It reads the oldest line in place and releases its slot.
+ *        Only the producer writes `head` and only the consumer writes `tail`. Nobody blocks.
+ * @note  A line is dropped as a whole and counted when:
+ *          - `overflow` It does NOT fit in a slot.
+ *          - `dropped`  Every slot is taken.
+ *          - `error`    The receiver reported an overrun, a framing or a noise error in the middle of it.
+ * @note  Counters are free running. `num` MUST be a power of 2.
+ */
+typedef struct stCmnLine{
+  const uint8_t     *rx_buf;     /*!< Circular receive buffer written by the DMA */
+  uint32_t           rx_size;
+  uint32_t           rx_pos;     /*!< Next byte of `rx_buf` to be read */
+  char              *slot;       /*!< `num` slots of `width` bytes. The terminator included. */
+  uint32_t           num;
+  uint32_t           width;
+  uint32_t           len;        /*!< Length of the line being cut */
+  uint32_t           skip;       /*!< The line being cut is dropped */
+  uint32_t           frame;      /*!< A binary frame is being cut */
+  uint32_t           cobs;       /*!< Next COBS code byte if the text being cut were a frame body */
+  volatile uint32_t  head;       /*!< Lines completed by the producer */
+  volatile uint32_t  tail;       /*!< Lines released by the consumer */
+  volatile uint32_t  overflow;
+  volatile uint32_t  dropped;
+  volatile uint32_t  error;
+} tCmnLine;
+
+void        cmn_line_init( tCmnLine *line, const uint8_t *rx_buf, uint32_t rx_size, char *slot, uint32_t num, uint32_t width);
+uint32_t    cmn_line_feed( tCmnLine *line, uint32_t rx_pos);
+void        cmn_line_error( tCmnLine *line);
+const char *cmn_line_front( tCmnLine *line);
+size_t      cmn_line_frame( tCmnLine *line, uint8_t **body);
+void        cmn_line_pop( tCmnLine *line);
+uint32_t    cmn_line_pending( const tCmnLine *line);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/* ********************************** EOF *********************************** */
@@ -19,6 +19,7 @@
 
 #include <stdint.h>
 #include "device.h"
+#include "cmn_type.h"
 
 
 #ifndef CMN_MATH_H
@@ -36,6 +37,17 @@ uint32_t cmn_math_largest_pow2(uint32_t x);
 uint32_t cmn_math_pow10(uint8_t x);
 uint32_t cmn_math_largest_pow10(uint32_t x);
 uint8_t cmn_math_count_dec_digits( uint32_t x);
+
+uint16_t  cmn_math_wrap3600( int32_t x);
+uint16_t  cmn_math_mod3600( uint32_t x);
+cmnBrad_t cmn_math_ddeg2brad( uint16_t x);
+uint16_t  cmn_math_brad2ddeg( cmnBrad_t x);
+cmnQ15_t  cmn_math_mul_q15( cmnQ15_t a, cmnQ15_t b);
+cmnQ15_t  cmn_math_sin_q15( cmnBrad_t x);
+cmnQ15_t  cmn_math_cos_q15( cmnBrad_t x);
+void      cmn_math_sincos_q15( cmnBrad_t x, cmnQ15_t *p_sin, cmnQ15_t *p_cos);
+cmnBrad_t cmn_math_atan2_brad( int32_t y, int32_t x);
+
 #ifdef __cplusplus
 }
 #endif
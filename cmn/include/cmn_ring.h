@@ -0,0 +1,67 @@
+/**
+ ******************************************************************************
+ * @file    cmn_ring.h
+ * @author  RandleH
+ * @brief   Common Program - Lock-free Byte Ring
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 RandleH.
+ * All rights reserved.
+ *
+ * This software component is licensed by RandleH under BSD 3-Clause license,
+ * the "License"; You may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at:
+ *                        opensource.org/licenses/BSD-3-Clause
+ *
+ ******************************************************************************
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include "cmn_type.h"
+
+
+#ifndef CMN_RING_H
+#define CMN_RING_H
+
+
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @brief Multi-producer single-consumer byte ring
+ * @note  Producers may be tasks or ISRs of any priority. Nobody blocks and no interrupt is masked:
+ *          - A producer reserves its bytes with a CAS on `head`, copies, then adds to `commit`.
+ *            A message is written as a whole or dropped and counted in `dropped`.
+ *          - The consumer only reads when `commit==head`, i.e. no producer is in the middle of a copy.
+ *            The last producer to commit kicks the consumer, so nothing is left behind.
+ *          - The consumer is owned by whoever wins the CAS on `busy`. A DMA transfer keeps it
+ *            until the transfer complete interrupt calls `cmn_ring_next()`.
+ * @note  Counters are free running. `size` MUST be a power of 2.
+ */
+typedef struct stCmnRing{
+  uint8_t           *buf;
+  uint32_t           size;
+  volatile uint32_t  head;       /*!< Reserved by producers */
+  volatile uint32_t  commit;     /*!< Bytes completely written by producers */
+  volatile uint32_t  tail;       /*!< Released by the consumer */
+  volatile uint32_t  busy;       /*!< The consumer is owned. eg: A DMA transfer is running */
+  volatile uint32_t  dropped;    /*!< Messages rejected because the ring was full */
+} tCmnRing;
+
+void     cmn_ring_init( tCmnRing *ring, uint8_t *buf, uint32_t size);
+size_t   cmn_ring_write( tCmnRing *ring, const void *data, size_t len);
+size_t   cmn_ring_claim( tCmnRing *ring, const uint8_t **ptr);
+size_t   cmn_ring_next( tCmnRing *ring, size_t done, const uint8_t **ptr);
+size_t   cmn_ring_pending( const tCmnRing *ring);
+uint32_t cmn_ring_dropped( const tCmnRing *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/* ********************************** EOF *********************************** */
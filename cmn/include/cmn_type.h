@@ -134,6 +134,20 @@ typedef union cmnDateTime_t{
   uint32_t word;
 }cmnDateTime_t;
 
+/**
+ * @brief Seconds escaped since 2022/01/01 00:00:00
+ * @note  Covers up to year 2158. `cmnDateTime_t` can ONLY hold up to year 2085.
+ */
+typedef uint32_t cmnEpoch_t;
+
+/**
+ * @brief Binary angle. One full turn is `65536` so it wraps around for free.
+ */
+typedef uint16_t cmnBrad_t;
+
+typedef int16_t  cmnQ15_t;   /*!< Fixed point [-1:1) with 15 fractional bits */
+typedef int32_t  cmnQ31_t;   /*!< Fixed point [-1:1) with 31 fractional bits */
+
 typedef enum cmnWeekday_t{
   kWeekDay_Monday    = 0,
   kWeekDay_Tuesday   = 1,
@@ -50,6 +50,7 @@ float cmn_utility_str2float(const char *str, cmnBoolean_t *isValid);
 uint8_t cmn_utility_uint2strdec_width( char *str, uint8_t maxlen, uint32_t value, uint8_t width);
 uint8_t cmn_utility_uint2strhex_width( char *str, uint8_t maxlen, uint32_t value, uint8_t width);
 uint8_t cmn_utility_int2strdec_width( char *str, uint8_t maxlen, int32_t value, uint8_t width);
+uint8_t cmn_utility_uint2strdec_2digits( char *str, uint32_t value);
 uint8_t cmn_utility_uint2strdec( char *str, uint8_t maxlen, uint32_t value);
 uint8_t cmn_utility_uint2strhex( char *str, uint8_t maxlen, uint32_t value);
 uint8_t cmn_utility_int2strdec( char *str, uint8_t maxlen, int32_t value);
@@ -80,6 +81,12 @@ void cmn_utility_angleset(                                \
                           const cmnDateTime_t *pTime      \
                           );
 
+uint32_t cmn_utility_days_from_civil( uint32_t year, uint32_t month, uint32_t day);
+void     cmn_utility_civil_from_days( uint32_t days, uint32_t *year, uint32_t *month, uint32_t *day);
+
+cmnEpoch_t    cmn_utility_datetime2epoch( cmnDateTime_t time);
+cmnDateTime_t cmn_utility_epoch2datetime( cmnEpoch_t epoch);
+
 int32_t cmn_utility_timediff( cmnDateTime_t timeA, cmnDateTime_t timeB);
 
 cmnWeekday_t cmn_utility_get_weekday( cmnDateTime_t time);
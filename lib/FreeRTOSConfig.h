@@ -34,6 +34,7 @@
 #if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
  #include <stdint.h>
  extern uint32_t SystemCoreClock;
+ extern uint32_t app_rtos_runtime_counter( void);
 #endif
 
 /*  CMSIS-RTOSv2 defines 56 levels of priorities. To be able to use them
@@ -92,7 +93,7 @@
 #endif
 #define configUSE_RECURSIVE_MUTEXES          1
 #define configUSE_MALLOC_FAILED_HOOK         1
-#define configUSE_APPLICATION_TASK_TAG       0
+#define configUSE_APPLICATION_TASK_TAG       1
 #define configUSE_COUNTING_SEMAPHORES        1
 #define configUSE_CO_ROUTINES                0
 #if defined (configUSE_CO_ROUTINES) && (configUSE_CO_ROUTINES==1)
@@ -153,17 +154,45 @@
 #ifdef DEBUG
   #define configRECORD_STACK_HIGH_ADDRESS         1
   #define configUSE_TRACE_FACILITY                1
-  #define configGENERATE_RUN_TIME_STATS           0
+  #define configGENERATE_RUN_TIME_STATS           1
   #define configUSE_PORT_OPTIMISED_TASK_SELECTION	0
   #define INCLUDE_pcGetTaskName                   1
   #define configCHECK_FOR_STACK_OVERFLOW          1
 #else
-  #define configGENERATE_RUN_TIME_STATS           0
+  #define configUSE_TRACE_FACILITY                1
+  #define configGENERATE_RUN_TIME_STATS           1
   #define configUSE_PORT_OPTIMISED_TASK_SELECTION	0
   #define INCLUDE_pcGetTaskName                   0
   #define configCHECK_FOR_STACK_OVERFLOW          1
 #endif
 
+/**
+ * @note Run-time statistics for the `TOP` command. The profiling tick is started by `profile_init()`.
+ */
+#if (configGENERATE_RUN_TIME_STATS==1)
+  #define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+  #define portGET_RUN_TIME_COUNTER_VALUE()        app_rtos_runtime_counter()
+#endif
+
+/**
+ * @note Task timeline. See `top/timeline.h`. The task number is unique per task with `configUSE_TRACE_FACILITY`.
+ *       Semaphores and mutexes are queues, so they are recorded by the queue macros.
+ */
+#if (defined TIMELINE) && (TIMELINE==1)
+  #include "timeline.h"
+  #define traceTASK_SWITCHED_IN()                         TIMELINE_RECORD( TASK_IN,     pxCurrentTCB->uxTCBNumber)
+  #define traceBLOCKING_ON_QUEUE_RECEIVE( pxQueue)        TIMELINE_RECORD( QUEUE_BLOCK, pxQueue)
+  #define traceBLOCKING_ON_QUEUE_SEND( pxQueue)           TIMELINE_RECORD( QUEUE_BLOCK, pxQueue)
+  #define traceQUEUE_RECEIVE( pxQueue)                    TIMELINE_RECORD( QUEUE_TAKE,  pxQueue)
+  #define traceQUEUE_RECEIVE_FROM_ISR( pxQueue)           TIMELINE_RECORD( QUEUE_TAKE,  pxQueue)
+  #define traceQUEUE_SEND( pxQueue)                       TIMELINE_RECORD( QUEUE_GIVE,  pxQueue)
+  #define traceQUEUE_SEND_FROM_ISR( pxQueue)              TIMELINE_RECORD( QUEUE_GIVE,  pxQueue)
+  #define traceEVENT_GROUP_WAIT_BITS_BLOCK( xEventGroup, uxBitsToWaitFor) \
+                                                          TIMELINE_RECORD( EVENT_WAIT,  uxBitsToWaitFor)
+  #define traceEVENT_GROUP_SET_BITS( xEventGroup, uxBitsToSet) \
+                                                          TIMELINE_RECORD( EVENT_SET,   uxBitsToSet)
+#endif
+
 #if (defined SYS_TARGET_STM32F411CEU6) || (defined EMULATOR_STM32F411CEU6)
   #define configCPU_CLOCK_HZ                (96000000U)
 #elif (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F405RGT6)
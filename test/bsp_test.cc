@@ -519,8 +519,6 @@ public:
 
     this->init_sensor();
 
-    // bsp_qmi8658_enable_fifo();
-    
     while(this->_cin >> s){
       if(s.length()==1){
         if(s[0]=='Q' || s[0]=='q'){
@@ -531,22 +529,32 @@ public:
           this->_err_msg<<"User objection."<<endl;
           break;
         }else if (s[0]=='T' || s[0]=='t'){
+          if(SUCCESS!=bsp_qmi8658_fifo_start()){
+            this->_cout << "FIFO not started" << endl;
+            continue;
+          }
           metope.bsp.status->A9[0] = 0;
           while(metope.bsp.status->A9[0]==0){
-            cmnBoolean_t ret = ERROR;
-
-            if(metope.bsp.status->i2c1[0]!=BUSY){
-              metope.bsp.status->i2c1[0] = BUSY;
-              ret = bsp_qmi8658_dma_update(&data);
-            }
-
-            if(ret==SUCCESS){
+            const tBspGyroFifoSample *burst = bsp_qmi8658_fifo_front(0);
+
+            if(burst!=NULL){
+              /* Watch the latest sample of the burst */
+              const tBspGyroFifoSample &last = burst[BSP_QMI8658_FIFO_WTM-1];
+              data.acc.x           = last.acc.x;
+              data.acc.y           = last.acc.y;
+              data.acc.z           = last.acc.z;
+              data.gyro.x          = last.gyro.x;
+              data.gyro.y          = last.gyro.y;
+              data.gyro.z          = last.gyro.z;
+              data.acc_sensitivity = ACC_SCALE_SENSITIVITY_2G;
+              data.deg_sensitivity = GYRO_SCALE_SENSITIVITY_2048DPS;
+              bsp_qmi8658_fifo_pop();
               live_watch(data);
             }else{
               this->_cout << "Not ready\r" << std::flush;
             }
             cmnBoolean_t async_mode = false;
-            cmn_tim2_sleep(100, async_mode);
+            cmn_tim2_sleep(20, async_mode);
           }
         }
       }else{
@@ -18,13 +18,43 @@
 */
 
 #include <bitset>
+#include <cmath>
+#include <random>
+#include <map>
+#include <set>
+#include <deque>
+#include <cstdio>
 #include "test.hh"
-#include "global.h"
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  #include "global.h"
+  #include "cmn_interrupt.h"
+#elif (defined SYS_TARGET_NATIVE)
+  #include <atomic>
+  #include <thread>
+  #include <chrono>
+  #include <fcntl.h>
+  #include <poll.h>
+  #include <termios.h>
+  #include <unistd.h>
+  extern LocalProjectTest tb_infra_local;
+#endif
 
 #include "cmn_test.hh"
 #include "cmn_type.h"
 #include "cmn_math.h"
-#include "cmn_interrupt.h"
+#include "cmn_color.h"
+#include "cmn_utility.h"
+#include "cmn_ring.h"
+#include "cmn_line.h"
+#include "cmn_frame.h"
+#include "cmn_burst.h"
+#include "trace.h"
+#include "trace.hh"
+#include "profile.h"
+#include "app_rtos_top.h"
+#include "timeline.h"
+#include "memory.h"
+#include "app_cmdbox.h"
 
 
 /* ************************************************************************** */
@@ -32,6 +62,7 @@
 /* ************************************************************************** */
 
 
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
 #ifdef __cplusplus
 extern "C"{
 #endif
@@ -107,6 +138,7 @@ public:
     return true;
   }
 };
+#endif
 
 
 class TestCmnDummy : public TestUnitWrapper<uint8_t,uint8_t>{
@@ -161,6 +193,7 @@ public:
 };
 
 
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
 #include "bsp_gyro.h"
 
 namespace paramsTestCmnStructAlignment{
@@ -189,92 +222,4277 @@ public:
     return result;
   }
 };
+#endif
 
-void add_cmn_test(void){
-  tb_infra_local
-    .insert( 
-      TestCmnDummy(), 
-      0, 
-      0
-    )
 
-    .insert(
-      TestCmnInterruptPushPopTopBasic(),
-      std::vector<tCmnInterruptUnit>{
-        {.operation=ENABLE,  .irqn=EXTI9_5_IRQn, .target_cnt=11256},
-        {.operation=ENABLE,  .irqn=USART1_IRQn,  .target_cnt=8837},
-        {.operation=DISABLE, .irqn=SPI3_IRQn,    .target_cnt=47},
-        {.operation=DISABLE, .irqn=EXTI0_IRQn,   .target_cnt=203984},
-        {.operation=ENABLE,  .irqn=EXTI1_IRQn,   .target_cnt=637}
-      },
-      std::vector<uint32_t>{47,637,8837,11256,203984}
-    )
+/* ************************************************************************** */
+/*                          Date & Time Calculation                           */
+/* ************************************************************************** */
+namespace paramsTestCmnUtilityEpoch{
 
-    .insert(
-      TestCmnInterruptPushPopTopCornerCase(),
-      (uint8_t)0,
-      (uint8_t)0
-    )
+/**
+ * @note: First and last year to be verified
+ */
+typedef std::array<uint32_t,2> Input;
 
-    .insert( 
-      TestCmnMathGcd(),
-      std::array<std::array<int32_t,2>,10>{{
-        {0,0},
-        {4,6},
-        {46,78},
-        {78,46},
-        {78,3},
-        {435,134},
-        {89327645,4845},
-        {139,84435},
-        {9834,672},
-        {128,1024}
-      }}, 
-      std::array<int32_t,10>{{
-        0,
-        2,
-        2,
-        2,
-        3,
-        1,
-        95,
-        1,
-        6,
-        128
-      }}
-    )
+/**
+ * @note: No output
+ */
+typedef uint8_t Output;
 
-    .insert(
-      TestCmnMathBit(),
-      std::array<uint32_t,10>{
-        {0x007B2A52}    /*!< Input: Counting Leading Zero */
-      },
-      std::array<uint32_t,10>{
-        {9}             /*!< Ref: Counting Leading Zero */
+static inline bool ref_is_leap_year(uint32_t y){
+  return (y%4==0 && y%100!=0) || (y%400==0);
+}
+
+static inline uint32_t ref_days_in_month(uint32_t y, uint32_t m){
+  const uint8_t DAYS[12] = {31,28,31,30,31,30,31,31,30,31,30,31};
+  return DAYS[m-1] + (m==2 && ref_is_leap_year(y));
+}
+
+} /* Namespace paramsTestCmnUtilityEpoch */
+
+/**
+ * @brief Exhaustive check of epoch conversion, time increment, time difference and weekday
+ * @note  Every single day within the given years is compared against a plain calendar walk.
+ *        Packed `cmnDateTime_t` is ONLY verified up to what the 6-bit year could hold.
+ */
+class TestCmnUtilityEpoch : public TestUnitWrapper<paramsTestCmnUtilityEpoch::Input,paramsTestCmnUtilityEpoch::Output>{
+public:
+  TestCmnUtilityEpoch():TestUnitWrapper("test_cmn_utility_epoch"){}
+
+  bool run( paramsTestCmnUtilityEpoch::Input& input, paramsTestCmnUtilityEpoch::Output& ref) override{
+    using namespace paramsTestCmnUtilityEpoch;
+    const uint32_t MAX_PACKED_YEAR = CMN_DATE_YEAR_OFFSET + 63;
+
+    uint32_t      days    = cmn_utility_days_from_civil( input[0], 1, 1);
+    uint32_t      weekday = (days + kWeekDay_Saturday) % 7;
+    cmnDateTime_t noon0   = {.word = 0};
+    cmnDateTime_t som     = {.word = 0};
+    cmnDateTime_t eod     = {.word = 0};
+    uint32_t      ms_rem  = 0;
+
+    for(uint32_t y=input[0]; y<=input[1]; ++y){
+      for(uint32_t m=1; m<=12; ++m){
+        for(uint32_t d=1; d<=ref_days_in_month(y,m); ++d, ++days, weekday=(weekday+1)%7){
+          uint32_t dut = cmn_utility_days_from_civil( y, m, d);
+          if( dut!=days ){
+            this->_err_msg<<"Mismatch in cmn_utility_days_from_civil(). Date="<<y<<'/'<<m<<'/'<<d<<" dut="<<dut<<" ref="<<days<<endl;
+            return false;
+          }
+
+          uint32_t dut_y, dut_m, dut_d;
+          cmn_utility_civil_from_days( days, &dut_y, &dut_m, &dut_d);
+          if( dut_y!=y || dut_m!=m || dut_d!=d ){
+            this->_err_msg<<"Mismatch in cmn_utility_civil_from_days(). Days="<<days<<" dut="<<dut_y<<'/'<<dut_m<<'/'<<dut_d<<" ref="<<y<<'/'<<m<<'/'<<d<<endl;
+            return false;
+          }
+
+          if( y>MAX_PACKED_YEAR ){
+            continue;
+          }
+
+          cmnDateTime_t time = {.word = 0};
+          time.year   = y - CMN_DATE_YEAR_OFFSET;
+          time.month  = m;
+          time.day    = d;
+          time.hour   = days % 24;
+          time.minute = (days*7) % 60;
+          time.second = (days*13) % 60;
+
+          cmnEpoch_t epoch = cmn_utility_datetime2epoch(time);
+          cmnEpoch_t epoch_ref = days*86400 + time.hour*3600 + time.minute*60 + time.second;
+          if( epoch!=epoch_ref ){
+            this->_err_msg<<"Mismatch in cmn_utility_datetime2epoch(). Date="<<y<<'/'<<m<<'/'<<d<<" dut="<<epoch<<" ref="<<epoch_ref<<endl;
+            return false;
+          }
+
+          if( cmn_utility_epoch2datetime(epoch).word!=time.word ){
+            this->_err_msg<<"Mismatch in cmn_utility_epoch2datetime(). Epoch="<<epoch<<endl;
+            return false;
+          }
+
+          if( (uint32_t)cmn_utility_get_weekday(time)!=weekday ){
+            this->_err_msg<<"Mismatch in cmn_utility_get_weekday(). Date="<<y<<'/'<<m<<'/'<<d<<" dut="<<cmn_utility_get_weekday(time)<<" ref="<<weekday<<endl;
+            return false;
+          }
+
+          /* Midnight rollover from the previous day */
+          if( eod.word!=0 ){
+            cmn_utility_timeinc( &ms_rem, &eod, 700);
+            if( ms_rem!=200 || eod.year!=time.year || eod.month!=m || eod.day!=d || eod.hour!=0 || eod.minute!=0 || eod.second!=0 ){
+              this->_err_msg<<"Mismatch in cmn_utility_timeinc(). Expected midnight of "<<y<<'/'<<m<<'/'<<d<<" ms_rem="<<ms_rem<<endl;
+              return false;
+            }
+          }
+          eod        = time;
+          eod.hour   = 23;
+          eod.minute = 59;
+          eod.second = 59;
+          ms_rem     = 500;
+
+          /* Difference within the month against the 1st */
+          if( d==1 ){
+            som = time;
+          }
+          if( cmn_utility_timediff(eod, som)!=(int32_t)(cmn_utility_datetime2epoch(eod) - cmn_utility_datetime2epoch(som)) ){
+            this->_err_msg<<"Mismatch in cmn_utility_timediff() within the month. Date="<<y<<'/'<<m<<'/'<<d<<" dut="<<cmn_utility_timediff(eod, som)<<endl;
+            return false;
+          }
+
+          /* Difference against the first noon */
+          time.hour = 12; time.minute = 0; time.second = 0;
+          if( noon0.word==0 ){
+            noon0 = time;
+          }
+          int32_t diff_ref = (int32_t)(cmn_utility_days_from_civil(y,m,d) - cmn_utility_days_from_civil(input[0],1,1)) * 86400;
+          if( cmn_utility_timediff(time, noon0)!=diff_ref || cmn_utility_timediff(noon0, time)!=-diff_ref ){
+            this->_err_msg<<"Mismatch in cmn_utility_timediff(). Date="<<y<<'/'<<m<<'/'<<d<<" dut="<<cmn_utility_timediff(time, noon0)<<" ref="<<diff_ref<<endl;
+            return false;
+          }
+        }
       }
-    )
-    .insert(
-      TestCmnStructAlignment(),
-      paramsTestCmnStructAlignment::Input{{
-        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->temperature.L),\
-        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->temperature.H),\
-        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->gyro.x),\
-        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->gyro.y),\
-        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->gyro.z),\
-        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->acc.x),\
-        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->acc.y),\
-        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->acc.z)
-      }},
-      paramsTestCmnStructAlignment::Output{{
-        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->raw[0]),\
-        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->raw[1]),\
-        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->fifo[0]),\
-        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->fifo[2]),\
-        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->fifo[4]),\
-        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->fifo[6]),\
-        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->fifo[8]),\
-        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->fifo[10])
-      }}
-    )
-  ;
+    }
+    return true;
+  }
+};
+
+
+/**
+ * @note
+ *  Previous implementation of the date calculation. Kept for benchmark ONLY.
+ *  NOT inlined so the call cost matches the library functions.
+ */
+namespace legacyCmnUtilityTime{
+
+__attribute__((noinline)) static void timeinc( uint32_t *ms_rem, cmnDateTime_t *pTime, uint32_t ms){
+  div_t tmp = div( *ms_rem + ms, 1000);
+  if(unlikely(pTime->second+tmp.quot >= 60)){
+    tmp = div(pTime->second+tmp.quot, 60);
+    pTime->second = tmp.rem;
+    if(unlikely(pTime->minute+tmp.quot >= 60)){
+      tmp = div(pTime->minute+tmp.quot, 60);
+      pTime->minute = tmp.rem;
+      if(unlikely(pTime->hour+tmp.quot >= 24)){
+        tmp = div(pTime->hour+tmp.quot, 24);
+        pTime->hour = tmp.rem;
+        uint8_t max_day_this_month = ((pTime->month <=7) ? (30 + (pTime->month&0x01)) : (31 - (pTime->month&0x01)));
+        if(unlikely(pTime->year%4==0 && pTime->month==2)){
+          max_day_this_month = 28;
+        }
+        if(unlikely(pTime->day+tmp.quot >= max_day_this_month)){
+          tmp = div(pTime->day+tmp.quot, max_day_this_month);
+          pTime->day = tmp.rem;
+          if(unlikely(pTime->month+tmp.quot>12)){
+            tmp = div(pTime->month+tmp.quot, 12);
+            pTime->month = tmp.rem;
+            pTime->year+=tmp.quot;
+          }else{
+            pTime->month += tmp.quot;
+          }
+        }else{
+          pTime->day += tmp.quot;
+        }
+      }else{
+        pTime->hour += tmp.quot;
+      }
+    }else{
+      pTime->minute += tmp.quot;
+    }
+  }else{
+    pTime->second += tmp.quot;
+  }
+  *ms_rem = tmp.rem;
+}
+
+__attribute__((noinline)) static int32_t timediff( cmnDateTime_t timeA, cmnDateTime_t timeB){
+  int32_t sec = 0;
+  if(timeA.year != timeB.year || timeA.month != timeB.month){
+    return INT32_MAX;
+  }
+  sec += ((signed)(timeA.day - timeB.day))*3600*12;
+  sec += ((signed)(timeA.hour - timeB.hour))*3600;
+  sec += ((signed)(timeA.minute - timeB.minute))*60;
+  sec += ((signed)(timeA.second - timeB.second));
+  return sec;
+}
+
+__attribute__((noinline)) static cmnWeekday_t get_weekday( cmnDateTime_t time){
+  int Y, C, M, N, D;
+  M = 1 + (9 + time.month) % 12;
+  Y = CMN_DATE_YEAR_OFFSET + time.year - (M > 10);
+  C = Y / 100;
+  D = Y % 100;
+  N = ((13 * M - 1) / 5 + D + D / 4 + 6 * C + time.day + 5) % 7;
+  return (cmnWeekday_t)((7 + N) % 7);
+}
+
+} /* Namespace legacyCmnUtilityTime */
+
+
+/**
+ * @brief Time cost per operation. Current date calculation vs. the legacy one.
+ * @note  Report only. Per-op cost is printed as a `perf` line by `TestBench::report()`.
+ */
+class TestCmnUtilityTimeBench : public TestUnitWrapper<uint32_t,uint8_t>{
+public:
+  TestCmnUtilityTimeBench():TestUnitWrapper("test_cmn_utility_time_bench"){}
+
+  bool run( uint32_t& ops, uint8_t& ref) override{
+    volatile uint32_t sink = 0;
+    cmnDateTime_t     base = {.word = 0};
+    base.year  = 3;
+    base.month = 2;
+    base.day   = 28;
+    base.hour  = 23;
+
+    TestClock::init();
+
+    cmnDateTime_t time   = base;
+    uint32_t      ms_rem = 0;
+    TestBench::report("timeinc_legacy", ops, [&](uint32_t i){ legacyCmnUtilityTime::timeinc(&ms_rem, &time, 1000); sink += time.word; });
+    time = base; ms_rem = 0;
+    TestBench::report("timeinc",        ops, [&](uint32_t i){ cmn_utility_timeinc(&ms_rem, &time, 1000);           sink += time.word; });
+
+    time = base; ms_rem = 0;
+    TestBench::report("timeinc_rollover_legacy", ops, [&](uint32_t i){ cmnDateTime_t t = base; t.minute = 59; t.second = 59; legacyCmnUtilityTime::timeinc(&ms_rem, &t, 1000); sink += t.word; });
+    TestBench::report("timeinc_rollover",        ops, [&](uint32_t i){ cmnDateTime_t t = base; t.minute = 59; t.second = 59; cmn_utility_timeinc(&ms_rem, &t, 1000);           sink += t.word; });
+
+    cmnDateTime_t other = base;
+    other.day = 1;
+    TestBench::report("timediff_legacy", ops, [&](uint32_t i){ other.second = i%60; sink += legacyCmnUtilityTime::timediff(base, other); });
+    TestBench::report("timediff",        ops, [&](uint32_t i){ other.second = i%60; sink += cmn_utility_timediff(base, other); });
+
+    TestBench::report("weekday_legacy", ops, [&](uint32_t i){ time.day = 1 + i%28; sink += legacyCmnUtilityTime::get_weekday(time); });
+    TestBench::report("weekday",        ops, [&](uint32_t i){ time.day = 1 + i%28; sink += cmn_utility_get_weekday(time); });
+
+    cout<<endl;
+    UNUSED(sink);
+    return true;
+  }
+};
+
+
+/* ************************************************************************** */
+/*                         Integer to Decimal String                          */
+/* ************************************************************************** */
+/**
+ * @note
+ *  Previous implementation of the decimal conversion, one `div()` per digit.
+ *  Reference for the equivalence test and the benchmark. NOT inlined.
+ */
+namespace legacyCmnUtilityFormat{
+
+static uint8_t invalidify_str( char *str, uint8_t maxlen, uint8_t wordlen){
+  uint8_t idx = CMN_MIN( maxlen-1, wordlen);
+  memset( str, '#', idx);
+  str[idx] = '\0';
+  return idx;
+}
+
+__attribute__((noinline)) static uint8_t uint2strdec_width( char *str, uint8_t maxlen, uint32_t value, uint8_t width){
+  if(maxlen==0 || !str) return 0;
+  uint8_t wordlen = cmn_math_count_dec_digits(value);
+  if( width==0xFF ){
+    width = wordlen;
+  }
+  if(likely( wordlen <= width && width <= maxlen-1 )){
+    uint8_t idx = width;
+    div_t   tmp = {.quot = (int)value};
+    str[idx] = '\0';
+    do{
+      /* Unsigned step. `div()` on an `int` is ONLY valid below 2^31 */
+      uint32_t quot = (uint32_t)tmp.quot/10;
+      tmp.rem  = (uint32_t)tmp.quot - quot*10;
+      tmp.quot = quot;
+      str[--idx] = '0'+tmp.rem;
+    }while(idx > 0);
+    return width;
+  }else{
+    return invalidify_str( str, maxlen, wordlen);
+  }
+}
+
+__attribute__((noinline)) static uint8_t int2strdec_width( char *str, uint8_t maxlen, int32_t value, uint8_t width){
+  if(value<0 && maxlen!=0){
+    str[0] = '-';
+    return 1 + uint2strdec_width( ++str, maxlen-1, 0U-(uint32_t)value, width);
+  }else{
+    return uint2strdec_width( str, maxlen, value, width);
+  }
+}
+
+__attribute__((noinline)) static int vsnprintf(char *buf, size_t size, const char *format, va_list va){
+  uint8_t idx = 0;
+  while(*format && idx<size) {
+    if(*format != '%') {
+      buf[idx++] = *format++;
+      continue;
+    }else{
+      ++format;
+    }
+    char    c     = *format++;
+    bool    done  = false;
+    uint8_t width = 0xFF;
+    while(!done){
+      done = true;
+      switch(c) {
+        case 'u': case 'U': idx += uint2strdec_width( &buf[idx], size-idx, va_arg(va, uint32_t), width); break;
+        case 'd': case 'D': idx += int2strdec_width ( &buf[idx], size-idx, va_arg(va, int32_t),  width); break;
+        case 'c': case 'C': buf[idx++] = (char)va_arg(va, int); break;
+        case 'x': case 'X':{
+          if(width==0xFF){
+            idx += cmn_utility_uint2strhex( &buf[idx], size-idx, va_arg(va, uint32_t));
+          }else{
+            idx += cmn_utility_uint2strhex_width( &buf[idx], size-idx, va_arg(va, uint32_t), width);
+          }
+          break;
+        }
+        case 's': case 'S':{
+          const char *str = va_arg(va, char*);
+          size_t      len = strlen(str);
+          if( len > size-idx -1 ){
+            memset(&buf[idx], '#', size-idx-1);
+            idx = size-1;
+          }else{
+            strncpy(&buf[idx], str, size-idx);
+            idx += len;
+          }
+          break;
+        }
+        case '0':       c = *format++; done = false; break;
+        case '1'...'9': width = c - '0'; c = *format++; done = false; break;
+        default:        return 0;
+      }
+    }
+  }
+  idx = CMN_MIN( idx, size-1);
+  buf[idx++] = '\0';
+  return idx;
+}
+
+static int snprintf(char *buf, size_t size, const char *format, ...){
+  va_list va;
+  va_start(va, format);
+  int ret = vsnprintf(buf, size, format, va);
+  va_end(va);
+  return ret;
+}
+
+} /* Namespace legacyCmnUtilityFormat */
+
+namespace paramsTestCmnUtilityDecEquivalence{
+
+/**
+ * @note: [0] Every value below this one is verified with all widths
+ *        [1] Stride of the sweep over the full 32-bit range. `1` means a complete sweep.
+ */
+typedef std::array<uint32_t,2> Input;
+
+/**
+ * @note: No output
+ */
+typedef uint8_t Output;
+
+} /* Namespace paramsTestCmnUtilityDecEquivalence */
+
+/**
+ * @brief Table driven decimal conversion MUST produce byte identical output as the legacy one
+ * @note  Return value, characters, terminator and untouched bytes after it are all compared.
+ */
+class TestCmnUtilityDecEquivalence : public TestUnitWrapper<paramsTestCmnUtilityDecEquivalence::Input,paramsTestCmnUtilityDecEquivalence::Output>{
+private:
+  static constexpr size_t  BUF_LEN   = 16;
+  static constexpr uint8_t WIDTHS[]  = {0xFF,0,1,2,3,4,5,6,7,8,9,10,11};
+
+  template<class F, class G>
+  bool compare(const char *name, uint32_t value, uint8_t width, F &&ref, G &&dut){
+    char buf_ref[BUF_LEN], buf_dut[BUF_LEN];
+    memset( buf_ref, 0x55, BUF_LEN);
+    memset( buf_dut, 0x55, BUF_LEN);
+    int ret_ref = ref(buf_ref);
+    int ret_dut = dut(buf_dut);
+    if( ret_ref!=ret_dut || memcmp(buf_ref, buf_dut, BUF_LEN)!=0 ){
+      this->_err_msg<<name<<": value="<<value<<" width="<<(uint32_t)width<<" ref=\""<<std::string(buf_ref, strnlen(buf_ref,BUF_LEN))<<"\"("<<ret_ref<<")"<<" dut=\""<<std::string(buf_dut, strnlen(buf_dut,BUF_LEN))<<"\"("<<ret_dut<<")"<<endl;
+      return false;
+    }
+    return true;
+  }
+
+  bool verify_all_widths(uint32_t value){
+    for(uint8_t width : WIDTHS){
+      if(!compare("uint2strdec_width", value, width,
+        [&](char *buf){ return legacyCmnUtilityFormat::uint2strdec_width( buf, 12, value, width); },
+        [&](char *buf){ return cmn_utility_uint2strdec_width           ( buf, 12, value, width); })) return false;
+    }
+    return true;
+  }
+
+  bool verify_corner(uint32_t value){
+    for(uint8_t maxlen=0; maxlen<=BUF_LEN; ++maxlen){
+      for(uint8_t width : WIDTHS){
+        if(!compare("uint2strdec_width(maxlen)", value, width,
+          [&](char *buf){ return legacyCmnUtilityFormat::uint2strdec_width( buf, maxlen, value, width); },
+          [&](char *buf){ return cmn_utility_uint2strdec_width           ( buf, maxlen, value, width); })) return false;
+        if(!compare("int2strdec_width(maxlen)", value, width,
+          [&](char *buf){ return legacyCmnUtilityFormat::int2strdec_width( buf, maxlen, (int32_t)value, width); },
+          [&](char *buf){ return cmn_utility_int2strdec_width           ( buf, maxlen, (int32_t)value, width); })) return false;
+      }
+      if(maxlen==0) continue;
+      if(!compare("snprintf(%02d)", value, 2,
+        [&](char *buf){ return legacyCmnUtilityFormat::snprintf( buf, maxlen, "%02d:%02u", (int32_t)value, value); },
+        [&](char *buf){ return cmn_utility_snprintf           ( buf, maxlen, "%02d:%02u", (int32_t)value, value); })) return false;
+      if(!compare("snprintf(%d)", value, 0xFF,
+        [&](char *buf){ return legacyCmnUtilityFormat::snprintf( buf, maxlen, "%d|%u|%5u", (int32_t)value, value, value); },
+        [&](char *buf){ return cmn_utility_snprintf           ( buf, maxlen, "%d|%u|%5u", (int32_t)value, value, value); })) return false;
+    }
+    return true;
+  }
+
+public:
+  TestCmnUtilityDecEquivalence():TestUnitWrapper("test_cmn_utility_dec_equivalence"){}
+
+  bool run( paramsTestCmnUtilityDecEquivalence::Input& input, paramsTestCmnUtilityDecEquivalence::Output& ref) override{
+    /* Dense range. Every digit pair at every position up to the given limit */
+    for(uint32_t value=0; value<input[0]; ++value){
+      if(!verify_all_widths(value)) return false;
+    }
+
+    /* Sparse sweep over the full range */
+    for(uint64_t value=0; value<=UINT32_MAX; value+=input[1]){
+      if(!verify_all_widths((uint32_t)value)) return false;
+    }
+
+    /* Buffer length, sign and digit count boundaries */
+    std::vector<uint32_t> corners = {0, 1, 99, 100, UINT32_MAX, INT32_MAX, (uint32_t)INT32_MIN};
+    for(uint32_t pow10=10; pow10<1000000000U; pow10*=10){
+      corners.insert( corners.end(), {pow10-1, pow10, pow10+1, 0U-pow10, 0U-pow10+1});
+    }
+    for(uint32_t value : corners){
+      if(!verify_all_widths(value) || !verify_corner(value)) return false;
+    }
+
+    /* Two digits fast path */
+    for(uint32_t value=0; value<100; ++value){
+      if(!verify_corner(value)) return false;
+      if(!compare("uint2strdec_2digits", value, 2,
+        [&](char *buf){ return legacyCmnUtilityFormat::uint2strdec_width( buf, 3, value, 2); },
+        [&](char *buf){ return cmn_utility_uint2strdec_2digits         ( buf, value); })) return false;
+    }
+    return true;
+  }
+};
+
+/**
+ * @brief Time cost per conversion. Table driven decimal conversion vs. the legacy one.
+ * @note  Report only. Per-op cost is printed as a `perf` line by `TestBench::report()`.
+ */
+class TestCmnUtilityDecBench : public TestUnitWrapper<uint32_t,uint8_t>{
+public:
+  TestCmnUtilityDecBench():TestUnitWrapper("test_cmn_utility_dec_bench"){}
+
+  bool run( uint32_t& ops, uint8_t& ref) override{
+    volatile uint32_t sink = 0;
+    char              buf[32];
+
+    /* Values with a uniformly distributed digit count */
+    std::vector<uint32_t> values(1024);
+    uint32_t seed = 0x1234567U;
+    for(size_t i=0; i<values.size(); ++i){
+      seed = seed*1664525U + 1013904223U;
+      values[i] = seed >> (seed%32);
+    }
+
+    TestClock::init();
+
+    TestBench::report("uint2strdec_legacy", ops, [&](uint32_t i){ sink += legacyCmnUtilityFormat::uint2strdec_width( buf, sizeof(buf), values[i&1023], 0xFF); });
+    TestBench::report("uint2strdec",        ops, [&](uint32_t i){ sink += cmn_utility_uint2strdec_width           ( buf, sizeof(buf), values[i&1023], 0xFF); });
+
+    TestBench::report("uint2strdec_max_legacy", ops, [&](uint32_t i){ sink += legacyCmnUtilityFormat::uint2strdec_width( buf, sizeof(buf), UINT32_MAX-i, 0xFF); });
+    TestBench::report("uint2strdec_max",        ops, [&](uint32_t i){ sink += cmn_utility_uint2strdec_width           ( buf, sizeof(buf), UINT32_MAX-i, 0xFF); });
+
+    TestBench::report("dec_02_legacy", ops, [&](uint32_t i){ sink += legacyCmnUtilityFormat::uint2strdec_width( buf, sizeof(buf), i%60, 2); });
+    TestBench::report("dec_02",        ops, [&](uint32_t i){ sink += cmn_utility_uint2strdec_2digits          ( buf, i%60); });
+
+    TestBench::report("snprintf_hhmmss_legacy", ops, [&](uint32_t i){ sink += legacyCmnUtilityFormat::snprintf( buf, sizeof(buf), "%02d:%02d:%02d", i%24, i%60, (i>>1)%60); });
+    TestBench::report("snprintf_hhmmss",        ops, [&](uint32_t i){ sink += cmn_utility_snprintf           ( buf, sizeof(buf), "%02d:%02d:%02d", i%24, i%60, (i>>1)%60); });
+
+    TestBench::report("snprintf_trace_legacy", ops, [&](uint32_t i){ sink += legacyCmnUtilityFormat::snprintf( buf, sizeof(buf), "tick=%u err=%d", values[i&1023], -(int32_t)(i&0xFFF)); });
+    TestBench::report("snprintf_trace",        ops, [&](uint32_t i){ sink += cmn_utility_snprintf           ( buf, sizeof(buf), "tick=%u err=%d", values[i&1023], -(int32_t)(i&0xFFF)); });
+
+    cout<<endl;
+    UNUSED(sink);
+    return true;
+  }
+};
+
+
+/* ************************************************************************** */
+/*                           Compiled Trace Format                            */
+/* ************************************************************************** */
+namespace paramsTestTraceFmt{
+
+/**
+ * @note: Number of random argument sets per format string
+ */
+typedef uint32_t Input;
+
+/**
+ * @note: No output
+ */
+typedef uint8_t Output;
+
+#define TB_TRACE_FMT_LINE   "%s" "ms=%u H_rem=%u M_rem=%d deg=%03u"
+#define TB_TRACE_FMT_CLOCK  "%02d:%02d:%02d"
+#define TB_TRACE_FMT_MIXED  "0x%08X|%x|%c|%5u|%3d|%0d|[%s]"
+#define TB_TRACE_FMT_PLAIN  "System boot completed."
+
+} /* Namespace paramsTestTraceFmt */
+
+/**
+ * @brief Compiled trace format MUST produce byte identical output as `cmn_utility_snprintf()`
+ * @note  Every buffer size from 1 to beyond the full message is verified.
+ */
+class TestTraceFmtEquivalence : public TestUnitWrapper<paramsTestTraceFmt::Input,paramsTestTraceFmt::Output>{
+private:
+  static constexpr size_t BUF_LEN = 96;
+
+  template<class F, class G>
+  bool compare(const char *fmt, size_t size, F &&ref, G &&dut){
+    char buf_ref[BUF_LEN], buf_dut[BUF_LEN];
+    memset( buf_ref, 0x55, BUF_LEN);
+    memset( buf_dut, 0x55, BUF_LEN);
+    int ret_ref = ref(buf_ref);
+    int ret_dut = dut(buf_dut);
+    if( ret_ref!=ret_dut || memcmp(buf_ref, buf_dut, BUF_LEN)!=0 ){
+      this->_err_msg<<"format=\""<<fmt<<"\" size="<<size<<" ref=\""<<std::string(buf_ref, strnlen(buf_ref,BUF_LEN))<<"\"("<<ret_ref<<")"<<" dut=\""<<std::string(buf_dut, strnlen(buf_dut,BUF_LEN))<<"\"("<<ret_dut<<")"<<endl;
+      return false;
+    }
+    return true;
+  }
+
+public:
+  TestTraceFmtEquivalence():TestUnitWrapper("test_trace_fmt_equivalence"){}
+
+  bool run( paramsTestTraceFmt::Input& input, paramsTestTraceFmt::Output& ref) override{
+#define TB_TRACE_FMT_COMPARE( fmt, ...) \
+    compare( fmt, size, [&](char *buf){ return cmn_utility_snprintf( buf, size, fmt, ##__VA_ARGS__); },\
+                        [&](char *buf){ return TRACE_FMT_SNPRINTF  ( buf, size, fmt, ##__VA_ARGS__); })
+
+    const char *names[] = { "", "A", "metope", "a string longer than most of the buffers under test......"};
+    uint32_t    seed    = 0x2468ACEU;
+
+    for(uint32_t n=0; n<input; ++n){
+      seed = seed*1664525U + 1013904223U;
+      uint32_t    u    = seed >> (seed%32);
+      int32_t     d    = (seed&1) ? -(int32_t)(u>>1) : (int32_t)(u>>1);
+      const char *name = names[n%4];
+
+      for(size_t size=1; size<BUF_LEN; ++size){
+        bool ok = true;
+        ok &= TB_TRACE_FMT_COMPARE( TB_TRACE_FMT_LINE,  FMT_DEBUG_STR, u, u%60, d, u%360);
+        ok &= TB_TRACE_FMT_COMPARE( TB_TRACE_FMT_CLOCK, n%24, u%60, d%100);
+        ok &= TB_TRACE_FMT_COMPARE( TB_TRACE_FMT_MIXED, u, u, (char)('A'+n%26), u%100000, d%1000, d, name);
+        ok &= TB_TRACE_FMT_COMPARE( TB_TRACE_FMT_PLAIN);
+        if(!ok){
+          return false;
+        }
+      }
+    }
+#undef TB_TRACE_FMT_COMPARE
+    return true;
+  }
+};
+
+/**
+ * @brief Time cost per formatted message. Compiled trace format vs. runtime parsing.
+ * @note  Report only. Per-op cost is printed as a `perf` line by `TestBench::report()`.
+ */
+class TestTraceFmtBench : public TestUnitWrapper<uint32_t,uint8_t>{
+public:
+  TestTraceFmtBench():TestUnitWrapper("test_trace_fmt_bench"){}
+
+  bool run( uint32_t& ops, uint8_t& ref) override{
+    volatile uint32_t sink = 0;
+    char              buf[128];
+
+    TestClock::init();
+
+    TestBench::report("trace_line_runtime",  ops, [&](uint32_t i){ sink += cmn_utility_snprintf( buf, sizeof(buf), TB_TRACE_FMT_LINE, FMT_DEBUG_STR, i, i%60, -(int32_t)i, i%360); });
+    TestBench::report("trace_line_compiled", ops, [&](uint32_t i){ sink += TRACE_FMT_SNPRINTF  ( buf, sizeof(buf), TB_TRACE_FMT_LINE, FMT_DEBUG_STR, i, i%60, -(int32_t)i, i%360); });
+
+    TestBench::report("trace_clock_runtime",  ops, [&](uint32_t i){ sink += cmn_utility_snprintf( buf, sizeof(buf), TB_TRACE_FMT_CLOCK, i%24, i%60, (i>>1)%60); });
+    TestBench::report("trace_clock_compiled", ops, [&](uint32_t i){ sink += TRACE_FMT_SNPRINTF  ( buf, sizeof(buf), TB_TRACE_FMT_CLOCK, i%24, i%60, (i>>1)%60); });
+
+    TestBench::report("trace_plain_runtime",  ops, [&](uint32_t i){ sink += cmn_utility_snprintf( buf, sizeof(buf), TB_TRACE_FMT_PLAIN); });
+    TestBench::report("trace_plain_compiled", ops, [&](uint32_t i){ sink += TRACE_FMT_SNPRINTF  ( buf, sizeof(buf), TB_TRACE_FMT_PLAIN); });
+
+    cout<<endl;
+    UNUSED(sink);
+    return true;
+  }
+};
+
+
+/* ************************************************************************** */
+/*                             Deferred Binary Log                            */
+/* ************************************************************************** */
+namespace paramsTestTraceDefer{
+
+/**
+ * @note: Number of random messages
+ */
+typedef uint32_t Input;
+
+/**
+ * @note: No output
+ */
+typedef uint8_t Output;
+
+/**
+ * @brief Host decoder in C++. Same as `tool/uart.py`.
+ * @param [in]  rec  - One record starting from the sync byte
+ * @param [out] text - Decoded message
+ * @return Record length. 0 if the record is broken.
+ */
+static inline size_t decode( const uint8_t *rec, size_t size, std::string &text){
+  if( size < TRACE_DEFER_HEADER_LEN || rec[0]!=TRACE_DEFER_SYNC || size < (size_t)TRACE_DEFER_HEADER_LEN+rec[1] ){
+    return 0;
+  }
+  const size_t    len = TRACE_DEFER_HEADER_LEN + rec[1];
+  const uint32_t  id  = rec[2] | (rec[3]<<8) | (rec[4]<<16);
+  const char     *fmt = trace_defer_fmt(id);
+
+  std::vector<trace::Op>   ops;
+  std::vector<trace::Arg>  argv;
+  std::vector<std::string> strs(TRACE_DEFER_ARG_MAX);
+  size_t                   idx = TRACE_DEFER_HEADER_LEN;
+
+  trace::walk( fmt, [&](const trace::Op &op){ ops.push_back(op); });
+  for(const auto &op : ops){
+    trace::Arg arg{};
+    if( op.code==trace::OpCode::kLiteral ){
+      continue;
+    }else if( op.code==trace::OpCode::kString ){
+      std::string &str = strs[argv.size()];
+      str.assign( (const char *)&rec[idx+1], rec[idx]);
+      idx  += 1 + rec[idx];
+      arg.s = str.c_str();
+    }else{
+      memcpy( &arg.u, &rec[idx], 4);
+      idx += 4;
+    }
+    argv.push_back(arg);
+  }
+  if( idx!=len ){
+    return 0;
+  }
+
+  char buf[128];
+  trace::run( trace::Call{ ops.data(), ops.size(), fmt, argv.data()}, buf, sizeof(buf));
+  text = buf;
+  return len;
+}
+
+/**
+ * @brief Empty the ring
+ */
+static inline void flush(void){
+  uint8_t buf[TRACE_DEFER_RECORD_MAX];
+  while( trace_defer_drain( buf, sizeof(buf)) );
+}
+
+} /* Namespace paramsTestTraceDefer */
+
+/**
+ * @brief Deferred records MUST decode into the same text as the compiled trace format
+ * @note  The ring is drained in small chunks, then overflowed on purpose.
+ */
+class TestTraceDefer : public TestUnitWrapper<paramsTestTraceDefer::Input,paramsTestTraceDefer::Output>{
+public:
+  TestTraceDefer():TestUnitWrapper("test_trace_defer"){}
+
+  bool run( paramsTestTraceDefer::Input& input, paramsTestTraceDefer::Output& ref) override{
+    using namespace paramsTestTraceDefer;
+
+    const char *names[] = { "", "A", "metope", "a string longer than the deferred log keeps in one record......"};
+    uint32_t    seed    = 0x13579BDU;
+    uint8_t     chunk[TRACE_DEFER_RECORD_MAX+7];
+
+    flush();
+
+    for(uint32_t n=0; n<input; ++n){
+      seed = seed*1664525U + 1013904223U;
+      uint32_t    u    = seed >> (seed%32);
+      int32_t     d    = (seed&1) ? -(int32_t)(u>>1) : (int32_t)(u>>1);
+      std::string name = names[n%4];
+
+      std::vector<std::string> expect(4);
+      char buf[128];
+      TRACE_FMT_SNPRINTF( buf, sizeof(buf), TB_TRACE_FMT_LINE,  FMT_DEBUG_STR, u, u%60, d, u%360);           expect[0] = buf;
+      TRACE_FMT_SNPRINTF( buf, sizeof(buf), TB_TRACE_FMT_CLOCK, n%24, u%60, d%100);                          expect[1] = buf;
+      TRACE_FMT_SNPRINTF( buf, sizeof(buf), TB_TRACE_FMT_MIXED, u, u, (char)('A'+n%26), u%100000, d%1000, d,
+                          name.substr(0, TRACE_DEFER_STR_MAX).c_str());                                       expect[2] = buf;
+      TRACE_FMT_SNPRINTF( buf, sizeof(buf), TB_TRACE_FMT_PLAIN);                                             expect[3] = buf;
+
+      TRACE_DEFER_PRINTF( TB_TRACE_FMT_LINE,  FMT_DEBUG_STR, u, u%60, d, u%360);
+      TRACE_DEFER_PRINTF( TB_TRACE_FMT_CLOCK, n%24, u%60, d%100);
+      TRACE_DEFER_PRINTF( TB_TRACE_FMT_MIXED, u, u, (char)('A'+n%26), u%100000, d%1000, d, name.c_str());
+      TRACE_DEFER_PRINTF( TB_TRACE_FMT_PLAIN);
+
+      /* Drain with an odd chunk size. Records MUST never be split. */
+      std::vector<uint8_t> stream;
+      size_t len;
+      while( 0!=(len = trace_defer_drain( chunk, TRACE_DEFER_RECORD_MAX+1+n%7)) ){
+        size_t idx = 0;
+        while( idx<len ){
+          std::string text;
+          size_t      rec = decode( &chunk[idx], len-idx, text);
+          if( rec==0 ){
+            this->_err_msg<<"Broken record at byte "<<idx<<" of a chunk"<<endl;
+            return false;
+          }
+          if( stream.size()>=expect.size() || text!=expect[stream.size()] ){
+            this->_err_msg<<"dut=\""<<text<<"\" ref=\""<<(stream.size()<expect.size() ? expect[stream.size()] : "")<<"\""<<endl;
+            return false;
+          }
+          stream.push_back(0);
+          idx += rec;
+        }
+      }
+      if( stream.size()!=expect.size() ){
+        this->_err_msg<<"Expect "<<expect.size()<<" records but got "<<stream.size()<<endl;
+        return false;
+      }
+    }
+
+    /* Overflow */
+    uint32_t accepted = 0;
+    while( 0!=TRACE_DEFER_PRINTF( TB_TRACE_FMT_CLOCK, accepted%24, accepted%60, accepted%100) ){
+      ++accepted;
+    }
+    for(uint32_t i=0; i<4; ++i){
+      TRACE_DEFER_PRINTF( TB_TRACE_FMT_CLOCK, 0, 0, 0);
+    }
+    if( trace_defer_dropped()!=5 ){
+      this->_err_msg<<"Expect 5 records dropped but got "<<trace_defer_dropped()<<endl;
+      return false;
+    }
+
+    uint32_t received = 0;
+    uint32_t dropped  = 0;
+    size_t   len;
+    while( 0!=(len = trace_defer_drain( chunk, sizeof(chunk))) ){
+      for(size_t idx=0; idx<len; idx+=TRACE_DEFER_HEADER_LEN+chunk[idx+1]){
+        if( (chunk[idx+2] | (chunk[idx+3]<<8) | (chunk[idx+4]<<16))==TRACE_DEFER_ID_DROPPED ){
+          memcpy( &dropped, &chunk[idx+TRACE_DEFER_HEADER_LEN], 4);
+        }else{
+          ++received;
+        }
+      }
+    }
+    if( received!=accepted || dropped!=5 ){
+      this->_err_msg<<"accepted="<<accepted<<" received="<<received<<" dropped="<<dropped<<endl;
+      return false;
+    }
+    return true;
+  }
+};
+
+
+/* ************************************************************************** */
+/*                              Module Log Level                              */
+/* ************************************************************************** */
+namespace paramsTestTraceLevel{
+
+/**
+ * @note: Number of calls of the cost measurement
+ */
+typedef uint32_t Input;
+
+/**
+ * @note: No output
+ */
+typedef uint8_t Output;
+
+/**
+ * @note A module stripped at compile time. It shares the runtime slot of `MISC`.
+ */
+#define TRACE_COMPILE_LEVEL_TB_STRIPPED   TRACE_LEVEL_OFF
+enum{ kTraceModule_TB_STRIPPED = kTraceModule_MISC };
+
+/**
+ * @note A module kept at compile time whatever `LOG_LEVEL` the build uses. Same runtime slot.
+ */
+#define TRACE_COMPILE_LEVEL_TB_KEPT       TRACE_LEVEL_DEBUG
+enum{ kTraceModule_TB_KEPT = kTraceModule_MISC };
+
+static uint32_t evaluated = 0;
+
+static inline uint32_t touch(void){
+  return ++evaluated;
+}
+
+} /* Namespace paramsTestTraceLevel */
+
+/**
+ * @brief Filtered and stripped calls MUST never evaluate their arguments
+ */
+class TestTraceLevel : public TestUnitWrapper<paramsTestTraceLevel::Input,paramsTestTraceLevel::Output>{
+public:
+  TestTraceLevel():TestUnitWrapper("test_trace_level"){}
+
+  bool run( paramsTestTraceLevel::Input& input, paramsTestTraceLevel::Output& ref) override{
+    using namespace paramsTestTraceLevel;
+    const uint8_t saved = trace_module_level[kTraceModule_MISC];
+    bool          result = true;
+
+    /* Stripped. The runtime level does NOT matter. */
+    trace_level_set( kTraceModule_MISC, TRACE_LEVEL_DEBUG);
+    evaluated = 0;
+    TRACE_LOG( TB_STRIPPED, TRACE_LEVEL_ERROR, FMT_ERROR_STR, "stripped %u", touch());
+    if( evaluated!=0 ){
+      this->_err_msg<<"A stripped call evaluated its argument"<<endl;
+      result = false;
+    }
+
+    /* Filtered at runtime */
+    trace_level_set( kTraceModule_MISC, TRACE_LEVEL_OFF);
+    TRACE_LOG( TB_KEPT, TRACE_LEVEL_ERROR, FMT_ERROR_STR, "filtered %u", touch());
+    if( evaluated!=0 ){
+      this->_err_msg<<"A filtered call evaluated its argument"<<endl;
+      result = false;
+    }
+
+    /* Kept and printed */
+    trace_level_set( kTraceModule_MISC, TRACE_LEVEL_ERROR);
+    TRACE_LOG( TB_KEPT, TRACE_LEVEL_ERROR, FMT_ERROR_STR, "test_trace_level: printed on purpose %u" FMT_RESET, touch());
+    if( evaluated!=1 ){
+      this->_err_msg<<"A printed call evaluated its argument "<<evaluated<<" times"<<endl;
+      result = false;
+    }
+
+    if( trace_level_set( kNumTraceModule+1, TRACE_LEVEL_ERROR)!=-1 || trace_level_set( 0, TRACE_LEVEL_DEBUG+1)!=-1 ){
+      this->_err_msg<<"Out of range parameters were accepted"<<endl;
+      result = false;
+    }
+
+    /* Cost of a call filtered at runtime */
+    trace_level_set( kTraceModule_MISC, TRACE_LEVEL_OFF);
+    const tTestBenchConfig cfg = { 1000, 101, input};
+    auto filtered = [](uint32_t i){
+      TRACE_LOG( TB_KEPT, TRACE_LEVEL_ERROR, FMT_ERROR_STR, "%u %u %u", i, i%60, i%360);
+    };
+    TestBench::print( "trace_runtime_filtered", cfg, TestBench::measure( cfg, filtered)[0], 0);
+    cout<<endl;
+
+    trace_level_set( kTraceModule_MISC, saved);
+    return result;
+  }
+};
+
+
+/* ************************************************************************** */
+/*                                Crash Record                                */
+/* ************************************************************************** */
+namespace paramsTestTraceCrash{
+
+/**
+ * @note: Number of records pushed through the crash ring
+ */
+typedef uint32_t Input;
+
+/**
+ * @note: No output
+ */
+typedef uint8_t Output;
+
+/**
+ * @note A module kept at compile time whatever `LOG_LEVEL` the build uses. It shares the runtime
+ *       slot of `MISC`.
+ */
+#define TRACE_COMPILE_LEVEL_TB_MIRRORED   TRACE_LEVEL_DEBUG
+enum{ kTraceModule_TB_MIRRORED = kTraceModule_MISC };
+
+/**
+ * @brief Decode every record kept by the crash ring
+ * @return false if a record is broken
+ */
+static inline bool dump( std::vector<std::string> &lines){
+  uint8_t  buf[TRACE_DEFER_RECORD_MAX];
+  uint32_t cursor = 0;
+  size_t   len;
+  while( 0!=(len = trace_crash_read( buf, sizeof(buf), &cursor)) ){
+    for(size_t idx=0; idx<len; ){
+      std::string text;
+      size_t      rec = paramsTestTraceDefer::decode( &buf[idx], len-idx, text);
+      if( rec==0 ){
+        return false;
+      }
+      lines.push_back( text);
+      idx += rec;
+    }
+  }
+  return true;
+}
+
+} /* Namespace paramsTestTraceCrash */
+
+/**
+ * @brief The crash ring MUST keep the latest records, freeze on a crash and survive the boot check
+ * @note  The reset itself is covered by `TestTraceCrashReset` on the emulator.
+ */
+class TestTraceCrash : public TestUnitWrapper<paramsTestTraceCrash::Input,paramsTestTraceCrash::Output>{
+public:
+  TestTraceCrash():TestUnitWrapper("test_trace_crash"){}
+
+  bool run( paramsTestTraceCrash::Input& input, paramsTestTraceCrash::Output& ref) override{
+    using namespace paramsTestTraceCrash;
+    std::vector<std::string> lines;
+
+    /* Garbage after power on MUST be dropped */
+    memset( &trace_crash, 0x5A, sizeof(trace_crash));
+    if( trace_crash_boot()!=kTraceCrash_None || trace_crash.magic!=TRACE_CRASH_ARMED || trace_crash.head!=trace_crash.tail ){
+      this->_err_msg<<"Garbage was NOT dropped at boot"<<endl;
+      return false;
+    }
+
+    /* Wraparound keeps the latest consecutive records */
+    for(uint32_t i=0; i<input; ++i){
+      TRACE_CRASH_PRINTF( "crash %u", i);
+    }
+    if( !dump( lines) || lines.empty() || lines.back()!="crash "+std::to_string(input-1) ){
+      this->_err_msg<<"The latest record is missing"<<endl;
+      return false;
+    }
+    for(size_t i=1; i<lines.size(); ++i){
+      if( lines[i]!="crash "+std::to_string( input-lines.size()+i) ){
+        this->_err_msg<<"Records are NOT consecutive: \""<<lines[i-1]<<"\" then \""<<lines[i]<<"\""<<endl;
+        return false;
+      }
+    }
+    if( lines.size() < CMN_MIN( input, TRACE_CRASH_RING_SIZE/(TRACE_DEFER_HEADER_LEN+4)-1) ){
+      this->_err_msg<<"Only "<<lines.size()<<" records were kept"<<endl;
+      return false;
+    }
+
+    /* A printed call is mirrored. A filtered one is NOT. */
+    const uint8_t saved = trace_module_level[kTraceModule_MISC];
+    trace_level_set( kTraceModule_MISC, TRACE_LEVEL_OFF);
+    TRACE_LOG( TB_MIRRORED, TRACE_LEVEL_ERROR, FMT_ERROR_STR, "test_trace_crash: filtered %u", 1U);
+    trace_level_set( kTraceModule_MISC, TRACE_LEVEL_ERROR);
+    TRACE_LOG( TB_MIRRORED, TRACE_LEVEL_ERROR, FMT_ERROR_STR, "test_trace_crash: mirrored %u" FMT_RESET, 2U);
+    trace_level_set( kTraceModule_MISC, saved);
+
+    /* Stamp */
+    const std::string path = "/a/path/longer/than/the/string/kept/by/one/record/cmn_test.cc";
+    trace_crash_assert( path.c_str(), 1234);
+    TRACE_CRASH_PRINTF( "after the crash %u", 0U);
+    if( trace_crash.magic!=TRACE_CRASH_FROZEN || trace_crash.reason!=kTraceCrash_Assert || trace_crash.pc==0 ){
+      this->_err_msg<<"The crash was NOT stamped"<<endl;
+      return false;
+    }
+    if( trace_crash_boot()!=kTraceCrash_Assert ){
+      this->_err_msg<<"The stamped ring was dropped at boot"<<endl;
+      return false;
+    }
+
+    char assertion[128];
+    TRACE_FMT_SNPRINTF( assertion, sizeof(assertion), FMT_ERROR_STR "Assertion@%s:%u" FMT_RESET,
+                        path.substr( path.size()-TRACE_DEFER_STR_MAX).c_str(), 1234);
+    lines.clear();
+    if( !dump( lines) || lines.size()<2 ){
+      this->_err_msg<<"The stamped ring can NOT be read"<<endl;
+      return false;
+    }
+    if( lines.back()!=assertion ){
+      this->_err_msg<<"dut=\""<<lines.back()<<"\" ref=\""<<assertion<<"\""<<endl;
+      return false;
+    }
+    if( lines[lines.size()-2].find("mirrored 2")==std::string::npos || lines[lines.size()-3]!="crash "+std::to_string(input-1) ){
+      this->_err_msg<<"The leveled call was NOT mirrored exactly once: \""<<lines[lines.size()-2]<<"\""<<endl;
+      return false;
+    }
+
+    /* Corruption MUST re-arm */
+    trace_crash.buf[trace_crash.tail & (TRACE_CRASH_RING_SIZE-1)] ^= 0xFF;
+    if( trace_crash_boot()!=kTraceCrash_None || trace_crash.magic!=TRACE_CRASH_ARMED ){
+      this->_err_msg<<"A corrupted ring was kept at boot"<<endl;
+      return false;
+    }
+
+    /* Cost of one record */
+    const tTestBenchConfig cfg = { 1000, 101, 1000};
+    auto record = [](uint32_t i){
+      TRACE_CRASH_PRINTF( "ms=%u H_rem=%u M_rem=%d deg=%03u", i, i%60, -(int32_t)i, i%360);
+    };
+    TestBench::print( "trace_crash_record", cfg, TestBench::measure( cfg, record)[0], 0);
+    cout<<endl;
+
+    trace_crash_clear();
+    return true;
+  }
+};
+
+#if (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+/**
+ * @brief The crash ring MUST survive `NVIC_SystemReset()`
+ * @note  Two boots. The first one leaves a flag file on the host through semihosting, stamps an
+ *        assertion and resets. The second one finds the flag, removes it and checks the ring.
+ *        The flag is removed in any case, so a wiped RAM can NOT loop forever.
+ */
+class TestTraceCrashReset : public TestUnitWrapper<uint8_t,uint8_t>{
+public:
+  TestTraceCrashReset():TestUnitWrapper("test_trace_crash_reset"){}
+
+  bool run( uint8_t& input, uint8_t& ref) override{
+    const char *flag = "trace_crash_reset.flag";
+    FILE       *f    = fopen( flag, "rb");
+
+    if(!f){
+      f = fopen( flag, "wb");
+      if(!f){
+        this->_err_msg<<"Can NOT create "<<flag<<" on the host. Is semihosting enabled?"<<endl;
+        return false;
+      }
+      fclose(f);
+      trace_crash_clear();
+      TRACE_CRASH_PRINTF( "before reset %u", 0x5EEDU);
+      trace_crash_assert( __FILE__, __LINE__);
+      NVIC_SystemReset();
+    }
+    fclose(f);
+    remove( flag);
+
+    std::vector<std::string> lines;
+    if( trace_crash.magic!=TRACE_CRASH_FROZEN || trace_crash.reason!=kTraceCrash_Assert ){
+      this->_err_msg<<"The crash record was lost across the reset"<<endl;
+      return false;
+    }
+    if( !paramsTestTraceCrash::dump( lines) || lines.size()!=2 || lines[0]!="before reset 24301" ){
+      this->_err_msg<<"The records were NOT kept across the reset"<<endl;
+      return false;
+    }
+    trace_crash_clear();
+    return true;
+  }
+};
+#endif
+
+
+/* ************************************************************************** */
+/*                               Profiling Zone                               */
+/* ************************************************************************** */
+#if (PROFILE_ZONE==1)
+namespace paramsTestProfileZone{
+
+/**
+ * @note: Ticks spent in each sample
+ */
+typedef uint32_t Input;
+
+/**
+ * @note: Maximum average ticks of an empty zone
+ */
+typedef uint32_t Output;
+
+static inline void spin( uint32_t ticks){
+  const uint32_t start = profile_now();
+  while( profile_now() - start < ticks );
+}
+
+} /* Namespace paramsTestProfileZone */
+
+/**
+ * @brief Zones MUST accumulate count, total, min and max, and cost little enough for hot paths
+ */
+class TestProfileZone : public TestUnitWrapper<paramsTestProfileZone::Input,paramsTestProfileZone::Output>{
+public:
+  TestProfileZone():TestUnitWrapper("test_profile_zone"){}
+
+  bool run( paramsTestProfileZone::Input& input, paramsTestProfileZone::Output& ref) override{
+    using namespace paramsTestProfileZone;
+    const tProfileZone *misc = &profile_zone[kProfileZone_MISC];
+
+    profile_init();
+    if( misc->count!=0 || misc->total!=0 ){
+      this->_err_msg<<"Zones were NOT cleared"<<endl;
+      return false;
+    }
+
+    /* C */
+    for(uint32_t i=1; i<=10; ++i){
+      PROFILE_BEGIN( MISC);
+      spin( input*i);
+      PROFILE_END( MISC);
+    }
+    if( misc->count!=10 || misc->min<input || misc->max<10*input || misc->total<55ULL*input || misc->min>misc->max ){
+      this->_err_msg<<"n="<<misc->count<<" total="<<misc->total<<" min="<<misc->min<<" max="<<misc->max<<endl;
+      return false;
+    }
+
+    /* C++. The inner scope is part of the outer one. */
+    profile_reset();
+    {
+      PROFILE_SCOPE( MISC);
+      spin( input);
+      {
+        PROFILE_SCOPE( MISC);
+        spin( input);
+      }
+    }
+    if( misc->count!=2 || misc->max < misc->min + input ){
+      this->_err_msg<<"Nested scopes: n="<<misc->count<<" min="<<misc->min<<" max="<<misc->max<<endl;
+      return false;
+    }
+    if( profile_zone_name( kProfileZone_VSNPRINTF)!=std::string("vsnprintf") || profile_zone_name( kNumProfileZone)[0]!='\0' ){
+      this->_err_msg<<"Wrong zone names"<<endl;
+      return false;
+    }
+
+    /* Cost of an empty zone */
+    const tTestBenchConfig cfg = { 1000, 101, 1000};
+    auto empty = [](uint32_t i){
+      PROFILE_BEGIN( MISC);
+      PROFILE_END( MISC);
+    };
+    const auto cost = TestBench::measure( cfg, empty)[0];
+    TestBench::print( "profile_zone_empty", cfg, cost, 0);
+    cout<<" overhead="<<profile_overhead()<<endl;
+
+    profile_reset();
+    if( profile_overhead() > ref ){
+      this->_err_msg<<"An empty zone takes "<<profile_overhead()<<" ticks"<<endl;
+      return false;
+    }
+    return true;
+  }
+};
+#endif
+
+
+/* ************************************************************************** */
+/*                          Task Run-time Statistics                          */
+/* ************************************************************************** */
+namespace paramsTestRtosTop{
+
+/**
+ * @note: Number of time slices between two queries
+ */
+typedef uint32_t Input;
+
+/**
+ * @note: No output
+ */
+typedef uint8_t Output;
+
+/**
+ * @brief Synthetic scheduler. Time slices of random length go to tasks in proportion to their weight.
+ */
+struct Load{
+  struct Task{ uint32_t id; uint32_t weight; uint32_t runtime; bool alive; };
+  std::vector<Task> tasks;
+  uint32_t          total;
+  uint32_t          seed = 0x2468ACEU;
+
+  uint32_t rand(void){
+    seed = seed*1664525U + 1013904223U;
+    return seed >> 8;
+  }
+
+  void run( uint32_t slices){
+    uint32_t sum = 0;
+    for(const auto &t : tasks){
+      sum += t.alive ? t.weight : 0;
+    }
+    for(uint32_t n=0; n<slices; ++n){
+      uint32_t pick = rand()%sum;
+      uint32_t len  = 1 + rand()%2000;
+      for(auto &t : tasks){
+        if( !t.alive ){
+          continue;
+        }
+        if( pick < t.weight ){
+          t.runtime += len;
+          break;
+        }
+        pick -= t.weight;
+      }
+      total += len;
+    }
+  }
+
+  uint32_t sample( tAppRtosTopTask *out){
+    uint32_t num = 0;
+    for(const auto &t : tasks){
+      if( t.alive ){
+        out[num] = tAppRtosTopTask{};
+        out[num].id      = t.id;
+        out[num].runtime = t.runtime;
+        snprintf( out[num].name, sizeof(out[num].name), "task%u", t.id);
+        ++num;
+      }
+    }
+    return num;
+  }
+};
+
+} /* Namespace paramsTestRtosTop */
+
+/**
+ * @brief CPU shares of `TOP` MUST match the synthetic load, across counter wraps and task churn
+ */
+class TestRtosTop : public TestUnitWrapper<paramsTestRtosTop::Input,paramsTestRtosTop::Output>{
+private:
+  bool check( const tAppRtosTop &top, const std::map<uint32_t,uint32_t> &before, const paramsTestRtosTop::Load &load, uint32_t period){
+    uint32_t sum = 0;
+    if( top.period!=period ){
+      this->_err_msg<<"period="<<top.period<<" ref="<<period<<endl;
+      return false;
+    }
+    for(uint32_t i=0; i<top.num; ++i){
+      const tAppRtosTopTask &t = top.task[i];
+      uint32_t delta = 0;
+      for(const auto &ref : load.tasks){
+        if( ref.id==t.id ){
+          auto it = before.find(t.id);
+          delta   = ref.runtime - (it==before.end() ? 0 : it->second);
+        }
+      }
+      const uint32_t expect = (uint32_t)(((uint64_t)delta*1000U)/period);
+      if( t.permille!=expect ){
+        this->_err_msg<<t.name<<": permille="<<t.permille<<" ref="<<expect<<endl;
+        return false;
+      }
+      if( i>0 && top.task[i-1].permille<t.permille ){
+        this->_err_msg<<"NOT sorted busiest first at "<<i<<endl;
+        return false;
+      }
+      sum += t.permille;
+    }
+    /* Every slice belongs to a live task. Rounding loses less than 1 permille per task. */
+    if( sum>1000 || sum+top.num<1000 ){
+      this->_err_msg<<"Shares add up to "<<sum<<" permille"<<endl;
+      return false;
+    }
+    return true;
+  }
+
+public:
+  TestRtosTop():TestUnitWrapper("test_rtos_top"){}
+
+  bool run( paramsTestRtosTop::Input& input, paramsTestRtosTop::Output& ref) override{
+    using namespace paramsTestRtosTop;
+    tAppRtosTop     top = {};
+    tAppRtosTopTask sample[APP_RTOS_TOP_MAX_TASK];
+    Load            load;
+
+    /* Counters start close to the wrap */
+    load.total = 0xFFF00000U;
+    load.tasks = {
+      {1,  2, 0xFFF00000U - 6000, true},      /* eg: bsp_screen_main */
+      {2,  1, 0,                  true},      /* eg: app_clock_main  */
+      {3,  1, 0,                  true},      /* eg: app_cmdbox_main */
+      {4, 12, 6000,               true}       /* eg: IDLE            */
+    };
+    top.total = load.total;
+    for(const auto &t : load.tasks){
+      top.task[top.num]         = tAppRtosTopTask{};
+      top.task[top.num].id      = t.id;
+      top.task[top.num].runtime = t.runtime;
+      ++top.num;
+    }
+
+    for(uint32_t query=0; query<6; ++query){
+      if( query==2 ){
+        load.tasks.push_back( {5, 4, 0, true});  /* Created between two queries */
+      }
+      if( query==4 ){
+        load.tasks[1].alive = false;             /* Deleted */
+      }
+
+      std::map<uint32_t,uint32_t> before;
+      for(uint32_t i=0; i<top.num; ++i){
+        before[top.task[i].id] = top.task[i].runtime;
+      }
+      const uint32_t start = load.total;
+      load.run( input);
+
+      uint32_t num = load.sample( sample);
+      app_rtos_top_update( &top, sample, num, load.total);
+      if( !check( top, before, load, load.total-start) ){
+        this->_err_msg<<"at query "<<query<<endl;
+        return false;
+      }
+    }
+
+    /* The weights are 2:1:1:12:4. The idle task MUST lead by far. */
+    if( strcmp( top.task[0].name, "task4")!=0 || top.task[0].permille<500 ){
+      this->_err_msg<<"Busiest task is "<<top.task[0].name<<" at "<<top.task[0].permille<<" permille"<<endl;
+      return false;
+    }
+    return true;
+  }
+};
+
+
+/* ************************************************************************** */
+/*                                Task Timeline                               */
+/* ************************************************************************** */
+namespace paramsTestTimeline{
+
+/**
+ * @note: Number of events recorded. More than the ring holds.
+ */
+typedef uint32_t Input;
+
+/**
+ * @note: No output
+ */
+typedef uint8_t Output;
+
+static inline uint32_t type_of( uint32_t i){
+  return 1 + i%(kNumTimeline-1);
+}
+
+} /* Namespace paramsTestTimeline */
+
+/**
+ * @brief The ring MUST keep the latest events in order, skip the overwritten ones and cost little enough for every switch
+ */
+class TestTimeline : public TestUnitWrapper<paramsTestTimeline::Input,paramsTestTimeline::Output>{
+private:
+  /**
+   * @brief Read everything after `cursor` with a small buffer and check it is `first`, `first+1`, ... `last`
+   */
+  bool drain( uint32_t *cursor, uint32_t first, uint32_t last){
+    using namespace paramsTestTimeline;
+    tTimelineEvent buf[7];
+    size_t         len;
+    uint32_t       expect = first;
+    uint32_t       prev   = 0;
+    while( 0 != (len = timeline_read( buf, sizeof(buf)/sizeof(buf[0]), cursor)) ){
+      for(size_t k=0; k<len; ++k, ++expect){
+        const uint32_t type = buf[k].word >> 24;
+        const uint32_t id   = buf[k].word & TIMELINE_ID_MASK;
+        if( id!=expect || type!=type_of(expect) ){
+          this->_err_msg<<"Read id="<<id<<" type="<<type<<" expected id="<<expect<<endl;
+          return false;
+        }
+        if( expect!=first && (int32_t)(buf[k].time - prev) < 0 ){
+          this->_err_msg<<"Time went back at id="<<id<<endl;
+          return false;
+        }
+        prev = buf[k].time;
+      }
+    }
+    if( expect!=last+1 ){
+      this->_err_msg<<"Read up to "<<expect<<" expected "<<last+1<<endl;
+      return false;
+    }
+    return true;
+  }
+
+public:
+  TestTimeline():TestUnitWrapper("test_timeline"){}
+
+  bool run( paramsTestTimeline::Input& input, paramsTestTimeline::Output& ref) override{
+    using namespace paramsTestTimeline;
+    uint32_t cursor = 0;
+
+    /* Wraparound keeps the latest ones */
+    timeline_clear();
+    for(uint32_t i=0; i<input; ++i){
+      timeline_record( type_of(i), i);
+    }
+    if( timeline.head!=input || !drain( &cursor, input-TIMELINE_EVENT_NUM, input-1) ){
+      this->_err_msg<<"After "<<input<<" events"<<endl;
+      return false;
+    }
+
+    /* A reader overtaken by the writer skips to the oldest event kept */
+    for(uint32_t i=input; i<input+TIMELINE_EVENT_NUM/2; ++i){
+      timeline_record( type_of(i), i);
+    }
+    if( !drain( &cursor, input, input+TIMELINE_EVENT_NUM/2-1) ){
+      this->_err_msg<<"Incremental read"<<endl;
+      return false;
+    }
+    const uint32_t head = input+TIMELINE_EVENT_NUM/2;
+    for(uint32_t i=head; i<head+2*TIMELINE_EVENT_NUM+3; ++i){
+      timeline_record( type_of(i), i);
+    }
+    if( !drain( &cursor, head+TIMELINE_EVENT_NUM+3, head+2*TIMELINE_EVENT_NUM+2) ){
+      this->_err_msg<<"Overtaken reader"<<endl;
+      return false;
+    }
+
+    /* Disabled recorder, 24-bit id and an explicit time */
+    tTimelineEvent ev, extra;
+    cursor = 0;
+    timeline_clear();
+    timeline_enable( 0);
+    timeline_record( kTimeline_TASK_IN, 1);
+    timeline_enable( 1);
+    timeline_record_at( 0xFFFFFFF0U, kTimeline_QUEUE_GIVE, 0x20001234U);
+    if( timeline_read( &ev, 1, &cursor)!=1 || timeline_read( &extra, 1, &cursor)!=0 ){
+      this->_err_msg<<"A disabled recorder MUST drop the event"<<endl;
+      return false;
+    }
+    if( ev.time!=0xFFFFFFF0U || ev.word!=((kTimeline_QUEUE_GIVE<<24) | 0x001234U) ){
+      this->_err_msg<<"time="<<ev.time<<" word="<<ev.word<<endl;
+      return false;
+    }
+    if( timeline_type_name( kTimeline_TASK_IN)!=std::string("in") || timeline_type_name( kNumTimeline)[0]!='\0' ){
+      this->_err_msg<<"Wrong type names"<<endl;
+      return false;
+    }
+
+    /* The dump prints the ring and records again from empty */
+    timeline_record( kTimeline_TASK_IN, 2);
+    timeline_dump();
+    if( timeline.head!=0 || timeline.enable!=1 ){
+      this->_err_msg<<"The dump MUST clear and restart the recorder"<<endl;
+      return false;
+    }
+
+    const tTestBenchConfig cfg = { 1000, 101, 1000};
+    auto record = [](uint32_t i){
+      timeline_record( kTimeline_TASK_IN, i);
+    };
+    TestBench::print( "timeline_record", cfg, TestBench::measure( cfg, record)[0], 0);
+    cout<<endl;
+    timeline_clear();
+    return true;
+  }
+};
+
+
+/* ************************************************************************** */
+/*                                Memory Owner                                */
+/* ************************************************************************** */
+#if (MEMORY_OWNER==1)
+namespace paramsTestMemoryOwner{
+
+/**
+ * @note: Number of random steps after the script
+ */
+typedef uint32_t Input;
+
+/**
+ * @note: No output
+ */
+typedef uint8_t Output;
+
+/**
+ * @brief `M`alloc, `R`ealloc or `F`ree the block of `slot` as `owner`
+ */
+struct Step{ char op; uint32_t owner; uint32_t slot; uint32_t size; };
+
+struct Block{ uint8_t *ptr; uint32_t owner; uint32_t size; };
+
+static const Step SCRIPT[] = {
+  {'M', kMemoryOwner_BOOT,   0,  100},
+  {'M', kMemoryOwner_SCREEN, 1,  300},
+  {'M', kMemoryOwner_SCREEN, 2,    1},
+  {'R', kMemoryOwner_CLOCK,  1,  500},     /* Stays with the screen */
+  {'F', kMemoryOwner_CLOCK,  0,    0},     /* Credited to boot */
+  {'R', kMemoryOwner_CLOCK,  3,   64},     /* From NULL: charged to the clock */
+  {'R', kMemoryOwner_CLOCK,  1,   20},
+  {'M', kMemoryOwner_CMDBOX, 0,    0},
+  {'R', kMemoryOwner_MISC,   2,    0},     /* Size 0 frees */
+  {'F', kMemoryOwner_MISC,   2,    0},     /* NULL */
+};
+
+} /* Namespace paramsTestMemoryOwner */
+
+/**
+ * @brief Every owner MUST match a model of the allocation script, whoever frees or grows the block
+ */
+class TestMemoryOwner : public TestUnitWrapper<paramsTestMemoryOwner::Input,paramsTestMemoryOwner::Output>{
+private:
+  tMemoryOwner                   _base[kNumMemoryOwner];
+  tMemoryOwner                   _model[kNumMemoryOwner];
+  paramsTestMemoryOwner::Block   _block[16];
+
+  void charge( uint32_t owner, int32_t bytes, int32_t count){
+    _model[owner].bytes += bytes;
+    _model[owner].count += count;
+    _model[owner].peak   = std::max( _model[owner].peak, _model[owner].bytes);
+  }
+
+  bool intact( const paramsTestMemoryOwner::Block &b, uint32_t slot){
+    for(uint32_t k=0; k<b.size; ++k){
+      if( b.ptr[k]!=(uint8_t)(slot+k) ){
+        this->_err_msg<<"Slot "<<slot<<" was corrupted at byte "<<k<<endl;
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool step( const paramsTestMemoryOwner::Step &s){
+    using namespace paramsTestMemoryOwner;
+    Block &b = _block[s.slot];
+    memory_owner_set( NULL, s.owner);
+    if( !intact( b, s.slot) ){
+      return false;
+    }
+
+    switch( s.op){
+      case 'M':
+        if( b.ptr ){
+          return true;
+        }
+        b = { (uint8_t *)MALLOC( s.size), s.owner, s.size};
+        charge( s.owner, s.size, 1);
+        break;
+      case 'R':{
+        uint8_t *p = (uint8_t *)REALLOC( b.ptr, s.size);
+        if( s.size==0 ){
+          if( b.ptr ){
+            charge( b.owner, -(int32_t)b.size, -1);
+          }
+          b = { NULL, 0, 0};
+        }else if( b.ptr ){
+          charge( b.owner, (int32_t)s.size-(int32_t)b.size, 0);
+          b.ptr  = p;
+          b.size = std::min( b.size, s.size);     /* Only the kept bytes are checked */
+          if( !intact( b, s.slot) ){
+            return false;
+          }
+          b.size = s.size;
+        }else{
+          charge( s.owner, s.size, 1);
+          b = { p, s.owner, s.size};
+        }
+        break;
+      }
+      case 'F':
+        FREE( b.ptr);
+        if( b.ptr ){
+          charge( b.owner, -(int32_t)b.size, -1);
+        }
+        b = { NULL, 0, 0};
+        break;
+    }
+    for(uint32_t k=0; k<b.size; ++k){
+      b.ptr[k] = (uint8_t)(s.slot+k);
+    }
+
+    for(uint32_t i=0; i<kNumMemoryOwner; ++i){
+      const tMemoryOwner &o = memory_owner[i];
+      if( o.bytes!=_base[i].bytes+_model[i].bytes || o.count!=_base[i].count+_model[i].count ||
+          o.peak !=std::max( _base[i].peak, _base[i].bytes+_model[i].peak) ){
+        this->_err_msg<<memory_owner_name(i)<<": bytes="<<o.bytes<<" n="<<o.count<<" peak="<<o.peak<<" after "<<s.op<<" slot "<<s.slot<<endl;
+        return false;
+      }
+    }
+    return true;
+  }
+
+public:
+  TestMemoryOwner():TestUnitWrapper("test_memory_owner"){}
+
+  bool run( paramsTestMemoryOwner::Input& input, paramsTestMemoryOwner::Output& ref) override{
+    using namespace paramsTestMemoryOwner;
+    const uint32_t owner = memory_owner_current();
+    memcpy( _base, memory_owner, sizeof(_base));
+    memset( _model, 0, sizeof(_model));
+    memset( _block, 0, sizeof(_block));
+
+    for(const Step &s : SCRIPT){
+      if( !step( s) ){
+        return false;
+      }
+    }
+
+    uint32_t seed = 0x13579BDU;
+    for(uint32_t n=0; n<input; ++n){
+      seed = seed*1664525U + 1013904223U;
+      const uint32_t r = seed >> 8;
+      const Step s = { "MRF"[r%3], (r>>2)%kNumMemoryOwner, (r>>5)%16, (r>>9)%700 };
+      if( !step( s) ){
+        return false;
+      }
+    }
+
+    for(uint32_t i=0; i<16; ++i){
+      if( !step( Step{'F', kMemoryOwner_MISC, i, 0}) ){
+        return false;
+      }
+    }
+    for(uint32_t i=0; i<kNumMemoryOwner; ++i){
+      if( memory_owner[i].bytes!=_base[i].bytes || memory_owner[i].count!=_base[i].count ){
+        this->_err_msg<<memory_owner_name(i)<<" leaked"<<endl;
+        return false;
+      }
+    }
+    if( memory_owner_name( kMemoryOwner_SCREEN)!=std::string("screen") || memory_owner_name( kNumMemoryOwner)[0]!='\0' ){
+      this->_err_msg<<"Wrong owner names"<<endl;
+      return false;
+    }
+    memory_owner_set( NULL, owner);
+    return true;
+  }
+};
+#endif
+
+
+/* ************************************************************************** */
+/*                             Allocation Tracking                            */
+/* ************************************************************************** */
+#if (MEMORY_TRACK==1)
+namespace paramsTestMemoryTrack{
+
+/**
+ * @note: Number of style switches
+ */
+typedef uint32_t Input;
+
+/**
+ * @note: Most blocks alive at once in the churn
+ */
+typedef uint32_t Output;
+
+/**
+ * @note Three call sites of a clock style: the objects, one buffer and its growth
+ */
+static __attribute__((noinline)) void *style_obj( size_t size){ return MALLOC( size); }
+static __attribute__((noinline)) void *style_buf( size_t size){ return MALLOC( size); }
+static __attribute__((noinline)) void *style_grow( void *pv, size_t size){ return REALLOC( pv, size); }
+
+struct Style{
+  void    *obj[12];
+  void    *buf;
+  uint32_t bytes;
+};
+
+static void style_open( Style &s, uint32_t kind){
+  s.bytes = 0;
+  for(uint32_t i=0; i<12; ++i){
+    s.obj[i]  = style_obj( 24 + 8*((kind+i)%5));
+    s.bytes  += 24 + 8*((kind+i)%5);
+  }
+  s.buf    = style_grow( style_buf( 64), 256 + 128*kind);
+  s.bytes += 256 + 128*kind;
+}
+
+static void style_close( Style &s){
+  for(uint32_t i=0; i<12; ++i){
+    FREE( s.obj[i]);
+  }
+  FREE( s.buf);
+}
+
+} /* Namespace paramsTestMemoryTrack */
+
+/**
+ * @brief Switching clock styles back and forth MUST NOT leave any tracked byte behind
+ * @note  The styles are simulated by three call sites. Afterwards, a churn close to the capacity
+ *        checks that the table still finds every live block after the backward shifts.
+ */
+class TestMemoryTrack : public TestUnitWrapper<paramsTestMemoryTrack::Input,paramsTestMemoryTrack::Output>{
+private:
+  tMemoryTrackSite _base[MEMORY_TRACK_SITE_NUM];
+
+  bool balanced( const char *when){
+    for(uint32_t i=0; i<MEMORY_TRACK_SITE_NUM; ++i){
+      const tMemoryTrackSite &s = memory_track.site[i];
+      const uint32_t bytes = s.site==_base[i].site ? _base[i].bytes : 0;
+      if( s.bytes!=bytes ){
+        this->_err_msg<<"Site 0x"<<std::hex<<s.site<<std::dec<<" holds "<<s.bytes<<" bytes "<<when<<endl;
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool churn( uint32_t live_max, uint32_t since){
+    std::set<uintptr_t> live;
+    std::vector<void *> block;
+    const uint32_t      count = memory_track.count;
+    uint32_t            seed  = 0x2468ACEU;
+
+    for(uint32_t n=0; n<20*live_max; ++n){
+      seed = seed*1664525U + 1013904223U;
+      if( block.size()<live_max && ((seed>>28)>=6 || block.empty()) ){
+        block.push_back( MALLOC( 1 + (seed>>8)%96));
+        live.insert( (uintptr_t)block.back());
+      }else{
+        const uint32_t k = (seed>>8)%block.size();
+        live.erase( (uintptr_t)block[k]);
+        FREE( block[k]);
+        block[k] = block.back();
+        block.pop_back();
+      }
+      if( memory_track.count!=count+live.size() ){
+        this->_err_msg<<"Churn: "<<memory_track.count-count<<" blocks tracked, "<<live.size()<<" alive"<<endl;
+        return false;
+      }
+      if( (n&63)==63 ){
+        static tMemoryTrackBlock buf[MEMORY_TRACK_NUM];
+        const size_t len   = memory_track_blocks( buf, MEMORY_TRACK_NUM, since);
+        size_t       found = 0;
+        for(size_t i=0; i<len; ++i){
+          found += live.count( buf[i].ptr);
+        }
+        if( found!=live.size() ){
+          this->_err_msg<<"Churn: "<<found<<" of "<<live.size()<<" blocks found"<<endl;
+          return false;
+        }
+      }
+    }
+    for(void *p : block){
+      FREE( p);
+    }
+    return true;
+  }
+
+public:
+  TestMemoryTrack():TestUnitWrapper("test_memory_track"){}
+
+  bool run( paramsTestMemoryTrack::Input& input, paramsTestMemoryTrack::Output& live_max) override{
+    using namespace paramsTestMemoryTrack;
+    const uint32_t owner = memory_owner_current();
+    const uint32_t since = memory_track_now();
+    const uint32_t bytes = memory_track.bytes;
+    const uint32_t count = memory_track.count;
+    const uint32_t lost  = memory_track.lost;
+    memcpy( _base, memory_track.site, sizeof(_base));
+    memory_owner_set( NULL, kMemoryOwner_CLOCK);
+
+    Style    style;
+    uint32_t peak = 0;
+    style_open( style, 0);
+    for(uint32_t n=1; n<=input; ++n){
+      style_close( style);
+      style_open( style, n%3);
+      peak = std::max( peak, style.bytes);
+      if( memory_track.bytes!=bytes+style.bytes || memory_track.count!=count+13 ){
+        this->_err_msg<<"Switch "<<n<<": "<<memory_track.bytes-bytes<<" bytes tracked, "<<style.bytes<<" expected"<<endl;
+        return false;
+      }
+    }
+
+    /* The opened style is the only thing left since the start */
+    static tMemoryTrackBlock buf[MEMORY_TRACK_NUM];
+    size_t   len = memory_track_blocks( buf, MEMORY_TRACK_NUM, since);
+    uint32_t sum = 0;
+    for(size_t i=0; i<len; ++i){
+      sum += buf[i].size;
+      if( memory_track.site[buf[i].site].owner!=kMemoryOwner_CLOCK ){
+        this->_err_msg<<"Block charged to "<<memory_owner_name( memory_track.site[buf[i].site].owner)<<endl;
+        return false;
+      }
+    }
+    if( len!=13 || sum!=style.bytes ){
+      this->_err_msg<<len<<" blocks of "<<sum<<" bytes outstanding, 13 of "<<style.bytes<<" expected"<<endl;
+      return false;
+    }
+    style_close( style);
+    if( !balanced( "after the switches") ){
+      return false;
+    }
+
+    /* Allocations ever made and peak of the new sites: 12 objects, one buffer grown once */
+    tMemoryTrackSite site[MEMORY_TRACK_SITE_NUM];
+    len = memory_track_sites( site, MEMORY_TRACK_SITE_NUM);
+    uint32_t total = 0;
+    uint32_t site_peak = 0;
+    for(size_t i=0; i<len; ++i){
+      if( site[i].owner==kMemoryOwner_CLOCK ){
+        total    += site[i].total;
+        site_peak = std::max( site_peak, site[i].peak);
+      }
+    }
+    if( total<(input+1)*14 || site_peak<256+128*2 ){
+      this->_err_msg<<"Sites counted "<<total<<" allocations and a peak of "<<site_peak<<endl;
+      return false;
+    }
+
+    /* A leak is reported at its call site */
+    void *leak = style_buf( 40);
+    len = memory_track_blocks( buf, MEMORY_TRACK_NUM, since);
+    if( len!=1 || buf[0].ptr!=(uintptr_t)leak || buf[0].size!=40 || memory_track.site[buf[0].site].bytes!=40 ){
+      this->_err_msg<<"The leak was NOT reported"<<endl;
+      return false;
+    }
+    FREE( leak);
+
+    memory_owner_set( NULL, owner);
+    if( !churn( live_max, since) || !balanced( "after the churn") ){
+      return false;
+    }
+    if( memory_track.bytes!=bytes || memory_track.count!=count || memory_track.lost!=lost || memory_track.peak<peak ){
+      this->_err_msg<<"bytes="<<memory_track.bytes<<" n="<<memory_track.count<<" lost="<<memory_track.lost<<" peak="<<memory_track.peak<<endl;
+      return false;
+    }
+    return true;
+  }
+};
+#endif
+
+
+/* ************************************************************************** */
+/*                              Lock-free Byte Ring                           */
+/* ************************************************************************** */
+namespace paramsTestCmnRing{
+
+/**
+ * @note: Number of messages
+ */
+typedef uint32_t Input;
+
+/**
+ * @note: No output
+ */
+typedef uint8_t Output;
+
+/**
+ * @brief Message of `len` bytes: [len][producer][seq_lo][seq_hi][payload...]
+ */
+static inline void make_msg( uint8_t *msg, uint8_t len, uint8_t producer, uint16_t seq){
+  msg[0] = len;
+  msg[1] = producer;
+  msg[2] = (uint8_t)(seq);
+  msg[3] = (uint8_t)(seq>>8);
+  for(uint8_t k=4; k<len; ++k){
+    msg[k] = (uint8_t)(producer + seq + k);
+  }
+}
+
+static inline bool check_msg( const uint8_t *msg){
+  const uint16_t seq = msg[2] | (msg[3]<<8);
+  for(uint8_t k=4; k<msg[0]; ++k){
+    if( msg[k] != (uint8_t)(msg[1] + seq + k) ){
+      return false;
+    }
+  }
+  return true;
+}
+
+} /* Namespace paramsTestCmnRing */
+
+/**
+ * @brief Byte order, wraparound and overflow of a single producer
+ * @note  The consumer holds a chunk across writes like a running DMA and releases it in pieces.
+ */
+class TestCmnRing : public TestUnitWrapper<paramsTestCmnRing::Input,paramsTestCmnRing::Output>{
+public:
+  TestCmnRing():TestUnitWrapper("test_cmn_ring"){}
+
+  bool run( paramsTestCmnRing::Input& input, paramsTestCmnRing::Output& ref) override{
+    using namespace paramsTestCmnRing;
+
+    uint8_t             storage[64];
+    tCmnRing            ring;
+    std::vector<uint8_t> expect;
+    size_t              consumed = 0;
+    uint32_t            dropped  = 0;
+    const uint8_t      *held     = NULL;
+    size_t              held_len = 0;
+    std::mt19937        rng(0x2468ACE);
+
+    cmn_ring_init( &ring, storage, sizeof(storage));
+
+    auto consume = [&]( size_t k) -> bool{
+      for(size_t j=0; j<k; ++j){
+        if( consumed>=expect.size() || held[j]!=expect[consumed] ){
+          this->_err_msg<<"Byte "<<consumed<<" mismatched"<<endl;
+          return false;
+        }
+        ++consumed;
+      }
+      held_len = cmn_ring_next( &ring, k, &held);
+      return true;
+    };
+
+    for(uint32_t n=0; n<input; ++n){
+      uint8_t msg[24];
+      uint8_t len  = 4 + rng()%20;
+      size_t  room = sizeof(storage) - cmn_ring_pending( &ring);
+      make_msg( msg, len, 0, (uint16_t)n);
+
+      size_t ret = cmn_ring_write( &ring, msg, len);
+      if( (ret==len) != (len<=room) || (ret!=len && ret!=0) ){
+        this->_err_msg<<"write() returned "<<ret<<" with "<<room<<" bytes of room for "<<(int)len<<endl;
+        return false;
+      }
+      if( ret ){
+        expect.insert( expect.end(), msg, msg+len);
+      }else{
+        ++dropped;
+      }
+
+      if( held_len==0 ){
+        held_len = cmn_ring_claim( &ring, &held);
+      }else if( cmn_ring_claim( &ring, &held)!=0 ){
+        this->_err_msg<<"The consumer was claimed twice"<<endl;
+        return false;
+      }
+      if( held_len && !consume( rng()%(held_len+1)) ){
+        return false;
+      }
+    }
+
+    while( held_len || 0!=(held_len = cmn_ring_claim( &ring, &held)) ){
+      if( !consume( held_len) ){
+        return false;
+      }
+    }
+
+    if( consumed!=expect.size() || cmn_ring_pending( &ring)!=0 ){
+      this->_err_msg<<"consumed="<<consumed<<" expect="<<expect.size()<<endl;
+      return false;
+    }
+    if( dropped==0 || cmn_ring_dropped( &ring)!=dropped ){
+      this->_err_msg<<"dropped="<<cmn_ring_dropped( &ring)<<" expect="<<dropped<<endl;
+      return false;
+    }
+    return true;
+  }
+};
+
+#if (defined SYS_TARGET_NATIVE)
+/**
+ * @brief Producer threads against a consumer thread modelling the DMA and its interrupt
+ * @note  A producer that wins the consumer hands the chunk to the DMA thread like a DMA start.
+ *        The DMA thread chains the chunks with `cmn_ring_next()` like the transfer complete
+ *        interrupt. Every message MUST arrive whole and in order per producer, or be counted
+ *        as dropped. The caller latency of a write plus kick is reported.
+ */
+class TestCmnRingConcurrent : public TestUnitWrapper<paramsTestCmnRing::Input,paramsTestCmnRing::Output>{
+public:
+  TestCmnRingConcurrent():TestUnitWrapper("test_cmn_ring_concurrent"){}
+
+  bool run( paramsTestCmnRing::Input& input, paramsTestCmnRing::Output& ref) override{
+    using namespace paramsTestCmnRing;
+    static constexpr uint8_t kProducer = 4;
+
+    static uint8_t                storage[256];
+    tCmnRing                      ring;
+    std::vector<uint8_t>          wire;
+    std::atomic<const uint8_t*>   dma_ptr{NULL};
+    std::atomic<size_t>           dma_len{0};
+    std::atomic<bool>             stop{false};
+    std::vector<double>           cost[kProducer];
+
+    cmn_ring_init( &ring, storage, sizeof(storage));
+
+    std::thread dma([&](){
+      while( !stop.load() || dma_len.load()!=0 ){
+        size_t len = dma_len.load();
+        if( len==0 ){
+          std::this_thread::yield();
+          continue;
+        }
+        const uint8_t *ptr = dma_ptr.load();
+        dma_len.store(0);
+        while( len ){
+          wire.insert( wire.end(), ptr, ptr+len);
+          len = cmn_ring_next( &ring, len, &ptr);
+        }
+      }
+    });
+
+    std::vector<std::thread> producers;
+    TestClock::init();
+    for(uint8_t p=0; p<kProducer; ++p){
+      producers.emplace_back([&,p](){
+        std::mt19937 rng(p);
+        cost[p].reserve(input);
+        for(uint32_t n=0; n<input; ++n){
+          uint8_t msg[40];
+          make_msg( msg, 4 + rng()%36, p, (uint16_t)n);
+
+          TestClock::tick_t t0 = TestClock::now();
+          size_t ret = cmn_ring_write( &ring, msg, msg[0]);
+          const uint8_t *ptr;
+          size_t         len = cmn_ring_claim( &ring, &ptr);
+          if( len ){
+            dma_ptr.store( ptr);
+            dma_len.store( len);
+          }
+          TestClock::tick_t t1 = TestClock::now();
+          cost[p].push_back( (double)(TestClock::tick_t)(t1-t0));
+
+          /* Leave the wire some time. Otherwise nearly everything is dropped. */
+          if( !ret ){
+            std::this_thread::yield();
+          }
+        }
+      });
+    }
+    for(auto &t : producers){
+      t.join();
+    }
+    stop.store(true);
+    dma.join();
+
+    uint32_t received[kProducer] = {0};
+    int32_t  last[kProducer]     = {-1, -1, -1, -1};
+    for(size_t idx=0; idx<wire.size(); idx+=wire[idx]){
+      const uint8_t *msg = &wire[idx];
+      if( msg[0]<4 || idx+msg[0]>wire.size() || msg[1]>=kProducer || !check_msg( msg) ){
+        this->_err_msg<<"Broken message at byte "<<idx<<endl;
+        return false;
+      }
+      int32_t seq = msg[2] | (msg[3]<<8);
+      if( seq <= last[msg[1]] ){
+        this->_err_msg<<"Producer "<<(int)msg[1]<<" sent "<<seq<<" after "<<last[msg[1]]<<endl;
+        return false;
+      }
+      last[msg[1]] = seq;
+      ++received[msg[1]];
+    }
+
+    uint32_t total = 0;
+    for(auto r : received){
+      total += r;
+    }
+    if( cmn_ring_pending( &ring)!=0 || total + cmn_ring_dropped( &ring) != kProducer*input ){
+      this->_err_msg<<"received="<<total<<" dropped="<<cmn_ring_dropped( &ring)<<" pending="<<cmn_ring_pending( &ring)<<endl;
+      return false;
+    }
+
+    std::vector<double> all;
+    for(auto &c : cost){
+      all.insert( all.end(), c.begin(), c.end());
+    }
+    const double worst = *std::max_element( all.begin(), all.end());
+    TestBench::print( "ring_write_kick_concurrent", tTestBenchConfig{ 0, (uint32_t)all.size(), 1}, TestBench::summarize( all), 0);
+    cout<<"\nworst,ring_write_kick_concurrent,"<<worst<<','<<TestClock::unit<<",dropped="<<cmn_ring_dropped( &ring)<<endl;
+    return true;
+  }
+};
+#endif
+
+
+/* ************************************************************************** */
+/*                              Receive Line Ring                             */
+/* ************************************************************************** */
+namespace paramsTestCmnLine{
+
+/**
+ * @note: Number of bursts
+ */
+typedef uint32_t Input;
+
+/**
+ * @note: No output
+ */
+typedef uint8_t Output;
+
+static constexpr uint32_t kRxSize = 64;
+static constexpr uint32_t kNum    = 4;
+static constexpr uint32_t kWidth  = 32;
+
+/**
+ * @brief Circular DMA into `rx_buf` with the interrupts of the receiver
+ * @note  `cmn_line_feed()` runs on the half transfer, the full transfer and the idle line after a burst.
+ */
+struct Dma{
+  uint8_t  rx_buf[kRxSize];
+  uint32_t pos = 0;
+  uint32_t isr = 0;
+
+  void write( tCmnLine &line, uint8_t c){
+    rx_buf[pos] = c;
+    pos = (pos+1) % kRxSize;
+    if( pos==kRxSize/2 || pos==0 ){
+      cmn_line_feed( &line, pos);
+      ++isr;
+    }
+  }
+  void idle( tCmnLine &line){
+    cmn_line_feed( &line, pos);
+    ++isr;
+  }
+};
+
+/**
+ * @brief Reference of the line cutting. Lines are dropped on the same conditions.
+ */
+struct Model{
+  std::deque<std::string> queue;
+  std::string             cur;
+  bool                    skip     = false;
+  uint32_t                overflow = 0;
+  uint32_t                dropped  = 0;
+  uint32_t                error    = 0;
+
+  void put( char c){
+    if( c=='\r' || c=='\n' ){
+      if( !skip && !cur.empty() ){
+        queue.push_back( cur);
+      }
+      skip = false;
+      cur.clear();
+    }else if( skip ){
+    }else if( cur.size()+1 >= kWidth ){
+      ++overflow;
+      skip = true;
+      cur.clear();
+    }else if( cur.empty() && queue.size() >= kNum ){
+      ++dropped;
+      skip = true;
+    }else{
+      cur.push_back( c);
+    }
+  }
+  void fail( void){
+    ++error;
+    skip = true;
+    cur.clear();
+  }
+};
+
+} /* Namespace paramsTestCmnLine */
+
+/**
+ * @brief Random bursts against the reference: lines split across bursts and across the buffer end,
+ *        `\r\n` pairs, lines too long for a slot, a slow consumer and receiver errors
+ * @note  The number of interrupts per received kilobyte is reported. It was one per byte before.
+ */
+class TestCmnLine : public TestUnitWrapper<paramsTestCmnLine::Input,paramsTestCmnLine::Output>{
+private:
+  bool pop( tCmnLine &line, paramsTestCmnLine::Model &model){
+    const char *front = cmn_line_front( &line);
+    if( model.queue.empty() ){
+      if( front ){
+        this->_err_msg<<"Unexpected line ["<<front<<"]"<<endl;
+        return false;
+      }
+      return true;
+    }
+    if( !front || model.queue.front()!=front ){
+      this->_err_msg<<"Got ["<<(front ? front : "NULL")<<"] expect ["<<model.queue.front()<<"]"<<endl;
+      return false;
+    }
+    cmn_line_pop( &line);
+    model.queue.pop_front();
+    return true;
+  }
+
+public:
+  TestCmnLine():TestUnitWrapper("test_cmn_line"){}
+
+  bool run( paramsTestCmnLine::Input& input, paramsTestCmnLine::Output& ref) override{
+    using namespace paramsTestCmnLine;
+    static const char kChar[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ 0123456789";
+
+    char     slot[kNum*kWidth];
+    tCmnLine line;
+    Dma      dma;
+    Model    model;
+    uint32_t bytes = 0;
+    uint32_t seed  = 0x1234567U;
+    auto     rand  = [&seed](uint32_t n){ seed = seed*1664525U + 1013904223U; return (seed>>8)%n; };
+
+    cmn_line_init( &line, dma.rx_buf, kRxSize, slot, kNum, kWidth);
+
+    for(uint32_t n=0; n<input; ++n){
+      std::string burst;
+      for(uint32_t k=rand(3)+1; k>0; --k){
+        const uint32_t len = rand(8)==0 ? kWidth + rand(kWidth) : rand(kWidth);
+        for(uint32_t i=0; i<len; ++i){
+          burst.push_back( kChar[rand(sizeof(kChar)-1)]);
+        }
+        static const char *kEnd[] = { "\n", "\r\n", "\r", "" };
+        burst += kEnd[rand(4)];
+      }
+      const uint32_t fail = rand(16)==0 ? rand(burst.size()+1) : UINT32_MAX;
+
+      for(uint32_t i=0; i<burst.size(); ++i){
+        if( i==fail ){
+          /* The interrupt cuts what was received so far, then drops the line */
+          dma.idle( line);
+          cmn_line_error( &line);
+          model.fail();
+        }
+        dma.write( line, (uint8_t)burst[i]);
+        model.put( burst[i]);
+      }
+      dma.idle( line);
+      bytes += burst.size();
+
+      for(uint32_t k=rand(4); k>0; --k){
+        if( !pop( line, model) ){
+          return false;
+        }
+      }
+      if( cmn_line_pending( &line)!=model.queue.size() ){
+        this->_err_msg<<"pending="<<cmn_line_pending( &line)<<" expect="<<model.queue.size()<<" after burst "<<n<<endl;
+        return false;
+      }
+    }
+
+    while( !model.queue.empty() ){
+      if( !pop( line, model) ){
+        return false;
+      }
+    }
+    if( cmn_line_front( &line)!=NULL || line.overflow!=model.overflow || line.dropped!=model.dropped || line.error!=model.error ){
+      this->_err_msg<<"overflow="<<line.overflow<<'/'<<model.overflow<<" dropped="<<line.dropped<<'/'<<model.dropped<<" error="<<line.error<<'/'<<model.error<<endl;
+      return false;
+    }
+    if( model.overflow==0 || model.dropped==0 || model.error==0 ){
+      this->_err_msg<<"Every drop MUST be exercised"<<endl;
+      return false;
+    }
+    cout<<"uart_rx,isr_per_kb,"<<(uint32_t)((uint64_t)dma.isr*1024U/bytes)<<",bytes="<<bytes<<endl;
+    return true;
+  }
+};
+
+#if (defined SYS_TARGET_NATIVE)
+/**
+ * @brief The receive interrupt and the command box task on two threads
+ * @note  Every line MUST arrive whole and in order, or be counted as dropped.
+ */
+class TestCmnLineConcurrent : public TestUnitWrapper<paramsTestCmnLine::Input,paramsTestCmnLine::Output>{
+public:
+  TestCmnLineConcurrent():TestUnitWrapper("test_cmn_line_concurrent"){}
+
+  bool run( paramsTestCmnLine::Input& input, paramsTestCmnLine::Output& ref) override{
+    using namespace paramsTestCmnLine;
+    static char       slot[kNum*kWidth];
+    static Dma        dma;
+    tCmnLine          line;
+    std::atomic<bool> stop{false};
+    uint32_t          received = 0;
+    int64_t           last     = -1;
+    bool              result   = true;
+
+    cmn_line_init( &line, dma.rx_buf, kRxSize, slot, kNum, kWidth);
+
+    std::thread task([&](){
+      for(;;){
+        const bool  done  = stop.load();
+        const char *front = cmn_line_front( &line);
+        if( !front ){
+          if( done ){
+            break;
+          }
+          std::this_thread::yield();
+          continue;
+        }
+        char    expect[kWidth];
+        int64_t seq = atoll( &front[4]);
+        snprintf( expect, sizeof(expect), "LINE%u %u", (unsigned)seq, (unsigned)(seq*7919U));
+        if( seq<=last || strcmp( front, expect)!=0 ){
+          this->_err_msg<<"Got ["<<front<<"] after "<<last<<endl;
+          result = false;
+          break;
+        }
+        last = seq;
+        ++received;
+        cmn_line_pop( &line);
+      }
+    });
+
+    for(uint32_t n=0; n<input; ++n){
+      char msg[kWidth];
+      const int len = snprintf( msg, sizeof(msg), "LINE%u %u\r\n", (unsigned)n, (unsigned)(n*7919U));
+      for(int i=0; i<len; ++i){
+        dma.write( line, (uint8_t)msg[i]);
+      }
+      if( (n&3)==3 ){
+        dma.idle( line);
+      }
+    }
+    dma.idle( line);
+    stop.store(true);
+    task.join();
+
+    if( result && received + line.dropped != input ){
+      this->_err_msg<<"received="<<received<<" dropped="<<line.dropped<<endl;
+      return false;
+    }
+    return result;
+  }
+};
+#endif
+
+
+/* ************************************************************************** */
+/*                              COBS Frame                                    */
+/* ************************************************************************** */
+namespace paramsTestCmnFrame{
+
+/**
+ * @note: Number of random frames
+ */
+typedef uint32_t Input;
+
+/**
+ * @note: No output
+ */
+typedef uint8_t Output;
+
+/**
+ * @note `PING` with "\0\x11\0Metope\r\n". Same as `FRAME_GOLDEN` in `tool/uart.py`.
+ */
+static const uint8_t kGoldenPayload[] = { 0x00, 0x11, 0x00, 'M', 'e', 't', 'o', 'p', 'e', '\r', '\n' };
+static const uint8_t kGoldenWire[]    = { 0x00, 0x02, 0x01, 0x02, 0x11, 0x0B, 'M', 'e', 't', 'o', 'p', 'e', '\r', '\n', 0xB6, 0xCC, 0x00 };
+
+} /* Namespace paramsTestCmnFrame */
+
+/**
+ * @brief CRC check value, the golden frame shared with `tool/uart.py`, random frames full of zeros
+ *        and line ends through a round trip and single bit errors, then frames and text lines cut
+ *        apart by the receive line ring
+ */
+class TestCmnFrame : public TestUnitWrapper<paramsTestCmnFrame::Input,paramsTestCmnFrame::Output>{
+public:
+  TestCmnFrame():TestUnitWrapper("test_cmn_frame"){}
+
+  bool run( paramsTestCmnFrame::Input& input, paramsTestCmnFrame::Output& ref) override{
+    using namespace paramsTestCmnFrame;
+    static uint8_t wire[CMN_FRAME_WIRE_SIZE(300)];
+    static uint8_t copy[CMN_FRAME_WIRE_SIZE(300)];
+    uint8_t        payload[300];
+    uint8_t        type;
+    const uint8_t *p_payload;
+    size_t         payload_len;
+
+    if( cmn_frame_crc16( (const uint8_t *)"123456789", 9, CMN_FRAME_CRC16_INIT)!=0x29B1 ){
+      this->_err_msg<<"CRC-16/CCITT-FALSE check value mismatch"<<endl;
+      return false;
+    }
+    size_t n = cmn_frame_encode( 0x01, kGoldenPayload, sizeof(kGoldenPayload), wire);
+    if( n!=sizeof(kGoldenWire) || memcmp( wire, kGoldenWire, n)!=0 ){
+      this->_err_msg<<"The golden frame does NOT match `tool/uart.py`"<<endl;
+      return false;
+    }
+
+    uint32_t seed       = 0x600DF00DU;
+    auto     rand       = [&seed](uint32_t n){ seed = seed*1664525U + 1013904223U; return (seed>>8)%n; };
+    uint32_t undetected = 0;
+    for(uint32_t k=0; k<input; ++k){
+      static const uint8_t kByte[] = { 0x00, 0x00, '\r', '\n', 0xA5, 0xFF };
+      const size_t len = rand(sizeof(payload)+1);
+      for(size_t i=0; i<len; ++i){
+        payload[i] = rand(2) ? kByte[rand(sizeof(kByte))] : (uint8_t)rand(256);
+      }
+      n = cmn_frame_encode( (uint8_t)k, payload, len, wire);
+      if( n>CMN_FRAME_WIRE_SIZE(len) || wire[0]!=0 || wire[n-1]!=0 || memchr( &wire[1], 0, n-2)!=NULL ){
+        this->_err_msg<<"Frame "<<k<<" of "<<len<<" bytes is NOT delimited by its only two zeros"<<endl;
+        return false;
+      }
+      memcpy( copy, wire, n);
+      if( cmn_frame_decode( &wire[1], n-2, &type, &p_payload, &payload_len)!=kCmnFrame_OK
+       || type!=(uint8_t)k || payload_len!=len || memcmp( p_payload, payload, len)!=0 ){
+        this->_err_msg<<"Frame "<<k<<" of "<<len<<" bytes does NOT survive the round trip"<<endl;
+        return false;
+      }
+      copy[1+rand(n-2)] ^= (uint8_t)(1U << rand(8));
+      undetected += (cmn_frame_decode( &copy[1], n-2, &type, &p_payload, &payload_len)==kCmnFrame_OK);
+    }
+    if( undetected!=0 ){
+      this->_err_msg<<undetected<<" single bit errors passed the check"<<endl;
+      return false;
+    }
+
+    /* Frames take slots like lines. `\r` and `\n` inside a frame are data. */
+    using paramsTestCmnLine::kRxSize;
+    using paramsTestCmnLine::kNum;
+    using paramsTestCmnLine::kWidth;
+    char                   slot[kNum*kWidth];
+    tCmnLine               line;
+    paramsTestCmnLine::Dma dma;
+    cmn_line_init( &line, dma.rx_buf, kRxSize, slot, kNum, kWidth);
+
+    std::vector<std::string> piece;
+    piece.push_back( "GT\r\n");
+    n = cmn_frame_encode( 0x01, "\r\n\r\n", 4, wire);
+    piece.push_back( std::string( (const char *)wire, n));
+    piece.push_back( "TOP");                      /* Ended by the next frame */
+    n = cmn_frame_encode( 0x02, kGoldenPayload, sizeof(kGoldenPayload), wire);
+    piece.push_back( std::string( (const char *)wire, n));
+    piece.push_back( std::string( 2, '\0'));      /* Empty frame */
+    piece.push_back( "\nMEM\n");
+
+    auto cut = [&]( const std::vector<std::string> &piece){
+      std::vector<std::string> got;
+      for( const std::string &burst : piece){
+        for( char c : burst){
+          dma.write( line, (uint8_t)c);
+        }
+        dma.idle( line);
+        for( const char *front; NULL!=(front = cmn_line_front( &line)); cmn_line_pop( &line)){
+          uint8_t     *body;
+          const size_t len = cmn_line_frame( &line, &body);
+          if( len==0 ){
+            got.push_back( front);
+          }else if( cmn_frame_decode( body, len, &type, &p_payload, &payload_len)==kCmnFrame_OK ){
+            got.push_back( std::string( 1, (char)type) + std::string( (const char *)p_payload, payload_len));
+          }else{
+            got.push_back( "?");
+          }
+        }
+      }
+      return got;
+    };
+    std::vector<std::string> got = cut( piece);
+
+    const std::vector<std::string> expect = {
+      "GT",
+      std::string( "\x01\r\n\r\n"),
+      "TOP",
+      std::string( "\x02") + std::string( (const char *)kGoldenPayload, sizeof(kGoldenPayload)),
+      "MEM"
+    };
+    if( got!=expect || line.overflow || line.dropped ){
+      this->_err_msg<<"Got "<<got.size()<<" units from the mixed stream, expect "<<expect.size()<<endl;
+      return false;
+    }
+
+    /* One lost delimiter costs at most the frame it belonged to. The bodies hold no line end. */
+    for( uint32_t lost=0; lost<2; ++lost){
+      static const uint8_t kPing[] = { 0x00, 'P', 'I', 'N', 'G', 0x00};
+      std::string frame[2];
+      for( uint32_t i=0; i<2; ++i){
+        n = cmn_frame_encode( (uint8_t)(0x10+i), kPing, sizeof(kPing)-i, wire);
+        frame[i] = std::string( (const char *)wire, n);
+      }
+      frame[0].erase( lost ? frame[0].size()-1 : 0, 1);
+
+      piece = { "GT\n", frame[0], frame[1], "MEM\n"};
+      got   = cut( piece);
+      if( got.size()<2 || got[got.size()-2]!=std::string( "\x11") + std::string( (const char *)kPing, sizeof(kPing)-1) || got.back()!="MEM" ){
+        this->_err_msg<<"The frame and the line after a lost "<<(lost ? "closing" : "opening")<<" delimiter do NOT go through"<<endl;
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+
+/* ************************************************************************** */
+/*                         Sensor FIFO Burst Reads                            */
+/* ************************************************************************** */
+#if (defined SYS_TARGET_NATIVE)
+namespace paramsTestCmnBurst{
+
+/**
+ * @note: Seconds of sensor data
+ */
+typedef uint32_t Input;
+
+/**
+ * @note: No output
+ */
+typedef uint8_t Output;
+
+/**
+ * @note QMI8658 registers and the FIFO setup of `bsp_qmi8658_fifo_enable()`
+ */
+enum{
+  kRegCtrl9       = 0x0A,
+  kRegFifoCtrl    = 0x14,
+  kRegFifoData    = 0x17,
+  kCmdAck         = 0x00,
+  kCmdReqFifo     = 0x05,
+  kFifoCtrlStream = 0x0E
+};
+static const uint64_t kSampleNs   = 500000;        /*!< 2KHz */
+static const uint32_t kDepth      = 128;
+static const uint32_t kWtm        = 64;
+static const uint32_t kSampleSize = 12;
+static const uint64_t kI2cHz      = 350000;        /*!< `hi2c1` of STM32F411CEU6 */
+static const uint64_t kCmdDoneNs  = 50000;         /*!< Ctrl9 command to INT1. Assumed. */
+static const uint64_t kWakeNs     = 1000000;       /*!< Consumer task wakes up. Assumed. */
+static const uint64_t kTimeoutNs  = 20000000;      /*!< Consumer polls `bsp_qmi8658_fifo_front()` without a burst */
+static const uint64_t kNever      = UINT64_MAX;
+
+/**
+ * @note Interrupts taken per transfer by the HAL: start, address, register, data or the repeated
+ *       start and address, byte transfer finished. A DMA read adds the transfer complete.
+ */
+static const uint32_t kIrqWrite   = 5;
+static const uint32_t kIrqRead    = 7;
+
+/**
+ * @note Same sequence as `bsp_qmi8658_fifo_step` in `bsp_gyro.c`
+ */
+static const tCmnBurstStep kStep[] = {
+  { kCmnBurst_Write, kRegCtrl9,    kCmdReqFifo     },
+  { kCmnBurst_Wait,  0,            0               },
+  { kCmnBurst_Write, kRegCtrl9,    kCmdAck         },
+  { kCmnBurst_Read,  kRegFifoData, 0               },
+  { kCmnBurst_Write, kRegFifoCtrl, kFifoCtrlStream },
+  { kCmnBurst_End,   0,            0               }
+};
+
+/**
+ * @brief Nanoseconds on the bus: start, address, register, the repeated start and address of a read, data, stop
+ */
+static uint64_t bus_ns( bool read, size_t len){
+  const uint64_t bits = 2 + 9*(2 + (read ? 1 : 0) + len) + (read ? 1 : 0);
+  return bits * 1000000000ULL / kI2cHz;
+}
+
+/**
+ * @brief Sample `k` on the wire: its number, then bytes derived from it
+ */
+static void sample_encode( uint32_t k, uint8_t *raw){
+  uint32_t h = k * 2654435761U;
+  memcpy( raw, &k, 4);
+  for(uint32_t i=4; i<kSampleSize; ++i){
+    h ^= h >> 13;
+    h *= 0x5BD1E995U;
+    raw[i] = (uint8_t)(h >> 24);
+  }
+}
+
+/**
+ * @brief QMI8658 with a FIFO in stream mode behind an I2C bus of one transfer at a time
+ */
+struct Model{
+  tCmnBurst            burst;
+  uint8_t              buf[2*kWtm*kSampleSize];
+  std::deque<uint32_t> fifo;
+  bool                 rd_mode     = false;
+  bool                 int2        = false;
+  uint32_t             overwritten = 0;   /*!< Pushed out of the full FIFO */
+  uint32_t             aborted     = 0;   /*!< Popped by a failed read */
+  uint32_t             underrun    = 0;   /*!< Read from an empty FIFO */
+  uint32_t             rogue       = 0;   /*!< Transfers out of order */
+
+  uint64_t             now         = 0;
+  uint64_t             cmd_done    = kNever;
+  uint64_t             bus_end     = kNever;
+  uint8_t              bus_op      = 0;
+  uint8_t              bus_reg     = 0;
+  uint8_t              bus_val     = 0;
+  bool                 bus_fail    = false;
+  uint32_t             transfers   = 0;
+  uint32_t             fail_every  = 0;
+  uint32_t             starts      = 0;
+  uint32_t             start_fail  = 0;
+  uint32_t             refused     = 0;   /*!< Transfers that failed to start */
+  uint64_t             bus_busy    = 0;
+
+  uint32_t             irq         = 0;   /*!< Interrupts taken by the CPU */
+  double               isr_s       = 0;   /*!< Host time inside the producer calls */
+
+  bool level( void) const{
+    return fifo.size() >= kWtm;
+  }
+
+  /**
+   * @brief Same as `bsp_qmi8658_int2_isr()` behind a rising edge
+   */
+  void edge( void){
+    const bool rise = level() && !int2;
+    int2 = level();
+    if( rise ){
+      irq += 1;
+      auto start = std::chrono::steady_clock::now();
+      cmn_burst_trigger( &burst);
+      isr_s += std::chrono::duration<double>( std::chrono::steady_clock::now() - start).count();
+    }
+  }
+};
+
+static int bus( void *param, uint8_t op, uint8_t reg, uint8_t *buf, size_t len){
+  Model *m = (Model *)param;
+  if( m->bus_end!=kNever ){
+    m->rogue += 1;
+    return -1;
+  }
+  m->starts += 1;
+  if( m->start_fail && (m->starts % m->start_fail)==0 ){
+    /* e.g. `HAL_BUSY`. No interrupt follows. */
+    m->refused += 1;
+    return -1;
+  }
+  m->transfers += 1;
+  m->bus_fail = m->fail_every && (m->transfers % m->fail_every)==0;
+  m->bus_op   = op;
+  m->bus_reg  = reg;
+  m->bus_val  = buf[0];
+  m->bus_end  = m->now + bus_ns( op==kCmnBurst_Read, len);
+  m->bus_busy+= m->bus_end - m->now;
+
+  if( op==kCmnBurst_Read ){
+    if( reg!=kRegFifoData || !m->rd_mode || len!=kWtm*kSampleSize ){
+      m->rogue += 1;
+    }
+    for(size_t i=0; i<len/kSampleSize; ++i){
+      if( m->fifo.empty() ){
+        m->underrun += 1;
+        memset( &buf[i*kSampleSize], 0xFF, kSampleSize);
+        continue;
+      }
+      if( m->bus_fail ){
+        m->aborted += 1;
+      }else{
+        sample_encode( m->fifo.front(), &buf[i*kSampleSize]);
+      }
+      m->fifo.pop_front();
+    }
+    m->int2 = m->level();
+  }
+  return 0;
+}
+
+} /* Namespace paramsTestCmnBurst */
+
+/**
+ * @brief The QMI8658 FIFO drain of `bsp_gyro.c` against a model of the sensor and the I2C bus
+ * @note  Samples at 2KHz fill a FIFO of 128 in stream mode. The watermark of 64 rises INT2, the
+ *        Ctrl9 command done rises INT1, and every transfer ends some time later as on a 350KHz bus.
+ *        One second runs clean, one with transfers failing or failing to start, one with a consumer
+ *        too slow for the double buffer, then clean again. The consumer polls like the callers of
+ *        `bsp_qmi8658_fifo_front()`, which restarts a transfer that failed to start. Every sample MUST come once, in order and intact, or be
+ *        accounted as lost, and none is lost in the clean seconds. Then the CPU per second of data against polling `bsp_qmi8658_update()`.
+ */
+class TestCmnBurst : public TestUnitWrapper<paramsTestCmnBurst::Input,paramsTestCmnBurst::Output>{
+public:
+  TestCmnBurst():TestUnitWrapper("test_cmn_burst"){}
+
+  bool run( paramsTestCmnBurst::Input& input, paramsTestCmnBurst::Output& ref) override{
+    using namespace paramsTestCmnBurst;
+    static Model m;
+    m = Model();
+    cmn_burst_init( &m.burst, kStep, bus, &m, m.buf, kWtm*kSampleSize);
+
+    const uint64_t end       = (uint64_t)input * 1000000000ULL;
+    uint64_t       sample_at = 0;
+    uint32_t       produced  = 0;
+    uint64_t       wake_at   = kNever;
+    uint32_t       delivered = 0;
+    uint32_t       early     = 0;     /*!< Samples of the clean first second delivered */
+    uint32_t       recovered = 0;     /*!< Samples delivered from 4s on, once the faults are over */
+    const uint32_t kFrom     = 8000;
+    const uint32_t kTo       = (uint32_t)(end/kSampleNs) - 500;
+    uint32_t       corrupted = 0;
+    uint32_t       order     = 0;
+    int64_t        last      = -1;
+    uint32_t       bursts    = 0;
+    double         task_s    = 0;
+
+    for(;;){
+      const uint64_t sample = sample_at < end ? sample_at : kNever;
+      const uint64_t t      = std::min( std::min( sample, m.cmd_done), std::min( m.bus_end, wake_at));
+      if( t==kNever ){
+        break;
+      }
+      m.now          = t;
+      m.fail_every   = (t >= 1000000000ULL && t < 2000000000ULL) ? 37 : 0;
+      m.start_fail   = (t >= 1000000000ULL && t < 2000000000ULL) ? 23 : 0;
+      const uint64_t wake_ns = (t >= 2000000000ULL && t < 3000000000ULL) ? 100000000ULL : kWakeNs;
+
+      if( t==m.bus_end ){
+        /* Same as `bsp_qmi8658_i2c_isr()` */
+        m.bus_end = kNever;
+        if( !m.bus_fail && m.bus_op==kCmnBurst_Write ){
+          if( m.bus_reg==kRegCtrl9 && m.bus_val==kCmdReqFifo ){
+            m.cmd_done = t + kCmdDoneNs;
+          }else if( m.bus_reg==kRegFifoCtrl ){
+            m.rd_mode = false;
+          }
+        }
+        m.irq += (m.bus_op==kCmnBurst_Read) ? kIrqRead : kIrqWrite;
+        const uint32_t head  = m.burst.head;
+        auto           start = std::chrono::steady_clock::now();
+        cmn_burst_done( &m.burst, m.bus_fail ? ERROR : SUCCESS);
+        if( !m.burst.busy && m.level() ){
+          cmn_burst_trigger( &m.burst);
+        }
+        m.isr_s += std::chrono::duration<double>( std::chrono::steady_clock::now() - start).count();
+        if( m.burst.head!=head ){
+          wake_at = std::min( wake_at, t + wake_ns);
+        }
+      }else if( t==m.cmd_done ){
+        /* Same as `bsp_qmi8658_int1_isr()` */
+        m.cmd_done = kNever;
+        m.rd_mode  = true;
+        m.irq     += 1;
+        auto start = std::chrono::steady_clock::now();
+        cmn_burst_irq( &m.burst);
+        m.isr_s   += std::chrono::duration<double>( std::chrono::steady_clock::now() - start).count();
+      }else if( t==sample ){
+        if( m.fifo.size()==kDepth ){
+          m.fifo.pop_front();
+          m.overwritten += 1;
+        }
+        m.fifo.push_back( produced++);
+        sample_at += kSampleNs;
+        m.edge();
+      }else{
+        /* Consumer task. Same as `bsp_qmi8658_fifo_front()` then `bsp_qmi8658_fifo_pop()`. */
+        wake_at    = (t < end) ? t + std::max( kTimeoutNs, wake_ns) : kNever;
+        auto start = std::chrono::steady_clock::now();
+        if( NULL==cmn_burst_front( &m.burst) ){
+          cmn_burst_retry( &m.burst);
+        }
+        const uint8_t *p;
+        while( NULL!=(p = cmn_burst_front( &m.burst)) ){
+          for(uint32_t i=0; i<kWtm; ++i){
+            uint8_t  raw[kSampleSize];
+            uint32_t k;
+            memcpy( &k, &p[i*kSampleSize], 4);
+            sample_encode( k, raw);
+            corrupted += 0!=memcmp( raw, &p[i*kSampleSize], kSampleSize);
+            order     += (int64_t)k <= last;
+            last       = k;
+            delivered += 1;
+            early     += k < 1500;
+            recovered += k >= kFrom && k < kTo;
+          }
+          bursts += 1;
+          cmn_burst_pop( &m.burst);
+        }
+        task_s += std::chrono::duration<double>( std::chrono::steady_clock::now() - start).count();
+        m.edge();
+      }
+    }
+
+    if( m.rogue || m.underrun || corrupted || order || m.burst.busy ){
+      this->_err_msg<<"Rogue transfers "<<m.rogue<<", underruns "<<m.underrun<<", corrupted "<<corrupted<<", out of order "<<order<<endl;
+      return false;
+    }
+    if( produced != delivered + m.overwritten + m.aborted + m.fifo.size() ){
+      this->_err_msg<<"Produced "<<produced<<" samples, delivered "<<delivered<<", overwritten "<<m.overwritten
+                    <<", aborted "<<m.aborted<<", left "<<m.fifo.size()<<endl;
+      return false;
+    }
+    if( early!=1500 || recovered!=kTo-kFrom || m.burst.error==0 || m.refused==0 || m.burst.stall==0 ){
+      this->_err_msg<<"Clean seconds delivered "<<early<<"/1500 and "<<recovered<<"/"<<kTo-kFrom
+                    <<", errors "<<m.burst.error<<", refused "<<m.refused<<", stalls "<<m.burst.stall<<endl;
+      return false;
+    }
+
+    /* `bsp_qmi8658_update()` spins on STATUS0, CTRL2, CTRL3 and 14 bytes of data per sample */
+    const uint64_t  poll_ns = 3*bus_ns( true, 1) + bus_ns( true, 14);
+    std::set<uint64_t> polled;
+    for( uint64_t t=0; t<1000000000ULL; t+=poll_ns){
+      polled.insert( (t + 3*bus_ns( true, 1)) / kSampleNs);
+    }
+
+    const double sec = (double)input;
+    cout<<"qmi8658,fifo,samples_per_s,"<<(uint32_t)(delivered/sec)<<",irq_per_s,"<<(uint32_t)(m.irq/sec)
+        <<",bus_ms_per_s,"<<(uint32_t)(m.bus_busy/sec/1e6)<<",cpu_us_per_s,"<<(uint32_t)((m.isr_s+task_s)/sec*1e6)
+        <<",bursts,"<<bursts<<",stalls,"<<m.burst.stall<<",errors,"<<m.burst.error<<",refused,"<<m.refused<<endl;
+    cout<<"qmi8658,poll,samples_per_s,"<<polled.size()<<",cpu_ms_per_s,1000,cpu_ms_for_all,"
+        <<(uint32_t)(poll_ns*(1000000000ULL/kSampleNs)/1000000ULL)<<endl;
+    return true;
+  }
+};
+#endif
+
+
+/* ************************************************************************** */
+/*                             Command Box Tokenizer                          */
+/* ************************************************************************** */
+namespace paramsTestCmdbox{
+
+/**
+ * @note: Number of random lines
+ */
+typedef uint32_t Input;
+
+/**
+ * @note: No output
+ */
+typedef uint8_t Output;
+
+struct Command{
+  std::string keyword;
+  size_t      nargs;
+};
+
+#define TB_CMDBOX_COMMAND( KEYWORD, NARGS)   { #KEYWORD, NARGS },
+static const std::vector<Command> kCommand = { APP_CMDBOX_LIST( TB_CMDBOX_COMMAND) };
+#undef TB_CMDBOX_COMMAND
+
+/**
+ * @brief Reference of the tokenizer
+ * @return Index into `kCommand`. `-1` when it is unknown.
+ */
+static int tokenize( const std::string &line, std::vector<arg_t> &args){
+  size_t      end = line.find_first_of( std::string(" ;\r\n\0", 5));
+  std::string key = line.substr( 0, end);
+  for( auto &c : key ){
+    c = (char)toupper( (unsigned char)c);
+  }
+  int found = -1;
+  for( size_t k=0; k<kCommand.size(); ++k){
+    if( kCommand[k].keyword==key ){
+      found = (int)k;
+    }
+  }
+  if( found<0 ){
+    return found;
+  }
+  size_t pos = key.size();
+  args.assign( kCommand[found].nargs, 0);
+  for( auto &arg : args){
+    while( pos<line.size() && line[pos]==' ' ){
+      ++pos;
+    }
+    uint32_t value = 0;
+    while( pos<line.size() && isdigit( (unsigned char)line[pos]) ){
+      value = value*10U + (uint32_t)(line[pos++]-'0');
+    }
+    arg = (arg_t)value;
+  }
+  return found;
+}
+
+/**
+ * @brief The dispatch before the perfect hash: upper case copy, bucket of the first letter, `strstr()`
+ *        against every keyword of the bucket, `atoi()` over the digits
+ * @note  Longer keywords go first in a bucket, as prefixes would shadow them.
+ */
+struct Legacy{
+  std::vector<const Command *> bucket[26];
+
+  Legacy( void){
+    for( const auto &cmd : kCommand){
+      bucket[cmd.keyword[0]-'A'].push_back( &cmd);
+    }
+    for( auto &b : bucket){
+      std::stable_sort( b.begin(), b.end(), []( const Command *x, const Command *y){ return x->keyword.size() > y->keyword.size(); });
+    }
+  }
+
+  const Command *tokenize( const char *line, arg_t *args) const{
+    char copy[MAX_CMD_STRING_LEN];
+    strncpy( copy, line, sizeof(copy)-1);
+    copy[sizeof(copy)-1] = '\0';
+    for( char *p=copy; *p; ++p){
+      *p = (*p=='\r' || *p=='\n') ? '\0' : (char)toupper( (unsigned char)*p);
+    }
+    if( !isalpha( (unsigned char)copy[0]) ){
+      return nullptr;
+    }
+    for( const Command *cmd : bucket[copy[0]-'A']){
+      if( strstr( copy, cmd->keyword.c_str())==copy ){
+        size_t cursor = cmd->keyword.size();
+        for( size_t i=0; i<cmd->nargs; ++i){
+          while( copy[cursor]==' ' ){
+            ++cursor;
+          }
+          size_t start = cursor;
+          while( isdigit( (unsigned char)copy[cursor]) ){
+            ++cursor;
+          }
+          char tmp = copy[cursor];
+          copy[cursor] = '\0';
+          args[i] = atoi( &copy[start]);
+          copy[cursor] = tmp;
+        }
+        return cmd;
+      }
+    }
+    return nullptr;
+  }
+};
+
+/**
+ * @note Lines of a typical session
+ */
+static const char *kLine[] = {
+  "ST 2025 10 18 21 30 5\r\n",
+  "dispbr 80\r\n",
+  "LOG 3 4\n",
+  "LOGLS\r\n",
+  "TOP\r\n",
+  "PROFRST\n",
+  "CW 12\r\n",
+  "MEM\r\n",
+};
+
+} /* Namespace paramsTestCmdbox */
+
+/**
+ * @brief Every keyword resolves to itself in any case. Prefixes and extensions of a keyword are unknown.
+ *        Then random lines, mostly near misses of the keywords, against the reference tokenizer.
+ */
+class TestCmdboxTokenize : public TestUnitWrapper<paramsTestCmdbox::Input,paramsTestCmdbox::Output>{
+private:
+  bool check( const std::string &line){
+    using namespace paramsTestCmdbox;
+    std::vector<arg_t>                expect;
+    const int                         found = paramsTestCmdbox::tokenize( line, expect);
+    const tAppCmdboxDatabaseListUnit *p_cmd = NULL;
+    arg_t                             args[MAX_NUN_ARGS_SUPPORTED] = {0};
+
+    app_cmdbox_tokenize( line.c_str(), &p_cmd, args);
+    if( found<0 ){
+      if( p_cmd ){
+        this->_err_msg<<"["<<line<<"] matched "<<p_cmd->keyword<<" but it is unknown"<<endl;
+        return false;
+      }
+      return true;
+    }
+    if( !p_cmd || kCommand[found].keyword!=p_cmd->keyword || p_cmd->nargs!=kCommand[found].nargs ){
+      this->_err_msg<<"["<<line<<"] matched "<<(p_cmd ? p_cmd->keyword : "NULL")<<" expect "<<kCommand[found].keyword<<endl;
+      return false;
+    }
+    for( size_t i=0; i<expect.size(); ++i){
+      if( args[i]!=expect[i] ){
+        this->_err_msg<<"["<<line<<"] arg["<<i<<"]="<<args[i]<<" expect "<<expect[i]<<endl;
+        return false;
+      }
+    }
+    return true;
+  }
+
+public:
+  TestCmdboxTokenize():TestUnitWrapper("test_cmdbox_tokenize"){}
+
+  bool run( paramsTestCmdbox::Input& input, paramsTestCmdbox::Output& ref) override{
+    using namespace paramsTestCmdbox;
+    static const char kChar[] = "ABCDEFGHIJKLMNOPRSTWlogst0123456789 -";
+
+    for( const auto &cmd : kCommand){
+      std::string lower = cmd.keyword;
+      for( auto &c : lower){
+        c = (char)tolower( (unsigned char)c);
+      }
+      const tAppCmdboxDatabaseListUnit *p_cmd = NULL;
+      arg_t                             args[MAX_NUN_ARGS_SUPPORTED];
+      for( const std::string &line : { cmd.keyword, lower+"\r\n", cmd.keyword+" 1 2 3 4 5 6" }){
+        app_cmdbox_tokenize( line.c_str(), &p_cmd, args);
+        if( !p_cmd || cmd.keyword!=p_cmd->keyword ){
+          this->_err_msg<<"["<<line<<"] MUST match "<<cmd.keyword<<endl;
+          return false;
+        }
+      }
+      for( const std::string &line : { cmd.keyword.substr( 0, cmd.keyword.size()-1), cmd.keyword+"X", cmd.keyword+"0 1" }){
+        if( !check( line) ){
+          return false;
+        }
+      }
+    }
+
+    uint32_t seed = 0x2468ACEU;
+    auto     rand = [&seed](uint32_t n){ seed = seed*1664525U + 1013904223U; return (seed>>8)%n; };
+    for( uint32_t n=0; n<input; ++n){
+      std::string line;
+      switch( rand(4)){
+        case 0:
+          for( uint32_t i=rand(10); i>0; --i){
+            line.push_back( kChar[rand(sizeof(kChar)-1)]);
+          }
+          break;
+        case 1:
+          line = kCommand[rand(kCommand.size())].keyword;
+          line.erase( rand(line.size()+1));
+          line.push_back( kChar[rand(sizeof(kChar)-1)]);
+          break;
+        default:
+          line = kCommand[rand(kCommand.size())].keyword;
+          for( auto &c : line){
+            c = rand(2) ? (char)tolower( (unsigned char)c) : c;
+          }
+          break;
+      }
+      for( uint32_t k=rand(8); k>0; --k){
+        line.append( rand(3)+1, ' ');
+        for( uint32_t i=rand(11); i>0; --i){
+          line.push_back( rand(16) ? (char)('0'+rand(10)) : kChar[rand(sizeof(kChar)-1)]);
+        }
+      }
+      static const char *kEnd[] = { "\r\n", "\n", "\r", "" };
+      line += kEnd[rand(4)];
+      if( !check( line) ){
+        return false;
+      }
+    }
+
+    /* Parse and queue a batch without running it */
+    tAppCmdBox box = {};
+    box.quiet = 1;
+    app_cmdbox_parse( &box, "st 2025 10 18 21 30 5;BOGUS 1; ;gt\r\n");
+    const tAppCmdBoxPendingExe &exe = box.pending_exe[0];
+    if( box.head!=2 || box.seq!=3 || box.unknown!=1 || !exe.p_matched_cmd || strcmp( exe.p_matched_cmd->keyword, "ST")!=0 || exe.args[5]!=5 ){
+      this->_err_msg<<"The ring MUST hold ST with all 6 arguments, then GT. head="<<box.head<<" seq="<<box.seq<<endl;
+      return false;
+    }
+    if( strcmp( box.pending_exe[1].p_matched_cmd->keyword, "GT")!=0 || box.pending_exe[1].seq!=2 ){
+      this->_err_msg<<"GT MUST follow with the sequence number 2"<<endl;
+      return false;
+    }
+    return true;
+  }
+};
+
+
+#if (defined SYS_TARGET_NATIVE)
+/**
+ * @brief A host script pipelining commands through the receiver and the command box task
+ * @note  Bursts of up to `BSP_CFG_UART_RX_LINE_NUM` lines are received by the circular DMA, then the
+ *        task drains them like `app_cmdbox_main()`. Once with `;` batches, once with one command per line.
+ *        Native only. The callbacks drive the hardware on target.
+ */
+class TestCmdboxPipeline : public TestUnitWrapper<paramsTestCmdbox::Input,paramsTestCmdbox::Output>{
+private:
+  bool run_script( uint32_t input, bool batch){
+    static const char *kScript[] = { "GT", "CW 1", "CCW 2", "DISPBR 80", "DISPON", "ST 2025 10 18 21 30 5", "TOP" };
+
+    uint8_t    rx_buf[BSP_CFG_UART_RX_DMA_SIZE] = {};
+    char       slot[BSP_CFG_UART_RX_LINE_NUM*BSP_CFG_UART_RX_BUF_SIZE];
+    uint32_t   rx_pos = 0;
+    tCmnLine   line;
+    tAppCmdBox box    = {};
+    box.quiet = 1;
+    cmn_line_init( &line, rx_buf, sizeof(rx_buf), slot, BSP_CFG_UART_RX_LINE_NUM, BSP_CFG_UART_RX_BUF_SIZE);
+
+    uint32_t seed = 0x13579BDU;
+    auto     rand = [&seed](uint32_t n){ seed = seed*1664525U + 1013904223U; return (seed>>8)%n; };
+
+    /* The script is prepared first. Only the receiver and the task are timed. */
+    std::vector<std::vector<std::string>> bursts;
+    uint32_t sent = 0;
+    while( sent<input ){
+      std::vector<std::string> burst;
+      for(uint32_t k=rand(BSP_CFG_UART_RX_LINE_NUM)+1; k>0 && sent<input; --k){
+        std::string text = kScript[rand(sizeof(kScript)/sizeof(kScript[0]))];
+        ++sent;
+        while( batch && sent<input ){
+          const char *next = kScript[rand(sizeof(kScript)/sizeof(kScript[0]))];
+          if( text.size()+1+strlen(next)+1 >= BSP_CFG_UART_RX_BUF_SIZE ){
+            break;
+          }
+          text = text + ";" + next;
+          ++sent;
+        }
+        burst.push_back( text + "\r\n");
+      }
+      bursts.push_back( burst);
+    }
+
+    uint32_t executed = 0;
+    auto     start    = std::chrono::steady_clock::now();
+    for( const auto &burst : bursts){
+      for( const auto &text : burst){
+        for( char c : text){
+          rx_buf[rx_pos] = (uint8_t)c;
+          rx_pos = (rx_pos+1) % sizeof(rx_buf);
+          if( rx_pos==sizeof(rx_buf)/2 || rx_pos==0 ){
+            cmn_line_feed( &line, rx_pos);
+          }
+        }
+        cmn_line_feed( &line, rx_pos);
+      }
+      for( const char *cmd = cmn_line_front( &line); cmd != NULL; cmd = cmn_line_front( &line)){
+        app_cmdbox_parse( &box, cmd);
+        cmn_line_pop( &line);
+        executed += app_cmdbox_exe( &box, 0);
+      }
+    }
+    const double sec = std::chrono::duration<double>( std::chrono::steady_clock::now() - start).count();
+
+    if( executed!=input || box.seq!=input || box.tail!=input || box.busy!=0 || box.unknown!=0 ){
+      this->_err_msg<<"executed="<<executed<<" seq="<<box.seq<<" busy="<<box.busy<<" unknown="<<box.unknown<<" expect "<<input<<endl;
+      return false;
+    }
+    if( line.overflow || line.dropped || line.error ){
+      this->_err_msg<<"The receiver dropped lines: overflow="<<line.overflow<<" dropped="<<line.dropped<<endl;
+      return false;
+    }
+    cout<<"cmdbox,cmds_per_s,"<<(uint32_t)(input/sec)<<(batch ? ",batch" : ",single")<<",cmds_per_line="<<(double)input/sent_lines( bursts)<<endl;
+    return true;
+  }
+
+  static size_t sent_lines( const std::vector<std::vector<std::string>> &bursts){
+    size_t n = 0;
+    for( const auto &burst : bursts){
+      n += burst.size();
+    }
+    return n;
+  }
+
+public:
+  TestCmdboxPipeline():TestUnitWrapper("test_cmdbox_pipeline"){}
+
+  bool run( paramsTestCmdbox::Input& input, paramsTestCmdbox::Output& ref) override{
+    return run_script( input, true) && run_script( input, false);
+  }
+};
+
+namespace paramsTestCmdboxPty{
+
+/**
+ * @note Master side of the pseudo terminal. The device writes its replies here.
+ */
+static int g_master = -1;
+
+static void tx( const void *data, size_t len){
+  const char *p = (const char *)data;
+  while( len>0 ){
+    const ssize_t n = write( g_master, p, len);
+    if( n<=0 ){
+      return;
+    }
+    p   += n;
+    len -= n;
+  }
+}
+
+/**
+ * @brief Reply seen by the host. `frame` holds the type then the payload. Text lines have no line end.
+ */
+struct Reply{
+  bool        frame;
+  std::string data;
+};
+
+} /* Namespace paramsTestCmdboxPty */
+
+/**
+ * @brief Binary frames against text commands through a raw pseudo terminal, the same way `tool/uart.py`
+ *        talks to the board
+ * @note  The device thread reads the master side in chunks of half the DMA buffer into the circular
+ *        receive buffer, then drains it like `app_cmdbox_main()`. The host pipelines the requests from
+ *        one thread and demultiplexes the replies from another. Short requests would fill more slots
+ *        than one chunk can free, so the window is the number of slots.
+ *        First the echo of random payloads interleaved with text commands, then the clock set by
+ *        `TIME` frames against the clock set by `ST` lines. Native only.
+ */
+class TestCmdboxFramePty : public TestUnitWrapper<paramsTestCmdbox::Input,paramsTestCmdbox::Output>{
+private:
+  bool loopback( const std::vector<std::string> &request, std::vector<paramsTestCmdboxPty::Reply> &reply, double &sec, size_t &wire){
+    using namespace paramsTestCmdboxPty;
+
+    const int master = posix_openpt( O_RDWR | O_NOCTTY);
+    if( master<0 || grantpt( master)!=0 || unlockpt( master)!=0 ){
+      this->_err_msg<<"No pseudo terminal"<<endl;
+      return false;
+    }
+    const int slave = open( ptsname( master), O_RDWR | O_NOCTTY);
+    struct termios tio;
+    tcgetattr( slave, &tio);
+    cfmakeraw( &tio);
+    tcsetattr( slave, TCSANOW, &tio);
+    tcgetattr( master, &tio);
+    cfmakeraw( &tio);
+    tcsetattr( master, TCSANOW, &tio);
+    g_master = master;
+
+    uint8_t    rx_buf[BSP_CFG_UART_RX_DMA_SIZE] = {};
+    char       slot[BSP_CFG_UART_RX_LINE_NUM*BSP_CFG_UART_RX_BUF_SIZE];
+    uint32_t   rx_pos = 0;
+    tCmnLine   line;
+    tAppCmdBox box    = {};
+    box.tx = tx;
+    cmn_line_init( &line, rx_buf, sizeof(rx_buf), slot, BSP_CFG_UART_RX_LINE_NUM, BSP_CFG_UART_RX_BUF_SIZE);
+
+    std::atomic<bool> stop( false);
+    std::thread device( [&](){
+      while( !stop.load() ){
+        struct pollfd pfd = { master, POLLIN, 0 };
+        if( poll( &pfd, 1, 10)<=0 ){
+          continue;
+        }
+        const ssize_t n = read( master, &rx_buf[rx_pos], std::min<size_t>( sizeof(rx_buf)/2, sizeof(rx_buf)-rx_pos));
+        if( n<=0 ){
+          continue;
+        }
+        rx_pos = (rx_pos+n) % sizeof(rx_buf);
+        cmn_line_feed( &line, rx_pos);
+        for( const char *cmd = cmn_line_front( &line); cmd != NULL; cmd = cmn_line_front( &line)){
+          uint8_t     *body;
+          const size_t len = cmn_line_frame( &line, &body);
+          if( len!=0 ){
+            app_cmdbox_frame( &box, body, len);
+          }else{
+            app_cmdbox_parse( &box, cmd);
+          }
+          cmn_line_pop( &line);
+          app_cmdbox_exe( &box, 0);
+        }
+      }
+    });
+
+    /* No more requests in flight than the receiver has slots, like `--window` of `tool/uart.py` */
+    std::atomic<size_t> answered( 0);
+    auto start = std::chrono::steady_clock::now();
+    wire = 0;
+    std::thread host( [&](){
+      for( size_t k=0; k<request.size(); ++k){
+        while( k-answered.load()>=BSP_CFG_UART_RX_LINE_NUM ){
+          if( std::chrono::steady_clock::now()>start+std::chrono::seconds(10) ){
+            return;
+          }
+        }
+        const std::string &req = request[k];
+        const char *p   = req.data();
+        size_t      len = req.size();
+        while( len>0 ){
+          const ssize_t n = write( slave, p, len);
+          if( n<=0 ){
+            return;
+          }
+          p   += n;
+          len -= n;
+        }
+      }
+    });
+
+    /* Replies are cut apart the same way as `TraceDecoder` in `tool/uart.py` */
+    uint8_t     buf[256];
+    std::string unit;
+    bool        in_frame = false;
+    auto        deadline = start + std::chrono::seconds(10);
+    reply.clear();
+    while( reply.size()<request.size() && std::chrono::steady_clock::now()<deadline ){
+      struct pollfd pfd = { slave, POLLIN, 0 };
+      if( poll( &pfd, 1, 10)<=0 ){
+        continue;
+      }
+      const ssize_t n = read( slave, buf, sizeof(buf));
+      for( ssize_t i=0; i<n; ++i){
+        const uint8_t c = buf[i];
+        if( c==CMN_FRAME_DELIMITER ){
+          if( in_frame && !unit.empty() ){
+            uint8_t        type;
+            const uint8_t *payload;
+            size_t         payload_len;
+            if( cmn_frame_decode( (uint8_t *)&unit[0], unit.size(), &type, &payload, &payload_len)==kCmnFrame_OK ){
+              reply.push_back( { true, std::string( 1, (char)type) + std::string( (const char *)payload, payload_len) });
+            }else{
+              reply.push_back( { true, "" });
+            }
+          }
+          in_frame = !in_frame;
+          unit.clear();
+        }else if( !in_frame && (c=='\r' || c=='\n') ){
+          if( !unit.empty() ){
+            reply.push_back( { false, unit });
+          }
+          unit.clear();
+        }else{
+          unit.push_back( (char)c);
+        }
+      }
+      answered.store( reply.size());
+      wire += (n>0 ? n : 0);
+    }
+    sec = std::chrono::duration<double>( std::chrono::steady_clock::now() - start).count();
+
+    host.join();
+    stop.store( true);
+    device.join();
+    close( slave);
+    close( master);
+    g_master = -1;
+
+    for( const std::string &req : request){
+      wire += req.size();
+    }
+    if( reply.size()!=request.size() || line.overflow || line.dropped || line.error || box.frame_err || box.unknown || box.busy ){
+      this->_err_msg<<reply.size()<<" replies to "<<request.size()<<" requests, dropped="<<line.dropped<<" frame_err="<<box.frame_err<<endl;
+      return false;
+    }
+    return true;
+  }
+
+public:
+  TestCmdboxFramePty():TestUnitWrapper("test_cmdbox_frame_pty"){}
+
+  bool run( paramsTestCmdbox::Input& input, paramsTestCmdbox::Output& ref) override{
+    using namespace paramsTestCmdboxPty;
+    uint32_t seed = 0x2468ACEU;
+    auto     rand = [&seed](uint32_t n){ seed = seed*1664525U + 1013904223U; return (seed>>8)%n; };
+
+    std::vector<std::string> request;
+    std::vector<std::string> expect;
+    std::vector<Reply>       reply;
+    uint8_t                  wire[CMN_FRAME_WIRE_SIZE(APP_CMDBOX_FRAME_MAX)];
+    double                   sec;
+    size_t                   bytes;
+
+    /* Echo of payloads full of delimiters and line ends between text commands */
+    for(uint32_t k=0; k<input; ++k){
+      if( rand(4)==0 ){
+        request.push_back( "GT\r\n");
+        expect.push_back( "=> ACK");
+        continue;
+      }
+      static const uint8_t kByte[] = { 0x00, '\r', '\n', 0xA5 };
+      uint8_t payload[48];
+      const size_t len = rand(sizeof(payload)+1);
+      for(size_t i=0; i<len; ++i){
+        payload[i] = rand(2) ? kByte[rand(sizeof(kByte))] : (uint8_t)rand(256);
+      }
+      request.push_back( std::string( (const char *)wire, cmn_frame_encode( 0x01, payload, len, wire)));
+      expect.push_back( std::string( 1, (char)(0x01|APP_CMDBOX_FRAME_REPLY)) + std::string( 1, '\0') + std::string( (const char *)payload, len));
+    }
+    if( !loopback( request, reply, sec, bytes) ){
+      return false;
+    }
+    for(size_t i=0; i<reply.size(); ++i){
+      if( reply[i].frame ? reply[i].data!=expect[i] : reply[i].data.compare( 0, expect[i].size(), expect[i])!=0 ){
+        this->_err_msg<<"Reply "<<i<<" does NOT answer its request"<<endl;
+        return false;
+      }
+    }
+
+    /* The same clock set as a frame and as a line */
+    static const uint8_t kTime[] = { 0xE9, 0x07, 10, 18, 21, 30, 5 };
+    static const char    kSt[]   = "ST 2025 10 18 21 30 5\n";
+    const std::string    frame( (const char *)wire, cmn_frame_encode( 0x02, kTime, sizeof(kTime), wire));
+    for(int binary=1; binary>=0; --binary){
+      request.assign( input, binary ? frame : std::string( kSt));
+      if( !loopback( request, reply, sec, bytes) ){
+        return false;
+      }
+      for( const Reply &r : reply){
+        if( binary ? (!r.frame || r.data!=std::string( "\x82\0", 2)) : (r.frame || r.data.compare( 0, 6, "=> ACK")!=0) ){
+          this->_err_msg<<"Unexpected reply to "<<(binary ? "TIME" : "ST")<<endl;
+          return false;
+        }
+      }
+      cout<<"cmdbox,pty,"<<(binary ? "frame" : "ascii")<<",ops_per_s,"<<(uint32_t)(input/sec)<<",wire_bytes_per_op,"<<(double)bytes/input<<endl;
+    }
+    return true;
+  }
+};
+
+namespace paramsTestCmdboxMacro{
+
+/**
+ * @note Replies of the box since the last `take()`
+ */
+static std::string g_reply;
+
+static void tx( const void *data, size_t len){
+  g_reply.append( (const char *)data, len);
+}
+
+static std::string take( void){
+  std::string reply;
+  reply.swap( g_reply);
+  return reply;
+}
+
+} /* Namespace paramsTestCmdboxMacro */
+
+/**
+ * @brief Record a macro, replay it against a fake clock, keep it across a reset of the box
+ * @note  The steps must run at the times of their delays, with the replies of a replay. Then the
+ *        replay rate of pre-parsed steps against the same commands parsed from lines. Native only.
+ */
+class TestCmdboxMacro : public TestUnitWrapper<paramsTestCmdbox::Input,paramsTestCmdbox::Output>{
+private:
+  tAppCmdboxMacroBank bank;
+  tAppCmdBox          box;
+
+  void send( const char *line){
+    app_cmdbox_parse( &box, line);
+    app_cmdbox_exe( &box, 0);
+  }
+
+  bool expect( const std::string &reply, const char *when){
+    const std::string got = paramsTestCmdboxMacro::take();
+    if( got!=reply ){
+      this->_err_msg<<when<<": got ["<<got<<"] expect ["<<reply<<"]"<<endl;
+      return false;
+    }
+    return true;
+  }
+
+public:
+  TestCmdboxMacro():TestUnitWrapper("test_cmdbox_macro"){}
+
+  bool run( paramsTestCmdbox::Input& input, paramsTestCmdbox::Output& ref) override{
+    using namespace paramsTestCmdboxMacro;
+
+    /* Garbage is not a bank */
+    memset( &bank, 0xA5, sizeof(bank));
+    box    = {};
+    box.tx = tx;
+    app_cmdbox_macro_init( &box, &bank);
+    for( uint32_t i=0; i<APP_CMDBOX_MACRO_NUM; ++i){
+      if( bank.len[i]!=0 ){
+        this->_err_msg<<"A bank of garbage was kept"<<endl;
+        return false;
+      }
+    }
+
+    /* Commands are stored, not run. The controls run while recording. */
+    send( "MREC 1;CW 3;MWAIT 100;dispbr 80;MWAIT 250;ST 2025 10 18 21 30 5;MEND\r\n");
+    if( !expect( "=> ACK 0 MREC 0\n=> REC 1 CW 0\n=> ACK 2 MWAIT 0\n=> REC 3 DISPBR 2\n=> ACK 4 MWAIT 0\n"
+                 "=> REC 5 ST 4\n=> ACK 6 MEND 5\n", "Record") ){
+      return false;
+    }
+    send( "MLS\n");
+    if( !expect( "=> MACRO 0 0\n=> MACRO 1 5\n=> 0 CW 3\n=> 1 MWAIT 100\n=> 2 DISPBR 80\n=> 3 MWAIT 250\n"
+                 "=> 4 ST 2025 10 18 21 30 5\n=> MACRO 2 0\n=> MACRO 3 0\n=> ACK 7 MLS 0\n", "List") ){
+      return false;
+    }
+    send( "MPLAY 0 1;MWAIT 5;MREC 4;MEND\n");
+    if( !expect( "=> ACK 8 MPLAY 1\n=> ACK 9 MWAIT 1\n=> ACK 10 MREC 1\n=> ACK 11 MEND -1\n", "Errors") ){
+      return false;
+    }
+
+    /* Twice on a fake clock. The clock starts on the first poll. */
+    send( "MPLAY 1 2\n");
+    if( !expect( "=> ACK 12 MPLAY 0\n", "Play") ){
+      return false;
+    }
+    struct Tick{ uint32_t now; uint32_t next; const char *reply; };
+    static const Tick kTick[] = {
+      { 1000, 100,                   "=> RUN 0 CW 0\n" },
+      { 1050, 50,                    "" },
+      { 1100, 250,                   "=> RUN 2 DISPBR 0\n" },
+      { 1349, 1,                     "" },
+      { 1350, 1,                     "=> RUN 4 ST 0\n" },
+      { 1350, 100,                   "=> RUN 0 CW 0\n" },
+      { 1460, 250,                   "=> RUN 2 DISPBR 0\n" },
+      { 1710, 1,                     "=> RUN 4 ST 0\n" },
+      { 1712, APP_CMDBOX_MACRO_IDLE, "=> END 1 2 712\n" },
+      { 2000, APP_CMDBOX_MACRO_IDLE, "" },
+    };
+    for( const Tick &tick : kTick){
+      const uint32_t next = app_cmdbox_macro_poll( &box, tick.now);
+      app_cmdbox_exe( &box, 0);
+      if( next!=tick.next ){
+        this->_err_msg<<"At "<<tick.now<<"ms the next step is in "<<next<<"ms, expect "<<tick.next<<endl;
+        return false;
+      }
+      if( !expect( tick.reply, "Replay") ){
+        return false;
+      }
+    }
+
+    /* Host commands keep their sequence numbers between the steps of a replay */
+    send( "MPLAY 1 0\n");
+    app_cmdbox_macro_poll( &box, 0xFFFFFFF0U);
+    send( "GT;MSTOP\n");
+    if( app_cmdbox_macro_poll( &box, 0xFFFFFFF0U + 400)!=APP_CMDBOX_MACRO_IDLE ){
+      this->_err_msg<<"The replay did NOT stop"<<endl;
+      return false;
+    }
+    if( !expect( "=> ACK 13 MPLAY 0\n=> RUN 0 CW 0\n=> ACK 14 GT 0\n=> ACK 15 MSTOP 0\n", "Stop") ){
+      return false;
+    }
+
+    /* Kept across a reset of the box, lost once the bank is corrupted */
+    box    = {};
+    box.tx = tx;
+    app_cmdbox_macro_init( &box, &bank);
+    if( bank.len[1]!=5 || bank.step[1][4].args[0]!=2025 ){
+      this->_err_msg<<"The macro was NOT kept across a reset"<<endl;
+      return false;
+    }
+    bank.step[1][0].args[0] ^= 1;
+    app_cmdbox_macro_init( &box, &bank);
+    if( bank.len[1]!=0 ){
+      this->_err_msg<<"A corrupted bank was kept"<<endl;
+      return false;
+    }
+
+    /* Replay rate of pre-parsed steps against parsing the same lines */
+    static const char *kLine[] = { "GT\n", "CW 1\n", "CCW 2\n", "DISPBR 80\n", "DISPON\n", "ST 2025 10 18 21 30 5\n", "TOP\n" };
+    box.quiet = 1;
+    send( "MREC 0;GT;CW 1;CCW 2;DISPBR 80;DISPON;ST 2025 10 18 21 30 5;TOP;MEND\n");
+    const uint32_t steps = bank.len[0];
+    uint32_t       ran   = 0;
+    auto           start = std::chrono::steady_clock::now();
+    app_cmdbox_macro_play( &box, 0, input/steps);
+    while( app_cmdbox_macro_poll( &box, 0)!=APP_CMDBOX_MACRO_IDLE ){
+      ran += app_cmdbox_exe( &box, 0);
+    }
+    ran += app_cmdbox_exe( &box, 0);
+    const double replay = std::chrono::duration<double>( std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for(uint32_t n=0; n<input/steps; ++n){
+      for( const char *line : kLine){
+        app_cmdbox_parse( &box, line);
+        app_cmdbox_exe( &box, 0);
+      }
+    }
+    const double parse = std::chrono::duration<double>( std::chrono::steady_clock::now() - start).count();
+
+    if( steps!=sizeof(kLine)/sizeof(kLine[0]) || ran!=input/steps*steps ){
+      this->_err_msg<<"Replayed "<<ran<<" steps, expect "<<input/steps*steps<<endl;
+      return false;
+    }
+    cout<<"cmdbox,macro,cmds_per_s,"<<(uint32_t)(ran/replay)<<",parsed,"<<(uint32_t)(ran/parse)<<endl;
+    return true;
+  }
+};
+#endif
+
+
+/* ************************************************************************** */
+/*                         Fixed Point Trigonometry                           */
+/* ************************************************************************** */
+namespace paramsTestCmnMathTrig{
+
+/**
+ * @note: [0] Maximum error of sin/cos in Q15 LSB
+ *        [1] Maximum error of atan2 in binary angle
+ */
+typedef std::array<uint32_t,2> Input;
+
+/**
+ * @note: No output
+ */
+typedef uint8_t Output;
+
+static constexpr double PI = 3.14159265358979323846;
+
+static inline int32_t ref_sin_q15(uint32_t brad){
+  return (int32_t)std::lround( 32767.0 * std::sin( brad * 2*PI / 65536.0));
+}
+
+static inline int32_t ref_atan2_brad(int32_t y, int32_t x){
+  double a = std::atan2( (double)y, (double)x) * 65536.0 / (2*PI);
+  return (int32_t)std::lround( a<0 ? a+65536.0 : a) & 0xFFFF;
+}
+
+static inline int32_t brad_dist(int32_t a, int32_t b){
+  int32_t d = (a-b) & 0xFFFF;
+  return CMN_MIN( d, 0x10000-d);
+}
+
+} /* Namespace paramsTestCmnMathTrig */
+
+/**
+ * @brief Accuracy bounds of the fixed point angle and trigonometry kernels
+ * @note  Every binary angle is verified for sin/cos. atan2 is verified on circles of
+ *        radius from 1 to 2^30 and on a dense grid around the origin.
+ */
+class TestCmnMathTrig : public TestUnitWrapper<paramsTestCmnMathTrig::Input,paramsTestCmnMathTrig::Output>{
+public:
+  TestCmnMathTrig():TestUnitWrapper("test_cmn_math_trig"){}
+
+  bool run( paramsTestCmnMathTrig::Input& input, paramsTestCmnMathTrig::Output& ref) override{
+    using namespace paramsTestCmnMathTrig;
+    uint32_t err_sin = 0, err_atan = 0;
+
+    for(uint32_t x=0; x<=0xFFFF; ++x){
+      cmnQ15_t s, c;
+      cmn_math_sincos_q15( x, &s, &c);
+      err_sin = CMN_MAX( err_sin, (uint32_t)std::abs( s - ref_sin_q15(x)));
+      err_sin = CMN_MAX( err_sin, (uint32_t)std::abs( c - ref_sin_q15(x+0x4000)));
+      if(s!=cmn_math_sin_q15(x) || c!=cmn_math_cos_q15(x)){
+        this->_err_msg<<"sincos mismatches sin/cos at brad="<<x<<endl;
+        return false;
+      }
+    }
+
+    for(double r=1; r<(1U<<30); r*=3.7){
+      for(uint32_t x=0; x<=0xFFFF; x+=7){
+        int32_t px = (int32_t)std::lround( r*std::cos( x*2*PI/65536.0));
+        int32_t py = (int32_t)std::lround( r*std::sin( x*2*PI/65536.0));
+        if(px==0 && py==0) continue;
+        err_atan = CMN_MAX( err_atan, (uint32_t)brad_dist( cmn_math_atan2_brad(py, px), ref_atan2_brad(py, px)));
+      }
+    }
+    for(int32_t py=-64; py<=64; ++py){
+      for(int32_t px=-64; px<=64; ++px){
+        if(px==0 && py==0) continue;
+        err_atan = CMN_MAX( err_atan, (uint32_t)brad_dist( cmn_math_atan2_brad(py, px), ref_atan2_brad(py, px)));
+      }
+    }
+    const int32_t extremes[] = { INT32_MIN, INT32_MIN+1, -1, 1, INT32_MAX};
+    for(int32_t py : extremes){
+      for(int32_t px : extremes){
+        err_atan = CMN_MAX( err_atan, (uint32_t)brad_dist( cmn_math_atan2_brad(py, px), ref_atan2_brad(py, px)));
+      }
+    }
+    if(cmn_math_atan2_brad(0, 0)!=0){
+      this->_err_msg<<"atan2(0,0) should be 0"<<endl;
+      return false;
+    }
+
+    cout<<"\nbound,sin_cos_q15,"<<err_sin<<",lsb"<<"\nbound,atan2_brad,"<<err_atan<<",brad"<<endl;
+    if(err_sin > input[0] || err_atan > input[1]){
+      this->_err_msg<<"Error exceeds the bound: sin/cos="<<err_sin<<"lsb atan2="<<err_atan<<"brad"<<endl;
+      return false;
+    }
+
+    for(int32_t x=-3600; x<7200; ++x){
+      if(cmn_math_wrap3600(x) != ((x%3600)+3600)%3600){
+        this->_err_msg<<"wrap3600("<<x<<")="<<cmn_math_wrap3600(x)<<endl;
+        return false;
+      }
+    }
+    for(uint64_t x=0; x<=UINT32_MAX; x+=(x<1000000) ? 1 : 65521){
+      if(cmn_math_mod3600(x) != x%3600){
+        this->_err_msg<<"mod3600("<<x<<")="<<cmn_math_mod3600(x)<<endl;
+        return false;
+      }
+    }
+    if(cmn_math_mod3600(UINT32_MAX) != UINT32_MAX%3600){
+      this->_err_msg<<"mod3600(UINT32_MAX)="<<cmn_math_mod3600(UINT32_MAX)<<endl;
+      return false;
+    }
+    for(uint16_t x=0; x<3600; ++x){
+      if(cmn_math_brad2ddeg( cmn_math_ddeg2brad(x))!=x){
+        this->_err_msg<<"ddeg->brad->ddeg round trip failed at "<<x<<endl;
+        return false;
+      }
+    }
+
+    for(int32_t a=INT16_MIN; a<=INT16_MAX; a+=37){
+      for(int32_t b : {INT16_MIN, -12345, -1, 0, 1, 23456, INT16_MAX}){
+        int32_t exp = CMN_MIN( INT16_MAX, (int32_t)((a*b + 0x4000) >> 15));
+        if(cmn_math_mul_q15(a, b)!=exp){
+          this->_err_msg<<"mul_q15("<<a<<","<<b<<")="<<cmn_math_mul_q15(a, b)<<" expected "<<exp<<endl;
+          return false;
+        }
+      }
+    }
+    if(cmn_math_mul_q15(INT16_MIN, INT16_MIN)!=INT16_MAX){
+      this->_err_msg<<"mul_q15(-1,-1) should saturate"<<endl;
+      return false;
+    }
+
+    /* Needle angles accumulated step by step match the ones of the total elapsed time */
+    {
+      uint16_t rem[3] = {0}, deg[3] = {0}, inc[3];
+      uint64_t total = 0;
+      std::mt19937 rng(3600);
+      for(int i=0; i<100000; ++i){
+        uint32_t ms = (i%1000==0) ? 43200000 : rng()%2000;
+        total += ms;
+        cmn_utility_angleinc( &rem[0], &rem[1], &rem[2], &inc[0], &inc[1], &inc[2], ms);
+        for(int k=0; k<3; ++k){
+          deg[k] = cmn_math_wrap3600( deg[k] + inc[k]);
+        }
+        if(deg[0]!=(total/12000)%3600 || deg[1]!=(total/1000)%3600 || deg[2]!=(total*3/50)%3600){
+          this->_err_msg<<"Needle angles diverge after "<<total<<"ms: "<<deg[0]<<","<<deg[1]<<","<<deg[2]<<endl;
+          return false;
+        }
+      }
+
+      cmnDateTime_t time = {0};
+      time.hour = 12;
+      cmn_utility_angleset( &rem[0], &rem[1], &rem[2], &deg[0], &deg[1], &deg[2], &time);
+      if(deg[0]!=0 || deg[1]!=0 || deg[2]!=0){
+        this->_err_msg<<"Needle angles at 12 o'clock should be 0: "<<deg[0]<<","<<deg[1]<<","<<deg[2]<<endl;
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+/**
+ * @brief Time cost per operation. Fixed point kernels vs. libm (and CMSIS-DSP on target).
+ * @note  Report only. Per-op cost is printed as a `perf` line by `TestBench::report()`.
+ */
+class TestCmnMathTrigBench : public TestUnitWrapper<uint32_t,uint8_t>{
+public:
+  TestCmnMathTrigBench():TestUnitWrapper("test_cmn_math_trig_bench"){}
+
+  bool run( uint32_t& ops, uint8_t& ref) override{
+    volatile int32_t sink = 0;
+    const float      K    = 2*3.14159265f/65536;
+
+    TestClock::init();
+
+    TestBench::report("sin_libm",      ops, [&](uint32_t i){ sink += (int32_t)(32767*sinf( (i*40503U & 0xFFFF)*K)); });
+    TestBench::report("sin_q15",       ops, [&](uint32_t i){ sink += cmn_math_sin_q15( i*40503U); });
+
+    TestBench::report("sincos_libm",   ops, [&](uint32_t i){ float a = (i*40503U & 0xFFFF)*K; sink += (int32_t)(32767*sinf(a)) + (int32_t)(32767*cosf(a)); });
+    TestBench::report("sincos_q15",    ops, [&](uint32_t i){ cmnQ15_t s, c; cmn_math_sincos_q15( i*40503U, &s, &c); sink += s + c; });
+#if (defined TB_CMSIS_DSP) && (TB_CMSIS_DSP==1)
+    TestBench::report("sincos_cmsis_q31", ops, [&](uint32_t i){ q31_t s, c; arm_sin_cos_q31( (q31_t)(i*40503U<<16), &s, &c); sink += (s>>16) + (c>>16); });
+#endif
+
+    TestBench::report("atan2_libm",    ops, [&](uint32_t i){ sink += (int32_t)(atan2f( (float)(int16_t)(i*40503U), (float)(int16_t)(i*7919U))/K); });
+    TestBench::report("atan2_brad",    ops, [&](uint32_t i){ sink += cmn_math_atan2_brad( (int16_t)(i*40503U), (int16_t)(i*7919U)); });
+
+    TestBench::report("mod3600_div",   ops, [&](uint32_t i){ sink += (i*40503U) % 3600; });
+    TestBench::report("mod3600",       ops, [&](uint32_t i){ sink += cmn_math_mod3600( i*40503U); });
+    TestBench::report("wrap3600",      ops, [&](uint32_t i){ sink += cmn_math_wrap3600( (int32_t)(i&0x1FFF) - 3600); });
+
+    cout<<endl;
+    UNUSED(sink);
+    return true;
+  }
+};
+
+
+/* ************************************************************************** */
+/*                          RGB565 Blend / Gradient                           */
+/* ************************************************************************** */
+namespace paramsTestCmnColor565{
+
+/**
+ * @note: [0] Number of random rounds per opacity
+ *        [1] Longest span in pixels
+ */
+typedef std::array<uint32_t,2> Input;
+
+/**
+ * @note: No output
+ */
+typedef uint8_t Output;
+
+static inline uint16_t ref_swap(uint16_t c){
+  return (uint16_t)((c>>8) | (c<<8));
+}
+
+/**
+ * @brief Copy of `lv_color_mix()` of LVGL 8.3 for 16-bit color with `LV_COLOR_16_SWAP==1`
+ * @note  `LV_UDIV255()` applied on each channel. Operates on unswapped colors.
+ */
+static inline uint16_t ref_mix(uint16_t c1, uint16_t c2, uint8_t mix){
+  uint32_t r = (((c1>>11)&0x1F)*mix + ((c2>>11)&0x1F)*(255-mix))*0x8081U >> 23;
+  uint32_t g = (((c1>> 5)&0x3F)*mix + ((c2>> 5)&0x3F)*(255-mix))*0x8081U >> 23;
+  uint32_t b = (((c1    )&0x1F)*mix + ((c2    )&0x1F)*(255-mix))*0x8081U >> 23;
+  return (uint16_t)((r<<11) | (g<<5) | b);
+}
+
+static inline uint16_t ref_mix_buf(uint16_t c1, uint16_t c2, uint8_t mix, bool swapped){
+  return swapped ? ref_swap( ref_mix( ref_swap(c1), ref_swap(c2), mix)) : ref_mix( c1, c2, mix);
+}
+
+static inline uint16_t ref_gradient(uint16_t from, uint16_t to, uint32_t i, uint32_t n){
+  uint32_t x = (i*((256U<<16)/n)) >> 16;
+  uint32_t r = (((from>>11)&0x1F)*(256-x) + ((to>>11)&0x1F)*x) >> 8;
+  uint32_t g = (((from>> 5)&0x3F)*(256-x) + ((to>> 5)&0x3F)*x) >> 8;
+  uint32_t b = (((from    )&0x1F)*(256-x) + ((to    )&0x1F)*x) >> 8;
+  return (uint16_t)((r<<11) | (g<<5) | b);
+}
+
+/**
+ * @brief Per pixel loops in the shape of `lv_draw_sw_blend_basic()`
+ */
+__attribute__((noinline)) void ref_blend_row(uint16_t *dst, const uint16_t *src, uint32_t n, uint8_t opa, bool swapped){
+  for(uint32_t i=0; i<n; ++i){
+    dst[i] = ref_mix_buf( src[i], dst[i], opa, swapped);
+  }
+}
+
+__attribute__((noinline)) void ref_fill_opa_row(uint16_t *dst, uint16_t color, uint32_t n, uint8_t opa, bool swapped){
+  for(uint32_t i=0; i<n; ++i){
+    dst[i] = ref_mix_buf( color, dst[i], opa, swapped);
+  }
+}
+
+__attribute__((noinline)) void ref_gradient_row(uint16_t *dst, uint16_t from, uint16_t to, uint32_t n){
+  for(uint32_t i=0; i<n; ++i){
+    dst[i] = ref_gradient( from, to, i, n);
+  }
+}
+
+} /* Namespace paramsTestCmnColor565 */
+
+/**
+ * @brief Pixel exactness of the RGB565 kernels
+ * @note  Every opacity, random pixels, odd lengths, unaligned buffers and both byte orders.
+ *        Pixels around the span are guarded and must stay untouched.
+ */
+class TestCmnColor565 : public TestUnitWrapper<paramsTestCmnColor565::Input,paramsTestCmnColor565::Output>{
+private:
+  static constexpr uint16_t GUARD = 0xA55A;
+
+  bool compare(const char *kernel, const std::vector<uint16_t> &out, const std::vector<uint16_t> &exp, uint32_t n, uint32_t opa, bool swapped){
+    for(size_t i=0; i<out.size(); ++i){
+      if(out[i]!=exp[i]){
+        this->_err_msg<<kernel<<": n="<<n<<" opa="<<opa<<" swapped="<<swapped<<" mismatch at ["<<i<<"] "
+                      <<std::hex<<out[i]<<"!="<<exp[i]<<std::dec<<endl;
+        return false;
+      }
+    }
+    return true;
+  }
+
+public:
+  TestCmnColor565():TestUnitWrapper("test_cmn_color_565"){}
+
+  bool run( paramsTestCmnColor565::Input& input, paramsTestCmnColor565::Output& ref) override{
+    using namespace paramsTestCmnColor565;
+    std::mt19937 rng(565);
+
+    for(uint32_t opa=0; opa<=255; ++opa){
+      for(uint32_t round=0; round<input[0]; ++round){
+        for(bool swapped : {false, true}){
+          uint32_t n   = rng() % (input[1]+1);
+          uint32_t ofs = rng() & 1;   /* Unaligned span */
+
+          std::vector<uint16_t> bg(n+4, GUARD), src(n+4, GUARD);
+          for(uint32_t i=0; i<n; ++i){
+            bg [i+1+ofs] = (uint16_t)rng();
+            src[i+1+ofs] = (uint16_t)rng();
+          }
+          uint16_t color = (uint16_t)rng();
+
+          std::vector<uint16_t> out = bg, exp = bg;
+          cmn_color_565_blend( &out[1+ofs], &src[1+ofs], n, opa, swapped);
+          for(uint32_t i=0; i<n; ++i){
+            exp[i+1+ofs] = ref_mix_buf( src[i+1+ofs], bg[i+1+ofs], opa, swapped);
+          }
+          if(!compare( "blend", out, exp, n, opa, swapped)) return false;
+
+          out = bg, exp = bg;
+          cmn_color_565_fill_opa( &out[1+ofs], color, n, opa, swapped);
+          for(uint32_t i=0; i<n; ++i){
+            exp[i+1+ofs] = ref_mix_buf( color, bg[i+1+ofs], opa, swapped);
+          }
+          if(!compare( "fill_opa", out, exp, n, opa, swapped)) return false;
+
+          out = bg, exp = bg;
+          cmn_color_565_fill( &out[1+ofs], color, n);
+          for(uint32_t i=0; i<n; ++i){
+            exp[i+1+ofs] = color;
+          }
+          if(!compare( "fill", out, exp, n, opa, swapped)) return false;
+
+          out = bg, exp = bg;
+          cmn_color_565_swap( &out[1+ofs], &src[1+ofs], n);
+          for(uint32_t i=0; i<n; ++i){
+            exp[i+1+ofs] = ref_swap( src[i+1+ofs]);
+          }
+          if(!compare( "swap", out, exp, n, opa, swapped)) return false;
+
+          cmn_color_565_swap( &out[1+ofs], &out[1+ofs], n);
+          for(uint32_t i=0; i<n; ++i){
+            exp[i+1+ofs] = src[i+1+ofs];
+          }
+          if(!compare( "swap_inplace", out, exp, n, opa, swapped)) return false;
+        }
+      }
+    }
+
+    for(uint32_t n=1; n<=input[1]; ++n){
+      for(bool swapped : {false, true}){
+        uint16_t from = (uint16_t)rng(), to = (uint16_t)rng();
+        std::vector<uint16_t> out(n+2, GUARD), exp(n+2, GUARD);
+        cmn_color_565_gradient( &out[1], from, to, n, swapped);
+        for(uint32_t i=0; i<n; ++i){
+          exp[i+1] = swapped ? ref_swap( ref_gradient( ref_swap(from), ref_swap(to), i, n)) : ref_gradient( from, to, i, n);
+        }
+        if(!compare( "gradient", out, exp, n, 0, swapped)) return false;
+      }
+    }
+    return true;
+  }
+};
+
+/**
+ * @brief Throughput of the RGB565 kernels vs. per pixel loops on a screen row
+ * @note  Report only. Per-pixel cost is printed as a `perf` line by `TestBench::report()`,
+ *        followed by `throughput,<name>,<Mpix/s>,Mpix/s`.
+ */
+class TestCmnColor565Bench : public TestUnitWrapper<uint32_t,uint8_t>{
+private:
+  static constexpr uint32_t ROW = 240;
+
+  template<class F>
+  void report(const char *name, uint32_t rows, F &&func){
+    const double cost = TestBench::report( name, rows, func, ROW);
+    cout<<"\nthroughput,"<<name<<','<<std::setprecision(1)<<(TestClock::ticks_per_us()/cost)<<",Mpix/s";
+  }
+
+public:
+  TestCmnColor565Bench():TestUnitWrapper("test_cmn_color_565_bench"){}
+
+  bool run( uint32_t& rows, uint8_t& ref) override{
+    using namespace paramsTestCmnColor565;
+    static uint16_t dst[ROW+1], src[ROW+1];
+    for(uint32_t i=0; i<=ROW; ++i){
+      dst[i] = (uint16_t)(i*40503U);
+      src[i] = (uint16_t)(i*7919U);
+    }
+
+    TestClock::init();
+
+    report("blend_565_pixel",    rows, [&](uint32_t i){ ref_blend_row( dst, src, ROW, (uint8_t)(i|1), true); });
+    report("blend_565",          rows, [&](uint32_t i){ cmn_color_565_blend( dst, src, ROW, (uint8_t)(i|1), true); });
+    report("blend_565_unaligned",rows, [&](uint32_t i){ cmn_color_565_blend( dst+1, src, ROW, (uint8_t)(i|1), true); });
+
+    report("fill_opa_565_pixel", rows, [&](uint32_t i){ ref_fill_opa_row( dst, (uint16_t)i, ROW, (uint8_t)(i|1), true); });
+    report("fill_opa_565",       rows, [&](uint32_t i){ cmn_color_565_fill_opa( dst, (uint16_t)i, ROW, (uint8_t)(i|1), true); });
+
+    report("gradient_565_pixel", rows, [&](uint32_t i){ ref_gradient_row( dst, (uint16_t)i, (uint16_t)~i, ROW); });
+    report("gradient_565",       rows, [&](uint32_t i){ cmn_color_565_gradient( dst, (uint16_t)i, (uint16_t)~i, ROW, false); });
+
+    report("swap_565",           rows, [&](uint32_t i){ cmn_color_565_swap( dst, src, ROW); });
+
+    cout<<endl;
+    return true;
+  }
+};
+
+void add_cmn_test(void){
+  tb_infra_local
+    .insert( 
+      TestCmnDummy(), 
+      0, 
+      0
+    )
+  ;
+
+#if (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  /* Runs first. It resets the emulator once. */
+  tb_infra_local
+    .insert(
+      TestTraceCrashReset(),
+      (uint8_t)0,
+      (uint8_t)0
+    )
+  ;
+#endif
+
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  tb_infra_local
+    .insert(
+      TestCmnInterruptPushPopTopBasic(),
+      std::vector<tCmnInterruptUnit>{
+        {.operation=ENABLE,  .irqn=EXTI9_5_IRQn, .target_cnt=11256},
+        {.operation=ENABLE,  .irqn=USART1_IRQn,  .target_cnt=8837},
+        {.operation=DISABLE, .irqn=SPI3_IRQn,    .target_cnt=47},
+        {.operation=DISABLE, .irqn=EXTI0_IRQn,   .target_cnt=203984},
+        {.operation=ENABLE,  .irqn=EXTI1_IRQn,   .target_cnt=637}
+      },
+      std::vector<uint32_t>{47,637,8837,11256,203984}
+    )
+
+    .insert(
+      TestCmnInterruptPushPopTopCornerCase(),
+      (uint8_t)0,
+      (uint8_t)0
+    )
+  ;
+#endif
+
+  tb_infra_local
+    .insert( 
+      TestCmnMathGcd(),
+      std::array<std::array<int32_t,2>,10>{{
+        {0,0},
+        {4,6},
+        {46,78},
+        {78,46},
+        {78,3},
+        {435,134},
+        {89327645,4845},
+        {139,84435},
+        {9834,672},
+        {128,1024}
+      }}, 
+      std::array<int32_t,10>{{
+        0,
+        2,
+        2,
+        2,
+        3,
+        1,
+        95,
+        1,
+        6,
+        128
+      }}
+    )
+
+    .insert(
+      TestCmnMathBit(),
+      std::array<uint32_t,10>{
+        {0x007B2A52}    /*!< Input: Counting Leading Zero */
+      },
+      std::array<uint32_t,10>{
+        {9}             /*!< Ref: Counting Leading Zero */
+      }
+    )
+  ;
+
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  tb_infra_local
+    .insert(
+      TestCmnStructAlignment(),
+      paramsTestCmnStructAlignment::Input{{
+        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->temperature.L),\
+        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->temperature.H),\
+        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->gyro.x),\
+        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->gyro.y),\
+        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->gyro.z),\
+        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->acc.x),\
+        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->acc.y),\
+        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->acc.z)
+      }},
+      paramsTestCmnStructAlignment::Output{{
+        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->raw[0]),\
+        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->raw[1]),\
+        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->fifo[0]),\
+        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->fifo[2]),\
+        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->fifo[4]),\
+        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->fifo[6]),\
+        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->fifo[8]),\
+        static_cast<void*>(&static_cast<tBspGyroData*>(nullptr)->fifo[10])
+      }}
+    )
+  ;
+#endif
+
+  tb_infra_local
+    .insert(
+      TestCmnUtilityEpoch(),
+      paramsTestCmnUtilityEpoch::Input{{2022, 2149}},
+      (uint8_t)0
+    )
+
+    .insert(
+      TestCmnUtilityTimeBench(),
+      (uint32_t)100000,
+      (uint8_t)0
+    )
+
+    .insert(
+      TestCmnUtilityDecEquivalence(),
+      paramsTestCmnUtilityDecEquivalence::Input{{1000000, 65521}},
+      (uint8_t)0
+    )
+
+    .insert(
+      TestCmnUtilityDecBench(),
+      (uint32_t)100000,
+      (uint8_t)0
+    )
+
+    .insert(
+      TestCmnMathTrig(),
+      paramsTestCmnMathTrig::Input{{1, 2}},
+      (uint8_t)0
+    )
+
+    .insert(
+      TestCmnMathTrigBench(),
+      (uint32_t)100000,
+      (uint8_t)0
+    )
+
+    .insert(
+      TestCmnColor565(),
+      paramsTestCmnColor565::Input{{8, 67}},
+      (uint8_t)0
+    )
+
+    .insert(
+      TestCmnColor565Bench(),
+      (uint32_t)2000,
+      (uint8_t)0
+    )
+
+    .insert(
+      BenchCompareUnit( "bench_cmn_math_sin_q15_vs_libm",
+        [](uint32_t i){ bench_keep( cmn_math_sin_q15( i*40503U)); },
+        [](uint32_t i){ bench_keep( sinf( (i*40503U & 0xFFFF)*(2*3.14159265f/65536))); }
+      ),
+      tTestBenchConfig{ 1000, 101, 1000},
+      TEST_BENCH_BASELINE( 1.0, 0, 0)     /* Host libm is vectorized and close. Gate on target only. */
+    )
+
+    .insert(
+      BenchCompareUnit( "bench_cmn_utility_2digits_vs_snprintf",
+        [](uint32_t i){ char buf[4]; cmn_utility_uint2strdec_2digits( buf, i%100); bench_keep( buf); },
+        [](uint32_t i){ char buf[4]; cmn_utility_snprintf( buf, sizeof(buf), "%02u", i%100); bench_keep( buf); }
+      ),
+      tTestBenchConfig{ 1000, 101, 1000},
+      TEST_BENCH_BASELINE( 0.5, 0, 0)     /* Host timing is too noisy for a ratio this tight. Gate on target only. */
+    )
+
+    .insert(
+      BenchUnit( "bench_cmn_color_565_blend_row", [](uint32_t i){
+        static uint16_t dst[240], src[240];
+        cmn_color_565_blend( dst, src, 240, (uint8_t)i, true);
+        bench_keep( dst);
+      }),
+      tTestBenchConfig{ 100, 101, 100},
+      TEST_BENCH_BASELINE( 0, 0, 0)
+    )
+
+    .insert(
+      TestTraceFmtEquivalence(),
+      (paramsTestTraceFmt::Input)2000,
+      (uint8_t)0
+    )
+
+    .insert(
+      TestTraceFmtBench(),
+      (uint32_t)100000,
+      (uint8_t)0
+    )
+
+    .insert(
+      TestTraceDefer(),
+      (paramsTestTraceDefer::Input)500,
+      (uint8_t)0
+    )
+
+    .insert(
+      TestTraceLevel(),
+      (paramsTestTraceLevel::Input)1000,
+      (uint8_t)0
+    )
+
+    .insert(
+      TestTraceCrash(),
+      (paramsTestTraceCrash::Input)500,
+      (uint8_t)0
+    )
+
+    .insert(
+      TestRtosTop(),
+      (paramsTestRtosTop::Input)5000,
+      (uint8_t)0
+    )
+
+    .insert(
+      TestTimeline(),
+      (paramsTestTimeline::Input)(3*TIMELINE_EVENT_NUM+5),
+      (uint8_t)0
+    )
+
+    .insert(
+      TestCmnRing(),
+      (paramsTestCmnRing::Input)20000,
+      (uint8_t)0
+    )
+
+    .insert(
+      TestCmnLine(),
+      (paramsTestCmnLine::Input)20000,
+      (uint8_t)0
+    )
+
+    .insert(
+      TestCmnFrame(),
+      (paramsTestCmnFrame::Input)20000,
+      (uint8_t)0
+    )
+
+    .insert(
+      TestCmdboxTokenize(),
+      (paramsTestCmdbox::Input)100000,
+      (uint8_t)0
+    )
+
+    .insert(
+      BenchCompareUnit( "bench_cmdbox_parse_vs_strstr",
+        [](uint32_t i){
+          const tAppCmdboxDatabaseListUnit *p_cmd;
+          arg_t                             args[MAX_NUN_ARGS_SUPPORTED];
+          using namespace paramsTestCmdbox;
+          bench_keep( app_cmdbox_tokenize( kLine[i%(sizeof(kLine)/sizeof(kLine[0]))], &p_cmd, args));
+          bench_keep( args);
+        },
+        [](uint32_t i){
+          static const paramsTestCmdbox::Legacy legacy;
+          arg_t                                 args[MAX_NUN_ARGS_SUPPORTED];
+          using namespace paramsTestCmdbox;
+          bench_keep( legacy.tokenize( kLine[i%(sizeof(kLine)/sizeof(kLine[0]))], args));
+          bench_keep( args);
+        }
+      ),
+      tTestBenchConfig{ 1000, 101, 1000},
+      TEST_BENCH_BASELINE( 0.5, 0, 0)     /* Gated on target, where the cycle counter is exact */
+    )
+
+    .insert(
+      BenchUnit( "bench_cmn_ring_write_line", [](uint32_t i){
+        static uint8_t  storage[1024];
+        static tCmnRing ring = { storage, sizeof(storage), 0, 0, 0, 0, 0};
+        const uint8_t  *ptr;
+        uint8_t         msg[48];
+        paramsTestCmnRing::make_msg( msg, sizeof(msg), 0, (uint16_t)i);
+        cmn_ring_write( &ring, msg, sizeof(msg));
+        /* Drain at once like an infinitely fast DMA */
+        for(size_t len = cmn_ring_claim( &ring, &ptr); len; len = cmn_ring_next( &ring, len, &ptr));
+      }),
+      tTestBenchConfig{ 1000, 101, 1000},
+      TEST_BENCH_BASELINE( 0, 0, 0)
+    )
+
+    .insert(
+      BenchCompareUnit( "bench_trace_defer_vs_text",
+        [](uint32_t i){
+          TRACE_DEFER_PRINTF( TB_TRACE_FMT_LINE, FMT_DEBUG_STR, i, i%60, -(int32_t)i, i%360);
+          if( (i&15)==15 ){
+            uint8_t buf[TRACE_DEFER_RING_SIZE];
+            bench_keep( trace_defer_drain( buf, sizeof(buf)));
+          }
+        },
+        [](uint32_t i){ char buf[128]; TRACE_FMT_SNPRINTF( buf, sizeof(buf), TB_TRACE_FMT_LINE, FMT_DEBUG_STR, i, i%60, -(int32_t)i, i%360); bench_keep( buf); }
+      ),
+      tTestBenchConfig{ 1000, 101, 1024},
+      TEST_BENCH_BASELINE( 0.5, 0, 0)     /* The drain is amortized into the deferred side. Gate on target only. */
+    )
+  ;
+
+#if (MEMORY_OWNER==1)
+  tb_infra_local
+    .insert(
+      TestMemoryOwner(),
+      (paramsTestMemoryOwner::Input)3000,
+      (uint8_t)0
+    )
+  ;
+#endif
+
+#if (MEMORY_TRACK==1)
+  tb_infra_local
+    .insert(
+      TestMemoryTrack(),
+      (paramsTestMemoryTrack::Input)1000,
+      (paramsTestMemoryTrack::Output)200
+    )
+  ;
+#endif
+
+#if (PROFILE_ZONE==1)
+  tb_infra_local
+    .insert(
+      TestProfileZone(),
+      (paramsTestProfileZone::Input)2000,
+      (paramsTestProfileZone::Output)1000     /* Ticks. Cycles on target, nanoseconds on native. */
+    )
+  ;
+#endif
+
+#if (defined SYS_TARGET_NATIVE)
+  tb_infra_local
+    .insert(
+      TestCmnRingConcurrent(),
+      (paramsTestCmnRing::Input)20000,
+      (uint8_t)0
+    )
+
+    .insert(
+      TestCmnLineConcurrent(),
+      (paramsTestCmnLine::Input)50000,
+      (uint8_t)0
+    )
+
+    .insert(
+      TestCmnBurst(),
+      (paramsTestCmnBurst::Input)10,
+      (uint8_t)0
+    )
+
+    .insert(
+      TestCmdboxPipeline(),
+      (paramsTestCmdbox::Input)100000,
+      (uint8_t)0
+    )
+
+    .insert(
+      TestCmdboxFramePty(),
+      (paramsTestCmdbox::Input)20000,
+      (uint8_t)0
+    )
+
+    .insert(
+      TestCmdboxMacro(),
+      (paramsTestCmdbox::Input)200000,
+      (uint8_t)0
+    )
+  ;
+#endif
 }
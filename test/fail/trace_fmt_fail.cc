@@ -0,0 +1,61 @@
+/**
+ ******************************************************************************
+ * @file    trace_fmt_fail.cc
+ * @author  RandleH
+ * @brief   Compile-time Test Program - Broken trace format strings
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2022 RandleH.
+ * All rights reserved.
+ *
+ * This software component is licensed by RandleH under BSD 3-Clause license,
+ * the "License"; You may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at:
+ *                        opensource.org/licenses/BSD-3-Clause
+ *
+ ******************************************************************************
+*/
+
+/**
+ * @note
+ *  NOT part of the test bench executable. Each case is compiled on its own by ctest
+ *  with `-DTRACE_FMT_FAIL_CASE=<n>` and MUST be rejected with the expected diagnostic.
+ *  Case 0 is the control group and MUST compile.
+ */
+#include "trace.hh"
+
+int trace_fmt_fail_case(char *buf, size_t size){
+  const char *name = "metope";
+  uint32_t    u32  = 0;
+  uint64_t    u64  = 0;
+  float       f32  = 0;
+
+  (void)name; (void)u32; (void)u64; (void)f32;
+
+#if   TRACE_FMT_FAIL_CASE==0
+  return TRACE_FMT_SNPRINTF( buf, size, "%s %02d:%02u 0x%08X %c", name, u32, u32, u32, 'A');
+#elif TRACE_FMT_FAIL_CASE==1
+  return TRACE_FMT_SNPRINTF( buf, size, "%u %u", u32);
+#elif TRACE_FMT_FAIL_CASE==2
+  return TRACE_FMT_SNPRINTF( buf, size, "%u", u32, u32);
+#elif TRACE_FMT_FAIL_CASE==3
+  return TRACE_FMT_SNPRINTF( buf, size, "%d", name);
+#elif TRACE_FMT_FAIL_CASE==4
+  return TRACE_FMT_SNPRINTF( buf, size, "%s", u32);
+#elif TRACE_FMT_FAIL_CASE==5
+  return TRACE_FMT_SNPRINTF( buf, size, "%u", u64);
+#elif TRACE_FMT_FAIL_CASE==6
+  return TRACE_FMT_SNPRINTF( buf, size, "%u", f32);
+#elif TRACE_FMT_FAIL_CASE==7
+  return TRACE_FMT_SNPRINTF( buf, size, "%f", f32);
+#elif TRACE_FMT_FAIL_CASE==8
+  return TRACE_FMT_SNPRINTF( buf, size, "%12u", u32);
+#elif TRACE_FMT_FAIL_CASE==9
+  return TRACE_FMT_SNPRINTF( buf, size, "%8s", name);
+#elif TRACE_FMT_FAIL_CASE==10
+  return TRACE_FMT_SNPRINTF( buf, size, "100%", u32);
+#endif
+}
+
+/* ********************************** EOF *********************************** */
@@ -0,0 +1,12 @@
+
+
+/* ************************************************************************** */
+/*                              Headfile Guards                               */
+/* ************************************************************************** */
+#ifndef PERF_TEST_HH
+#define PERF_TEST_HH
+
+void add_perf_test( void);
+
+
+#endif
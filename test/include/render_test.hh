@@ -0,0 +1,12 @@
+
+
+/* ************************************************************************** */
+/*                              Headfile Guards                               */
+/* ************************************************************************** */
+#ifndef RENDER_TEST_HH
+#define RENDER_TEST_HH
+
+void add_render_test( void);
+
+
+#endif
@@ -27,7 +27,16 @@
 #include <memory>
 #include <queue>
 #include <cstring>
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <string>
 #include <iomanip>
+#include <algorithm>
+#include "device.h"
+#if (defined SYS_TARGET_NATIVE)
+  #include <chrono>
+#endif
 
 
 /* ************************************************************************** */
@@ -103,6 +112,77 @@ using namespace std;
 
 
 
+/* ************************************************************************** */
+/*                              Test Timestamp                                */
+/* ************************************************************************** */
+/**
+ * @brief Free running timestamp for benchmarks
+ * @note  Target counts CPU cycles with DWT. Native counts nanoseconds with `std::chrono::steady_clock`.
+ *        Always take the difference of two timestamps. The target counter wraps every 2^32 cycles.
+ * @note  DWT is NOT modelled by QEMU. The emulator reads TIM5 instead, which QEMU clocks at 1GHz of
+ *        virtual time. Under `-icount shift=0` one instruction takes exactly 1ns of virtual time, so
+ *        TIM5 counts retired instructions and every run gives the same numbers.
+ */
+namespace TestClock{
+
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6)
+typedef uint32_t tick_t;
+static constexpr const char *unit = "cyc";
+
+inline void init(void){
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT       = 0;
+  DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+inline tick_t now(void){
+  return DWT->CYCCNT;
+}
+
+inline double ticks_per_us(void){
+  return SystemCoreClock / 1e6;
+}
+#elif (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+typedef uint32_t tick_t;
+static constexpr const char *unit = "insn";
+
+inline void init(void){
+  __HAL_RCC_TIM5_CLK_ENABLE();
+  TIM5->PSC = 0;
+  TIM5->ARR = UINT32_MAX;
+  SET_BIT( TIM5->EGR, TIM_EGR_UG);
+  SET_BIT( TIM5->CR1, TIM_CR1_CEN);
+}
+
+inline tick_t now(void){
+  return TIM5->CNT;
+}
+
+/**
+ * @note Instructions per microsecond of the modelled core, assuming one instruction per cycle
+ */
+inline double ticks_per_us(void){
+  return SystemCoreClock / 1e6;
+}
+#elif (defined SYS_TARGET_NATIVE)
+typedef uint64_t tick_t;
+static constexpr const char *unit = "ns";
+
+inline void init(void){}
+
+inline tick_t now(void){
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline double ticks_per_us(void){
+  return 1000.0;
+}
+#endif
+
+} /* Namespace TestClock */
+
+
+
 /* ************************************************************************** */
 /*                            Test Bone Component                             */
 /* ************************************************************************** */
@@ -242,6 +322,204 @@ public:
 };
 
 
+/* ************************************************************************** */
+/*                            Benchmark Component                             */
+/* ************************************************************************** */
+/**
+ * @brief Benchmark Unit Family
+ * @note  The callable `void(uint32_t i)` is called `warmup` times untimed. Then `samples` timed
+ *        samples of `ops` calls each are taken with `TestClock`. `i` keeps counting across calls.
+ *        Each sample is converted into the cost per call. One line is printed per unit:
+ *
+ *          perf,<name>,<samples>,<ops>,<min>,<median>,<p99>,<unit>,<limit>,<verdict>
+ *
+ *        `<limit>` is the highest median accepted, or 0 if the unit is not gated.
+ *        `<verdict>` is one of `PASS`, `FAIL` and `INFO`.
+ *        `BenchCompareUnit` prints the `perf` line of both callables followed by:
+ *
+ *          ratio,<name>,<median ratio>,<limit>,<verdict>
+ *
+ *        The format is parsed by scripts. New fields may only be appended.
+ *
+ * @example
+ *          tb_infra_local
+ *            .insert(
+ *              BenchUnit( "bench_sin_q15", [](uint32_t i){ bench_keep( cmn_math_sin_q15(i)); }),
+ *              tTestBenchConfig{ 1000, 101, 1000},
+ *              TEST_BENCH_BASELINE( 40, 0, 0.25)           // 40cyc +25% on target. Report only on native.
+ *            )
+ *            .insert(
+ *              BenchCompareUnit( "bench_sin_q15_vs_libm",
+ *                                [](uint32_t i){ bench_keep( cmn_math_sin_q15(i)); },
+ *                                [](uint32_t i){ bench_keep( sinf(i)); }),
+ *              tTestBenchConfig{ 1000, 101, 1000},
+ *              TEST_BENCH_BASELINE( 1.0, 1.0, 0)           // Must never be slower than libm
+ *            );
+ */
+typedef struct stTestBenchConfig{
+  uint32_t warmup;     /*!< Untimed calls before the first sample */
+  uint32_t samples;    /*!< Number of timed samples */
+  uint32_t ops;        /*!< Calls per sample. Amortizes the cost of reading the timestamp */
+} tTestBenchConfig;
+
+typedef struct stTestBenchBaseline{
+  double cost;         /*!< Expected median per call in `TestClock::unit` (or the ratio). 0 means report only */
+  double tolerance;    /*!< Accepted regression. The unit fails if the median exceeds `cost*(1+tolerance)` */
+} tTestBenchBaseline;
+
+typedef struct stTestBenchResult{
+  double min;
+  double median;
+  double p99;
+} tTestBenchResult;
+
+/**
+ * @brief Pick the baseline of the running platform
+ * @note  Cycles on target and nanoseconds on native are not comparable. Use 0 to report only.
+ */
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  #define TEST_BENCH_BASELINE( target_cost, native_cost, tol)   (tTestBenchBaseline{ (double)(target_cost), (double)(tol)})
+#elif (defined SYS_TARGET_NATIVE)
+  #define TEST_BENCH_BASELINE( target_cost, native_cost, tol)   (tTestBenchBaseline{ (double)(native_cost), (double)(tol)})
+#endif
+
+/**
+ * @brief Keep a value alive so the measured code is not optimized away
+ */
+template<class T>
+inline void bench_keep(const T &x){
+  asm volatile("" : : "r"(&x) : "memory");
+}
+
+namespace TestBench{
+
+inline tTestBenchResult summarize( std::vector<double> &cost){
+  std::sort( cost.begin(), cost.end());
+  const size_t n = cost.size();
+  return tTestBenchResult{ cost[0], cost[n/2], cost[ (n*99 + 99)/100 - 1]};
+}
+
+/**
+ * @brief Take the timed samples of one or more callables
+ * @note  Samples of all callables are interleaved so a slow drift of the clock or the
+ *        host load affects every callable the same way.
+ */
+template<class... F>
+inline std::array<tTestBenchResult, sizeof...(F)> measure( const tTestBenchConfig &cfg, F&... func){
+  std::array<std::vector<double>, sizeof...(F)> cost;
+  const uint32_t samples = std::max<uint32_t>( cfg.samples, 1);
+  const uint32_t ops     = std::max<uint32_t>( cfg.ops, 1);
+  for(auto &c : cost){
+    c.reserve(samples);
+  }
+
+  TestClock::init();
+  uint32_t i = 0;
+  for(uint32_t w=0; w<cfg.warmup; ++w, ++i){
+    (func(i), ...);
+  }
+  for(uint32_t s=0; s<samples; ++s, i+=ops){
+    size_t k = 0;
+    ([&](auto &f){
+      TestClock::tick_t t0 = TestClock::now();
+      for(uint32_t j=0; j<ops; ++j){
+        f(i+j);
+      }
+      TestClock::tick_t t1 = TestClock::now();
+      cost[k++].push_back( (double)(TestClock::tick_t)(t1-t0) / ops);
+    }(func), ...);
+  }
+
+  std::array<tTestBenchResult, sizeof...(F)> result;
+  for(size_t k=0; k<sizeof...(F); ++k){
+    result[k] = summarize( cost[k]);
+  }
+  return result;
+}
+
+inline double limit_of( const tTestBenchBaseline &baseline){
+  return baseline.cost * (1 + baseline.tolerance);
+}
+
+inline const char *verdict_of( double value, double limit){
+  return (limit<=0) ? "INFO" : ((value<=limit) ? "PASS" : "FAIL");
+}
+
+inline void print( const char *name, const tTestBenchConfig &cfg, const tTestBenchResult &r, double limit){
+  cout<<"\nperf,"<<name<<','<<cfg.samples<<','<<cfg.ops<<','<<std::fixed<<std::setprecision(2)
+      <<r.min<<','<<r.median<<','<<r.p99<<','<<TestClock::unit<<','<<limit<<','<<verdict_of( r.median, limit);
+}
+
+/**
+ * @brief Measure about `ops` calls of `func` and print the cost per item. Report only.
+ * @note  Shorthand of `BenchUnit` without a baseline for the benches that print a table.
+ *        The calls are split into `TEST_BENCH_REPORT_SAMPLES` samples after a tenth of
+ *        them as warmup. A call handles `per_call` items, e.g. the pixels of a row.
+ * @return Median cost per item in `TestClock::unit`
+ */
+#define TEST_BENCH_REPORT_SAMPLES   (11)
+template<class F>
+inline double report( const char *name, uint32_t ops, F &&func, uint32_t per_call=1){
+  const tTestBenchConfig cfg = { ops/10, TEST_BENCH_REPORT_SAMPLES, std::max<uint32_t>( ops/TEST_BENCH_REPORT_SAMPLES, 1)};
+  tTestBenchResult       r   = measure( cfg, func)[0];
+  r.min    /= per_call;
+  r.median /= per_call;
+  r.p99    /= per_call;
+  print( name, cfg, r, 0);
+  return r.median;
+}
+
+} /* Namespace TestBench */
+
+
+/**
+ * @brief Benchmark of a single callable
+ * @note  Fails only if a baseline is given and the median exceeds it.
+ */
+template<class F>
+class BenchUnit : public TestUnitWrapper<tTestBenchConfig,tTestBenchBaseline>{
+private:
+  F _func;
+
+public:
+  BenchUnit(const std::string test_name, F func):TestUnitWrapper(test_name),_func(func){}
+
+  bool run( tTestBenchConfig& cfg, tTestBenchBaseline& baseline) override{
+    const tTestBenchResult r     = TestBench::measure( cfg, _func)[0];
+    const double           limit = TestBench::limit_of( baseline);
+    TestBench::print( this->name(), cfg, r, limit);
+    cout<<endl;
+    return limit<=0 || r.median<=limit;
+  }
+};
+
+/**
+ * @brief Benchmark of a candidate against a reference on the same machine
+ * @note  The baseline is the highest accepted `candidate/reference` ratio of the medians.
+ *        Unlike an absolute cost, the ratio holds across hosts and can gate native CI.
+ */
+template<class F, class G>
+class BenchCompareUnit : public TestUnitWrapper<tTestBenchConfig,tTestBenchBaseline>{
+private:
+  F _candidate;
+  G _reference;
+
+public:
+  BenchCompareUnit(const std::string test_name, F candidate, G reference):TestUnitWrapper(test_name),_candidate(candidate),_reference(reference){}
+
+  bool run( tTestBenchConfig& cfg, tTestBenchBaseline& baseline) override{
+    const auto   r     = TestBench::measure( cfg, _candidate, _reference);
+    const double ratio = r[0].median / std::max( r[1].median, 1e-9);
+    const double limit = TestBench::limit_of( baseline);
+    const std::string name = this->name();
+    TestBench::print( name.c_str(),            cfg, r[0], 0);
+    TestBench::print( (name+"_ref").c_str(),   cfg, r[1], 0);
+    cout<<"\nratio,"<<name<<','<<std::fixed<<std::setprecision(3)<<ratio<<','<<limit<<','<<TestBench::verdict_of( ratio, limit)<<endl;
+    return limit<=0 || ratio<=limit;
+  }
+};
+
+
 /* ************************************************************************** */
 /*                            Test Infrastructure                             */
 /* ************************************************************************** */
@@ -321,7 +599,7 @@ public:
   virtual void callback_if_passed( void){}
   virtual void callback_if_failed( void){}
 
-  void verdict(void){
+  bool verdict(void){
     const auto num_tests = _package.size();
     _cout<<"Number of tests in this batch: "<< num_tests<<'\n'<<endl;
     uint32_t cnt = 0;
@@ -340,6 +618,7 @@ public:
 #endif
       bool result = std::get<0>(item)->run( std::get<1>(item), std::get<2>(item));
       if(result==false){
+        v_result = false;
         _cout<<"FAILED"<<endl;
         _cout<<CONSOLE_FMT_RED<<"Error Signature:\n"<<std::get<0>(item)->info()<<CONSOLE_FMT_RESET<<endl;
       }else{
@@ -356,6 +635,7 @@ public:
     }else{
       callback_if_passed();
     }
+    return v_result;
   }
   
 
@@ -380,6 +660,7 @@ public:
 /* ************************************************************************** */
 /*                       Customized Test Infrastructure                       */
 /* ************************************************************************** */
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
 #include "bsp_led.h"    // Required by class `LocalProjectTest`
 /**
  * @brief Local Test Infrastructure
@@ -391,6 +672,16 @@ public:
   void callback_if_passed(void) override{bsp_led_on();}
   void callback_if_failed(void) override{bsp_led_off();}
 };
+#elif (defined SYS_TARGET_NATIVE)
+/**
+ * @brief Local Test Infrastructure
+ * @note  Native build has no LED. Verdict is returned to the shell instead.
+ */
+class LocalProjectTest : public Test{
+public:
+  using Test::Test;
+};
+#endif
 
 
 /**
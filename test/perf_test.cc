@@ -0,0 +1,319 @@
+/**
+ ******************************************************************************
+ * @file    perf_test.cc
+ * @author  RandleH
+ * @brief   Performance Regression Test Program
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 RandleH.
+ * All rights reserved.
+ *
+ * This software component is licensed by RandleH under BSD 3-Clause license,
+ * the "License"; You may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at:
+ *                        opensource.org/licenses/BSD-3-Clause
+ *
+ ******************************************************************************
+*/
+
+/**
+ * @note
+ *  Every unit prints one `perf,...` line (see `BenchUnit` in `test.hh`). The units never gate by
+ *  themselves. On the emulator the numbers are retired instructions under QEMU `-icount shift=0`,
+ *  which are reproducible, and `tool/perf.py` compares them against `test/perf_baseline.csv`.
+ *  On native the numbers are nanoseconds. `tool/perf.py --native` keeps them apart and only fails
+ *  a unit that got twice as slow.
+ */
+
+/* ************************************************************************** */
+/*                                  Includes                                  */
+/* ************************************************************************** */
+#include "test.hh"
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  #include "global.h"
+  #include "app_clock.h"
+  #include "lvgl.h"
+#elif (defined SYS_TARGET_NATIVE)
+  extern LocalProjectTest tb_infra_perf;
+#endif
+
+#include "perf_test.hh"
+#include "cmn_type.h"
+#include "cmn_math.h"
+#include "cmn_color.h"
+#include "cmn_utility.h"
+#include "cmn_ring.h"
+#include "cmn_line.h"
+#include "trace.h"
+#include "trace.hh"
+#include "profile.h"
+#include "memory.h"
+
+
+/* ************************************************************************** */
+/*                               Private Macros                               */
+/* ************************************************************************** */
+/**
+ * @note Instruction counts do not vary between samples. A few samples are enough.
+ */
+#define PERF_MICRO_CONFIG   (tTestBenchConfig{ 16, 5, 256})
+#define PERF_ROW_CONFIG     (tTestBenchConfig{  2, 5,  16})
+#define PERF_FRAME_CONFIG   (tTestBenchConfig{  1, 5,   1})
+#define PERF_REPORT_ONLY    TEST_BENCH_BASELINE( 0, 0, 0)
+
+
+/* ************************************************************************** */
+/*                                Clock Screens                               */
+/* ************************************************************************** */
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+/**
+ * @brief Needle update and render cost of one clock style
+ * @note  The style is brought up once and three units are reported:
+ *          <name>_needle     - `inc_time()` by one second. No render.
+ *          <name>_frame      - `inc_time()` by one second and render the invalidated area.
+ *          <name>_full_frame - Render the whole screen.
+ *        The flush is a dummy on the emulator, so only the CPU side is counted.
+ */
+class PerfClockStyle : public TestUnitWrapper<tTestBenchConfig,tTestBenchBaseline>{
+private:
+  AppGuiClockEnum_t _style;
+
+public:
+  PerfClockStyle(const std::string test_name, AppGuiClockEnum_t style):TestUnitWrapper(test_name),_style(style){}
+
+  bool run( tTestBenchConfig& cfg, tTestBenchBaseline& baseline) override{
+    tAppClock *p_clock = &metope.app.clock;
+    app_clock_bench_open( p_clock, _style);
+
+    auto needle = [&](uint32_t i){
+      p_clock->func.inc_time( &p_clock->param, 1000);
+    };
+    auto frame = [&](uint32_t i){
+      p_clock->func.inc_time( &p_clock->param, 1000);
+      lv_tick_inc(1000);
+      lv_refr_now(NULL);
+    };
+    auto full_frame = [&](uint32_t i){
+      lv_obj_invalidate( lv_scr_act());
+      lv_refr_now(NULL);
+    };
+
+    const std::string name = this->name();
+    TestBench::print( (name+"_needle").c_str(),     cfg, TestBench::measure( cfg, needle)[0],     0);
+    TestBench::print( (name+"_frame").c_str(),      cfg, TestBench::measure( cfg, frame)[0],      0);
+    TestBench::print( (name+"_full_frame").c_str(), cfg, TestBench::measure( cfg, full_frame)[0], 0);
+    cout<<endl;
+
+    app_clock_bench_close( p_clock);
+    return true;
+  }
+};
+#endif
+
+
+void add_perf_test(void){
+  tb_infra_perf
+    /* Formatting */
+    .insert(
+      BenchUnit( "perf_fmt_snprintf_hhmm", [](uint32_t i){
+        char buf[8];
+        cmn_utility_snprintf( buf, sizeof(buf), "%02d:%02d", (i>>6)%24, i%60);
+        bench_keep( buf);
+      }),
+      PERF_MICRO_CONFIG, PERF_REPORT_ONLY
+    )
+
+    .insert(
+      BenchUnit( "perf_fmt_trace_hhmm", [](uint32_t i){
+        char buf[8];
+        TRACE_FMT_SNPRINTF( buf, sizeof(buf), "%02d:%02d", (i>>6)%24, i%60);
+        bench_keep( buf);
+      }),
+      PERF_MICRO_CONFIG, PERF_REPORT_ONLY
+    )
+
+    .insert(
+      BenchUnit( "perf_fmt_int2strdec", [](uint32_t i){
+        char buf[12];
+        cmn_utility_int2strdec( buf, sizeof(buf), (int32_t)(i*2654435761U));
+        bench_keep( buf);
+      }),
+      PERF_MICRO_CONFIG, PERF_REPORT_ONLY
+    )
+
+    /* Trace. Deferred record vs. text line. The drain is amortized into the deferred side. */
+    .insert(
+      BenchUnit( "perf_trace_defer_line", [](uint32_t i){
+        TRACE_DEFER_PRINTF( FMT_INFO_STR "ms=%u H_rem=%u M_rem=%d deg=%03u", i, i%60, -(int32_t)i, i%360);
+        if( (i&15)==15 ){
+          uint8_t buf[TRACE_DEFER_RING_SIZE];
+          bench_keep( trace_defer_drain( buf, sizeof(buf)));
+        }
+      }),
+      PERF_MICRO_CONFIG, PERF_REPORT_ONLY
+    )
+
+    .insert(
+      BenchUnit( "perf_trace_text_line", [](uint32_t i){
+        char buf[64];
+        TRACE_FMT_SNPRINTF( buf, sizeof(buf), "%s" "ms=%u H_rem=%u M_rem=%d deg=%03u", FMT_INFO_STR, i, i%60, -(int32_t)i, i%360);
+        bench_keep( buf);
+      }),
+      PERF_MICRO_CONFIG, PERF_REPORT_ONLY
+    )
+
+    .insert(
+      BenchUnit( "perf_trace_crash_line", [](uint32_t i){
+        if( trace_crash.magic!=TRACE_CRASH_ARMED ){
+          trace_crash_clear();
+        }
+        TRACE_CRASH_PRINTF( FMT_INFO_STR "ms=%u H_rem=%u M_rem=%d deg=%03u", i, i%60, -(int32_t)i, i%360);
+      }),
+      PERF_MICRO_CONFIG, PERF_REPORT_ONLY
+    )
+
+    /* Profiling zone. Empty, i.e. the overhead added to every sample. */
+    .insert(
+      BenchUnit( "perf_profile_zone_empty", [](uint32_t i){
+        PROFILE_BEGIN( MISC);
+        PROFILE_END( MISC);
+      }),
+      PERF_MICRO_CONFIG, PERF_REPORT_ONLY
+    )
+
+    /* Allocation. The wrapper with its owner header and tracking vs. the C library. */
+    .insert(
+      BenchUnit( "perf_memory_malloc_free", [](uint32_t i){
+        void *p = MALLOC( 16 + (i&63));
+        bench_keep( p);
+        FREE( p);
+      }),
+      PERF_MICRO_CONFIG, PERF_REPORT_ONLY
+    )
+
+    .insert(
+      BenchUnit( "perf_memory_libc_malloc_free", [](uint32_t i){
+        void *p = malloc( 16 + (i&63));
+        bench_keep( p);
+        free( p);
+      }),
+      PERF_MICRO_CONFIG, PERF_REPORT_ONLY
+    )
+
+    /* UART transmit ring. Drained at once like an infinitely fast DMA. */
+    .insert(
+      BenchUnit( "perf_uart_ring_write_line", [](uint32_t i){
+        static uint8_t  storage[1024];
+        static tCmnRing ring = { storage, sizeof(storage), 0, 0, 0, 0, 0};
+        const uint8_t  *ptr;
+        char            line[50];
+        memset( line, 'a' + i%26, sizeof(line));
+        cmn_ring_write( &ring, line, sizeof(line));
+        for(size_t len = cmn_ring_claim( &ring, &ptr); len; len = cmn_ring_next( &ring, len, &ptr));
+      }),
+      PERF_MICRO_CONFIG, PERF_REPORT_ONLY
+    )
+
+    /* UART receive. One kilobyte of command lines cut from a circular buffer by 16-byte bursts, then read. */
+    .insert(
+      BenchUnit( "perf_uart_rx_line_kb", [](uint32_t i){
+        static uint8_t  rx_buf[64];
+        static char     slot[4*32];
+        static tCmnLine line;
+        static uint32_t pos = 0;
+        static const char text[] = "BRIGHTNESS 512\r\nPROF\r\nTOP\r\n";
+        if( line.rx_buf==NULL ){
+          cmn_line_init( &line, rx_buf, sizeof(rx_buf), slot, 4, 32);
+        }
+        for(uint32_t k=0; k<1024; ++k){
+          rx_buf[pos] = (uint8_t)text[(i+k)%(sizeof(text)-1)];
+          pos = (pos+1) & (sizeof(rx_buf)-1);
+          if( (pos&15)==0 ){
+            cmn_line_feed( &line, pos);
+            for(const char *cmd = cmn_line_front( &line); cmd; cmd = cmn_line_front( &line)){
+              bench_keep( cmd[0]);
+              cmn_line_pop( &line);
+            }
+          }
+        }
+      }),
+      PERF_ROW_CONFIG, PERF_REPORT_ONLY
+    )
+
+    /* Date math */
+    .insert(
+      BenchUnit( "perf_date_timeinc", [](uint32_t i){
+        static cmnDateTime_t time = {.word = 0};
+        static uint32_t      rem  = 0;
+        cmn_utility_timeinc( &rem, &time, 1000);
+        bench_keep( time);
+      }),
+      PERF_MICRO_CONFIG, PERF_REPORT_ONLY
+    )
+
+    .insert(
+      BenchUnit( "perf_date_timediff", [](uint32_t i){
+        cmnDateTime_t a = cmn_utility_epoch2datetime( i*86413U);
+        cmnDateTime_t b = cmn_utility_epoch2datetime( i*3607U);
+        bench_keep( cmn_utility_timediff( a, b));
+      }),
+      PERF_MICRO_CONFIG, PERF_REPORT_ONLY
+    )
+
+    .insert(
+      BenchUnit( "perf_date_weekday", [](uint32_t i){
+        bench_keep( cmn_utility_get_weekday( cmn_utility_epoch2datetime( i*86413U)));
+      }),
+      PERF_MICRO_CONFIG, PERF_REPORT_ONLY
+    )
+
+    /* Needle math */
+    .insert(
+      BenchUnit( "perf_needle_angleinc", [](uint32_t i){
+        static uint16_t hour_rem, minute_rem, second_rem;
+        uint16_t        hour_inc, minute_inc, second_inc;
+        cmn_utility_angleinc( &hour_rem, &minute_rem, &second_rem, &hour_inc, &minute_inc, &second_inc, 1000);
+        bench_keep( hour_inc + minute_inc + second_inc);
+      }),
+      PERF_MICRO_CONFIG, PERF_REPORT_ONLY
+    )
+
+    .insert(
+      BenchUnit( "perf_needle_angleset", [](uint32_t i){
+        uint16_t      hour_rem, minute_rem, second_rem, hour_deg, minute_deg, second_deg;
+        cmnDateTime_t time = cmn_utility_epoch2datetime( i*3607U);
+        cmn_utility_angleset( &hour_rem, &minute_rem, &second_rem, &hour_deg, &minute_deg, &second_deg, &time);
+        bench_keep( hour_deg + minute_deg + second_deg);
+      }),
+      PERF_MICRO_CONFIG, PERF_REPORT_ONLY
+    )
+
+    .insert(
+      BenchUnit( "perf_math_sincos_q15", [](uint32_t i){
+        cmnQ15_t s, c;
+        cmn_math_sincos_q15( (uint16_t)(i*40503U), &s, &c);
+        bench_keep( s + c);
+      }),
+      PERF_MICRO_CONFIG, PERF_REPORT_ONLY
+    )
+
+    /* Pixel kernels */
+    .insert(
+      BenchUnit( "perf_color_565_blend_row", [](uint32_t i){
+        static uint16_t dst[240], src[240];
+        cmn_color_565_blend( dst, src, 240, (uint8_t)(i|1), true);
+        bench_keep( dst);
+      }),
+      PERF_ROW_CONFIG, PERF_REPORT_ONLY
+    )
+  ;
+
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  tb_infra_perf
+    .insert( PerfClockStyle( "perf_clock_modern", kAppGuiClock_ClockModern), PERF_FRAME_CONFIG, PERF_REPORT_ONLY)
+    .insert( PerfClockStyle( "perf_clock_nana",   kAppGuiClock_NANA),        PERF_FRAME_CONFIG, PERF_REPORT_ONLY)
+    .insert( PerfClockStyle( "perf_clock_lvvvw",  kAppGuiClock_LVVVW),       PERF_FRAME_CONFIG, PERF_REPORT_ONLY)
+  ;
+#endif
+}
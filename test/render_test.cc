@@ -0,0 +1,330 @@
+/**
+ ******************************************************************************
+ * @file    render_test.cc
+ * @author  RandleH
+ * @brief   Clock Screen Golden Image Test Program
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 RandleH.
+ * All rights reserved.
+ *
+ * This software component is licensed by RandleH under BSD 3-Clause license,
+ * the "License"; You may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at:
+ *                        opensource.org/licenses/BSD-3-Clause
+ *
+ ******************************************************************************
+*/
+
+/**
+ * @note
+ *  Each scene brings up one clock style, moves it to a given time (and battery level), then
+ *  renders the whole screen through a flush that writes into a host file over semihosting.
+ *  The frame is compared to the golden image `test/golden/<scene>.ppm`:
+ *    - Match     : The frame file is removed.
+ *    - Mismatch  : The frame is kept as `test/golden/<scene>.actual.ppm` for inspection.
+ *    - No golden : The test fails. The frame is kept as above.
+ *  With `-DRENDER_GOLDEN_UPDATE=1` every frame is recorded as the golden image instead. Review and
+ *  commit them.
+ *  The render cost of every scene is printed as a `perf` line.
+ */
+
+/* ************************************************************************** */
+/*                                  Includes                                  */
+/* ************************************************************************** */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "test.hh"
+#include "render_test.hh"
+#if (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  #include "global.h"
+  #include "app_clock.h"
+  #include "lvgl.h"
+  #include "memory.h"
+#endif
+
+
+#if (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+/* ************************************************************************** */
+/*                               Private Macros                               */
+/* ************************************************************************** */
+#ifndef TEST_GOLDEN_DIR
+  #error "TEST_GOLDEN_DIR was NOT defined by test.cmake"
+#endif
+
+#ifndef TEST_GOLDEN_UPDATE
+  #define TEST_GOLDEN_UPDATE  (0)
+#endif
+
+#define PPM_HEADER        "P6\n240 240\n255\n"
+#define PPM_HEADER_LEN    (sizeof(PPM_HEADER)-1)
+
+static_assert( BSP_SCREEN_WIDTH==240 && BSP_SCREEN_HEIGHT==240, "Update `PPM_HEADER` to the screen size");
+
+
+namespace paramsTestRenderGolden{
+
+typedef struct stScene{
+  AppGuiClockEnum_t style;
+  cmnDateTime_t     time;
+  uint32_t          inc_ms;     /*!< Advance by `inc_time()` after `set_time()`. 0 means none */
+  int16_t           battery;    /*!< Battery level in the scale of 256. -1 means untouched */
+} Input;
+
+typedef struct stTolerance{
+  uint8_t  channel;             /*!< Accepted difference per 8-bit channel */
+  uint32_t max_pixel;           /*!< Number of pixels allowed to exceed `channel` */
+} Output;
+
+static inline cmnDateTime_t make_time( uint32_t year, uint32_t month, uint32_t day, uint32_t hour, uint32_t minute, uint32_t second){
+  cmnDateTime_t time = {.word = 0};
+  time.year   = year - CMN_DATE_YEAR_OFFSET;
+  time.month  = month;
+  time.day    = day;
+  time.hour   = hour;
+  time.minute = minute;
+  time.second = second;
+  return time;
+}
+
+/**
+ * @note Frame file being written by `host_flush_cb()`
+ */
+static FILE *host_frame = NULL;
+
+/**
+ * @brief Flush callback writing the area into a PPM file on the host
+ */
+static void host_flush_cb(lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_t *buf){
+  const lv_coord_t w = lv_area_get_width(area);
+  uint8_t          rgb[BSP_SCREEN_WIDTH*3];
+
+  for(lv_coord_t y=area->y1; y<=area->y2; ++y){
+    for(lv_coord_t x=0; x<w; ++x){
+      lv_color32_t c = { .full = lv_color_to32( buf[x]) };
+      rgb[3*x+0] = c.ch.red;
+      rgb[3*x+1] = c.ch.green;
+      rgb[3*x+2] = c.ch.blue;
+    }
+    fseek( host_frame, PPM_HEADER_LEN + 3*(y*BSP_SCREEN_WIDTH + area->x1), SEEK_SET);
+    fwrite( rgb, 3, w, host_frame);
+    buf += w;
+  }
+  lv_disp_flush_ready(disp_drv);
+}
+
+} /* Namespace paramsTestRenderGolden */
+
+
+/**
+ * @brief Golden image comparison of one scene
+ */
+class TestRenderGolden : public TestUnitWrapper<paramsTestRenderGolden::Input,paramsTestRenderGolden::Output>{
+private:
+  /**
+   * @brief Render the whole screen into `path`
+   */
+  bool render( const std::string &path){
+    using namespace paramsTestRenderGolden;
+    host_frame = fopen( path.c_str(), "wb+");
+    if(!host_frame){
+      this->_err_msg<<"Can NOT open "<<path<<" on the host. Is semihosting enabled?"<<endl;
+      return false;
+    }
+    fwrite( PPM_HEADER, 1, PPM_HEADER_LEN, host_frame);
+
+    lv_disp_t *disp     = lv_disp_get_default();
+    auto       flush_cb = disp->driver->flush_cb;
+    disp->driver->flush_cb = host_flush_cb;
+
+    const tTestBenchConfig cfg = { 0, 1, 1};
+    auto frame = [](uint32_t i){
+      lv_obj_invalidate( lv_scr_act());
+      lv_refr_now(NULL);
+    };
+    TestBench::print( (std::string("render_")+this->name()).c_str(), cfg, TestBench::measure( cfg, frame)[0], 0);
+    cout<<endl;
+
+    disp->driver->flush_cb = flush_cb;
+    fclose( host_frame);
+    host_frame = NULL;
+    return true;
+  }
+
+  /**
+   * @return Number of pixels exceeding the channel tolerance. `UINT32_MAX` if the files are NOT comparable
+   */
+  uint32_t compare( const std::string &actual, const std::string &golden, uint8_t channel){
+    FILE *fa = fopen( actual.c_str(), "rb");
+    FILE *fg = fopen( golden.c_str(), "rb");
+    uint32_t bad = UINT32_MAX;
+    char     ha[PPM_HEADER_LEN], hg[PPM_HEADER_LEN];
+
+    if( fa && fg && 1==fread( ha, PPM_HEADER_LEN, 1, fa) && 1==fread( hg, PPM_HEADER_LEN, 1, fg) && 0==memcmp( ha, hg, PPM_HEADER_LEN)){
+      uint8_t ra[BSP_SCREEN_WIDTH*3], rg[BSP_SCREEN_WIDTH*3];
+      bad = 0;
+      for(uint32_t y=0; y<BSP_SCREEN_HEIGHT; ++y){
+        if( 1!=fread( ra, sizeof(ra), 1, fa) || 1!=fread( rg, sizeof(rg), 1, fg)){
+          bad = UINT32_MAX;
+          break;
+        }
+        for(uint32_t x=0; x<BSP_SCREEN_WIDTH; ++x){
+          bool exceed = false;
+          for(uint32_t k=0; k<3; ++k){
+            exceed |= (uint8_t)std::abs( ra[3*x+k] - rg[3*x+k]) > channel;
+          }
+          bad += exceed;
+        }
+      }
+    }
+    if(fa) fclose(fa);
+    if(fg) fclose(fg);
+    return bad;
+  }
+
+public:
+  TestRenderGolden(const std::string test_name):TestUnitWrapper(test_name){}
+
+  bool run( paramsTestRenderGolden::Input& scene, paramsTestRenderGolden::Output& tol) override{
+    tAppClock        *p_clock = &metope.app.clock;
+    const std::string golden  = std::string(TEST_GOLDEN_DIR "/") + this->name() + ".ppm";
+    const std::string actual  = std::string(TEST_GOLDEN_DIR "/") + this->name() + ".actual.ppm";
+    bool              result  = true;
+
+    app_clock_bench_open( p_clock, scene.style);
+    p_clock->func.set_time( &p_clock->param, scene.time.word);
+    if( scene.inc_ms){
+      p_clock->func.inc_time( &p_clock->param, scene.inc_ms);
+    }
+    if( scene.battery>=0 && !app_clock_bench_set_battery( p_clock, (uint8_t)scene.battery)){
+      this->_err_msg<<"This clock style has no battery"<<endl;
+      result = false;
+    }
+    result = result && render( actual);
+    app_clock_bench_close( p_clock);
+    if(!result){
+      return false;
+    }
+
+#if (TEST_GOLDEN_UPDATE==1)
+    remove( golden.c_str());
+    rename( actual.c_str(), golden.c_str());
+    cout<<"golden,"<<this->name()<<",RECORDED"<<endl;
+    return true;
+#else
+    FILE *f = fopen( golden.c_str(), "rb");
+    if(!f){
+      this->_err_msg<<"No golden image "<<golden<<". Review "<<actual<<" and record it with -DRENDER_GOLDEN_UPDATE=1"<<endl;
+      return false;
+    }
+    fclose(f);
+#endif
+
+    uint32_t bad = compare( actual, golden, tol.channel);
+    cout<<"golden,"<<this->name()<<','<<bad<<','<<tol.max_pixel<<endl;
+    if( bad > tol.max_pixel){
+      this->_err_msg<<bad<<" pixels differ from "<<golden<<". See "<<actual<<endl;
+      return false;
+    }
+    remove( actual.c_str());
+    return true;
+  }
+};
+
+
+#if (MEMORY_TRACK==1)
+/**
+ * @brief Switching between the clock styles MUST NOT leave any tracked byte behind
+ * @note  One round of every style comes first, so the buffers LVGL keeps after the first use are
+ *        NOT taken as leaks. Input is the number of switches.
+ */
+class TestRenderStyleLeak : public TestUnitWrapper<uint32_t,uint8_t>{
+public:
+  TestRenderStyleLeak():TestUnitWrapper("render_style_leak"){}
+
+  bool run( uint32_t& input, uint8_t& ref) override{
+    const AppGuiClockEnum_t style[] = { kAppGuiClock_ClockModern, kAppGuiClock_NANA, kAppGuiClock_LVVVW};
+    const uint32_t          num     = sizeof(style)/sizeof(style[0]);
+    tAppClock              *p_clock = &metope.app.clock;
+
+    for(uint32_t i=0; i<num; ++i){
+      app_clock_bench_open( p_clock, style[i]);
+      app_clock_bench_close( p_clock);
+    }
+    const uint32_t bytes = memory_track.bytes;
+    const uint32_t count = memory_track.count;
+    const uint32_t since = memory_track_now();
+
+    for(uint32_t n=0; n<input; ++n){
+      app_clock_bench_open( p_clock, style[n%num]);
+      app_clock_bench_close( p_clock);
+    }
+    cout<<"memory,"<<this->name()<<','<<input<<','<<memory_track.peak<<','<<memory_track.lost<<endl;
+
+    if( memory_track.bytes!=bytes || memory_track.count!=count ){
+      static tMemoryTrackBlock block[8];
+      const size_t len = memory_track_blocks( block, 8, since);
+      this->_err_msg<<(int32_t)(memory_track.bytes-bytes)<<" bytes in "<<(int32_t)(memory_track.count-count)<<" blocks left behind"<<endl;
+      for(size_t i=0; i<len; ++i){
+        this->_err_msg<<"  "<<block[i].size<<" bytes from 0x"<<std::hex<<memory_track.site[block[i].site].site<<std::dec<<endl;
+      }
+      return false;
+    }
+    return true;
+  }
+};
+#endif
+#endif
+
+
+void add_render_test(void){
+#if (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  using namespace paramsTestRenderGolden;
+
+  /**
+   * @note One 565 step of red/blue is 8 in 8-bit. Rounding changes of a drawing path are accepted.
+   */
+  const Output tol = { 8, 0};
+
+  const struct{
+    const char        *name;
+    AppGuiClockEnum_t  style;
+  } styles[] = {
+    { "modern", kAppGuiClock_ClockModern},
+    { "nana",   kAppGuiClock_NANA       },
+    { "lvvvw",  kAppGuiClock_LVVVW      }
+  };
+
+  const struct{
+    const char *name;
+    Input       scene;
+  } scenes[] = {
+    { "midnight",  { kAppGuiClock_None, make_time( 2022,  1,  1,  0,  0,  0),    0, -1}},
+    { "0347",      { kAppGuiClock_None, make_time( 2024,  7, 15,  3, 47,  0),    0, -1}},
+    { "1259",      { kAppGuiClock_None, make_time( 2024,  7, 15, 12, 59,  0),    0, -1}},
+    { "rollover",  { kAppGuiClock_None, make_time( 2023, 12, 31, 23, 59, 59), 1000, -1}}
+  };
+
+  for(const auto &style : styles){
+    for(const auto &scene : scenes){
+      Input input = scene.scene;
+      input.style = style.style;
+      tb_infra_render.insert( TestRenderGolden( std::string(style.name) + "_" + scene.name), input, tol);
+    }
+  }
+
+  for(int16_t battery : {0, 64, 128, 192, 255}){
+    tb_infra_render.insert(
+      TestRenderGolden( std::string("modern_battery_") + std::to_string(battery)),
+      Input{ kAppGuiClock_ClockModern, make_time( 2024, 7, 15, 10, 10, 30), 0, battery},
+      tol
+    );
+  }
+
+#if (MEMORY_TRACK==1)
+  tb_infra_render.insert( TestRenderStyleLeak(), (uint32_t)1000, (uint8_t)0);
+#endif
+#endif
+}
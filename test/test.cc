@@ -141,6 +141,7 @@ ostream& ostream::operator<<(const char *str){
 /* ************************************************************************** */
 /*                       Standard I/O Stream Retargeting                      */
 /* ************************************************************************** */
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
 #ifdef __cplusplus
 extern "C"
 {
@@ -228,6 +229,7 @@ GETCHAR_PROTOTYPE{
 #ifdef __cplusplus
 } //extern "C"
 #endif
+#endif // Native build uses the host standard I/O
 
 
 
@@ -4,8 +4,75 @@ file(GLOB_RECURSE SRC_DIR__TEST CONFIGURE_DEPENDS   "${PRJ_TOP}/test/include/.h"
                                                     "${PRJ_TOP}/test/*.c" )
 
 
+# Compile-time only test cases are NOT part of the test bench
+list( FILTER SRC_DIR__TEST EXCLUDE REGEX "${PRJ_TOP}/test/fail/.*")
+
 list( APPEND SRC_LIST ${SRC_DIR__TEST})
 
+# Performance test bench is opt-in
+if( NOT (INCLUDE_TB_PERF AND INCLUDE_TB_PERF EQUAL 1))
+    list( REMOVE_ITEM SRC_LIST "${PRJ_TOP}/test/perf_test.cc")
+endif()
+
+# Golden image test bench is opt-in. Frames are read and written on the host through semihosting.
+if( INCLUDE_TB_RENDER AND INCLUDE_TB_RENDER EQUAL 1)
+    list( APPEND DEF_LIST "-DTEST_GOLDEN_DIR=\"${PRJ_TOP}/test/golden\"")
+else()
+    list( REMOVE_ITEM SRC_LIST "${PRJ_TOP}/test/render_test.cc")
+endif()
+
+if($ENV{METOPE_CHIP} STREQUAL "NATIVE")
+    list( APPEND SRC_LIST_TO_BE_REMOVED     "${PRJ_TOP}/test/bsp_test.cc"
+                                            "${PRJ_TOP}/test/app_test.cc" )
+
+    message( STATUS "Remove the test source files: ${SRC_LIST_TO_BE_REMOVED}")
+    list( REMOVE_ITEM SRC_LIST ${SRC_LIST_TO_BE_REMOVED})
+
+    # Native test bench returns the verdict to the shell
+    enable_testing()
+    add_test( NAME native_unit_test COMMAND ${PROJECT_NAME}.elf)
+
+    # Broken trace format strings MUST be rejected at compile time with the expected diagnostic
+    set( TRACE_FMT_FAIL_DIAG    "" 
+                                "too few arguments"
+                                "too many arguments"
+                                "take an integer, not a string"
+                                "takes a C string, not an integer"
+                                "integer of at most 32 bits"
+                                "argument type is not printable"
+                                "unsupported conversion specifier"
+                                "width must be a single digit"
+                                "width is not supported by"
+                                "dangling")
+    list( LENGTH TRACE_FMT_FAIL_DIAG TRACE_FMT_FAIL_NUM)
+    math( EXPR TRACE_FMT_FAIL_NUM "${TRACE_FMT_FAIL_NUM}-1")
+    foreach( CASE RANGE ${TRACE_FMT_FAIL_NUM})
+        list( GET TRACE_FMT_FAIL_DIAG ${CASE} DIAG)
+        add_test( NAME trace_fmt_fail_${CASE}
+                  COMMAND ${CMAKE_CXX_COMPILER} -std=gnu++17 -fsyntax-only -DTRACE_FMT_FAIL_CASE=${CASE}
+                          -I${PRJ_TOP}/top -I${PRJ_TOP}/cmn/include ${PRJ_TOP}/test/fail/trace_fmt_fail.cc)
+        if( NOT DIAG STREQUAL "")
+            set_tests_properties( trace_fmt_fail_${CASE} PROPERTIES PASS_REGULAR_EXPRESSION "TRACE: [^\n]*${DIAG}")
+        endif()
+    endforeach()
+
+    # Frame codec of the host tool against a pseudo terminal loopback
+    find_package( Python3 COMPONENTS Interpreter)
+    if( Python3_FOUND)
+        add_test( NAME uart_frame_selftest COMMAND ${Python3_EXECUTABLE} ${PRJ_TOP}/tool/uart.py --selftest)
+    endif()
+else()
+    # CMSIS-DSP reference kernels for the fixed point math benchmark
+    set( SRC_CMSIS_DSP  "${PRJ_TOP}/lib/STM32CubeF4/Drivers/CMSIS/DSP/Source/ControllerFunctions/arm_sin_cos_q31.c"
+                        "${PRJ_TOP}/lib/STM32CubeF4/Drivers/CMSIS/DSP/Source/CommonTables/arm_common_tables.c" )
+    list( GET SRC_CMSIS_DSP 0 SRC_CMSIS_DSP_0)
+    list( GET SRC_CMSIS_DSP 1 SRC_CMSIS_DSP_1)
+    if( EXISTS ${SRC_CMSIS_DSP_0} AND EXISTS ${SRC_CMSIS_DSP_1})
+        list( APPEND SRC_LIST ${SRC_CMSIS_DSP})
+        list( APPEND DEF_LIST "-DTB_CMSIS_DSP=1")
+    endif()
+endif()
+
 
 set( INC_DIR__TEST "")
 GET_SUBDIR( INC_DIR__TEST ${PRJ_TOP}/test)
@@ -0,0 +1,128 @@
+import argparse
+import re
+import sys
+
+
+parser = argparse.ArgumentParser(description="Generate the perfect hash of the command box keywords from `APP_CMDBOX_LIST` in `app_cmdbox.h`.")
+parser.add_argument("--input",  "-i", type=str, default="app/include/app_cmdbox.h",      help="Header holding `APP_CMDBOX_LIST`")
+parser.add_argument("--output", "-o", type=str, default="app/include/app_cmdbox_hash.h", help="Generated header")
+parser.add_argument("--check",  "-c", action="store_true",                                  help="Fail if the generated header is out of date instead of writing it")
+(params, unknown_args) = parser.parse_known_args()
+
+
+FNV_PRIME   = 0x01000193
+MAX_SEED    = 1 << 20
+
+
+def parse_list(text):
+  """
+  @brief  Collect the keywords of `APP_CMDBOX_LIST` in order
+  @return [keyword]
+  """
+  match = re.search(r"#define\s+APP_CMDBOX_LIST\s*\(\s*X\s*\)((?:.*\\\n)*.*)", text)
+  if match is None:
+    return None
+  return re.findall(r"X\(\s*(\w+)\s*,\s*\d+\s*\)", match.group(1))
+
+
+def hash_keyword(seed, keyword, bits):
+  """
+  @brief  Same as `APP_CMDBOX_HASH_STEP()` and `APP_CMDBOX_HASH_SLOT()` in `app_cmdbox.c`
+  """
+  h = seed
+  for c in keyword.upper().encode():
+    h = ((h ^ c) * FNV_PRIME) & 0xFFFFFFFF
+  return h >> (32 - bits)
+
+
+def search(keyword):
+  """
+  @brief  Smallest table with at least twice the slots of the keywords, then the first seed without collisions
+  @return (seed, bits, table)
+  """
+  bits = 1
+  while (1 << bits) < 2 * len(keyword):
+    bits += 1
+  for seed in range(1, MAX_SEED):
+    table = [0] * (1 << bits)
+    for (i, k) in enumerate(keyword):
+      slot = hash_keyword(seed, k, bits)
+      if table[slot]:
+        break
+      table[slot] = i + 1
+    else:
+      return (seed, bits, table)
+  return None
+
+
+def render(seed, bits, table, num):
+  rows = []
+  for i in range(0, len(table), 16):
+    rows.append("  " + " ".join("{:2},".format(v) for v in table[i:i+16]))
+  return """/**
+ ******************************************************************************
+ * @file    app_cmdbox_hash.h
+ * @author  RandleH
+ * @brief   Application Program - Command Box Keyword Hash
+ ******************************************************************************
+ * @attention
+ *
+ * Generated by `tool/cmdbox.py` from `APP_CMDBOX_LIST` in `app_cmdbox.h`.
+ * DO NOT EDIT.
+ *
+ ******************************************************************************
+*/
+
+#ifndef APP_CMDBOX_HASH_H
+#define APP_CMDBOX_HASH_H
+
+#include <stdint.h>
+
+#define APP_CMDBOX_HASH_SEED    (0x{seed:08X}U)
+#define APP_CMDBOX_HASH_BITS    ({bits})
+#define APP_CMDBOX_HASH_NUM     ({num})
+
+/**
+ * @note Slot => index of the keyword in `APP_CMDBOX_LIST` plus 1. `0` is empty.
+ */
+static const uint8_t APP_CMDBOX_HASH_TABLE[1U<<APP_CMDBOX_HASH_BITS] = {{
+{rows}
+}};
+
+#endif
+/* ********************************** EOF *********************************** */
+""".format(seed=seed, bits=bits, num=num, rows="\n".join(rows))
+
+
+if __name__ == "__main__":
+  with open(params.input) as f:
+    keyword = parse_list(f.read())
+  if not keyword:
+    print("[cmdbox]: No `APP_CMDBOX_LIST` was found in {}".format(params.input))
+    sys.exit(1)
+  if len(set(k.upper() for k in keyword)) != len(keyword):
+    print("[cmdbox]: Duplicated keywords in `APP_CMDBOX_LIST`")
+    sys.exit(1)
+
+  result = search(keyword)
+  if result is None:
+    print("[cmdbox]: No perfect hash was found")
+    sys.exit(1)
+
+  (seed, bits, table) = result
+  text = render(seed, bits, table, len(keyword))
+  if params.check:
+    try:
+      with open(params.output) as f:
+        same = (f.read() == text)
+    except FileNotFoundError:
+      same = False
+    if not same:
+      print("[cmdbox]: {} is out of date. Run `python3 tool/cmdbox.py` and commit it".format(params.output))
+      sys.exit(1)
+    print("[cmdbox]: {} is up to date".format(params.output))
+    sys.exit(0)
+
+  with open(params.output, "w") as f:
+    f.write(text)
+  print("[cmdbox]: {} keywords in {} slots with seed 0x{:08X} => {}".format(len(keyword), 1 << bits, seed, params.output))
@@ -0,0 +1,171 @@
+import argparse
+import csv
+import os
+import subprocess
+import sys
+
+
+parser = argparse.ArgumentParser(description="Run the performance test bench under QEMU `-icount` and compare against the baseline.")
+parser.add_argument("--elf",       "-e", type=str,   default="build/model1.elf",        help="Emulator build with `-DUNIT_TEST=1 -DINCLUDE_TB_PERF=1`")
+parser.add_argument("--native",    "-n", action="store_true",                           help="Run a native build on the host instead of QEMU")
+parser.add_argument("--log",       "-l", type=str,   default="",                        help="Parse an existing log instead of running QEMU")
+parser.add_argument("--baseline",  "-b", type=str,   default="test/perf_baseline.csv",  help="Baseline file. One `name,median,unit` row per unit and platform")
+parser.add_argument("--threshold", "-t", type=float, default=None,                      help="Accepted regression ratio. eg: 0.02 fails above +2%%. Default: 0.02 for `insn`, 1.00 for `ns`")
+parser.add_argument("--update",    "-u", action="store_true",                           help="Write the measured numbers into the baseline file. Required to add or drop a unit")
+parser.add_argument("--qemu",            type=str,   default="qemu-system-arm",         help="QEMU binary")
+parser.add_argument("--timeout",         type=int,   default=1800,                      help="Timeout in seconds")
+(params, unknown_args) = parser.parse_known_args()
+
+
+"""
+@note
+  `-icount shift=0` advances the virtual clock by exactly 1ns per instruction. The firmware reads
+  the virtual clock with TIM5 at 1GHz, so the numbers are instruction counts and are the same on
+  every host. `sleep=off` and `align=off` keep the host speed out of the virtual clock.
+"""
+QEMU_ARGS = [ "-M", "netduinoplus2", "-nographic",
+              "-icount", "shift=0,align=off,sleep=off",
+              "-semihosting-config", "enable=on,target=native"]
+
+"""
+@note
+  Native numbers are wall clock nanoseconds of the host the baseline was recorded on. They only
+  catch gross regressions and need to be recorded again with `--update` on another host.
+"""
+THRESHOLD = { "insn": 0.02, "ns": 1.00}
+
+
+def run_qemu():
+  cmd = [params.qemu] + QEMU_ARGS + ["-kernel", params.elf]
+  print("[perf]: " + " ".join(cmd))
+  try:
+    proc = subprocess.run( cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, timeout=params.timeout)
+  except subprocess.TimeoutExpired as e:
+    print("[perf]: QEMU timed out after {}s".format(params.timeout))
+    return (e.stdout or b"").decode("utf-8", "replace")
+  return proc.stdout.decode("utf-8", "replace")
+
+
+def run_native():
+  print("[perf]: " + params.elf)
+  try:
+    proc = subprocess.run( [params.elf], stdout=subprocess.PIPE, stderr=subprocess.STDOUT, timeout=params.timeout)
+  except subprocess.TimeoutExpired as e:
+    print("[perf]: Native run timed out after {}s".format(params.timeout))
+    return (e.stdout or b"").decode("utf-8", "replace")
+  return proc.stdout.decode("utf-8", "replace")
+
+
+def parse_log(text):
+  """
+  @brief  Collect the `perf` lines of the log
+  @note   perf,<name>,<samples>,<ops>,<min>,<median>,<p99>,<unit>,<limit>,<verdict>
+  @return ({name: (median, unit)}, firmware verdict)
+  """
+  result  = {}
+  verdict = None
+  in_perf = False
+  for line in text.splitlines():
+    line = line.strip()
+    if line.startswith("Performance Test:"):
+      in_perf = True
+    elif in_perf and line.startswith("perf,"):
+      field = line.split(",")
+      if len(field) >= 10:
+        result[field[1]] = (float(field[5]), field[7])
+    elif in_perf and line.startswith("Test completed. Verdict result:"):
+      verdict = line.split(":")[1].strip()
+      in_perf = False
+  return (result, verdict)
+
+
+def load_baseline(path):
+  """
+  @return {unit: {name: median}}
+  """
+  baseline = {}
+  if os.path.exists(path):
+    with open(path, newline="") as f:
+      for row in csv.reader(f):
+        if not row or row[0].startswith("#") or row[0]=="name":
+          continue
+        baseline.setdefault(row[2], {})[row[0]] = float(row[1])
+  return baseline
+
+
+def save_baseline(path, result):
+  """
+  @note Rows of the other platforms are kept
+  """
+  baseline = load_baseline(path)
+  for unit in set(u for (_, u) in result.values()):
+    baseline[unit] = {}
+  for name, (value, unit) in result.items():
+    baseline[unit][name] = value
+  with open(path, "w", newline="") as f:
+    f.write("# Generated by tool/perf.py --update. Median per call: `insn` under QEMU -icount shift=0, `ns` on a native host.\n")
+    w = csv.writer(f, lineterminator="\n")
+    w.writerow(["name", "median", "unit"])
+    for unit in sorted(baseline):
+      for name in sorted(baseline[unit]):
+        w.writerow([name, "{:.2f}".format(baseline[unit][name]), unit])
+
+
+def compare(result, baseline):
+  """
+  @note A unit missing on either side fails. The baseline is only changed by `--update`.
+  """
+  failed = False
+  unit   = next(iter(result.values()))[1]
+  base_of_unit = baseline.get(unit, {})
+  threshold    = params.threshold if params.threshold is not None else THRESHOLD.get(unit, 0.02)
+  print("\n{:<40} {:>14} {:>14} {:>9}  {}".format("name", "baseline", "measured", "delta", "status"))
+  for name in sorted(set(result) | set(base_of_unit)):
+    if name not in result:
+      print("{:<40} {:>14.2f} {:>14} {:>9}  MISSING (run --update)".format(name, base_of_unit[name], "-", "-"))
+      failed = True
+      continue
+    value = result[name][0]
+    if name not in base_of_unit:
+      print("{:<40} {:>14} {:>14.2f} {:>9}  NEW (run --update)".format(name, "-", value, "-"))
+      failed = True
+      continue
+    base  = base_of_unit[name]
+    delta = (value - base) / base if base>0 else 0.0
+    if delta > threshold:
+      status = "REGRESSED"
+      failed = True
+    elif delta < -threshold:
+      status = "IMPROVED (run --update)"
+    else:
+      status = "OK"
+    print("{:<40} {:>14.2f} {:>14.2f} {:>+8.2f}%  {}".format(name, base, value, 100*delta, status))
+  return failed
+
+
+if __name__ == "__main__":
+  if params.log:
+    with open(params.log) as f:
+      text = f.read()
+  elif params.native:
+    text = run_native()
+  else:
+    text = run_qemu()
+
+  (result, verdict) = parse_log(text)
+  if not result:
+    print(text)
+    print("[perf]: No `perf` line was found. Was the firmware built with -DUNIT_TEST=1 -DINCLUDE_TB_PERF=1?")
+    sys.exit(1)
+
+  if params.update:
+    save_baseline(params.baseline, result)
+    print("[perf]: {} units written to {}".format(len(result), params.baseline))
+    sys.exit(0)
+
+  failed = compare(result, load_baseline(params.baseline))
+  if verdict!="PASSED":
+    print("[perf]: Firmware verdict is {}".format(verdict))
+    failed = True
+  print("\n[perf]: " + ("FAILED" if failed else "PASSED"))
+  sys.exit(1 if failed else 0)
@@ -0,0 +1,174 @@
+import argparse
+import json
+import re
+import sys
+
+
+parser = argparse.ArgumentParser(description="Convert the `TIMELINE` dump into the Chrome trace JSON. Open it in ui.perfetto.dev or chrome://tracing.")
+parser.add_argument("--log",    "-l", type=str, default="",              help="Log holding the `tl,` lines. Read stdin when empty")
+parser.add_argument("--output", "-o", type=str, default="timeline.json", help="Chrome trace JSON")
+(params, unknown_args) = parser.parse_known_args()
+
+
+"""
+@note
+  Exception numbers of the interrupt handlers recording their entry and exit. See `cmn/cmn_interrupt.c`.
+  The IRQ number of the STM32F4 vector table plus 16.
+"""
+ISR_NAME = {
+  15: "SysTick",
+  22: "EXTI0",
+  23: "EXTI1",
+  27: "DMA1_Stream0",
+  31: "DMA1_Stream4",
+  33: "DMA1_Stream6",
+  39: "EXTI9_5",
+  40: "TIM1_BRK_TIM9",
+  44: "TIM2",
+  47: "I2C1_EV",
+  48: "I2C1_ER",
+  52: "SPI2",
+  54: "USART2",
+  56: "EXTI15_10",
+}
+
+PID        = 1
+TID_ISR    = 1
+TID_TASK   = 100        # Task number N is drawn on the thread `TID_TASK + N`
+TID_UNKNOWN= TID_TASK   # Whatever ran before the first switch. Task numbers start from 1.
+
+
+def parse_log(text):
+  """
+  @brief  Collect the last dump of the log
+  @note   tl,hz,<hz> | tl,task,<num>,<name> | tl,zone,<id>,<name> | tl,ev,<tick>,<type>,<id hex> | tl,end,<lost>
+  @return (hz, {task number: name}, {zone id: name}, [(tick, type, id)], lost)
+  """
+  dump = None
+  for line in text.splitlines():
+    match = re.search(r"\btl,\w+,.*", line)
+    if match is None:
+      continue
+    field = match.group(0).strip().split(",")
+    if field[1]=="hz":
+      dump = { "hz": int(field[2]), "task": {}, "zone": {}, "event": [], "lost": 0, "done": False }
+    elif dump is None or dump["done"]:
+      continue
+    elif field[1]=="task" and len(field)>=4:
+      dump["task"][int(field[2])] = field[3]
+    elif field[1]=="zone" and len(field)>=4:
+      dump["zone"][int(field[2])] = field[3]
+    elif field[1]=="ev" and len(field)>=5:
+      dump["event"].append((int(field[2]), field[3], int(field[4], 16)))
+    elif field[1]=="end":
+      dump["lost"] = int(field[2])
+      dump["done"] = True
+  if dump is None:
+    return None
+  return (dump["hz"], dump["task"], dump["zone"], dump["event"], dump["lost"])
+
+
+def unwrap(event):
+  """
+  @brief  Extend the 32-bit ticks and sort the events by time
+  @note   Zone begins are recorded when the zone ends, so the ring is not strictly in order. Each tick
+          is taken as the nearest one to the previous event, which holds while the gap is below 2^31 ticks.
+  """
+  result = []
+  prev_raw = None
+  now      = 0
+  for (seq, (tick, kind, ident)) in enumerate(event):
+    if prev_raw is not None:
+      delta = (tick - prev_raw) & 0xFFFFFFFF
+      if delta >= 0x80000000:
+        delta -= 0x100000000
+      now += delta
+    prev_raw = tick
+    result.append((now, seq, kind, ident))
+  result.sort()
+  return result
+
+
+def convert(hz, task_name, zone_name, event):
+  """
+  @brief  One thread per task with its running slices, zones and kernel events. One thread for the interrupts.
+  """
+  event = unwrap(event)
+  if not event:
+    return []
+  origin = event[0][0]
+  def us(tick):
+    return (tick - origin) * 1e6 / hz
+
+  def task_tid(num):
+    return TID_TASK + num
+
+  out  = []
+  tids = { TID_ISR: "ISR" }
+
+  # Zones are paired in ring order first. An interrupt may be recorded between the begin and the end.
+  zone_open = {}
+  zone_pair = {}
+  for (tick, seq, kind, ident) in sorted(event, key=lambda e: e[1]):
+    if kind=="zb":
+      zone_open.setdefault(ident, []).append((tick, seq))
+    elif kind=="ze" and zone_open.get(ident):
+      zone_pair[seq] = zone_open[ident].pop()
+
+  current = None      # (task number, switched in at)
+  isr     = []        # (exception number, entered at)
+  for (tick, seq, kind, ident) in event:
+    tid = task_tid(current[0]) if current else TID_UNKNOWN
+    if kind=="in":
+      if current:
+        out.append({ "name": task_name.get(current[0], "task{}".format(current[0])), "ph": "X", "pid": PID, "tid": tid,
+                     "ts": us(current[1]), "dur": us(tick) - us(current[1]) })
+      current = (ident, tick)
+      tids[task_tid(ident)] = task_name.get(ident, "task{}".format(ident))
+    elif kind=="isr":
+      isr.append((ident, tick))
+    elif kind=="iret":
+      if isr and isr[-1][0]==ident:
+        (num, start) = isr.pop()
+        out.append({ "name": ISR_NAME.get(num, "IRQ{}".format(num-16)), "ph": "X", "pid": PID, "tid": TID_ISR,
+                     "ts": us(start), "dur": us(tick) - us(start) })
+    elif kind=="ze":
+      if seq in zone_pair:
+        start = zone_pair[seq][0]
+        out.append({ "name": zone_name.get(ident, "zone{}".format(ident)), "ph": "X", "pid": PID,
+                     "tid": TID_ISR if isr else tid, "ts": us(start), "dur": us(tick) - us(start) })
+    elif kind in ("qblk", "qtake", "qgive", "ewait", "eset"):
+      out.append({ "name": kind, "ph": "i", "s": "t", "pid": PID, "tid": TID_ISR if isr else tid,
+                   "ts": us(tick), "args": { "id": "0x{:06X}".format(ident) } })
+    if current is None and kind!="in":
+      tids.setdefault(TID_UNKNOWN, "unknown")
+
+  last = event[-1][0]
+  if current:
+    out.append({ "name": task_name.get(current[0], "task{}".format(current[0])), "ph": "X", "pid": PID,
+                 "tid": task_tid(current[0]), "ts": us(current[1]), "dur": us(last) - us(current[1]) })
+
+  meta = [{ "name": "process_name", "ph": "M", "pid": PID, "args": { "name": "Metope" } }]
+  for (tid, name) in sorted(tids.items()):
+    meta.append({ "name": "thread_name",       "ph": "M", "pid": PID, "tid": tid, "args": { "name": name } })
+    meta.append({ "name": "thread_sort_index", "ph": "M", "pid": PID, "tid": tid, "args": { "sort_index": tid } })
+  return meta + out
+
+
+if __name__ == "__main__":
+  if params.log:
+    with open(params.log, errors="replace") as f:
+      text = f.read()
+  else:
+    text = sys.stdin.read()
+
+  dump = parse_log(text)
+  if dump is None:
+    print("[timeline]: No `tl,hz` line was found. Was the firmware built with -DTIMELINE=1?")
+    sys.exit(1)
+
+  (hz, task_name, zone_name, event, lost) = dump
+  trace = convert(hz, task_name, zone_name, event)
+  with open(params.output, "w") as f:
+    json.dump({ "traceEvents": trace, "displayTimeUnit": "ns" }, f)
+  print("[timeline]: {} events ({} overwritten) at {}Hz => {}".format(len(event), lost, hz, params.output))
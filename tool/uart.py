@@ -1,9 +1,12 @@
-import serial
 import argparse
 import os
 import asyncio
-import serial_asyncio
+import collections
+import re
+import struct
 import sys
+import threading
+import time
 
 
 parser = argparse.ArgumentParser()
@@ -11,6 +14,11 @@ parser.add_argument("--baudrate", "-b", type=int, default=115200             , h
 parser.add_argument("--port",     "-p", type=str, default="tty.usbserial-A50", help="System Device Port. Find the tty using `grep /dev/tty*`")
 parser.add_argument("--timeout",  "-t", type=int, default=1,                   help="Timeout in seconds.")
 parser.add_argument("--logfile",  "-l", type=str, default="",                  help="Log to file.")
+parser.add_argument("--table",          type=str, default="build/model1.trace", help="Format string table of the deferred trace. Built with `-DTRACE_DEFER=1`")
+parser.add_argument("--decode",   "-d", type=str, default="",                  help="Decode a captured UART stream instead of opening the port")
+parser.add_argument("--script",   "-s", type=str, default="",                  help="Send the command lines of a file without waiting for each reply, then exit. `;` batches commands in one line.")
+parser.add_argument("--window",   "-w", type=int, default=4,                   help="Lines in flight with `--script`. At most `BSP_CFG_UART_RX_LINE_NUM`")
+parser.add_argument("--selftest",       action="store_true",                   help="Check the frame codec over a pseudo-terminal loopback, then exit. Linux only.")
 (params, unknown_args) = parser.parse_known_args()
 
 
@@ -23,6 +31,201 @@ else:
 
 
 
+"""
+@note
+  Binary frames multiplexed with the text lines. See `cmn/include/cmn_frame.h`.
+  On the wire: 0x00 | COBS( type | payload | CRC-16 LE ) | 0x00
+"""
+FRAME_DELIMITER = 0x00
+FRAME_REPLY     = 0x80
+FRAME_NAK       = 0xFF
+FRAME_TYPE      = { "PING": 0x01, "TIME": 0x02 }    # `APP_CMDBOX_FRAME_LIST` in `app/include/app_cmdbox.h`
+FRAME_GOLDEN    = ( 0x01, b"\x00\x11\x00Metope\r\n",  # Also checked by `test_cmn_frame`
+                    bytes.fromhex("00020102110b4d65746f70650d0ab6cc00") )
+
+def crc16(data, crc=0xFFFF):
+  """
+  @brief CRC-16/CCITT-FALSE. Same as `cmn_frame_crc16()`.
+  """
+  for b in data:
+    x    = ((crc >> 8) ^ b) & 0xFF
+    x   ^= x >> 4
+    crc  = ((crc << 8) ^ (x << 12) ^ (x << 5) ^ x) & 0xFFFF
+  return crc
+
+def cobs_encode(data):
+  out  = bytearray([0])
+  code = 0
+  for b in data:
+    if b != 0:
+      out.append(b)
+      if len(out) - code < 0xFF:
+        continue
+    out[code] = len(out) - code
+    code = len(out)
+    out.append(0)
+  out[code] = len(out) - code
+  return bytes(out)
+
+def cobs_decode(body):
+  """
+  @return Decoded bytes. `None` if the body is malformed.
+  """
+  out = bytearray()
+  i   = 0
+  while i < len(body):
+    code = body[i]
+    i   += 1
+    if code == 0 or i + code - 1 > len(body) or 0 in body[i:i+code-1]:
+      return None
+    out += body[i:i+code-1]
+    i   += code - 1
+    if code != 0xFF and i < len(body):
+      out.append(0)
+  return bytes(out) if out else None
+
+def frame_encode(ftype, payload=b""):
+  raw = bytes([ftype]) + bytes(payload)
+  return bytes([FRAME_DELIMITER]) + cobs_encode(raw + struct.pack("<H", crc16(raw))) + bytes([FRAME_DELIMITER])
+
+def frame_decode(body):
+  """
+  @param  body COBS body without the delimiters
+  @return (type, payload). `None` if it is malformed or fails the CRC.
+  """
+  raw = cobs_decode(body)
+  if raw is None or len(raw) < 3 or crc16(raw[:-2]) != struct.unpack("<H", raw[-2:])[0]:
+    return None
+  return (raw[0], raw[1:-2])
+
+def frame_str(frame):
+  if frame is None:
+    return "=> FRAME broken"
+  (ftype, payload) = frame
+  return "=> FRAME 0x{:02X} {}".format(ftype, payload.hex())
+
+
+
+class TraceDecoder:
+  """
+  @brief  Decode the deferred trace records mixed with plain text lines
+  @note   Record: [0xA5][payload length][format id: 3 bytes LE][payload]. See `top/trace.h`
+          The format id is the offset of the format string in the table (`.rodata` of the ELF).
+  """
+  SYNC       = 0xA5
+  HEADER_LEN = 5
+  ID_DROPPED = 0xFFFFFF
+
+  def __init__(self, table_path):
+    self.table = b""
+    self.buf   = bytearray()
+    self.text  = bytearray()
+    self.frames= []               # Every frame decoded. `None` for a broken one.
+    if table_path and os.path.exists(table_path):
+      with open(table_path, "rb") as f:
+        self.table = f.read()
+
+  def fmt_of(self, fid):
+    end = self.table.find(b"\0", fid)
+    if fid >= len(self.table) or end < 0:
+      return None
+    return self.table[fid:end].decode("utf-8", "replace")
+
+  @staticmethod
+  def int2str(value, width, fmt):
+    s = fmt.format(value)
+    if width is None:
+      return s
+    if len(s) > width:
+      return "#"*len(s)
+    return s.rjust(width, "0")
+
+  def format(self, fmt, payload):
+    """
+    @brief Same grammar as `cmn_utility_vsnprintf()`: `%[0...][1-9](u|d|x|c|s)`
+    """
+    out = []
+    idx = 0
+    i   = 0
+    while i < len(fmt):
+      if fmt[i] != "%":
+        out.append(fmt[i])
+        i += 1
+        continue
+      i += 1
+      while i < len(fmt) and fmt[i] == "0":
+        i += 1
+      width = None
+      if i < len(fmt) and fmt[i] in "123456789":
+        width = int(fmt[i])
+        i += 1
+      if i >= len(fmt):
+        break
+      spec = fmt[i].lower()
+      i += 1
+      if spec == "s":
+        n = payload[idx]
+        out.append(payload[idx+1:idx+1+n].decode("utf-8", "replace"))
+        idx += 1 + n
+        continue
+      (value,) = struct.unpack_from("<I", payload, idx)
+      idx += 4
+      if spec == "u":
+        out.append(self.int2str(value, width, "{:d}"))
+      elif spec == "d":
+        value = value - (1<<32) if value & 0x80000000 else value
+        out.append(("-" if value<0 else "") + self.int2str(abs(value), width, "{:d}"))
+      elif spec == "x":
+        out.append(self.int2str(value, width, "{:X}"))
+      elif spec == "c":
+        out.append(chr(value & 0xFF))
+    return "".join(out)
+
+  def feed(self, data):
+    """
+    @return Decoded lines
+    """
+    lines = []
+    self.buf += data
+    while self.buf:
+      if self.buf[0] == self.SYNC:
+        if len(self.buf) < self.HEADER_LEN or len(self.buf) < self.HEADER_LEN + self.buf[1]:
+          break
+        n       = self.HEADER_LEN + self.buf[1]
+        fid     = self.buf[2] | (self.buf[3]<<8) | (self.buf[4]<<16)
+        payload = bytes(self.buf[self.HEADER_LEN:n])
+        del self.buf[:n]
+        if fid == self.ID_DROPPED:
+          lines.append("[trace]: {} records dropped".format(struct.unpack("<I", payload)[0]))
+          continue
+        fmt = self.fmt_of(fid)
+        if fmt is None:
+          lines.append("[trace]: unknown format id 0x{:06X}. Is `{}` up to date?".format(fid, params.table))
+          continue
+        try:
+          lines.append(self.format(fmt, payload))
+        except (IndexError, struct.error):
+          lines.append("[trace]: broken record of \"{}\"".format(fmt))
+      elif self.buf[0] == FRAME_DELIMITER:
+        end = self.buf.find(FRAME_DELIMITER, 1)
+        if end < 0:
+          break
+        body = bytes(self.buf[1:end])
+        del self.buf[:end+1]
+        if body:
+          self.frames.append(frame_decode(body))
+          lines.append(frame_str(self.frames[-1]))
+      else:
+        c = self.buf.pop(0)
+        if c == ord("\n"):
+          lines.append(self.text.decode("utf-8", errors="ignore").strip())
+          self.text.clear()
+        else:
+          self.text.append(c)
+    return lines
+
+
+
 async def user_input_writer(writer):
   """
   Waits for user input and writes it to the serial port.
@@ -45,17 +248,71 @@ async def user_input_writer(writer):
       print(f"An error occurred during user input: {e}")
       break
 
-async def serial_reader(reader):
+REPLY = re.compile(r"=> (ACK|NAK|REC|FRAME)\b")
+
+async def script_writer(writer, reply):
+  """
+  Pipelines the lines of `--script`. Every command gets one `ACK`/`NAK` reply, or `REC` while a macro
+  is recorded, see `tAppCmdBox`. `RUN` and `END` lines of a replay answer no line of the script.
+  A line is retired once all of its commands are answered. Up to `--window` lines are in flight,
+  so the receive ring of the device never overflows.
+  """
+  with open(params.script) as f:
+    lines = [ l.strip() for l in f if l.strip() and not l.lstrip().startswith("#") ]
+  # `@<type> [payload in hex]` sends one frame. The type is a number or a name of `FRAME_TYPE`.
+  inflight = collections.deque()      # Commands of every line in flight still waiting for a reply
+  count    = collections.Counter()
+  start    = time.monotonic()
+
+  async def retire():
+    try:
+      kind = await asyncio.wait_for(reply.get(), params.timeout)
+    except asyncio.TimeoutError:
+      print(f"[script]: No reply within {params.timeout}s. {sum(inflight)} commands are lost.")
+      inflight.clear()
+      return
+    count[kind] += 1
+    inflight[0] -= 1
+    if inflight[0] == 0:
+      inflight.popleft()
+
+  for line in lines:
+    if line.startswith("@"):
+      field = line[1:].split(None, 1)
+      ftype = FRAME_TYPE.get(field[0].upper()) if field[0].upper() in FRAME_TYPE else int(field[0], 0)
+      data  = frame_encode(ftype, bytes.fromhex(field[1]) if len(field) > 1 else b"")
+      num   = 1
+    else:
+      data  = line.encode('utf-8') + b'\n'
+      num   = len([ c for c in line.split(";") if c.strip() ])
+    if num == 0:
+      continue
+    while len(inflight) >= params.window:
+      await retire()
+    writer.write(data)
+    await writer.drain()
+    inflight.append(num)
+  while inflight:
+    await retire()
+
+  sec = time.monotonic() - start
+  total = count["ACK"] + count["NAK"] + count["REC"] + count["FRAME"]
+  print(f"[script]: {len(lines)} lines, {count['ACK']} ACK, {count['NAK']} NAK, {count['REC']} REC, {count['FRAME']} FRAME in {sec:.2f}s => {total/sec if sec else 0:.0f} commands/s")
+
+async def serial_reader(reader, reply=None):
   """
   Reads data from the serial port and prints it.
   """
   print("Reading from serial port...")
+  decoder = TraceDecoder(params.table)
   while True:
     try:
-      line = await reader.readline()
-      if line:
-        decoded_line = line.decode('utf-8', errors='ignore').strip()
+      data = await reader.read(256)
+      for decoded_line in decoder.feed(data):
         print(f"| {decoded_line}")
+        match = REPLY.search(decoded_line)
+        if reply is not None and match:
+          reply.put_nowait(match.group(1))
     except asyncio.CancelledError:
       print("Serial reader task cancelled.")
       break
@@ -65,12 +322,14 @@ async def serial_reader(reader):
 
 
 async def main():
+  import serial_asyncio
   try:
     reader, writer = await serial_asyncio.open_serial_connection(url=os.path.join("/dev", params.port), baudrate=params.baudrate)
     
     # Create tasks for reading and writing concurrently
-    reader_task = asyncio.create_task(serial_reader(reader))
-    writer_task = asyncio.create_task(user_input_writer(writer))
+    reply       = asyncio.Queue()
+    reader_task = asyncio.create_task(serial_reader(reader, reply))
+    writer_task = asyncio.create_task(script_writer(writer, reply) if params.script else user_input_writer(writer))
 
     # Wait for the writer_task to finish (when user types 'exit')
     await writer_task
@@ -91,9 +350,78 @@ async def main():
 
 
 
+def selftest():
+  """
+  @brief Frame codec over a pseudo-terminal: the host writes frames mixed with text lines into the
+         master, an echo device on the slave answers every frame like `app_cmdbox_frame()` answers `PING`.
+  @return Number of failures
+  """
+  import pty
+  import random
+  import tty
+
+  fail = 0
+  (ftype, payload, wire) = FRAME_GOLDEN
+  if frame_encode(ftype, payload) != wire or frame_decode(wire[1:-1]) != (ftype, payload):
+    print("[selftest]: golden frame mismatch: {}".format(frame_encode(ftype, payload).hex()))
+    fail += 1
+  if crc16(b"123456789") != 0x29B1:
+    print("[selftest]: CRC-16/CCITT-FALSE check value mismatch")
+    fail += 1
+
+  (master, slave) = pty.openpty()
+  tty.setraw(master)
+  tty.setraw(slave)
+
+  def device():
+    decoder = TraceDecoder("")
+    done    = 0
+    while True:
+      data = os.read(slave, 4096)
+      decoder.feed(data)
+      for frame in decoder.frames[done:]:
+        if frame is None:
+          os.write(slave, frame_encode(FRAME_NAK, bytes([0xFD, 0xFF])))
+        elif frame[0] == 0x7F:
+          return
+        else:
+          os.write(slave, frame_encode(frame[0] | FRAME_REPLY, b"\x00" + frame[1]))
+      done = len(decoder.frames)
+
+  rng  = random.Random(7)
+  sent = [ bytes(rng.choice((0, 0x0A, 0x0D, 0xA5, rng.randrange(256))) for _ in range(rng.randrange(300))) for _ in range(500) ]
+  thread = threading.Thread(target=device, daemon=True)
+  thread.start()
+
+  host   = TraceDecoder("")
+  start  = time.monotonic()
+  writer = threading.Thread(target=lambda: [ os.write(master, b"text line\n" + frame_encode(0x01, p)) for p in sent ] + [ os.write(master, frame_encode(0x7F)) ])
+  writer.start()
+  while len(host.frames) < len(sent):
+    host.feed(os.read(master, 4096))
+  sec = time.monotonic() - start
+  writer.join()
+
+  for (p, frame) in zip(sent, host.frames):
+    if frame != (0x01 | FRAME_REPLY, b"\x00" + p):
+      fail += 1
+  wire  = sum(len(frame_encode(0x01, p)) for p in sent)
+  print("[selftest]: {} frames of {} payload bytes in {:.3f}s over the pty, {:.1%} of the wire is payload. {} failed".format(
+        len(sent), sum(len(p) for p in sent), sec, sum(len(p) for p in sent) / wire, fail))
+  os.close(master)
+  return fail
+
+
 if __name__=="__main__":
+  if params.selftest:
+    sys.exit(1 if selftest() else 0)
   try:
-    asyncio.run(main())
+    if params.decode:
+      with open(params.decode, "rb") as f:
+        for decoded_line in TraceDecoder(params.table).feed(f.read()):
+          print(f"| {decoded_line}")
+    else:
+      asyncio.run(main())
   except:
     pass
   finally:
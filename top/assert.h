@@ -21,6 +21,7 @@
 #if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
 #include "bsp_uart.h"
 #include "bsp_led.h"
+#include "trace.h"
 #elif defined (SYS_TARGET_NATIVE)
 #include <stdlib.h> 
 #endif
@@ -38,8 +39,10 @@
     #define ASSERT( expr, msg, ...)                               \
       do{                                                         \
         if(!(expr)){                                              \
+          trace_crash_assert( __FILE__, __LINE__);                \
           bsp_uart_printf("Assertion@%s:%u", __FILE__, __LINE__); \
           bsp_uart_printf( (msg),  ##__VA_ARGS__);                \
+          bsp_uart_flush();                                       \
           bsp_led_on();                                           \
           __BKPT(0);                                              \
           bsp_led_off();                                          \
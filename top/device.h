@@ -83,8 +83,17 @@
   #define GYRO_SDA_GPIO_Port    GPIOB
 
   #define CMN_CLZ_U32(u32_x)    __CLZ(u32_x)
+  #define CMN_SMLAD(x,y,acc)    __SMLAD(x,y,acc)
+  #define CMN_SSAT(x,bits)      __SSAT(x,bits)
+  #define CMN_SMUAD(x,y)        __SMUAD(x,y)
+  #define CMN_REV16(x)          __REV16(x)
 #elif (defined SYS_TARGET_NATIVE)
-
+  #define CMN_CLZ_U32(u32_x)    __builtin_clz(u32_x)
+  /* Portable version of the Cortex-M4 DSP instructions. Arguments are evaluated more than once */
+  #define CMN_SMLAD(x,y,acc)    ((int32_t)(acc) + (int16_t)(x)*(int16_t)(y) + (int16_t)((uint32_t)(x)>>16)*(int16_t)((uint32_t)(y)>>16))
+  #define CMN_SSAT(x,bits)      (((x) > (1<<((bits)-1))-1) ? (1<<((bits)-1))-1 : (((x) < -(1<<((bits)-1))) ? -(1<<((bits)-1)) : (x)))
+  #define CMN_SMUAD(x,y)        CMN_SMLAD(x,y,0)
+  #define CMN_REV16(x)          ((((uint32_t)(x) >> 8) & 0x00FF00FFU) | (((uint32_t)(x) << 8) & 0xFF00FF00U))
 #else
   #error "Unknown Device Header"
 #endif
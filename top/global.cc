@@ -87,4 +87,12 @@ volatile u32 gDummy = 0;
     Test                 tb_infra_os;
   #endif
 
+  #if (defined INCLUDE_TB_PERF) && (INCLUDE_TB_PERF==1)
+    LocalProjectTest     tb_infra_perf;
+  #endif
+
+  #if (defined INCLUDE_TB_RENDER) && (INCLUDE_TB_RENDER==1)
+    LocalProjectTest     tb_infra_render;
+  #endif
+
 #endif
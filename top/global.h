@@ -261,6 +261,8 @@ extern DMA_HandleTypeDef   hdma_i2c2_tx;
   extern LocalProjectTest     tb_infra_local;
   extern HumanInteractionTest tb_infra_bsp;
   extern Test                 tb_infra_os;
+  extern LocalProjectTest     tb_infra_perf;
+  extern LocalProjectTest     tb_infra_render;
 #endif
 
 
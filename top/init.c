@@ -35,6 +35,9 @@
 #include "device.h"
 #include "global.h"
 #include "cmn_interrupt.h"
+#include "trace.h"
+#include "profile.h"
+#include "memory.h"
 
 
 #include "bsp_cpu.h"
@@ -51,7 +54,7 @@
 #include "FreeRTOS.h"
 #include "task.h"
 
-#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6)
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
   #define BITBAND_SRAM(addr, bit) ((volatile uint32_t *)((SRAM_BB_BASE + ((uint32_t)(addr)-SRAM_BASE)*32 + (bit*4))))
 #endif
 
@@ -63,12 +66,17 @@
  * @return
 */
 void hw_init(void){
+  /* Before anything is logged. The crash record of the last boot is kept if there is one. */
+  trace_crash_boot();
+
   /* Reset of all peripherals, Initializes the Flash interface and the Systick. */
   HAL_Init();
 
   /* Configure the system clock */
   bsp_cpu_clock_init();
 
+  profile_init();
+
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
 
@@ -175,6 +183,12 @@ void os_init(void){
     &p_task->cmd_box._tcb\
   );
 
+  /* Owners of the blocks allocated by each task. See `MEMORY_OWNER`. */
+  memory_owner_set( p_task->screen_refresh._handle, kMemoryOwner_SCREEN);
+  memory_owner_set( p_task->clock_ui._handle,       kMemoryOwner_CLOCK);
+  memory_owner_set( p_task->screen_onoff._handle,   kMemoryOwner_SCREEN);
+  memory_owner_set( p_task->cmd_box._handle,        kMemoryOwner_CMDBOX);
+
   TaskHandle_t _handle;
   xTaskCreate( app_rtos_checkpoint, "app_rtos_checkpoint", 256U, NULL, kRtosTaskPriority_NORMAL, &_handle);
   
@@ -19,9 +19,49 @@
 
 
 #include <stdlib.h>
+#include <string.h>
+#include "memory.h"
 #if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
 #include "global.h"
 #elif (defined SYS_TARGET_NATIVE)
+#include <chrono>
+#endif
+
+
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  #define MEMORY_LOCK()           uint32_t primask = __get_PRIMASK(); __disable_irq()
+  #define MEMORY_UNLOCK()         __set_PRIMASK(primask)
+#else
+  #define MEMORY_LOCK()
+  #define MEMORY_UNLOCK()
+#endif
+
+#if (MEMORY_OWNER==1)
+/**
+ * @note In front of every block. Keeps the 8-byte alignment of the heap.
+ */
+typedef struct stMemoryHeader{
+  uint32_t owner;
+  uint32_t size;
+} tMemoryHeader;
+static_assert( sizeof(tMemoryHeader)==8, "The header MUST keep the 8-byte alignment");
+#endif
+
+#define MEMORY_OWNER_NAME( tag, name)     name,
+static const char * const memory_owner_names[kNumMemoryOwner] = { MEMORY_OWNER_LIST( MEMORY_OWNER_NAME) };
+#undef MEMORY_OWNER_NAME
+
+#if (defined SYS_TARGET_NATIVE)
+static uint32_t native_owner = kMemoryOwner_MISC;
+#endif
+
+#if (MEMORY_TRACK==1)
+static_assert( (MEMORY_TRACK_NUM & (MEMORY_TRACK_NUM-1))==0, "MEMORY_TRACK_NUM must be a power of 2");
+static_assert( (MEMORY_TRACK_SITE_NUM & (MEMORY_TRACK_SITE_NUM-1))==0, "MEMORY_TRACK_SITE_NUM must be a power of 2");
+
+#define MEMORY_TRACK_SITE()       ((uintptr_t)__builtin_return_address(0))
+#else
+#define MEMORY_TRACK_SITE()       ((uintptr_t)0)
 #endif
 
 
@@ -29,11 +69,14 @@
 extern "C"{
 #endif
 
+tMemoryOwner memory_owner[kNumMemoryOwner];
+
 /**
- * @brief Malloc Wrapper Function
- * 
+ * @note Unreferenced without `MEMORY_TRACK`, so the tables are removed by `--gc-sections`.
  */
-void *MALLOC(size_t xWantedSize) {
+tMemoryTrack memory_track;
+
+static void *heap_malloc(size_t xWantedSize) {
 #if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
   extern void *pvPortMalloc( size_t xWantedSize );
   const tRtos *p_rtos = &metope.rtos;
@@ -46,8 +89,8 @@ void *MALLOC(size_t xWantedSize) {
   return malloc(xWantedSize);
 #endif
 }
-  
-void FREE(void *pv) {
+
+static void heap_free(void *pv) {
 #if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
   extern void vPortFree( void *pv );
   const tRtos *p_rtos = &metope.rtos;
@@ -61,7 +104,7 @@ void FREE(void *pv) {
 #endif
 }
 
-void *REALLOC(void *pv, size_t xWantedSize) {
+static void *heap_realloc(void *pv, size_t xWantedSize) {
 #if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
   extern void *pvPortRealloc( void *pv, size_t xWantedSize );
   const tRtos *p_rtos = &metope.rtos;
@@ -75,6 +118,341 @@ void *REALLOC(void *pv, size_t xWantedSize) {
 #endif
 }
 
+#if (MEMORY_OWNER==1)
+static void memory_charge( uint32_t owner, uint32_t add, uint32_t sub, int32_t count) {
+  tMemoryOwner *p = &memory_owner[owner < kNumMemoryOwner ? owner : kMemoryOwner_MISC];
+  MEMORY_LOCK();
+  p->bytes += add - sub;
+  p->count += count;
+  if (p->bytes > p->peak) {
+    p->peak = p->bytes;
+  }
+  MEMORY_UNLOCK();
+}
+#endif
+
+#if (MEMORY_TRACK==1)
+static inline uint32_t track_hash( uintptr_t key, uint32_t mask) {
+  uint32_t h = (uint32_t)(key >> 3) * 2654435761U;
+  return (h ^ (h >> 16)) & mask;
+}
+
+/**
+ * @brief Slot of the call site `site` of `owner`. Inserted when missing, never removed.
+ * @return `MEMORY_TRACK_SITE_NUM` if the table is full
+ */
+static uint32_t track_site( uintptr_t site, uint32_t owner) {
+  uint32_t i = track_hash(site ^ owner, MEMORY_TRACK_SITE_NUM-1);
+  for (uint32_t n = 0; n < MEMORY_TRACK_SITE_NUM; ++n, i = (i+1) & (MEMORY_TRACK_SITE_NUM-1)) {
+    tMemoryTrackSite *p = &memory_track.site[i];
+    if (p->site == 0) {
+      p->site  = site;
+      p->owner = owner;
+      return i;
+    }
+    if (p->site == site && p->owner == owner) {
+      return i;
+    }
+  }
+  return MEMORY_TRACK_SITE_NUM;
+}
+
+/**
+ * @brief Slot of the block at `ptr`, or the empty slot ending its probe sequence
+ * @note  One slot is always left empty, so the probe ends.
+ */
+static uint32_t track_find( uintptr_t ptr) {
+  uint32_t i = track_hash(ptr, MEMORY_TRACK_NUM-1);
+  while (memory_track.block[i].ptr != ptr && memory_track.block[i].ptr != 0) {
+    i = (i+1) & (MEMORY_TRACK_NUM-1);
+  }
+  return i;
+}
+
+/**
+ * @brief Put `block` in the table and charge its call site
+ * @param [in] fresh - `1` counts a new allocation of the site
+ */
+static void track_add( const tMemoryTrackBlock *block, uint32_t fresh) {
+  tMemoryTrackSite *p_site = &memory_track.site[block->site];
+  memory_track.block[track_find(block->ptr)] = *block;
+  memory_track.bytes += block->size;
+  memory_track.count += 1;
+  if (memory_track.bytes > memory_track.peak) {
+    memory_track.peak = memory_track.bytes;
+  }
+  p_site->bytes += block->size;
+  p_site->count += 1;
+  p_site->total += fresh;
+  if (p_site->bytes > p_site->peak) {
+    p_site->peak = p_site->bytes;
+  }
+}
+
+/**
+ * @brief Track the new block at `ptr` of `size` bytes allocated from `site`
+ * @note  Blocks leave the table before they go back to the heap, so `ptr` is NOT in the table.
+ */
+static void track_insert( uintptr_t ptr, uint32_t size, uintptr_t site) {
+  const uint32_t owner = memory_owner_current();
+  const uint32_t time  = memory_track_now();
+  MEMORY_LOCK();
+  const uint32_t k = memory_track.count < MEMORY_TRACK_NUM-1 ? track_site(site, owner) : MEMORY_TRACK_SITE_NUM;
+  if (k < MEMORY_TRACK_SITE_NUM) {
+    const tMemoryTrackBlock block = { ptr, k, size, time };
+    track_add(&block, 1);
+  } else {
+    memory_track.lost += 1;
+  }
+  MEMORY_UNLOCK();
+}
+
+/**
+ * @brief Stop tracking the block at `ptr` and credit its call site
+ * @note  The following entries of the probe sequence are shifted back over the hole, so a lookup
+ *        never stops early at an empty slot and no tombstone is needed.
+ * @param [out] block - Removed entry. `ptr` is `0` if the block was NOT tracked.
+ */
+static void track_remove( uintptr_t ptr, tMemoryTrackBlock *block) {
+  MEMORY_LOCK();
+  uint32_t hole = track_find(ptr);
+  *block = memory_track.block[hole];
+  if (block->ptr != 0) {
+    tMemoryTrackSite *p_site = &memory_track.site[block->site];
+    memory_track.bytes -= block->size;
+    memory_track.count -= 1;
+    p_site->bytes      -= block->size;
+    p_site->count      -= 1;
+
+    for (uint32_t i = (hole+1) & (MEMORY_TRACK_NUM-1); memory_track.block[i].ptr != 0; i = (i+1) & (MEMORY_TRACK_NUM-1)) {
+      const uint32_t home = track_hash(memory_track.block[i].ptr, MEMORY_TRACK_NUM-1);
+      /* Moves unless its home lies cyclically in (hole, i] */
+      if (((i - home) & (MEMORY_TRACK_NUM-1)) >= ((i - hole) & (MEMORY_TRACK_NUM-1))) {
+        memory_track.block[hole] = memory_track.block[i];
+        hole = i;
+      }
+    }
+    memory_track.block[hole].ptr = 0;
+  }
+  MEMORY_UNLOCK();
+}
+#endif
+
+static void *memory_malloc(size_t xWantedSize, uintptr_t site) {
+#if (MEMORY_OWNER==1)
+  tMemoryHeader *p = (tMemoryHeader *)heap_malloc(sizeof(tMemoryHeader) + xWantedSize);
+  if (p == NULL) {
+    return NULL;
+  }
+  p->owner = memory_owner_current();
+  p->size  = (uint32_t)xWantedSize;
+  memory_charge(p->owner, p->size, 0, 1);
+  void *pv = p + 1;
+#else
+  void *pv = heap_malloc(xWantedSize);
+#endif
+#if (MEMORY_TRACK==1)
+  if (pv != NULL) {
+    track_insert((uintptr_t)pv, (uint32_t)xWantedSize, site);
+  }
+#else
+  (void)site;
+#endif
+  return pv;
+}
+
+static void memory_free(void *pv) {
+  if (pv == NULL) {
+    return;
+  }
+#if (MEMORY_TRACK==1)
+  tMemoryTrackBlock block;
+  track_remove((uintptr_t)pv, &block);
+#endif
+#if (MEMORY_OWNER==1)
+  tMemoryHeader *p = (tMemoryHeader *)pv - 1;
+  memory_charge(p->owner, 0, p->size, -1);
+  heap_free(p);
+#else
+  heap_free(pv);
+#endif
+}
+
+static void *memory_realloc(void *pv, size_t xWantedSize, uintptr_t site) {
+  if (xWantedSize == 0) {
+    memory_free(pv);
+    return NULL;
+  }
+  if (pv == NULL) {
+    return memory_malloc(xWantedSize, site);
+  }
+#if (MEMORY_TRACK==1)
+  /* Another task may get the old address as soon as the heap releases it */
+  tMemoryTrackBlock block;
+  track_remove((uintptr_t)pv, &block);
+#endif
+#if (MEMORY_OWNER==1)
+  tMemoryHeader *p  = (tMemoryHeader *)heap_realloc((tMemoryHeader *)pv - 1, sizeof(tMemoryHeader) + xWantedSize);
+  void          *pn = NULL;
+  if (p != NULL) {
+    const uint32_t size = p->size;
+    p->size = (uint32_t)xWantedSize;
+    memory_charge(p->owner, p->size, size, 0);
+    pn = p + 1;
+  }
+#else
+  void *pn = heap_realloc(pv, xWantedSize);
+#endif
+#if (MEMORY_TRACK==1)
+  if (pn != NULL) {
+    track_insert((uintptr_t)pn, (uint32_t)xWantedSize, site);
+  } else if (block.ptr != 0) {
+    /* Still allocated as before */
+    MEMORY_LOCK();
+    if (memory_track.count < MEMORY_TRACK_NUM-1) {
+      track_add(&block, 0);
+    } else {
+      memory_track.lost += 1;
+    }
+    MEMORY_UNLOCK();
+  }
+#endif
+  return pn;
+}
+
+/**
+ * @brief Malloc Wrapper Function
+ * @note  Charged to `memory_owner_current()` with `MEMORY_OWNER`. Tracked with `MEMORY_TRACK`.
+ */
+void *MALLOC(size_t xWantedSize) {
+  return memory_malloc(xWantedSize, MEMORY_TRACK_SITE());
+}
+  
+void FREE(void *pv) {
+  memory_free(pv);
+}
+
+/**
+ * @note  The block stays with its owner. Its call site becomes the caller of `REALLOC()`.
+ */
+void *REALLOC(void *pv, size_t xWantedSize) {
+  return memory_realloc(pv, xWantedSize, MEMORY_TRACK_SITE());
+}
+
+/**
+ * @brief Charge the blocks allocated by `task` to `owner`
+ * @note  Target: stored in the application tag of the task. `NULL` is the calling task.
+ *        Native: one owner for the whole process.
+ */
+void memory_owner_set( void *task, uint32_t owner) {
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  vTaskSetApplicationTaskTag((TaskHandle_t)task, (TaskHookFunction_t)(uintptr_t)owner);
+#elif (defined SYS_TARGET_NATIVE)
+  (void)task;
+  native_owner = owner;
+#endif
+}
+
+uint32_t memory_owner_current( void) {
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  if (!metope.rtos.status->running[0]) {
+    return kMemoryOwner_BOOT;
+  }
+  return (uint32_t)(uintptr_t)xTaskGetApplicationTaskTag(NULL);
+#elif (defined SYS_TARGET_NATIVE)
+  return native_owner;
+#endif
+}
+
+const char *memory_owner_name( uint32_t owner) {
+  return owner < kNumMemoryOwner ? memory_owner_names[owner] : "";
+}
+
+/**
+ * @brief Figures of the RTOS heap
+ * @note  Walks the free list with the scheduler suspended. All zero on native.
+ */
+void memory_heap( tMemoryHeap *heap) {
+  memset(heap, 0, sizeof(tMemoryHeap));
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  HeapStats_t stats;
+  vPortGetHeapStats(&stats);
+  heap->free          = stats.xAvailableHeapSpaceInBytes;
+  heap->min_ever_free = stats.xMinimumEverFreeBytesRemaining;
+  heap->largest_free  = stats.xSizeOfLargestFreeBlockInBytes;
+  heap->count         = stats.xNumberOfSuccessfulAllocations - stats.xNumberOfSuccessfulFrees;
+#endif
+}
+
+/**
+ * @brief Copy the call sites in use, most bytes first
+ * @note  Each site is copied under the lock, so a site may be one allocation ahead of the others.
+ * @return Number of sites copied. `0` without `MEMORY_TRACK`.
+ */
+size_t memory_track_sites( tMemoryTrackSite *buf, size_t num) {
+  size_t cnt = 0;
+#if (MEMORY_TRACK==1)
+  for (uint32_t i = 0; i < MEMORY_TRACK_SITE_NUM && cnt < num; ++i) {
+    MEMORY_LOCK();
+    const tMemoryTrackSite site = memory_track.site[i];
+    MEMORY_UNLOCK();
+    if (site.site == 0) {
+      continue;
+    }
+    size_t j = cnt++;
+    for (; j > 0 && buf[j-1].bytes < site.bytes; --j) {
+      buf[j] = buf[j-1];
+    }
+    buf[j] = site;
+  }
+#else
+  (void)buf;
+  (void)num;
+#endif
+  return cnt;
+}
+
+/**
+ * @brief Copy the live blocks allocated at or after `since`, oldest first
+ * @note  Take `memory_track_now()` before a piece of work. The blocks it leaves behind are its leaks.
+ *        Each slot is copied under the lock, so a block moved by a concurrent free may be missed.
+ * @return Number of blocks copied. `0` without `MEMORY_TRACK`.
+ */
+size_t memory_track_blocks( tMemoryTrackBlock *buf, size_t num, uint32_t since) {
+  size_t cnt = 0;
+#if (MEMORY_TRACK==1)
+  for (uint32_t i = 0; i < MEMORY_TRACK_NUM && cnt < num; ++i) {
+    MEMORY_LOCK();
+    const tMemoryTrackBlock block = memory_track.block[i];
+    MEMORY_UNLOCK();
+    if (block.ptr == 0 || (int32_t)(block.time - since) < 0) {
+      continue;
+    }
+    size_t j = cnt++;
+    for (; j > 0 && (int32_t)(buf[j-1].time - block.time) > 0; --j) {
+      buf[j] = buf[j-1];
+    }
+    buf[j] = block;
+  }
+#else
+  (void)buf;
+  (void)num;
+  (void)since;
+#endif
+  return cnt;
+}
+
+/**
+ * @brief Time stamp of the tracked blocks in ms. Wraps after 49 days.
+ */
+uint32_t memory_track_now( void) {
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  return HAL_GetTick();
+#elif (defined SYS_TARGET_NATIVE)
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
 #ifdef __cplusplus
 }
-#endif
\ No newline at end of file
+#endif
@@ -24,16 +24,131 @@
 /*                                  Includes                                  */
 /* ************************************************************************** */
 #include <stddef.h>
+#include <stdint.h>
 
 
+/* ************************************************************************** */
+/*                               Memory Owner                                 */
+/* ************************************************************************** */
+/**
+ * @note
+ *  Every block of `MALLOC()` is charged to the owner of the calling task: the application tag of
+ *  the task (see `memory_owner_set()`), `BOOT` before the scheduler starts and `MISC` for untagged
+ *  tasks. `FREE()` and `REALLOC()` credit the owner the block was charged to.
+ *  The owner and the size are kept in an 8-byte header in front of the block, so the accounting is
+ *  opt-in on target (`-DMEMORY_OWNER=1`) and always on native.
+ */
+#ifndef MEMORY_OWNER
+  #if (defined SYS_TARGET_NATIVE)
+    #define MEMORY_OWNER  (1)
+  #else
+    #define MEMORY_OWNER  (0)
+  #endif
+#endif
+
+#define MEMORY_OWNER_LIST( X)        \
+  X( MISC,    "misc"    )            \
+  X( BOOT,    "boot"    )            \
+  X( SCREEN,  "screen"  )            \
+  X( CLOCK,   "clock"   )            \
+  X( CMDBOX,  "cmdbox"  )
+
+#define MEMORY_OWNER_ENUM( tag, name)     kMemoryOwner_##tag,
+typedef enum MemoryOwnerEnum{
+  MEMORY_OWNER_LIST( MEMORY_OWNER_ENUM)
+  kNumMemoryOwner
+} MemoryOwnerEnum_t;
+#undef MEMORY_OWNER_ENUM
+
+typedef struct stMemoryOwner{
+  uint32_t bytes;                         /*!< Requested bytes in use */
+  uint32_t count;                         /*!< Blocks in use */
+  uint32_t peak;                          /*!< High-water of `bytes` */
+} tMemoryOwner;
+
+typedef struct stMemoryHeap{
+  uint32_t free;                          /*!< Free bytes of the RTOS heap */
+  uint32_t min_ever_free;
+  uint32_t largest_free;                  /*!< Largest block `MALLOC()` can still return */
+  uint32_t count;                         /*!< Blocks in use */
+} tMemoryHeap;
+
+
+/* ************************************************************************** */
+/*                            Allocation Tracking                             */
+/* ************************************************************************** */
+/**
+ * @note
+ *  Every live block of `MALLOC()` and `REALLOC()` is kept in an open-addressing table keyed by its
+ *  address, with the call site (return address into the caller), the size and the time in ms.
+ *  The table probes linearly and deletes by backward shift, so no tombstone is left behind.
+ *  Every call site, split by owner, accumulates the bytes and blocks in use, the peak bytes and the
+ *  number of allocations ever made. A site that keeps growing is a leak.
+ *  LVGL allocates through `lv_mem_alloc()`, so all of its blocks share one call site per owner.
+ *  Symbolize the sites with `arm-none-eabi-addr2line -f -e model1.elf <site>`.
+ *  Blocks and sites the tables have no room for are counted in `lost` and NOT tracked.
+ *  About 5KB of RAM, so opt-in on target (`-DMEMORY_TRACK=1`) and always on native.
+ */
+#ifndef MEMORY_TRACK
+  #if (defined SYS_TARGET_NATIVE)
+    #define MEMORY_TRACK          (1)
+  #else
+    #define MEMORY_TRACK          (0)
+  #endif
+#endif
+
+#ifndef MEMORY_TRACK_NUM
+  #define MEMORY_TRACK_NUM        (256)   /*!< Live blocks. Must be a power of 2 */
+#endif
+
+#ifndef MEMORY_TRACK_SITE_NUM
+  #define MEMORY_TRACK_SITE_NUM   (32)    /*!< Call sites. Must be a power of 2 */
+#endif
+
+typedef struct stMemoryTrackBlock{
+  uintptr_t ptr;                          /*!< `0` is an empty slot */
+  uint32_t  site;                         /*!< Index of the call site in `memory_track.site[]` */
+  uint32_t  size;
+  uint32_t  time;                         /*!< Allocated at, in ms */
+} tMemoryTrackBlock;
+
+typedef struct stMemoryTrackSite{
+  uintptr_t site;                         /*!< `0` is an empty slot */
+  uint32_t  owner;
+  uint32_t  bytes;                        /*!< Requested bytes in use */
+  uint32_t  count;                        /*!< Blocks in use */
+  uint32_t  peak;                         /*!< High-water of `bytes` */
+  uint32_t  total;                        /*!< Allocations ever made */
+} tMemoryTrackSite;
+
+typedef struct stMemoryTrack{
+  uint32_t          bytes;                /*!< Tracked bytes in use */
+  uint32_t          count;                /*!< Tracked blocks in use */
+  uint32_t          peak;
+  uint32_t          lost;                 /*!< Allocations NOT tracked for lack of room */
+  tMemoryTrackBlock block[MEMORY_TRACK_NUM];
+  tMemoryTrackSite  site[MEMORY_TRACK_SITE_NUM];
+} tMemoryTrack;
+
 #ifdef __cplusplus
 extern "C"{
 #endif
 
+extern tMemoryOwner memory_owner[kNumMemoryOwner];
+extern tMemoryTrack memory_track;
+
 void *MALLOC(size_t xWantedSize);
 void FREE(void *pv);
 void *REALLOC(void *pv, size_t xWantedSize);
 
+void        memory_owner_set( void *task, uint32_t owner);
+uint32_t    memory_owner_current( void);
+const char *memory_owner_name( uint32_t owner);
+void        memory_heap( tMemoryHeap *heap);
+size_t      memory_track_sites( tMemoryTrackSite *buf, size_t num);
+size_t      memory_track_blocks( tMemoryTrackBlock *buf, size_t num, uint32_t since);
+uint32_t    memory_track_now( void);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,143 @@
+/**
+ ******************************************************************************
+ * @file    profile.cc
+ * @author  RandleH
+ * @brief   Project profiling zones
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 RandleH.
+ * All rights reserved.
+ *
+ * This software component is licensed by RandleH under BSD 3-Clause license,
+ * the "License"; You may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at:
+ *                        opensource.org/licenses/BSD-3-Clause
+ *
+ ******************************************************************************
+*/
+
+/* ************************************************************************** */
+/*                                  Includes                                  */
+/* ************************************************************************** */
+#include <string.h>
+#include "profile.h"
+#include "timeline.h"
+#if (defined SYS_TARGET_NATIVE)
+  #include <chrono>
+#endif
+
+
+/* ************************************************************************** */
+/*                               Private Macros                               */
+/* ************************************************************************** */
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  #define PROFILE_LOCK()          uint32_t primask = __get_PRIMASK(); __disable_irq()
+  #define PROFILE_UNLOCK()        __set_PRIMASK(primask)
+#else
+  #define PROFILE_LOCK()
+  #define PROFILE_UNLOCK()
+#endif
+
+/**
+ * @note Number of empty zones measured by `profile_init()`. The fastest one is the overhead.
+ */
+#define PROFILE_CALIBRATION     (16)
+
+
+/* ************************************************************************** */
+/*                              Private Variables                             */
+/* ************************************************************************** */
+#define PROFILE_ZONE_NAME( tag, name)     name,
+static const char * const profile_zone_names[kNumProfileZone] = { PROFILE_ZONE_LIST( PROFILE_ZONE_NAME) };
+#undef PROFILE_ZONE_NAME
+
+static uint32_t overhead = 0;
+
+
+extern "C"{
+
+tProfileZone profile_zone[kNumProfileZone];
+
+#if (defined SYS_TARGET_NATIVE)
+uint32_t profile_now( void){
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+/**
+ * @brief Start the tick and measure the cost of one empty zone
+ * @note  Called once after the system clock is configured
+ */
+void profile_init( void){
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6)
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+#elif (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  __HAL_RCC_TIM5_CLK_ENABLE();
+  TIM5->PSC = 0;
+  TIM5->ARR = UINT32_MAX;
+  SET_BIT( TIM5->EGR, TIM_EGR_UG);
+  SET_BIT( TIM5->CR1, TIM_CR1_CEN);
+#endif
+
+  profile_reset();
+  for(uint32_t i=0; i<PROFILE_CALIBRATION; ++i){
+    const uint32_t start = profile_now();
+    profile_zone_end( kProfileZone_MISC, start);
+  }
+  overhead = profile_zone[kProfileZone_MISC].min;
+  profile_reset();
+#if (TIMELINE==1)
+  timeline_clear();
+#endif
+}
+
+/**
+ * @brief Close a zone opened at `start`
+ * @note  Safe from any task or ISR. Also recorded into the task timeline with `-DTIMELINE=1`.
+ */
+void profile_zone_end( uint32_t zone, uint32_t start){
+  const uint32_t delta = profile_now() - start;
+  tProfileZone  *p     = &profile_zone[zone];
+
+  PROFILE_LOCK();
+  if( p->count==0 || delta < p->min ){
+    p->min = delta;
+  }
+  p->count += 1;
+  p->total += delta;
+  if( delta > p->max ){
+    p->max = delta;
+  }
+  PROFILE_UNLOCK();
+
+#if (TIMELINE==1)
+  timeline_record_at( start, kTimeline_ZONE_BEGIN, zone);
+  timeline_record( kTimeline_ZONE_END, zone);
+#endif
+}
+
+/**
+ * @brief Clear every zone
+ */
+void profile_reset( void){
+  PROFILE_LOCK();
+  memset( profile_zone, 0, sizeof(profile_zone));
+  PROFILE_UNLOCK();
+}
+
+const char *profile_zone_name( uint32_t zone){
+  return zone<kNumProfileZone ? profile_zone_names[zone] : "";
+}
+
+/**
+ * @brief Ticks of one empty zone, measured by `profile_init()`. Included in every sample.
+ */
+uint32_t profile_overhead( void){
+  return overhead;
+}
+
+} /* extern "C" */
+
+/* ********************************** EOF *********************************** */
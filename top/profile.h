@@ -0,0 +1,147 @@
+/**
+ ******************************************************************************
+ * @file    profile.h
+ * @author  RandleH
+ * @brief   Project profiling zones
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 RandleH.
+ * All rights reserved.
+ *
+ * This software component is licensed by RandleH under BSD 3-Clause license,
+ * the "License"; You may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at:
+ *                        opensource.org/licenses/BSD-3-Clause
+ *
+ ******************************************************************************
+*/
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  #include "device.h"
+#endif
+
+
+/* ************************************************************************** */
+/*                               Profiling Zone                               */
+/* ************************************************************************** */
+/**
+ * @note
+ *  A zone accumulates the count, total, min and max ticks spent between its begin and its end.
+ *    - C      : `PROFILE_BEGIN( ZONE);` ... `PROFILE_END( ZONE);` in the same block.
+ *    - C++    : `PROFILE_SCOPE( ZONE);` till the end of the enclosing scope.
+ *  A tick is one CPU cycle of DWT on target and one nanosecond of `std::chrono::steady_clock`
+ *  on native. DWT is NOT modelled by QEMU, so the emulator reads TIM5 (see `TestClock`).
+ *  Nested and preempted zones include the time of whatever ran in between.
+ *  With `PROFILE_ZONE=0` every zone is removed by the preprocessor.
+ */
+#ifndef PROFILE_ZONE
+  #define PROFILE_ZONE  (1)
+#endif
+
+#define PROFILE_ZONE_LIST( X)                \
+  X( MISC,            "misc"            )    \
+  X( LV_TIMER,        "lv_timer"        )    \
+  X( LVGL_FLUSH,      "lvgl_flush"      )    \
+  X( QMI8658_UPDATE,  "qmi8658_update"  )    \
+  X( QMI8658_FIFO,    "qmi8658_fifo"    )    \
+  X( RTC_GET_TIME,    "rtc_get_time"    )    \
+  X( VSNPRINTF,       "vsnprintf"       )
+
+#define PROFILE_ZONE_ENUM( tag, name)     kProfileZone_##tag,
+typedef enum ProfileZoneEnum{
+  PROFILE_ZONE_LIST( PROFILE_ZONE_ENUM)
+  kNumProfileZone
+} ProfileZoneEnum_t;
+#undef PROFILE_ZONE_ENUM
+
+typedef struct stProfileZone{
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint64_t total;
+} tProfileZone;
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+extern tProfileZone profile_zone[kNumProfileZone];
+
+void        profile_init( void);
+void        profile_zone_end( uint32_t zone, uint32_t start);
+void        profile_reset( void);
+const char *profile_zone_name( uint32_t zone);
+uint32_t    profile_overhead( void);
+
+/**
+ * @brief Free running tick of the profiling zones
+ * @note  Always take the difference of two ticks. It wraps every 2^32 ticks.
+ * @note  `PROFILE_HZ` is its rate. The FreeRTOS run-time counter and the task timeline count it too.
+ */
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6)
+#define PROFILE_HZ    (SystemCoreClock)
+static inline uint32_t profile_now( void){
+  return DWT->CYCCNT;
+}
+#elif (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+#define PROFILE_HZ    (1000000000U)     /*!< TIM5 under `-icount shift=0`. See `tool/perf.py` */
+static inline uint32_t profile_now( void){
+  return TIM5->CNT;
+}
+#elif (defined SYS_TARGET_NATIVE)
+#define PROFILE_HZ    (1000000000U)
+uint32_t profile_now( void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#if (PROFILE_ZONE==1)
+  #define PROFILE_BEGIN( ZONE)      const uint32_t profile_start_##ZONE = profile_now()
+  #define PROFILE_END( ZONE)        profile_zone_end( kProfileZone_##ZONE, profile_start_##ZONE)
+#else
+  #define PROFILE_BEGIN( ZONE)      do{}while(0)
+  #define PROFILE_END( ZONE)        do{}while(0)
+#endif
+
+
+#ifdef __cplusplus
+namespace profile{
+
+/**
+ * @brief Zone of the enclosing scope
+ */
+class Scope{
+private:
+  const uint32_t _zone;
+  const uint32_t _start;
+
+public:
+  explicit Scope( uint32_t zone):_zone(zone),_start(profile_now()){}
+  ~Scope(){ profile_zone_end( _zone, _start); }
+
+  Scope( const Scope&)            = delete;
+  Scope& operator=( const Scope&) = delete;
+};
+
+} /* Namespace profile */
+
+#define PROFILE_CAT_( a, b)         a##b
+#define PROFILE_CAT( a, b)          PROFILE_CAT_( a, b)
+
+#if (PROFILE_ZONE==1)
+  #define PROFILE_SCOPE( ZONE)      const ::profile::Scope PROFILE_CAT( profile_scope_, __LINE__)( kProfileZone_##ZONE)
+#else
+  #define PROFILE_SCOPE( ZONE)      do{}while(0)
+#endif
+#endif
+
+#endif
+/* ********************************** EOF *********************************** */
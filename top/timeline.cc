@@ -0,0 +1,187 @@
+/**
+ ******************************************************************************
+ * @file    timeline.cc
+ * @author  RandleH
+ * @brief   Project task timeline recorder
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 RandleH.
+ * All rights reserved.
+ *
+ * This software component is licensed by RandleH under BSD 3-Clause license,
+ * the "License"; You may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at:
+ *                        opensource.org/licenses/BSD-3-Clause
+ *
+ ******************************************************************************
+*/
+
+/* ************************************************************************** */
+/*                                  Includes                                  */
+/* ************************************************************************** */
+#include <string.h>
+#include "timeline.h"
+#include "profile.h"
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6)
+  #include "FreeRTOS.h"
+  #include "task.h"
+  #include "bsp_uart.h"
+  #include "app_rtos_top.h"
+#elif (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  #include <stdio.h>
+  #include "app_rtos_top.h"
+#elif (defined SYS_TARGET_NATIVE)
+  #include <stdio.h>
+#endif
+
+
+/* ************************************************************************** */
+/*                               Private Macros                               */
+/* ************************************************************************** */
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  #define TIMELINE_LOCK()         uint32_t primask = __get_PRIMASK(); __disable_irq()
+  #define TIMELINE_UNLOCK()       __set_PRIMASK(primask)
+#else
+  #define TIMELINE_LOCK()
+  #define TIMELINE_UNLOCK()
+#endif
+
+static_assert( (TIMELINE_EVENT_NUM & (TIMELINE_EVENT_NUM-1))==0, "TIMELINE_EVENT_NUM must be a power of 2");
+
+/**
+ * @note The dump is printed line by line from a task. It sleeps a tick whenever the UART ring is
+ *       nearly full, so the DMA drains it by its interrupt with the other tasks running.
+ *       The emulator prints to the semihosting console like the render bench.
+ */
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6)
+  #define TIMELINE_LINE_MAX       (48)
+  #define TIMELINE_PRINTF( fmt, ...) \
+    do{ while( bsp_uart_tx_room() < TIMELINE_LINE_MAX){ vTaskDelay(1); } bsp_uart_printf( fmt, ##__VA_ARGS__); }while(0)
+#else
+  #define TIMELINE_PRINTF( fmt, ...) printf( fmt"\n", ##__VA_ARGS__)
+#endif
+
+
+/* ************************************************************************** */
+/*                              Private Variables                             */
+/* ************************************************************************** */
+#define TIMELINE_TYPE_NAME( tag, name)     name,
+static const char * const timeline_type_names[kNumTimeline] = { "", TIMELINE_TYPE_LIST( TIMELINE_TYPE_NAME) };
+#undef TIMELINE_TYPE_NAME
+
+
+extern "C"{
+
+/**
+ * @note Unreferenced without `-DTIMELINE=1`, so the ring is removed by `--gc-sections`.
+ */
+tTimeline timeline = { 0, 1, {} };
+
+/**
+ * @brief Record one event now
+ * @note  Safe from any task or ISR. Dropped while the recorder is disabled.
+ */
+void timeline_record( uint32_t type, uint32_t id){
+  timeline_record_at( profile_now(), type, id);
+}
+
+/**
+ * @brief Record one event that happened at `time`
+ * @note  Events may be recorded out of order. The converter sorts them by time.
+ */
+void timeline_record_at( uint32_t time, uint32_t type, uint32_t id){
+  TIMELINE_LOCK();
+  if( timeline.enable ){
+    tTimelineEvent *p = &timeline.event[timeline.head & (TIMELINE_EVENT_NUM-1)];
+    p->time        = time;
+    p->word        = (type << 24) | (id & TIMELINE_ID_MASK);
+    timeline.head += 1;
+  }
+  TIMELINE_UNLOCK();
+}
+
+/**
+ * @brief Copy the events after `cursor`, oldest first
+ * @note  A cursor behind the ring skips the overwritten events. Start from `0`.
+ * @param [out]   buf    - Event buffer
+ * @param [in]    num    - Capacity of `buf` in events
+ * @param [inout] cursor - Position of the next event to read
+ * @return Number of events copied. `0` when every event is read.
+ */
+size_t timeline_read( tTimelineEvent *buf, size_t num, uint32_t *cursor){
+  TIMELINE_LOCK();
+  const uint32_t head = timeline.head;
+  uint32_t       pos  = *cursor;
+  if( head - pos > TIMELINE_EVENT_NUM ){
+    pos = head - TIMELINE_EVENT_NUM;
+  }
+  size_t cnt = 0;
+  for(; cnt<num && pos!=head; ++cnt, ++pos){
+    buf[cnt] = timeline.event[pos & (TIMELINE_EVENT_NUM-1)];
+  }
+  *cursor = pos;
+  TIMELINE_UNLOCK();
+  return cnt;
+}
+
+void timeline_enable( uint32_t enable){
+  timeline.enable = enable;
+}
+
+/**
+ * @brief Drop every event
+ */
+void timeline_clear( void){
+  TIMELINE_LOCK();
+  timeline.head = 0;
+  TIMELINE_UNLOCK();
+}
+
+/**
+ * @brief Print the ring, then record again from an empty ring
+ * @note  The recorder is paused while printing, so the dump itself is not recorded. Task context on target.
+ *        tl,hz,<ticks per second>
+ *        tl,task,<task number>,<name>      Tasks alive at the dump. Target only.
+ *        tl,zone,<zone>,<name>
+ *        tl,ev,<tick>,<type>,<id>          Oldest first
+ *        tl,end,<overwritten events>
+ */
+void timeline_dump( void){
+  timeline_enable( 0);
+
+  TIMELINE_PRINTF( "tl,hz,%u", (unsigned)PROFILE_HZ);
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  static tAppRtosTopTask task[APP_RTOS_TOP_MAX_TASK];
+  uint32_t total;
+  uint32_t num_task = app_rtos_top_snapshot( task, APP_RTOS_TOP_MAX_TASK, &total);
+  for(uint32_t i=0; i<num_task; ++i){
+    TIMELINE_PRINTF( "tl,task,%u,%s", (unsigned)task[i].id, task[i].name);
+  }
+#endif
+  for(uint32_t i=0; i<kNumProfileZone; ++i){
+    TIMELINE_PRINTF( "tl,zone,%u,%s", (unsigned)i, profile_zone_name(i));
+  }
+
+  const uint32_t lost   = timeline.head > TIMELINE_EVENT_NUM ? timeline.head - TIMELINE_EVENT_NUM : 0;
+  uint32_t       cursor = 0;
+  tTimelineEvent buf[16];
+  size_t         len;
+  while( 0 != (len = timeline_read( buf, sizeof(buf)/sizeof(buf[0]), &cursor)) ){
+    for(size_t i=0; i<len; ++i){
+      TIMELINE_PRINTF( "tl,ev,%u,%s,%x", (unsigned)buf[i].time, timeline_type_name( buf[i].word >> 24), (unsigned)(buf[i].word & TIMELINE_ID_MASK));
+    }
+  }
+  TIMELINE_PRINTF( "tl,end,%u", (unsigned)lost);
+
+  timeline_clear();
+  timeline_enable( 1);
+}
+
+const char *timeline_type_name( uint32_t type){
+  return type<kNumTimeline ? timeline_type_names[type] : "";
+}
+
+} /* extern "C" */
+
+/* ********************************** EOF *********************************** */
@@ -0,0 +1,119 @@
+/**
+ ******************************************************************************
+ * @file    timeline.h
+ * @author  RandleH
+ * @brief   Project task timeline recorder
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 RandleH.
+ * All rights reserved.
+ *
+ * This software component is licensed by RandleH under BSD 3-Clause license,
+ * the "License"; You may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at:
+ *                        opensource.org/licenses/BSD-3-Clause
+ *
+ ******************************************************************************
+*/
+
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  #include "device.h"
+#endif
+
+
+/* ************************************************************************** */
+/*                                Task Timeline                               */
+/* ************************************************************************** */
+/**
+ * @note
+ *  Every event is 8 bytes: the profiling tick (see `profile_now()`) and one word packing the type
+ *  and a 24-bit id. The ring keeps the latest `TIMELINE_EVENT_NUM` events and overwrites the oldest.
+ *  The FreeRTOS trace macros in `FreeRTOSConfig.h` record the task switches, the queue/semaphore
+ *  and the event group operations. The interrupt handlers record their own entry and exit, and
+ *  every profiling zone is recorded as a begin/end pair.
+ *  `timeline_dump()` prints the events as text. `tool/timeline.py` converts them into the Chrome
+ *  trace JSON read by Perfetto and `chrome://tracing`.
+ *  Only built with `-DTIMELINE=1`. Otherwise every `TIMELINE_*` macro is empty.
+ */
+#ifndef TIMELINE
+  #define TIMELINE            (0)
+#endif
+
+#ifndef TIMELINE_EVENT_NUM
+  #define TIMELINE_EVENT_NUM  (512)       /*!< Must be a power of 2 */
+#endif
+
+#define TIMELINE_ID_MASK      (0x00FFFFFFU)
+
+#define TIMELINE_TYPE_LIST( X)                                                        \
+  X( TASK_IN,     "in"    )   /*!< Task switched in. id=task number             */    \
+  X( QUEUE_BLOCK, "qblk"  )   /*!< Blocked on a queue/semaphore. id=address     */    \
+  X( QUEUE_TAKE,  "qtake" )   /*!< Queue received/semaphore taken. id=address   */    \
+  X( QUEUE_GIVE,  "qgive" )   /*!< Queue sent/semaphore given. id=address       */    \
+  X( EVENT_WAIT,  "ewait" )   /*!< Blocked on an event group. id=bits           */    \
+  X( EVENT_SET,   "eset"  )   /*!< Event group bits set. id=bits                */    \
+  X( ISR_ENTER,   "isr"   )   /*!< Interrupt entered. id=exception number       */    \
+  X( ISR_EXIT,    "iret"  )   /*!< Interrupt exited. id=exception number        */    \
+  X( ZONE_BEGIN,  "zb"    )   /*!< Profiling zone opened. id=zone               */    \
+  X( ZONE_END,    "ze"    )   /*!< Profiling zone closed. id=zone               */
+
+#define TIMELINE_TYPE_ENUM( tag, name)     kTimeline_##tag,
+typedef enum TimelineTypeEnum{
+  kTimeline_NONE = 0,
+  TIMELINE_TYPE_LIST( TIMELINE_TYPE_ENUM)
+  kNumTimeline
+} TimelineTypeEnum_t;
+#undef TIMELINE_TYPE_ENUM
+
+typedef struct stTimelineEvent{
+  uint32_t time;                          /*!< Profiling tick */
+  uint32_t word;                          /*!< [31:24] type | [23:0] id */
+} tTimelineEvent;
+
+typedef struct stTimeline{
+  uint32_t       head;                    /*!< Number of events ever recorded. Free running. */
+  uint32_t       enable;
+  tTimelineEvent event[TIMELINE_EVENT_NUM];
+} tTimeline;
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+extern tTimeline timeline;
+
+void        timeline_record( uint32_t type, uint32_t id);
+void        timeline_record_at( uint32_t time, uint32_t type, uint32_t id);
+size_t      timeline_read( tTimelineEvent *buf, size_t num, uint32_t *cursor);
+void        timeline_enable( uint32_t enable);
+void        timeline_clear( void);
+void        timeline_dump( void);
+const char *timeline_type_name( uint32_t type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#if (TIMELINE==1)
+  #define TIMELINE_RECORD( TYPE, id)  timeline_record( kTimeline_##TYPE, (uint32_t)(id))
+  #if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+    #define TIMELINE_ISR_ENTER()      timeline_record( kTimeline_ISR_ENTER, __get_IPSR())
+    #define TIMELINE_ISR_EXIT()       timeline_record( kTimeline_ISR_EXIT,  __get_IPSR())
+  #else
+    #define TIMELINE_ISR_ENTER()      do{}while(0)
+    #define TIMELINE_ISR_EXIT()       do{}while(0)
+  #endif
+#else
+  #define TIMELINE_RECORD( TYPE, id)  do{}while(0)
+  #define TIMELINE_ISR_ENTER()        do{}while(0)
+  #define TIMELINE_ISR_EXIT()         do{}while(0)
+#endif
+
+#endif
+/* ********************************** EOF *********************************** */
@@ -7,7 +7,10 @@ if( NOT $ENV{METOPE_CHIP} STREQUAL "NATIVE")
                                                                 "${PRJ_TOP}/top/*.cc" 
                                                                 "${PRJ_TOP}/top/*.c" )
 else()
-    list( APPEND SRC_LIST_TO_BE_ADDED "${PRJ_TOP}/top/memory.cc")
+    list( APPEND SRC_LIST_TO_BE_ADDED "${PRJ_TOP}/top/memory.cc"
+                                     "${PRJ_TOP}/top/profile.cc"
+                                     "${PRJ_TOP}/top/timeline.cc"
+                                     "${PRJ_TOP}/top/trace.cc")
 endif()
 
 message( STATUS "Add the source files ${SRC_LIST_TO_BE_ADDED}")
@@ -17,6 +17,653 @@
  ******************************************************************************
 */
 
+/* ************************************************************************** */
+/*                                  Includes                                  */
+/* ************************************************************************** */
+#include <string.h>
+#include <stdarg.h>
+#include "trace.h"
+#include "trace.hh"
+#include "cmn_utility.h"
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  #include "device.h"
+  #include "bsp_uart.h"
+  #include "FreeRTOS.h"
+  #include "task.h"
+#elif (defined SYS_TARGET_NATIVE)
+  #include <stdio.h>
+#endif
 
 
+/* ************************************************************************** */
+/*                               Private Macros                               */
+/* ************************************************************************** */
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  /* Any task or ISR may log. The ring index is only held for a `memcpy()` of one record. */
+  #define TRACE_DEFER_LOCK()      uint32_t primask = __get_PRIMASK(); __disable_irq()
+  #define TRACE_DEFER_UNLOCK()    __set_PRIMASK(primask)
+  /* Kept across a reset. See the `.noinit` section of the linker script */
+  #define TRACE_CRASH_SECTION     __attribute__((section(".noinit")))
+#else
+  #define TRACE_DEFER_LOCK()
+  #define TRACE_DEFER_UNLOCK()
+  #define TRACE_CRASH_SECTION
+#endif
 
+#if (defined SYS_TARGET_NATIVE)
+  #define TRACE_NATIVE_LINE_MAX   (512)
+#endif
+
+static_assert( (TRACE_DEFER_RING_SIZE & (TRACE_DEFER_RING_SIZE-1))==0, "Ring size MUST be a power of 2");
+static_assert( TRACE_DEFER_RECORD_MAX - TRACE_DEFER_HEADER_LEN <= UINT8_MAX, "Payload length MUST fit in one byte");
+static_assert( TRACE_DEFER_HEADER_LEN + TRACE_DEFER_ARG_MAX*4 + TRACE_DEFER_STR_MAX + 1 <= TRACE_DEFER_RECORD_MAX, "Record can NOT hold a full string");
+static_assert( (TRACE_CRASH_RING_SIZE & (TRACE_CRASH_RING_SIZE-1))==0, "Ring size MUST be a power of 2");
+static_assert( TRACE_CRASH_RING_SIZE >= TRACE_DEFER_RECORD_MAX, "Crash ring can NOT hold a full record");
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+static_assert( TRACE_CRASH_TASK_LEN==configMAX_TASK_NAME_LEN, "Update `TRACE_CRASH_TASK_LEN`");
+#endif
+
+
+/* ************************************************************************** */
+/*                              Private Variables                             */
+/* ************************************************************************** */
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  /* Start of `.rodata`. Defined by the linker script */
+  extern "C" const char __trace_fmt_base[];
+  #define trace_fmt_base    __trace_fmt_base
+#else
+  /* Any constant close to the string literals. The offset may be negative on native. */
+  static const char trace_fmt_origin[] = "";
+  #define trace_fmt_base    trace_fmt_origin
+#endif
+
+#define TRACE_MODULE_INIT( tag, name)   TRACE_COMPILE_LEVEL_##tag,
+#define TRACE_MODULE_NAME( tag, name)   name,
+volatile uint8_t            trace_module_level[kNumTraceModule] = { TRACE_MODULE_LIST( TRACE_MODULE_INIT) };
+static const char * const   trace_module_names[kNumTraceModule] = { TRACE_MODULE_LIST( TRACE_MODULE_NAME) };
+#undef TRACE_MODULE_INIT
+#undef TRACE_MODULE_NAME
+
+static struct{
+  uint8_t           buf[TRACE_DEFER_RING_SIZE];
+  volatile uint32_t head;       /*!< Free running. Written by the loggers */
+  volatile uint32_t tail;       /*!< Free running. Written by the drain */
+  volatile uint32_t dropped;
+} defer_ring;
+
+tTraceCrash trace_crash TRACE_CRASH_SECTION;
+
+#if (defined SYS_TARGET_NATIVE)
+static tTraceSink trace_sink = NULL;
+#endif
+
+
+namespace trace{
+
+/* ************************************************************************** */
+/*                              Public Functions                              */
+/* ************************************************************************** */
+int run( const Call &call, char *buf, size_t size){
+  if(size==0) return 0;
+
+  const Arg *argv = call.argv;
+  size_t     idx  = 0;
+
+  for(size_t i=0; i<call.num_op && idx<size; ++i){
+    const Op &op = call.op[i];
+    switch(op.code){
+      case OpCode::kLiteral:{
+        /* Separators such as `:` or ` ` are the most common literal runs */
+        if(op.len==1){
+          buf[idx++] = call.fmt[op.offset];
+        }else{
+          size_t len = CMN_MIN( (size_t)op.len, size-idx);
+          memcpy( &buf[idx], &call.fmt[op.offset], len);
+          idx += len;
+        }
+        break;
+      }
+      case OpCode::kUnsigned:{
+        uint32_t value = (argv++)->u;
+        if(op.width==0xFF){
+          idx += cmn_utility_uint2strdec( &buf[idx], size-idx, value);
+        }else if(op.width==2 && value<100 && size-idx>2){
+          idx += cmn_utility_uint2strdec_2digits( &buf[idx], value);
+        }else{
+          idx += cmn_utility_uint2strdec_width( &buf[idx], size-idx, value, op.width);
+        }
+        break;
+      }
+      case OpCode::kSigned:{
+        int32_t value = (int32_t)(argv++)->u;
+        if(op.width==0xFF){
+          idx += cmn_utility_int2strdec( &buf[idx], size-idx, value);
+        }else if(op.width==2 && (uint32_t)value<100 && size-idx>2){
+          idx += cmn_utility_uint2strdec_2digits( &buf[idx], value);
+        }else{
+          idx += cmn_utility_int2strdec_width( &buf[idx], size-idx, value, op.width);
+        }
+        break;
+      }
+      case OpCode::kHex:{
+        uint32_t value = (argv++)->u;
+        if(op.width==0xFF){
+          idx += cmn_utility_uint2strhex( &buf[idx], size-idx, value);
+        }else{
+          idx += cmn_utility_uint2strhex_width( &buf[idx], size-idx, value, op.width);
+        }
+        break;
+      }
+      case OpCode::kChar:{
+        buf[idx++] = (char)(argv++)->u;
+        break;
+      }
+      case OpCode::kString:{
+        const char *str = (argv++)->s;
+        size_t      len = strlen(str);
+        if( len > size-idx-1 ){
+          memset( &buf[idx], '#', size-idx-1);
+          idx = size-1;
+        }else{
+          strncpy( &buf[idx], str, size-idx);
+          idx += len;
+        }
+        break;
+      }
+    }
+  }
+
+  idx = CMN_MIN( idx, size-1);
+  buf[idx++] = '\0';
+
+  return (int)idx;
+}
+
+int run_call( char *buf, size_t size, const void *ctx){
+  return run( *static_cast<const Call*>(ctx), buf, size);
+}
+
+/**
+ * @brief Format string and arguments of a C caller
+ */
+struct VaCall{
+  const char *fmt;
+  va_list     va;
+};
+
+/**
+ * @brief `cmn_utility_vsnprintf()` in the shape of a C formatter callback
+ * @param [in] ctx - Pointer to `trace::VaCall`
+ */
+static TRACE_UNUSED int run_va_call( char *buf, size_t size, const void *ctx){
+  const VaCall *call = static_cast<const VaCall*>(ctx);
+  va_list       va;
+  va_copy( va, const_cast<VaCall*>(call)->va);
+  int ret = cmn_utility_vsnprintf( buf, size, call->fmt, va);
+  va_end( va);
+  return ret;
+}
+
+/**
+ * @brief Encode one deferred record
+ * @param [out] rec - Shall hold `TRACE_DEFER_RECORD_MAX` bytes
+ * @return Record length
+ */
+static size_t encode( uint8_t *rec, const char *fmt, uint32_t str_mask, const Arg *argv, size_t num_arg){
+  uint32_t id  = (uint32_t)(fmt - trace_fmt_base) & TRACE_DEFER_ID_DROPPED;
+  size_t   len = TRACE_DEFER_HEADER_LEN;
+
+  rec[0] = TRACE_DEFER_SYNC;
+  rec[2] = (uint8_t)(id);
+  rec[3] = (uint8_t)(id>>8);
+  rec[4] = (uint8_t)(id>>16);
+
+  for(size_t i=0; i<num_arg; ++i){
+    if( str_mask & (1U<<i) ){
+      /* Leave room for the integers behind */
+      size_t room = TRACE_DEFER_RECORD_MAX - len - 1 - 4*(num_arg-i-1);
+      size_t n    = strnlen( argv[i].s, CMN_MIN( room, (size_t)TRACE_DEFER_STR_MAX));
+      rec[len++] = (uint8_t)n;
+      memcpy( &rec[len], argv[i].s, n);
+      len += n;
+    }else{
+      memcpy( &rec[len], &argv[i].u, 4);
+      len += 4;
+    }
+  }
+  rec[1] = (uint8_t)(len - TRACE_DEFER_HEADER_LEN);
+  return len;
+}
+
+/**
+ * @brief Copy one record into the crash ring. The oldest records are overwritten.
+ * @note  `tail` is moved before the copy and `head` after it, so a fault in between leaves
+ *        whole records only.
+ */
+static size_t crash_write( const uint8_t *rec, size_t len){
+  TRACE_DEFER_LOCK();
+  if( trace_crash.magic!=TRACE_CRASH_ARMED ){
+    TRACE_DEFER_UNLOCK();
+    return 0;
+  }
+  uint32_t head = trace_crash.head;
+  uint32_t tail = trace_crash.tail;
+  while( TRACE_CRASH_RING_SIZE - (head - tail) < len ){
+    tail += TRACE_DEFER_HEADER_LEN + trace_crash.buf[(tail+1) & (TRACE_CRASH_RING_SIZE-1)];
+  }
+  trace_crash.tail = tail;
+
+  size_t offset = head & (TRACE_CRASH_RING_SIZE-1);
+  size_t first  = CMN_MIN( len, TRACE_CRASH_RING_SIZE-offset);
+  memcpy( &trace_crash.buf[offset], rec, first);
+  memcpy( &trace_crash.buf[0], &rec[first], len-first);
+  trace_crash.head = head + len;
+  TRACE_DEFER_UNLOCK();
+
+  return len;
+}
+
+/**
+ * @brief Whether the ring left by the last boot holds whole records only
+ */
+static bool crash_valid( void){
+  uint32_t head = trace_crash.head;
+  uint32_t tail = trace_crash.tail;
+  if( head - tail > TRACE_CRASH_RING_SIZE || trace_crash.reason==kTraceCrash_None || trace_crash.reason>=kNumTraceCrash ){
+    return false;
+  }
+  while( tail != head ){
+    if( trace_crash.buf[tail & (TRACE_CRASH_RING_SIZE-1)] != TRACE_DEFER_SYNC || head - tail < TRACE_DEFER_HEADER_LEN ){
+      return false;
+    }
+    size_t len = TRACE_DEFER_HEADER_LEN + trace_crash.buf[(tail+1) & (TRACE_CRASH_RING_SIZE-1)];
+    if( len > TRACE_DEFER_RECORD_MAX || len > head - tail ){
+      return false;
+    }
+    tail += len;
+  }
+  return true;
+}
+
+/**
+ * @brief Collect the arguments of a C caller
+ * @return Number of arguments. At most `TRACE_DEFER_ARG_MAX`
+ */
+static uint32_t unpack( Arg *argv, uint32_t str_mask, uint32_t num_arg, va_list va){
+  num_arg = CMN_MIN( num_arg, (uint32_t)TRACE_DEFER_ARG_MAX);
+  for(uint32_t i=0; i<num_arg; ++i){
+    if( str_mask & (1U<<i) ){
+      argv[i].s = va_arg( va, const char *);
+    }else{
+      argv[i].u = va_arg( va, uint32_t);
+    }
+  }
+  return num_arg;
+}
+
+int crash_push( const char *fmt, uint32_t str_mask, const Arg *argv, size_t num_arg){
+  if( trace_crash.magic!=TRACE_CRASH_ARMED ){
+    return 0;
+  }
+  uint8_t rec[TRACE_DEFER_RECORD_MAX];
+  return (int)crash_write( rec, encode( rec, fmt, str_mask, argv, num_arg));
+}
+
+int level_push( const Call &call, uint32_t str_mask, size_t num_arg){
+  crash_push( call.fmt, str_mask, call.argv, num_arg);
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6)
+  return bsp_uart_print_with( run_call, &call);
+#elif (defined SYS_TARGET_NATIVE)
+  char buf[TRACE_NATIVE_LINE_MAX];
+  run( call, buf, sizeof(buf));
+  return trace_native_printf( "%s\n", buf);
+#else
+  return 0;
+#endif
+}
+
+int defer_push( const char *fmt, uint32_t str_mask, const Arg *argv, size_t num_arg){
+  uint8_t rec[TRACE_DEFER_RECORD_MAX];
+  size_t  len = encode( rec, fmt, str_mask, argv, num_arg);
+
+  crash_write( rec, len);
+
+  TRACE_DEFER_LOCK();
+  uint32_t head = defer_ring.head;
+  if( TRACE_DEFER_RING_SIZE - (head - defer_ring.tail) < len ){
+    defer_ring.dropped = defer_ring.dropped + 1;
+    TRACE_DEFER_UNLOCK();
+    return 0;
+  }
+  size_t offset = head & (TRACE_DEFER_RING_SIZE-1);
+  size_t first  = CMN_MIN( len, TRACE_DEFER_RING_SIZE-offset);
+  memcpy( &defer_ring.buf[offset], rec, first);
+  memcpy( &defer_ring.buf[0], &rec[first], len-first);
+  defer_ring.head = head + len;
+  TRACE_DEFER_UNLOCK();
+
+  return (int)len;
+}
+
+} /* Namespace trace */
+
+
+/* ************************************************************************** */
+/*                              Public Functions                              */
+/* ************************************************************************** */
+extern "C"{
+
+/**
+ * @brief Change the runtime log level
+ * @note  A level above the compile level of the module has no effect. Those calls were stripped.
+ * @param [in] module - `TraceModuleEnum_t`. `kNumTraceModule` means all modules.
+ * @param [in] level  - `TRACE_LEVEL_OFF` ... `TRACE_LEVEL_DEBUG`
+ * @return 0 on success. -1 if a parameter is out of range.
+ */
+int trace_level_set( uint32_t module, uint32_t level){
+  if( module > kNumTraceModule || level > TRACE_LEVEL_DEBUG ){
+    return -1;
+  }
+  for(uint32_t i=0; i<kNumTraceModule; ++i){
+    if( module==i || module==kNumTraceModule ){
+      trace_module_level[i] = (uint8_t)level;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Name of a module as written in the command box
+ * @return NULL if out of range
+ */
+const char *trace_module_name( uint32_t module){
+  return module < kNumTraceModule ? trace_module_names[module] : NULL;
+}
+
+/**
+ * @brief Deferred log of C callers. See `TRACE_DEFER_PRINTF()`
+ * @param [in] fmt      - Format string literal
+ * @param [in] str_mask - Bit `i` is set if the `i`th argument is a string
+ * @param [in] num_arg  - Number of arguments. At most `TRACE_DEFER_ARG_MAX`
+ * @return Number of bytes queued. 0 if the ring is full and the record was dropped.
+ */
+int trace_defer_log( const char *fmt, uint32_t str_mask, uint32_t num_arg, ...){
+  trace::Arg argv[TRACE_DEFER_ARG_MAX];
+  va_list    va;
+
+  va_start( va, num_arg);
+  num_arg = trace::unpack( argv, str_mask, num_arg, va);
+  va_end( va);
+
+  return trace::defer_push( fmt, str_mask, argv, num_arg);
+}
+
+/**
+ * @brief Move whole records out of the ring
+ * @note  Single consumer. A record is never split, so the output can be sent in any chunks.
+ *        A `TRACE_DEFER_ID_DROPPED` record is inserted first if any record was dropped.
+ * @param [out] buf  - Output buffer. Shall hold at least `TRACE_DEFER_RECORD_MAX` bytes.
+ * @param [in]  size - Size of the output buffer
+ * @return Number of bytes written into `buf`
+ */
+size_t trace_defer_drain( uint8_t *buf, size_t size){
+  size_t idx = 0;
+
+  if( defer_ring.dropped!=0 && size >= TRACE_DEFER_HEADER_LEN+4 ){
+    uint32_t dropped;
+    {
+      TRACE_DEFER_LOCK();
+      dropped            = defer_ring.dropped;
+      defer_ring.dropped = 0;
+      TRACE_DEFER_UNLOCK();
+    }
+    buf[idx++] = TRACE_DEFER_SYNC;
+    buf[idx++] = 4;
+    buf[idx++] = (uint8_t)(TRACE_DEFER_ID_DROPPED);
+    buf[idx++] = (uint8_t)(TRACE_DEFER_ID_DROPPED>>8);
+    buf[idx++] = (uint8_t)(TRACE_DEFER_ID_DROPPED>>16);
+    memcpy( &buf[idx], &dropped, 4);
+    idx += 4;
+  }
+
+  uint32_t tail = defer_ring.tail;
+  uint32_t head = defer_ring.head;
+  while( tail != head ){
+    size_t len = TRACE_DEFER_HEADER_LEN + defer_ring.buf[(tail+1) & (TRACE_DEFER_RING_SIZE-1)];
+    if( len > size-idx ){
+      break;
+    }
+    size_t offset = tail & (TRACE_DEFER_RING_SIZE-1);
+    size_t first  = CMN_MIN( len, TRACE_DEFER_RING_SIZE-offset);
+    memcpy( &buf[idx], &defer_ring.buf[offset], first);
+    memcpy( &buf[idx+first], &defer_ring.buf[0], len-first);
+    idx  += len;
+    tail += len;
+  }
+  defer_ring.tail = tail;
+
+  return idx;
+}
+
+/**
+ * @brief Number of records dropped and NOT reported by `trace_defer_drain()` yet
+ */
+uint32_t trace_defer_dropped( void){
+  return defer_ring.dropped;
+}
+
+/**
+ * @brief Format string of a record. The host decoder does the same with the extracted section.
+ */
+const char *trace_defer_fmt( uint32_t id){
+  /* Sign extend the 24-bit offset */
+  return &trace_fmt_base[ ((int32_t)(id<<8))>>8 ];
+}
+
+/**
+ * @brief Move pending records into the UART transmit ring
+ * @note  Low priority. Called by the idle task. Records stay here while the UART ring is full.
+ */
+void trace_defer_flush( void){
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6)
+  uint8_t buf[TRACE_DEFER_RECORD_MAX];
+  size_t  len;
+  while( bsp_uart_tx_room() >= sizeof(buf) && 0 != (len = trace_defer_drain( buf, sizeof(buf))) ){
+    bsp_uart_write( buf, len);
+  }
+#endif
+}
+
+/**
+ * @brief Validate the crash ring left by the last boot
+ * @note  Called first thing after reset. A stamped ring is kept until `trace_crash_clear()`.
+ *        Anything else, such as the random content after a power-on, re-arms an empty ring.
+ * @return `TraceCrashEnum_t` of the last boot. `kTraceCrash_None` if nothing was stamped.
+ */
+uint32_t trace_crash_boot( void){
+  if( trace_crash.magic==TRACE_CRASH_FROZEN && trace::crash_valid() ){
+    return trace_crash.reason;
+  }
+  trace_crash_clear();
+  return kTraceCrash_None;
+}
+
+/**
+ * @brief Crash record of C callers. See `TRACE_CRASH_PRINTF()`
+ * @return Number of bytes copied. 0 if the ring is NOT armed.
+ */
+int trace_crash_log( const char *fmt, uint32_t str_mask, uint32_t num_arg, ...){
+  if( trace_crash.magic!=TRACE_CRASH_ARMED ){
+    return 0;
+  }
+
+  trace::Arg argv[TRACE_DEFER_ARG_MAX];
+  va_list    va;
+
+  va_start( va, num_arg);
+  num_arg = trace::unpack( argv, str_mask, num_arg, va);
+  va_end( va);
+
+  return trace::crash_push( fmt, str_mask, argv, num_arg);
+}
+
+/**
+ * @brief Leveled log of C callers. See `TRACE_LEVEL_LOG()`
+ * @note  Mirrored into the crash ring, then printed like `TRACE_PRINTF()`.
+ */
+int trace_level_log( const char *fmt, uint32_t str_mask, uint32_t num_arg, ...){
+  va_list va;
+
+  if( trace_crash.magic==TRACE_CRASH_ARMED ){
+    trace::Arg argv[TRACE_DEFER_ARG_MAX];
+    va_start( va, num_arg);
+    uint32_t n = trace::unpack( argv, str_mask, num_arg, va);
+    va_end( va);
+    trace::crash_push( fmt, str_mask, argv, n);
+  }
+
+  int ret = 0;
+  va_start( va, num_arg);
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6)
+  trace::VaCall call = { fmt};
+  va_copy( call.va, va);
+  ret = bsp_uart_print_with( trace::run_va_call, &call);
+  va_end( call.va);
+#elif (defined SYS_TARGET_NATIVE)
+  char buf[TRACE_NATIVE_LINE_MAX];
+  vsnprintf( buf, sizeof(buf), fmt, va);
+  ret = trace_native_printf( "%s\n", buf);
+#endif
+  va_end( va);
+  return ret;
+}
+
+/**
+ * @brief Stamp the crash and freeze the ring
+ * @note  Fault context. Only the first crash is kept until the ring is dumped.
+ * @param [in] reason - `TraceCrashEnum_t`
+ * @param [in] frame  - Stacked R0-R3, R12, LR, PC, xPSR. NULL if none.
+ */
+void trace_crash_mark( uint32_t reason, const uint32_t *frame){
+  if( trace_crash.magic!=TRACE_CRASH_ARMED ){
+    return;
+  }
+  trace_crash.reason = reason;
+  trace_crash.lr     = frame ? frame[5] : 0;
+  trace_crash.pc     = frame ? frame[6] : 0;
+  trace_crash.psr    = frame ? frame[7] : 0;
+  memset( trace_crash.task, 0, sizeof(trace_crash.task));
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  trace_crash.cfsr   = SCB->CFSR;
+  trace_crash.hfsr   = SCB->HFSR;
+  trace_crash.mmfar  = SCB->MMFAR;
+  trace_crash.bfar   = SCB->BFAR;
+  if( xTaskGetSchedulerState()!=taskSCHEDULER_NOT_STARTED ){
+    strncpy( trace_crash.task, pcTaskGetName(NULL), sizeof(trace_crash.task));
+  }
+#else
+  trace_crash.cfsr   = 0;
+  trace_crash.hfsr   = 0;
+  trace_crash.mmfar  = 0;
+  trace_crash.bfar   = 0;
+#endif
+  trace_crash.magic  = TRACE_CRASH_FROZEN;
+}
+
+/**
+ * @brief Record the location of a failed `ASSERT()` and stamp the crash
+ * @note  The PC is the return address into the caller, i.e. the assertion itself.
+ */
+void trace_crash_assert( const char *file, uint32_t line){
+  /* The tail of the path is the useful part */
+  size_t len = strlen( file);
+  if( len > TRACE_DEFER_STR_MAX ){
+    file += len - TRACE_DEFER_STR_MAX;
+  }
+  TRACE_CRASH_PRINTF( FMT_ERROR_STR "Assertion@%s:%u" FMT_RESET, file, line);
+
+  uint32_t frame[8] = {0};
+  frame[6] = (uint32_t)(uintptr_t)__builtin_return_address(0);
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6) || (defined EMULATOR_STM32F411CEU6) || (defined EMULATOR_STM32F405RGT6)
+  frame[7] = __get_xPSR();
+#endif
+  trace_crash_mark( kTraceCrash_Assert, frame);
+}
+
+/**
+ * @brief Copy whole records out of the crash ring without releasing them
+ * @param [out]   buf    - Output buffer. Shall hold at least `TRACE_DEFER_RECORD_MAX` bytes.
+ * @param [in]    size   - Size of the output buffer
+ * @param [inout] cursor - Bytes already read from the oldest record. Start with 0.
+ * @return Number of bytes written into `buf`. 0 at the end.
+ */
+size_t trace_crash_read( uint8_t *buf, size_t size, uint32_t *cursor){
+  uint32_t head = trace_crash.head;
+  uint32_t tail = trace_crash.tail + *cursor;
+  size_t   idx  = 0;
+
+  if( trace_crash.head - trace_crash.tail > TRACE_CRASH_RING_SIZE ){
+    return 0;
+  }
+  while( tail != head ){
+    size_t len = TRACE_DEFER_HEADER_LEN + trace_crash.buf[(tail+1) & (TRACE_CRASH_RING_SIZE-1)];
+    if( len > size-idx ){
+      break;
+    }
+    size_t offset = tail & (TRACE_CRASH_RING_SIZE-1);
+    size_t first  = CMN_MIN( len, TRACE_CRASH_RING_SIZE-offset);
+    memcpy( &buf[idx], &trace_crash.buf[offset], first);
+    memcpy( &buf[idx+first], &trace_crash.buf[0], len-first);
+    idx  += len;
+    tail += len;
+  }
+  *cursor += (uint32_t)idx;
+  return idx;
+}
+
+/**
+ * @brief Drop the stamp and the records, then start recording again
+ */
+void trace_crash_clear( void){
+  trace_crash.magic  = 0;
+  trace_crash.head   = 0;
+  trace_crash.tail   = 0;
+  trace_crash.reason = kTraceCrash_None;
+  trace_crash.magic  = TRACE_CRASH_ARMED;
+}
+
+#if (defined SYS_TARGET_NATIVE)
+/**
+ * @brief `TRACE_PRINTF()` of native
+ * @note  A line longer than `TRACE_NATIVE_LINE_MAX` is cut when it goes to the sink.
+ */
+int trace_native_printf( const char *fmt, ...){
+  va_list va;
+  va_start( va, fmt);
+  if( trace_sink==NULL ){
+    int ret = vprintf( fmt, va);
+    va_end( va);
+    return ret;
+  }
+  char buf[TRACE_NATIVE_LINE_MAX];
+  int  ret = vsnprintf( buf, sizeof(buf), fmt, va);
+  va_end( va);
+  if( ret > 0 ){
+    trace_sink( buf, CMN_MIN( (size_t)ret, sizeof(buf)-1));
+  }
+  return ret;
+}
+
+/**
+ * @brief Send the lines of native to `sink` instead of stdout
+ * @param [in] sink - NULL for stdout
+ */
+void trace_native_sink( tTraceSink sink){
+  trace_sink = sink;
+}
+#endif
+
+} /* extern "C" */
+
+
+/* ********************************** EOF *********************************** */
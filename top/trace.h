@@ -20,14 +20,164 @@
 #ifndef TRACE_H
 #define TRACE_H
 
+#include <stdint.h>
+#include <stddef.h>
 
 
+/* ************************************************************************** */
+/*                             Deferred Binary Log                            */
+/* ************************************************************************** */
+/**
+ * @note
+ *  With `TRACE_DEFER=1` a trace call does NOT format anything. It copies a record into a RAM ring:
+ *    [0xA5][payload length][format id: 3 bytes in little endian][payload...]
+ *  The payload holds every argument in order. An integer takes 4 bytes in little endian. A string
+ *  takes one length byte followed by at most `TRACE_DEFER_STR_MAX` characters.
+ *  The format id is the offset of the format string literal from the start of `.rodata`. The
+ *  section is extracted from the ELF at build time (`build/model1.trace`) and `tool/uart.py`
+ *  decodes the stream with it. The format string MUST be a string literal.
+ *  The ring is sent by `trace_defer_flush()` from the idle task.
+ */
+#define TRACE_DEFER_SYNC          (0xA5)
+#define TRACE_DEFER_HEADER_LEN    (5)
+#define TRACE_DEFER_RECORD_MAX    (96)
+#define TRACE_DEFER_STR_MAX       (32)
+#define TRACE_DEFER_ARG_MAX       (8)
+#define TRACE_DEFER_RING_SIZE     (2048)
+#define TRACE_DEFER_ID_DROPPED    (0xFFFFFF)  /*!< Payload is the number of records dropped since the last one */
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+int      trace_defer_log( const char *fmt, uint32_t str_mask, uint32_t num_arg, ...);
+size_t   trace_defer_drain( uint8_t *buf, size_t size);
+uint32_t trace_defer_dropped( void);
+const char *trace_defer_fmt( uint32_t id);
+void     trace_defer_flush( void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* ************************************************************************** */
+/*                                Crash Record                                */
+/* ************************************************************************** */
+/**
+ * @note
+ *  Every leveled `TRACE_*` call also copies its deferred record into a small ring placed in
+ *  `.noinit` RAM, which the startup does NOT clear. The oldest records are overwritten.
+ *  A fault handler or `ASSERT()` stamps the fault registers and the task name, and the ring is
+ *  frozen until the `CRASH` command of the command box dumps and re-arms it on the next boot.
+ *  The records are decoded by `tool/uart.py` like the deferred log.
+ */
+#define TRACE_CRASH_RING_SIZE     (1024)
+#define TRACE_CRASH_TASK_LEN      (8)           /*!< `configMAX_TASK_NAME_LEN` */
+#define TRACE_CRASH_ARMED         (0x4C4F4741)  /*!< Recording */
+#define TRACE_CRASH_FROZEN        (0x43524153)  /*!< A crash was stamped. Kept until dumped. */
+
+typedef enum{
+  kTraceCrash_None = 0,
+  kTraceCrash_Assert,
+  kTraceCrash_HardFault,
+  kTraceCrash_MemManage,
+  kTraceCrash_BusFault,
+  kTraceCrash_UsageFault,
+  kNumTraceCrash
+} TraceCrashEnum_t;
+
+typedef struct stTraceCrash{
+  volatile uint32_t magic;        /*!< `TRACE_CRASH_ARMED` or `TRACE_CRASH_FROZEN`. Anything else is garbage. */
+  volatile uint32_t head;         /*!< Free running */
+  volatile uint32_t tail;         /*!< Start of the oldest record. Free running */
+  uint32_t          reason;       /*!< `TraceCrashEnum_t` */
+  uint32_t          pc;           /*!< Stacked PC. Caller of `ASSERT()` for an assertion. */
+  uint32_t          lr;
+  uint32_t          psr;          /*!< Stacked xPSR. The low 9 bits are the active exception. */
+  uint32_t          cfsr;
+  uint32_t          hfsr;
+  uint32_t          mmfar;
+  uint32_t          bfar;
+  char              task[TRACE_CRASH_TASK_LEN];
+  uint8_t           buf[TRACE_CRASH_RING_SIZE];
+} tTraceCrash;
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+extern tTraceCrash trace_crash;
+
+uint32_t trace_crash_boot( void);
+int      trace_crash_log( const char *fmt, uint32_t str_mask, uint32_t num_arg, ...);
+int      trace_level_log( const char *fmt, uint32_t str_mask, uint32_t num_arg, ...);
+void     trace_crash_mark( uint32_t reason, const uint32_t *frame);
+void     trace_crash_assert( const char *file, uint32_t line);
+size_t   trace_crash_read( uint8_t *buf, size_t size, uint32_t *cursor);
+void     trace_crash_clear( void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifndef __cplusplus
+/**
+ * @note
+ *  C callers. The string arguments are told apart at compile time. At most `TRACE_DEFER_ARG_MAX` arguments.
+ *  C++ callers use `::trace::defer_printf()` instead. See `trace.hh`.
+ */
+  #define TRACE_DEFER_IS_STR( x)  _Generic( (x)+0, char*: 1U, const char*: 1U, default: 0U)
+  #define TRACE_DEFER_STR_MASK_( _0, a0, a1, a2, a3, a4, a5, a6, a7, ...) \
+    ( (TRACE_DEFER_IS_STR(a0)<<0) | (TRACE_DEFER_IS_STR(a1)<<1) | (TRACE_DEFER_IS_STR(a2)<<2) | (TRACE_DEFER_IS_STR(a3)<<3) |\
+      (TRACE_DEFER_IS_STR(a4)<<4) | (TRACE_DEFER_IS_STR(a5)<<5) | (TRACE_DEFER_IS_STR(a6)<<6) | (TRACE_DEFER_IS_STR(a7)<<7) )
+  #define TRACE_DEFER_STR_MASK( ...) TRACE_DEFER_STR_MASK_( __VA_ARGS__, 0, 0, 0, 0, 0, 0, 0, 0)
+  #define TRACE_DEFER_NUM_ARG_( _0, _1, _2, _3, _4, _5, _6, _7, _8, N, ...) N
+  #define TRACE_DEFER_NUM_ARG( ...)  TRACE_DEFER_NUM_ARG_( 0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+
+  #define TRACE_DEFER_PRINTF( fmt, ...) \
+    trace_defer_log( "" fmt, TRACE_DEFER_STR_MASK( 0, ##__VA_ARGS__), TRACE_DEFER_NUM_ARG(__VA_ARGS__), ##__VA_ARGS__)
+  #define TRACE_CRASH_PRINTF( fmt, ...) \
+    trace_crash_log( "" fmt, TRACE_DEFER_STR_MASK( 0, ##__VA_ARGS__), TRACE_DEFER_NUM_ARG(__VA_ARGS__), ##__VA_ARGS__)
+  #define TRACE_LEVEL_LOG( fmt, ...) \
+    trace_level_log( "" fmt, TRACE_DEFER_STR_MASK( 0, ##__VA_ARGS__), TRACE_DEFER_NUM_ARG(__VA_ARGS__), ##__VA_ARGS__)
+#endif
+
+
+/* ************************************************************************** */
+/*                                Trace Printer                               */
+/* ************************************************************************** */
 #if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6)
   #include "bsp_uart.h"
-  #define TRACE_PRINTF( fmt, ...) bsp_uart_printf( fmt, ##__VA_ARGS__)
+  #ifdef __cplusplus
+    /* Format string and arguments are checked at compile time. See `trace.hh` */
+    #include "trace.hh"
+    #if (defined TRACE_DEFER) && (TRACE_DEFER==1)
+      #define TRACE_PRINTF( fmt, ...) ::trace::defer_printf( [](){ return fmt; }, ##__VA_ARGS__)
+    #else
+      #define TRACE_PRINTF( fmt, ...) ::trace::uart_printf( [](){ return fmt; }, ##__VA_ARGS__)
+    #endif
+  #else
+    #if (defined TRACE_DEFER) && (TRACE_DEFER==1)
+      #define TRACE_PRINTF( fmt, ...) TRACE_DEFER_PRINTF( fmt, ##__VA_ARGS__)
+    #else
+      #define TRACE_PRINTF( fmt, ...) bsp_uart_printf( fmt, ##__VA_ARGS__)
+    #endif
+  #endif
 #elif defined (SYS_TARGET_NATIVE)
   #include <stdio.h>
-  #define TRACE_PRINTF( fmt, ...) printf( fmt"\n", ##__VA_ARGS__)
+  /**
+   * @note Lines go to stdout unless `trace_native_sink()` takes them, e.g. to keep a fuzzer quiet.
+   */
+  typedef void (*tTraceSink)( const void *data, size_t len);
+  #ifdef __cplusplus
+  extern "C"{
+  #endif
+  int  trace_native_printf( const char *fmt, ...) __attribute__(( format(printf,1,2)));
+  void trace_native_sink( tTraceSink sink);
+  #ifdef __cplusplus
+  }
+  #endif
+  #define TRACE_PRINTF( fmt, ...) trace_native_printf( fmt"\n", ##__VA_ARGS__)
 #else
   #define TRACE_PRINTF( fmt, ...) 
 #endif
@@ -54,25 +204,164 @@
 #define FMT_WARN_STR     FMT_YELLOW "WARNING: "
 #define FMT_ERROR_STR    FMT_B_RED  "  ERROR: "
 
-#if defined(LOG_LEVEL) && (LOG_LEVEL==2)
-  #define TRACE_DEBUG( fmt, ...) TRACE_PRINTF( "%s" fmt FMT_RESET, FMT_DEBUG_STR, ##__VA_ARGS__)
-#else
-  #define TRACE_DEBUG( fmt, ...)
-#endif // LOG_LEVEL
+#ifdef __cplusplus
+  /* `TRACE_LEVEL_LOG()` of C++ callers */
+  #include "trace.hh"
+#endif
 
-#if defined(LOG_LEVEL) && (LOG_LEVEL>=1)
-  #define TRACE_INFO( fmt, ...) TRACE_PRINTF( "%s" fmt, FMT_INFO_STR, ##__VA_ARGS__)
+/**
+ * @note The prefix is kept in the format string literal, whose address is the id of the record.
+ *       The arguments are evaluated once, then mirrored into the crash ring and printed.
+ *       The deferred log is mirrored by `trace::defer_push()`.
+ */
+#if (defined TRACE_DEFER) && (TRACE_DEFER==1) && ((defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6))
+  #define TRACE_LEVEL_PRINTF( prefix, fmt, ...) TRACE_PRINTF( prefix fmt, ##__VA_ARGS__)
 #else
-  #define TRACE_INFO( fmt, ...)
-#endif // LOG_LEVEL
+  #define TRACE_LEVEL_PRINTF( prefix, fmt, ...) TRACE_LEVEL_LOG( prefix fmt, ##__VA_ARGS__)
+#endif
 
-#if defined(LOG_LEVEL) && (LOG_LEVEL>=0)
-  #define TRACE_WARNING( fmt, ...) TRACE_PRINTF( "%s" fmt FMT_RESET, FMT_WARN_STR, ##__VA_ARGS__)
-  #define TRACE_ERROR( fmt, ...)   TRACE_PRINTF( "%s" fmt FMT_RESET, FMT_ERROR_STR, ##__VA_ARGS__)
-#else
-  #define TRACE_WARNING( fmt, ...)
-  #define TRACE_ERROR( fmt, ...)
-#endif // LOG_LEVEL
+
+/* ************************************************************************** */
+/*                              Module Log Level                              */
+/* ************************************************************************** */
+/**
+ * @note
+ *  Every source file belongs to a module. Set the tag before any include, otherwise `MISC`:
+ *
+ *    #define TRACE_MODULE  BSP_GYRO
+ *
+ *  A call is kept only if its level is not above the compile level of the module, then printed
+ *  only if it is not above the runtime level. A stripped call is removed by the preprocessor and
+ *  its arguments are NOT even compiled. A filtered call never evaluates its arguments.
+ *  The compile level follows `LOG_LEVEL` and may be overridden per module by CMake:
+ *
+ *    cmake -DLOG_LEVEL=2 -DTRACE_LEVEL="BSP_GYRO=1;APP_CLOCK=0" ..
+ *
+ *  The runtime level starts at the compile level. See the `LOG` command of the command box.
+ *  Levels MUST stay plain digits. They are pasted into macro names.
+ */
+#define TRACE_LEVEL_OFF         0
+#define TRACE_LEVEL_ERROR       1
+#define TRACE_LEVEL_WARNING     2
+#define TRACE_LEVEL_INFO        3
+#define TRACE_LEVEL_DEBUG       4
+
+#define TRACE_MODULE_LIST( X)           \
+  X( MISC,        "misc"        )       \
+  X( CMN,         "cmn"         )       \
+  X( BSP_SCREEN,  "bsp_screen"  )       \
+  X( BSP_GYRO,    "bsp_gyro"    )       \
+  X( BSP_BATTERY, "bsp_battery" )       \
+  X( BSP_UART,    "bsp_uart"    )       \
+  X( APP_CLOCK,   "app_clock"   )       \
+  X( APP_CMDBOX,  "app_cmdbox"  )       \
+  X( APP_LVGL,    "app_lvgl"    )       \
+  X( APP_RTOS,    "app_rtos"    )
+
+#define TRACE_MODULE_ENUM( tag, name)   kTraceModule_##tag,
+typedef enum{
+  TRACE_MODULE_LIST( TRACE_MODULE_ENUM)
+  kNumTraceModule
+} TraceModuleEnum_t;
+#undef TRACE_MODULE_ENUM
+
+#ifndef TRACE_COMPILE_LEVEL
+  #if !defined(LOG_LEVEL)
+    #define TRACE_COMPILE_LEVEL   TRACE_LEVEL_OFF
+  #elif (LOG_LEVEL==2)
+    #define TRACE_COMPILE_LEVEL   TRACE_LEVEL_DEBUG
+  #elif (LOG_LEVEL==1)
+    #define TRACE_COMPILE_LEVEL   TRACE_LEVEL_INFO
+  #else
+    #define TRACE_COMPILE_LEVEL   TRACE_LEVEL_WARNING
+  #endif
+#endif
+
+#ifndef TRACE_COMPILE_LEVEL_MISC
+  #define TRACE_COMPILE_LEVEL_MISC          TRACE_COMPILE_LEVEL
+#endif
+#ifndef TRACE_COMPILE_LEVEL_CMN
+  #define TRACE_COMPILE_LEVEL_CMN           TRACE_COMPILE_LEVEL
+#endif
+#ifndef TRACE_COMPILE_LEVEL_BSP_SCREEN
+  #define TRACE_COMPILE_LEVEL_BSP_SCREEN    TRACE_COMPILE_LEVEL
+#endif
+#ifndef TRACE_COMPILE_LEVEL_BSP_GYRO
+  #define TRACE_COMPILE_LEVEL_BSP_GYRO      TRACE_COMPILE_LEVEL
+#endif
+#ifndef TRACE_COMPILE_LEVEL_BSP_BATTERY
+  #define TRACE_COMPILE_LEVEL_BSP_BATTERY   TRACE_COMPILE_LEVEL
+#endif
+#ifndef TRACE_COMPILE_LEVEL_BSP_UART
+  #define TRACE_COMPILE_LEVEL_BSP_UART      TRACE_COMPILE_LEVEL
+#endif
+#ifndef TRACE_COMPILE_LEVEL_APP_CLOCK
+  #define TRACE_COMPILE_LEVEL_APP_CLOCK     TRACE_COMPILE_LEVEL
+#endif
+#ifndef TRACE_COMPILE_LEVEL_APP_CMDBOX
+  #define TRACE_COMPILE_LEVEL_APP_CMDBOX    TRACE_COMPILE_LEVEL
+#endif
+#ifndef TRACE_COMPILE_LEVEL_APP_LVGL
+  #define TRACE_COMPILE_LEVEL_APP_LVGL      TRACE_COMPILE_LEVEL
+#endif
+#ifndef TRACE_COMPILE_LEVEL_APP_RTOS
+  #define TRACE_COMPILE_LEVEL_APP_RTOS      TRACE_COMPILE_LEVEL
+#endif
+
+#ifndef TRACE_MODULE
+  #define TRACE_MODULE  MISC
+#endif
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+extern volatile uint8_t trace_module_level[kNumTraceModule];
+
+int         trace_level_set( uint32_t module, uint32_t level);
+const char *trace_module_name( uint32_t module);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @note `TRACE_KEEP( compile, level)` is 1 if `level<=compile`. Both are digits.
+ */
+#define TRACE_MASK_0                  0, 0, 0, 0
+#define TRACE_MASK_1                  1, 0, 0, 0
+#define TRACE_MASK_2                  1, 1, 0, 0
+#define TRACE_MASK_3                  1, 1, 1, 0
+#define TRACE_MASK_4                  1, 1, 1, 1
+#define TRACE_PICK_1( e, w, i, d)     e
+#define TRACE_PICK_2( e, w, i, d)     w
+#define TRACE_PICK_3( e, w, i, d)     i
+#define TRACE_PICK_4( e, w, i, d)     d
+#define TRACE_IF_0( ...)
+#define TRACE_IF_1( ...)              __VA_ARGS__
+#define TRACE_PASTE_( a, b)           a##b
+#define TRACE_PASTE( a, b)            TRACE_PASTE_( a, b)
+#define TRACE_APPLY( f, ...)          f( __VA_ARGS__)
+#define TRACE_KEEP( compile, level)   TRACE_APPLY( TRACE_PASTE( TRACE_PICK_, level), TRACE_PASTE( TRACE_MASK_, compile))
+
+#define TRACE_LOG_( tag, level, prefix, fmt, ...)                                           \
+  TRACE_PASTE( TRACE_IF_, TRACE_KEEP( TRACE_COMPILE_LEVEL_##tag, level))(                   \
+    do{                                                                                     \
+      if( trace_module_level[kTraceModule_##tag] >= (level) ){                              \
+        TRACE_LEVEL_PRINTF( prefix, fmt, ##__VA_ARGS__);                                    \
+      }                                                                                     \
+    }while(0)                                                                               \
+  )
+
+/**
+ * @brief Log of an explicit module. `TRACE_ERROR()` and the others use `TRACE_MODULE`.
+ */
+#define TRACE_LOG( tag, level, prefix, fmt, ...)  TRACE_LOG_( tag, level, prefix, fmt, ##__VA_ARGS__)
+
+#define TRACE_DEBUG( fmt, ...)    TRACE_LOG( TRACE_MODULE, TRACE_LEVEL_DEBUG,   FMT_DEBUG_STR, fmt FMT_RESET, ##__VA_ARGS__)
+#define TRACE_INFO( fmt, ...)     TRACE_LOG( TRACE_MODULE, TRACE_LEVEL_INFO,    FMT_INFO_STR,  fmt,           ##__VA_ARGS__)
+#define TRACE_WARNING( fmt, ...)  TRACE_LOG( TRACE_MODULE, TRACE_LEVEL_WARNING, FMT_WARN_STR,  fmt FMT_RESET, ##__VA_ARGS__)
+#define TRACE_ERROR( fmt, ...)    TRACE_LOG( TRACE_MODULE, TRACE_LEVEL_ERROR,   FMT_ERROR_STR, fmt FMT_RESET, ##__VA_ARGS__)
 
 
 static inline int trace_dummy_printf( const char *fmt, ...){
@@ -0,0 +1,382 @@
+/**
+ ******************************************************************************
+ * @file    trace.hh
+ * @author  RandleH
+ * @brief   Project trace message - Compile-time format string checking
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2024 RandleH.
+ * All rights reserved.
+ *
+ * This software component is licensed by RandleH under BSD 3-Clause license,
+ * the "License"; You may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at:
+ *                        opensource.org/licenses/BSD-3-Clause
+ *
+ ******************************************************************************
+*/
+
+#ifndef TRACE_HH
+#define TRACE_HH
+
+/**
+ * @note
+ *  The grammar is exactly what `cmn_utility_vsnprintf()` understands:
+ *    `%[0...][1-9](u|d|x|c|s)`
+ *  A format string is validated against the argument types when it is compiled and lowered
+ *  into a sequence of `trace::Op`, which is placed in the read-only section.
+ *  At runtime the ops are interpreted by `trace::run()` without touching the format string
+ *  except for copying literal runs. The output is byte identical to `cmn_utility_vsnprintf()`.
+ *
+ * @example
+ *  char buf[32];
+ *  TRACE_FMT_SNPRINTF( buf, sizeof(buf), "%02d:%02d", hour, minute);
+ */
+
+/* ************************************************************************** */
+/*                                  Includes                                  */
+/* ************************************************************************** */
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include "trace.h"
+
+
+namespace trace{
+
+/* ************************************************************************** */
+/*                                Public Types                                */
+/* ************************************************************************** */
+enum class OpCode : uint8_t{
+  kLiteral  = 0,   /*!< Copy `len` characters of the format string starting at `offset` */
+  kUnsigned,       /*!< `%u` */
+  kSigned,         /*!< `%d` */
+  kHex,            /*!< `%x` */
+  kChar,           /*!< `%c` */
+  kString          /*!< `%s` */
+};
+
+typedef struct stOp{
+  OpCode   code;
+  uint8_t  width;  /*!< `0xFF` means the natural width */
+  uint16_t offset;
+  uint16_t len;
+} Op;
+
+typedef union unArg{
+  uint32_t    u;
+  const char *s;
+} Arg;
+
+typedef struct stCall{
+  const Op   *op;
+  size_t      num_op;
+  const char *fmt;
+  const Arg  *argv;
+} Call;
+
+enum class FmtError : uint8_t{
+  kNone = 0,
+  kDanglingPercent,
+  kBadSpecifier,
+  kBadWidth,
+  kWidthIgnored,
+  kTooLong
+};
+
+enum class ArgKind : uint8_t{
+  kInteger = 0,
+  kWideInteger,
+  kString,
+  kOther
+};
+
+typedef struct stFmtInfo{
+  size_t   num_op;
+  size_t   num_arg;
+  FmtError err;
+} FmtInfo;
+
+template<size_t N>
+struct Program{
+  Op op[N==0 ? 1 : N];
+};
+
+
+/* ************************************************************************** */
+/*                             Compile-time Parser                            */
+/* ************************************************************************** */
+/**
+ * @brief Walk through the format string and emit one op per literal run or conversion
+ * @param [in] fmt  - Format string
+ * @param [in] emit - Callback receiving each `Op`
+ * @return `FmtError::kNone` if the format string is valid
+ */
+template<class F>
+constexpr FmtError walk( const char *fmt, F &&emit){
+  size_t i = 0;
+  while(fmt[i]){
+    if(fmt[i]!='%'){
+      size_t start = i;
+      while(fmt[i] && fmt[i]!='%'){
+        ++i;
+      }
+      if(i > UINT16_MAX){
+        return FmtError::kTooLong;
+      }
+      emit(Op{ OpCode::kLiteral, 0xFF, (uint16_t)start, (uint16_t)(i-start)});
+      continue;
+    }
+    ++i;
+
+    uint8_t width = 0xFF;
+    while(fmt[i]=='0'){
+      ++i;
+    }
+    if(fmt[i]>='1' && fmt[i]<='9'){
+      width = fmt[i++] - '0';
+      if(fmt[i]>='0' && fmt[i]<='9'){
+        return FmtError::kBadWidth;
+      }
+    }
+
+    OpCode code = OpCode::kLiteral;
+    switch(fmt[i]){
+      case 'u': case 'U': code = OpCode::kUnsigned; break;
+      case 'd': case 'D': code = OpCode::kSigned;   break;
+      case 'x': case 'X': code = OpCode::kHex;      break;
+      case 'c': case 'C': code = OpCode::kChar;     break;
+      case 's': case 'S': code = OpCode::kString;   break;
+      case '\0':          return FmtError::kDanglingPercent;
+      default:            return FmtError::kBadSpecifier;
+    }
+    if((code==OpCode::kChar || code==OpCode::kString) && width!=0xFF){
+      return FmtError::kWidthIgnored;
+    }
+    emit(Op{ code, width, 0, 0});
+    ++i;
+  }
+  return FmtError::kNone;
+}
+
+constexpr FmtInfo scan( const char *fmt){
+  FmtInfo info = { 0, 0, FmtError::kNone};
+  info.err = walk( fmt, [&](const Op &op){
+    ++info.num_op;
+    info.num_arg += (op.code!=OpCode::kLiteral);
+  });
+  return info;
+}
+
+template<size_t N>
+constexpr Program<N> lower( const char *fmt){
+  Program<N> prog{};
+  size_t     idx = 0;
+  walk( fmt, [&](const Op &op){
+    prog.op[idx++] = op;
+  });
+  return prog;
+}
+
+template<class T>
+constexpr ArgKind kind_of(void){
+  using U = std::decay_t<T>;
+  if constexpr (std::is_integral_v<U> || std::is_enum_v<U>){
+    return (sizeof(U) <= sizeof(uint32_t)) ? ArgKind::kInteger : ArgKind::kWideInteger;
+  }else if constexpr (std::is_pointer_v<U> && std::is_same_v<std::remove_cv_t<std::remove_pointer_t<U>>, char>){
+    return ArgKind::kString;
+  }else{
+    return ArgKind::kOther;
+  }
+}
+
+/**
+ * @brief Index of the first argument whose type does NOT match its conversion
+ * @return `num_arg` if every argument matches
+ */
+template<size_t N, class... Args>
+constexpr size_t first_bad_arg( const Program<N> &prog, size_t num_op){
+  constexpr ArgKind kinds[] = { kind_of<Args>()..., ArgKind::kOther};
+  size_t arg = 0;
+  for(size_t i=0; i<num_op; ++i){
+    const OpCode code = prog.op[i].code;
+    if(code==OpCode::kLiteral){
+      continue;
+    }
+    const ArgKind expected = (code==OpCode::kString) ? ArgKind::kString : ArgKind::kInteger;
+    if(kinds[arg]!=expected){
+      return arg;
+    }
+    ++arg;
+  }
+  return arg;
+}
+
+template<class T>
+inline Arg pack( T value){
+  Arg arg{};
+  if constexpr (kind_of<T>()==ArgKind::kInteger){
+    arg.u = static_cast<uint32_t>(value);
+  }else if constexpr (kind_of<T>()==ArgKind::kString){
+    arg.s = value;
+  }
+  return arg;
+}
+
+
+/* ************************************************************************** */
+/*                               Runtime Engine                               */
+/* ************************************************************************** */
+/**
+ * @brief Interpret a lowered format string
+ * @param [in]  call - Ops, format string and packed arguments
+ * @param [out] buf  - String buffer
+ * @param [in]  size - The maximum length of this string buffer including the terminator
+ * @return Same as `cmn_utility_vsnprintf()`. Number of characters including the terminator.
+ */
+int run( const Call &call, char *buf, size_t size);
+
+/**
+ * @brief Same as `trace::run()`, in the shape of a C formatter callback
+ * @param [in] ctx - Pointer to `trace::Call`
+ */
+int run_call( char *buf, size_t size, const void *ctx);
+
+/**
+ * @brief Validate, lower and pack. Then hand the call over to the sink.
+ * @note  Every diagnostic below is reported at compile time.
+ */
+template<class Sink, class FmtFn, class... Args>
+inline int invoke( Sink &&sink, FmtFn fmt_fn, Args... args){
+  constexpr const char *fmt  = fmt_fn();
+  constexpr FmtInfo     info = scan(fmt);
+
+  static_assert( info.err!=FmtError::kDanglingPercent, "TRACE: format string ends with a dangling '%'");
+  static_assert( info.err!=FmtError::kBadSpecifier,    "TRACE: unsupported conversion specifier. Only %u %d %x %c %s are supported");
+  static_assert( info.err!=FmtError::kBadWidth,        "TRACE: width must be a single digit 1-9");
+  static_assert( info.err!=FmtError::kWidthIgnored,    "TRACE: width is not supported by %c and %s");
+  static_assert( info.err!=FmtError::kTooLong,         "TRACE: format string is too long");
+
+  if constexpr (info.err==FmtError::kNone){
+    static_assert( info.num_arg <= sizeof...(Args), "TRACE: too few arguments for the format string");
+    static_assert( info.num_arg >= sizeof...(Args), "TRACE: too many arguments for the format string");
+
+    static constexpr Program<info.num_op> prog = lower<info.num_op>(fmt);
+    constexpr ArgKind kinds[] = { kind_of<Args>()..., ArgKind::kOther};
+    constexpr size_t  bad     = first_bad_arg<info.num_op, Args...>( prog, info.num_op);
+
+    if constexpr (info.num_arg==sizeof...(Args) && bad < sizeof...(Args)){
+      static_assert( kinds[bad]!=ArgKind::kWideInteger, "TRACE: %u %d %x %c take an integer of at most 32 bits");
+      static_assert( kinds[bad]!=ArgKind::kString,      "TRACE: %u %d %x %c take an integer, not a string");
+      static_assert( kinds[bad]!=ArgKind::kInteger,     "TRACE: %s takes a C string, not an integer");
+      static_assert( kinds[bad]!=ArgKind::kOther,       "TRACE: argument type is not printable");
+      return 0;
+    }else{
+      const Arg  argv[] = { pack(args)..., Arg{}};
+      const Call call   = { prog.op, info.num_op, fmt, argv};
+      return sink(call);
+    }
+  }else{
+    return 0;
+  }
+}
+
+/**
+ * @brief Checked replacement of `cmn_utility_snprintf()`
+ */
+template<class FmtFn, class... Args>
+inline int snprintf( char *buf, size_t size, FmtFn fmt_fn, Args... args){
+  return invoke( [&](const Call &call){ return run( call, buf, size); }, fmt_fn, args...);
+}
+
+/* ************************************************************************** */
+/*                             Deferred Binary Log                            */
+/* ************************************************************************** */
+/**
+ * @brief Bit `i` is set if the `i`th argument is a string
+ */
+template<class... Args>
+constexpr uint32_t str_mask(void){
+  constexpr ArgKind kinds[] = { kind_of<Args>()..., ArgKind::kOther};
+  uint32_t mask = 0;
+  for(size_t i=0; i<sizeof...(Args); ++i){
+    mask |= (uint32_t)(kinds[i]==ArgKind::kString) << i;
+  }
+  return mask;
+}
+
+/**
+ * @brief Encode one record into the deferred log ring
+ * @param [in] fmt      - Format string literal
+ * @param [in] str_mask - Bit `i` is set if `argv[i]` is a string
+ * @return Number of bytes queued. 0 if the ring is full and the record was dropped.
+ */
+int defer_push( const char *fmt, uint32_t str_mask, const Arg *argv, size_t num_arg);
+
+/**
+ * @brief Checked deferred log. The address of the format string literal is its id.
+ */
+template<class FmtFn, class... Args>
+inline int defer_printf( FmtFn fmt_fn, Args... args){
+  static_assert( sizeof...(Args) <= TRACE_DEFER_ARG_MAX, "TRACE: too many arguments for the deferred log");
+  return invoke( [](const Call &call){ return defer_push( call.fmt, str_mask<Args...>(), call.argv, sizeof...(Args)); }, fmt_fn, args...);
+}
+
+/**
+ * @brief Encode one record into the crash ring. The oldest records are overwritten.
+ * @return Number of bytes copied. 0 if the ring is NOT armed.
+ */
+int crash_push( const char *fmt, uint32_t str_mask, const Arg *argv, size_t num_arg);
+
+/**
+ * @brief Checked crash record. Same encoding as `defer_printf()`.
+ */
+template<class FmtFn, class... Args>
+inline int crash_printf( FmtFn fmt_fn, Args... args){
+  static_assert( sizeof...(Args) <= TRACE_DEFER_ARG_MAX, "TRACE: too many arguments for the deferred log");
+  return invoke( [](const Call &call){ return crash_push( call.fmt, str_mask<Args...>(), call.argv, sizeof...(Args)); }, fmt_fn, args...);
+}
+
+/**
+ * @brief Mirror one leveled call into the crash ring, then print it
+ */
+int level_push( const Call &call, uint32_t str_mask, size_t num_arg);
+
+/**
+ * @brief Checked leveled log. The arguments are evaluated once for both sinks.
+ */
+template<class FmtFn, class... Args>
+inline int level_printf( FmtFn fmt_fn, Args... args){
+  static_assert( sizeof...(Args) <= TRACE_DEFER_ARG_MAX, "TRACE: too many arguments for the deferred log");
+  return invoke( [](const Call &call){ return level_push( call, str_mask<Args...>(), sizeof...(Args)); }, fmt_fn, args...);
+}
+
+#if (defined SYS_TARGET_STM32F411CEU6) || (defined SYS_TARGET_STM32F405RGT6)
+/**
+ * @brief Checked replacement of `bsp_uart_printf()`
+ * @note  Declared by `bsp_uart.h`, which `trace.h` includes on target
+ */
+template<class FmtFn, class... Args>
+inline int uart_printf( FmtFn fmt_fn, Args... args){
+  return invoke( [](const Call &call){ return bsp_uart_print_with( run_call, &call); }, fmt_fn, args...);
+}
+#endif
+
+} /* Namespace trace */
+
+
+/**
+ * @note
+ *  The format string MUST be a string literal. It is wrapped into a lambda so it stays
+ *  a constant expression inside the function template.
+ */
+#define TRACE_FMT_SNPRINTF( buf, size, fmt, ...)  ::trace::snprintf( buf, size, [](){ return fmt; }, ##__VA_ARGS__)
+#define TRACE_DEFER_PRINTF( fmt, ...)             ::trace::defer_printf( [](){ return fmt; }, ##__VA_ARGS__)
+#define TRACE_CRASH_PRINTF( fmt, ...)             ::trace::crash_printf( [](){ return fmt; }, ##__VA_ARGS__)
+#define TRACE_LEVEL_LOG( fmt, ...)                ::trace::level_printf( [](){ return fmt; }, ##__VA_ARGS__)
+
+#endif // TRACE_HH
+
+
+/* ********************************** EOF *********************************** */